@@ -23,6 +23,7 @@
 #include "vtr_lidar/data_types/costmap.hpp"
 #include "vtr_lidar/data_types/point.hpp"
 #include "vtr_lidar/data_types/pointmap.hpp"
+#include "vtr_lidar/data_types/pointmap_views.hpp"
 #include "vtr_tactic/cache.hpp"
 #include "vtr_tactic/types.hpp"
 
@@ -54,6 +55,8 @@ struct LidarQueryCache : virtual public tactic::QueryCache {
 
   // localization
   tactic::Cache<const PointMap<PointWithInfo>> submap_loc;
+  /// derived views of submap_loc shared by all modules, replaced with it
+  tactic::Cache<const PointMapViews> submap_loc_views;
   tactic::Cache<const bool> submap_loc_changed;
   tactic::Cache<const tactic::EdgeTransform> T_v_m_loc;
 
@@ -27,6 +27,8 @@
 #include "vtr_common/utils/hash.hpp"  // for std::pair hash
 #include "vtr_tactic/types.hpp"
 
+#include "vtr_lidar_msgs/msg/cost_map.hpp"
+
 namespace vtr {
 namespace lidar {
 namespace costmap {
@@ -41,6 +43,23 @@ struct PixKey {
   int x, y;
 };
 
+/**
+ * \brief Exact euclidean distance from every cell center of a grid to the
+ * closest point, i.e. a feature transform with the points as continuous sites
+ * instead of occupied cells: the lower envelope of the parabolas rooted at the
+ * points is computed along every column, in O(columns * points).
+ * \param[in] points x and y of the points [m]
+ * \param[in] origin key of cell (0, 0), cell (i, j) is centered at
+ * ((origin.x + i) * dl, (origin.y + j) * dl)
+ * \param[in] dl cell size [m]
+ * \param[in] max_distance points farther than this from a column are skipped,
+ * so distances beyond max_distance are not exact (but still beyond it)
+ * \param[out] dists distance [m] of every cell, sized to the grid on input
+ */
+void closestPointDistance(std::vector<Eigen::Vector2f> points,
+                          const PixKey& origin, const float dl,
+                          const float max_distance, Eigen::MatrixXf& dists);
+
 }  // namespace costmap
 }  // namespace lidar
 }  // namespace vtr
@@ -129,6 +148,23 @@ class DenseCostMap : public BaseCostMap {
   template <typename ComputeValueOp>
   void update(const ComputeValueOp& op);
 
+  /** \brief Same as above but only for cells with center in [min, max] */
+  template <typename ComputeValueOp>
+  void update(const Eigen::Vector2f& min, const Eigen::Vector2f& max,
+              const ComputeValueOp& op);
+
+  /**
+   * \brief Computes the exact distance from every cell center to the closest
+   * point (see costmap::closestPointDistance), then calls DistanceToValueOp
+   * with the distance [m] to get a cost.
+   * \param[in] points only x and y are used
+   * \param[in] max_distance points farther than this from the cost map are
+   * ignored, the op must return the same value for all distances beyond it
+   */
+  template <typename PointCloud, typename DistanceToValueOp>
+  void updateFromDistance(const PointCloud& points, const float& max_distance,
+                          const DistanceToValueOp& op);
+
   /** \brief update from a sparse cost map */
   void update(const std::unordered_map<costmap::PixKey, float>& values);
 
@@ -155,6 +191,19 @@ class DenseCostMap : public BaseCostMap {
 
 class SparseCostMap : public BaseCostMap {
  public:
+  using Ptr = std::shared_ptr<SparseCostMap>;
+  using ConstPtr = std::shared_ptr<const SparseCostMap>;
+
+  using SparseCostMapMsg = vtr_lidar_msgs::msg::CostMap;
+  /**
+   * \brief Static function that constructs this class from ROS2 message
+   * \note only the reduced cell values are stored, so a loaded cost map
+   * should not be updated with new points
+   */
+  static Ptr fromStorable(const SparseCostMapMsg& storable);
+  /** \brief Returns the ROS2 message to be stored */
+  SparseCostMapMsg toStorable() const;
+
   /**
    * \param[in] dl resolution of the grid
    * \param[in] size_x total size of the grid in x direction [meter]
@@ -191,10 +240,20 @@ class SparseCostMap : public BaseCostMap {
   using PointCloudMsg = sensor_msgs::msg::PointCloud2;
   PointCloudMsg toPointCloudMsg() const;
 
+  /** \brief version of the point map this cost map is computed from */
+  unsigned& map_version() { return map_version_; }
+  const unsigned& map_version() const { return map_version_; }
+  /** \brief hash of the parameters this cost map is computed with */
+  size_t& params_hash() { return params_hash_; }
+  const size_t& params_hash() const { return params_hash_; }
+
  protected:
   float at(const costmap::PixKey& k) const override;
 
  private:
+  unsigned map_version_ = 0;
+  size_t params_hash_ = 0;
+
   std::unordered_map<costmap::PixKey, std::vector<float>> raw_values_;
   std::unordered_map<costmap::PixKey, float> values_;
 };
@@ -42,6 +42,38 @@ void DenseCostMap::update(const ComputeValueOp& op) {
       op({(i + origin_.x) * dl_, (j + origin_.y) * dl_}, values_(i, j));
 }
 
+template <typename ComputeValueOp>
+void DenseCostMap::update(const Eigen::Vector2f& min,
+                          const Eigen::Vector2f& max,
+                          const ComputeValueOp& op) {
+  const int i_min = std::max((int)std::ceil(min.x() / dl_) - origin_.x, 0);
+  const int i_max =
+      std::min((int)std::floor(max.x() / dl_) - origin_.x, width_ - 1);
+  const int j_min = std::max((int)std::ceil(min.y() / dl_) - origin_.y, 0);
+  const int j_max =
+      std::min((int)std::floor(max.y() / dl_) - origin_.y, height_ - 1);
+  for (int i = i_min; i <= i_max; ++i)
+    for (int j = j_min; j <= j_max; ++j)
+      op({(i + origin_.x) * dl_, (j + origin_.y) * dl_}, values_(i, j));
+}
+
+template <typename PointCloud, typename DistanceToValueOp>
+void DenseCostMap::updateFromDistance(const PointCloud& points,
+                                      const float& max_distance,
+                                      const DistanceToValueOp& op) {
+  std::vector<Eigen::Vector2f> points_xy;
+  points_xy.reserve(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    points_xy.emplace_back(points[i].x, points[i].y);
+
+  Eigen::MatrixXf dists(width_, height_);
+  costmap::closestPointDistance(std::move(points_xy), origin_, dl_,
+                                max_distance, dists);
+
+  for (int i = 0; i < width_; ++i)
+    for (int j = 0; j < height_; ++j) op(dists(i, j), values_(i, j));
+}
+
 template <typename PointCloud, typename ReductionOp = SparseCostMap::AvgOp>
 void SparseCostMap::update(const PointCloud& points,
                            const std::vector<float>& values,
@@ -0,0 +1,93 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file costmap_history.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include "vtr_lidar/data_types/costmap.hpp"
+
+namespace vtr {
+namespace lidar {
+
+/**
+ * \brief Sliding window of the most recent cost maps for temporal filtering.
+ * \details Cells are indexed by integer keys in a fixed (world) frame. Each
+ * cost map in the window is a dense grid of a fixed number of cells around
+ * the robot, where a key is stored at slot (key mod width, key mod height), so
+ * moving the window with the robot only changes which keys map to a slot and
+ * never requires copying. Cost maps are kept in a ring buffer, and the number
+ * of cost maps containing each cell is maintained incrementally as cost maps
+ * enter and leave the window.
+ */
+class CostMapHistory {
+ public:
+  using Cells = std::vector<std::pair<costmap::PixKey, float>>;
+  using CellMap = std::unordered_map<costmap::PixKey, float>;
+
+  /**
+   * \param[in] history_size number of cost maps in the window
+   * \param[in] vote_threshold a cell is kept if present in at least this many
+   * cost maps
+   * \param[in] num_cells number of cells in each direction of the grid, must
+   * cover all cells of the cost maps in the window
+   */
+  CostMapHistory(const int& history_size, const int& vote_threshold,
+                 const int& num_cells);
+
+  size_t size() const { return size_; }
+  bool full() const { return size_ == layers_.size(); }
+
+  /**
+   * \brief Adds a cost map, removing the oldest one if the window is full.
+   * Duplicated cells take the max value.
+   */
+  void push(const Cells& cells);
+
+  /**
+   * \brief Returns cells present in at least vote_threshold cost maps, with
+   * the value from the newest cost map if it contains the cell, otherwise from
+   * the oldest cost map containing it.
+   */
+  CellMap filter() const;
+
+ private:
+  struct Layer {
+    /** \brief cell values of this cost map, NaN if not present */
+    std::vector<float> values;
+    /** \brief keys of cells present in this cost map */
+    std::vector<costmap::PixKey> keys;
+  };
+
+  size_t slot(const costmap::PixKey& k) const;
+  /** \brief i-th cost map in the window, 0 being the oldest */
+  const Layer& layer(const size_t& i) const;
+
+  const int vote_threshold_;
+  const int num_cells_;
+
+  /** \brief ring buffer of cost maps */
+  std::vector<Layer> layers_;
+  /** \brief index of the oldest cost map and number of cost maps */
+  size_t head_ = 0, size_ = 0;
+
+  /** \brief number of cost maps containing the key currently owning a slot */
+  std::vector<int> votes_;
+  std::vector<costmap::PixKey> owners_;
+};
+
+}  // namespace lidar
+}  // namespace vtr
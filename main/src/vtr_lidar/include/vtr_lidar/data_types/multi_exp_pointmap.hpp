@@ -44,11 +44,50 @@ class MultiExpPointMap : public PointMap<PointT> {
   std::deque<uint32_t>& exps() { return exps_; }
   const std::deque<uint32_t>& exps() const { return exps_; }
 
+  /** \brief Number of experiences added since the map was created or loaded */
+  uint32_t epoch() const { return epoch_; }
+
+  /**
+   * \brief Adds a new experience, the oldest one is dropped when there are
+   * more than max_num_exps.
+   * \details The bit vectors are aged lazily: each point stores the epoch its
+   * bit vector was last updated at (bits_epoch) and is only shifted when it
+   * is observed again, so adding an experience does not touch the points.
+   */
+  void addExperience(const uint32_t& exp);
+
+  /** \brief Bit vector of a point, bit 0 being the latest experience */
+  __uint128_t bits(const PointT& p) const;
+
+  /**
+   * \brief Marks the map points observed by a point cloud of the latest
+   * experience, i.e. closer than distance_threshold to one of its points,
+   * with point to plane distance below planar_threshold and normals agreeing
+   * (absolute cosine above normal_threshold).
+   * \details Neighbors are searched in a hash grid of the map with cells of
+   * the size of distance_threshold, the point cloud is split over threads.
+   */
+  void observe(const PointCloudType& point_cloud,
+               const float& distance_threshold, const float& planar_threshold,
+               const float& normal_threshold, const int& num_threads = 1);
+
+  /** \brief Adds the points of the latest experience in empty voxels */
+  void addPoints(const PointCloudType& point_cloud);
+
+ private:
+  /** \brief Shifts the bit vector of a point to the current epoch */
+  void age(PointT& p) const;
+
  private:
   /** \brief Maximum number of experiences */
   size_t max_num_exps_;
   /** \brief Experience Id vector */
   std::deque<uint32_t> exps_;
+  /**
+   * \brief Number of experiences added since the map was created or loaded,
+   * not stored: toStorable saves up-to-date bit vectors
+   */
+  uint32_t epoch_ = 0;
 };
 
 }  // namespace lidar
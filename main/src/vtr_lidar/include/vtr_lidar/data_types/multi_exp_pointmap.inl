@@ -55,6 +55,8 @@ auto MultiExpPointMap<PointT>::fromStorable(const MultiExpPointMapMsg& storable)
   }
   // build the experience queue
   for (const auto& vid : storable.experiences) data->exps_.emplace_back(vid);
+  // stored bit vectors are up to date, the map starts at epoch 0
+  for (auto& p : data->point_cloud_) p.bits_epoch = 0;
 
   return data;
 }
@@ -62,8 +64,14 @@ auto MultiExpPointMap<PointT>::fromStorable(const MultiExpPointMapMsg& storable)
 template <class PointT>
 auto MultiExpPointMap<PointT>::toStorable() const -> MultiExpPointMapMsg {
   MultiExpPointMapMsg storable;
-  // save point cloud data
-  pcl::toROSMsg(this->point_cloud_, storable.point_cloud);
+  // save point cloud data with up-to-date bit vectors, so that the message
+  // does not depend on the epoch
+  auto point_cloud = this->point_cloud_;
+  for (auto& p : point_cloud) {
+    p.bits = bits(p);
+    p.bits_epoch = 0;
+  }
+  pcl::toROSMsg(point_cloud, storable.point_cloud);
   // save vertex id
   storable.vertex_id = this->vertex_id_;
   // save transform
@@ -94,6 +102,127 @@ MultiExpPointMap<PointT>::MultiExpPointMap(const float& dl,
   }
 }
 
+template <class PointT>
+void MultiExpPointMap<PointT>::addExperience(const uint32_t& exp) {
+  exps_.push_back(exp);
+  if (exps_.size() > max_num_exps_) exps_.pop_front();
+  ++epoch_;
+}
+
+template <class PointT>
+__uint128_t MultiExpPointMap<PointT>::bits(const PointT& p) const {
+  const uint32_t age = epoch_ - p.bits_epoch;
+  return age < 8 * sizeof(p.bits) ? p.bits << age : 0;
+}
+
+template <class PointT>
+void MultiExpPointMap<PointT>::age(PointT& p) const {
+  p.bits = bits(p);
+  p.bits_epoch = epoch_;
+}
+
+template <class PointT>
+void MultiExpPointMap<PointT>::observe(const PointCloudType& point_cloud,
+                                       const float& distance_threshold,
+                                       const float& planar_threshold,
+                                       const float& normal_threshold,
+                                       const int& num_threads) {
+  auto& map_points = this->point_cloud_;
+  if (map_points.empty() || point_cloud.empty()) return;
+
+  // group the map points by cells, slightly larger than the search radius so
+  // that rounding cannot put a neighbor two cells away
+  const float cell_size = distance_threshold * 1.001f;
+  const auto getCellKey = [&cell_size](const PointT& p) {
+    return pointmap::VoxKey((int)std::floor(p.x / cell_size),
+                            (int)std::floor(p.y / cell_size),
+                            (int)std::floor(p.z / cell_size));
+  };
+  // [begin, end) of the cell in cell_indices
+  std::unordered_map<pointmap::VoxKey, std::pair<size_t, size_t>> cells;
+  for (const auto& p : map_points) cells[getCellKey(p)].second++;
+  size_t begin = 0;
+  for (auto& cell : cells) {
+    const auto size = cell.second.second;
+    cell.second.first = cell.second.second = begin;
+    begin += size;
+  }
+  std::vector<size_t> cell_indices(map_points.size());
+  for (size_t i = 0; i < map_points.size(); ++i)
+    cell_indices[cells[getCellKey(map_points[i])].second++] = i;
+
+  // flag the observed points, the search skips the ones already flagged
+  const float sq_radius = distance_threshold * distance_threshold;
+  std::vector<uint8_t> observed(map_points.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(num_threads)
+  for (int i = 0; i < (int)point_cloud.size(); ++i) {
+    const auto& pt = point_cloud[i];
+    const auto k = getCellKey(pt);
+    for (int dx = -1; dx <= 1; ++dx)
+      for (int dy = -1; dy <= 1; ++dy)
+        for (int dz = -1; dz <= 1; ++dz) {
+          const auto cell = cells.find(k + pointmap::VoxKey(dx, dy, dz));
+          if (cell == cells.end()) continue;
+          for (auto j = cell->second.first; j < cell->second.second; ++j) {
+            const auto idx = cell_indices[j];
+            uint8_t flag;
+#pragma omp atomic read
+            flag = observed[idx];
+            if (flag) continue;
+            const auto& pt2 = map_points[idx];
+            if (bits(pt2) & 1) continue;
+
+            // squared distance as computed by the kd-tree
+            float sq_dist = 0;
+            for (int d = 0; d < 3; ++d) {
+              const float diff = pt.data[d] - pt2.data[d];
+              sq_dist += diff * diff;
+            }
+            if (sq_dist >= sq_radius) continue;
+
+            // check point to plane distance
+            const auto diff = pt.getVector3fMap() - pt2.getVector3fMap();
+            const auto planar_dist =
+                std::abs(pt2.getNormalVector3fMap().dot(diff));
+            if (planar_dist > planar_threshold) continue;
+
+            // check normal consistency
+            const auto normal_dist = std::abs(
+                pt2.getNormalVector3fMap().dot(pt.getNormalVector3fMap()));
+            if (normal_dist < normal_threshold) continue;
+
+#pragma omp atomic write
+            observed[idx] = 1;
+          }
+        }
+  }
+
+  // update the observed points
+  for (size_t i = 0; i < map_points.size(); ++i) {
+    if (!observed[i]) continue;
+    auto& p = map_points[i];
+    age(p);
+    p.bits++;
+    p.multi_exp_obs += 1.0;
+  }
+}
+
+template <class PointT>
+void MultiExpPointMap<PointT>::addPoints(const PointCloudType& point_cloud) {
+  // grow geometrically, the map is reallocated (copied) only occasionally
+  auto& map_points = this->point_cloud_;
+  if (map_points.size() + point_cloud.size() > map_points.points.capacity())
+    map_points.reserve(std::max(map_points.size() + point_cloud.size(),
+                                2 * map_points.points.capacity()));
+  this->update(point_cloud, [this](bool success, PointT& curr_pt,
+                                   const PointT& /* new_pt */) {
+    if (!success) return;
+    curr_pt.bits = 1;
+    curr_pt.bits_epoch = epoch_;
+    curr_pt.multi_exp_obs = 1.0;
+  });
+}
+
 #if false
 template <class PointT>
 void MultiExpPointMap<PointT>::update(const PointMap<PointT>& point_map) {
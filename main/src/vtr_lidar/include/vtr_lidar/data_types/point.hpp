@@ -90,7 +90,7 @@ namespace lidar {
     }; \
     struct { \
       float multi_exp_obs; \
-      float unused1; \
+      uint32_t bits_epoch; \
       float unused2; \
       float unused3; \
     }; \
@@ -0,0 +1,73 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file pointmap_views.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "vtr_common/utils/macros.hpp"
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/data_types/pointmap.hpp"
+#include "vtr_lidar/utils/nanoflann_utils.hpp"
+
+namespace vtr {
+namespace lidar {
+
+/**
+ * \brief Derived views of a point map, computed lazily on first access.
+ * \details Each view is computed at most once, then it never changes, so a
+ * single instance can be shared by all modules working on the same submap,
+ * including the ones running asynchronously.
+ */
+class PointMapViews {
+ public:
+  PTR_TYPEDEFS(PointMapViews);
+
+  using PointMapType = PointMap<PointWithInfo>;
+  using PointCloudType = pcl::PointCloud<PointWithInfo>;
+
+  PointMapViews(const std::shared_ptr<const PointMapType> &point_map);
+
+  const PointMapType &pointMap() const { return *point_map_; }
+  const std::shared_ptr<const PointMapType> &pointMapPtr() const {
+    return point_map_;
+  }
+
+  /**
+   * \brief Points and normals of the map in the frame of its vertex, i.e.
+   * transformed by T_vertex_this.
+   */
+  const PointCloudType &vertexFramePointCloud() const;
+
+  /** \brief KD-tree over the points of the map, in the map frame */
+  const KDTree<PointWithInfo> &kdtree() const;
+
+ private:
+  const std::shared_ptr<const PointMapType> point_map_;
+
+  mutable std::once_flag vertex_frame_flag_;
+  mutable PointCloudType vertex_frame_point_cloud_;
+
+  mutable std::once_flag kdtree_flag_;
+  mutable std::unique_ptr<NanoFLANNAdapter<PointWithInfo>> adapter_;
+  mutable std::unique_ptr<KDTree<PointWithInfo>> kdtree_;
+};
+
+}  // namespace lidar
+}  // namespace vtr
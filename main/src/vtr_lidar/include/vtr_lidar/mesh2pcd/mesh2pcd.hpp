@@ -25,8 +25,6 @@
 #include <pcl/point_cloud.h>
 #include <Eigen/Core>
 
-#include "vtr_common/utils/hash.hpp"
-
 namespace vtr {
 namespace lidar {
 namespace mesh2pcd {
@@ -73,6 +71,8 @@ inline Eigen::Vector3f pol2cart(const Eigen::Vector3f& pol) {
 
 /**
  * \brief Converts a mesh to a point cloud using ray-tracing.
+ * \details Faces are rasterized into a spherical depth image with one pixel
+ * per (theta, phi) ray, split into bands of theta rows processed in parallel.
  * \note Does not support over-head and under-head objects.
  */
 class Mesh2PcdConverter {
@@ -90,6 +90,11 @@ class Mesh2PcdConverter {
     // range
     double range_min = 0.0;
     double range_max = 200.0;
+    // skip faces whose normal points away from the sensor, only valid for
+    // closed meshes with outward normals
+    bool cull_back_faces = false;
+    // number of threads rasterizing the depth image
+    int num_threads = 1;
   };
 
   Mesh2PcdConverter(const std::string& filename, const Config& config);
@@ -107,11 +112,16 @@ class Mesh2PcdConverter {
     }
     int x, y;
   };
-  friend class std::hash<Key>;
   Key getKey(const float& theta, const float& phi) const {
     return Key((int)std::round(theta / config_.theta_res),
                (int)std::round(phi / config_.phi_res));
   }
+  /** \brief Index of the ray (theta, phi) in the depth image, -1 if outside */
+  int getPixel(const Key& k) const {
+    const int row = k.x - theta_offset_, col = k.y - phi_offset_;
+    if (row < 0 || row >= num_rows_ || col < 0 || col >= num_cols_) return -1;
+    return row * num_cols_ + col;
+  }
 
   struct CandidateRays {
     std::vector<int> thetas;
@@ -123,6 +133,12 @@ class Mesh2PcdConverter {
  private:
   Config config_;
 
+  /** \brief Depth image layout, ray (theta_offset_, phi_offset_) is pixel 0 */
+  int theta_offset_ = 0, phi_offset_ = 0;
+  int num_rows_ = 0, num_cols_ = 0;
+  /** \brief Unit direction of the ray of each pixel */
+  std::vector<Eigen::Vector3f> rays_;
+
   std::vector<Eigen::Vector4f> vertices_;
   std::vector<Eigen::Vector4f> normals_;
   std::vector<std::array<int, 4>> faces_;
@@ -132,19 +148,4 @@ class Mesh2PcdConverter {
 }  // namespace lidar
 }  // namespace vtr
 
-// Specialization of std:hash function
-namespace std {
-
-template <>
-struct hash<vtr::lidar::mesh2pcd::Mesh2PcdConverter::Key> {
-  std::size_t operator()(
-      const vtr::lidar::mesh2pcd::Mesh2PcdConverter::Key& k) const {
-    std::size_t ret = 0;
-    vtr::common::hash_combine(ret, k.x, k.y);
-    return ret;
-  }
-};
-
-}  // namespace std
-
 #include "vtr_lidar/mesh2pcd/mesh2pcd.inl"
\ No newline at end of file
@@ -18,6 +18,8 @@
  */
 #pragma once
 
+#include <algorithm>
+
 #include "vtr_lidar/mesh2pcd/mesh2pcd.hpp"
 
 namespace vtr {
@@ -46,83 +48,142 @@ void Mesh2PcdConverter::addToPcd(pcl::PointCloud<PointT>& pcd,
   for (auto& v : vertices_org)
     vertices_polar.emplace_back(utils::cart2pol(v).tail<2>());
 
-  // construct frustum grid from existing points (assuming from a lidar scan)
-  std::unordered_map<Key, std::pair<float, std::vector<size_t>>> key2depthidx;
+  // construct depth image from existing points (assuming from a lidar scan),
+  // points outside of the image cannot be hit by any ray
+  const int num_pixels = num_rows_ * num_cols_;
+  std::vector<float> depth(num_pixels, 0.0);
+  std::vector<char> has_points(num_pixels, 0);
+  std::vector<int> point_pixels(pcd.size(), -1);
   for (size_t i = 0; i < pcd.size(); ++i) {
     const auto& pt = pcd.at(i);
     const auto pt_polar = utils::cart2pol(pt.getVector3fMap());
     const auto& rho = pt_polar(0);
     const auto& theta = pt_polar(1);
     const auto& phi = pt_polar(2);
-    const auto key = getKey(theta, phi);
-    auto res = key2depthidx.try_emplace(key, rho, std::vector<size_t>{i});
-    if (!res.second) {
-      auto& depthidx = res.first->second;
-      auto& depth = depthidx.first;
-      auto& idxs = depthidx.second;
-      idxs.emplace_back(i);          // need to record all points in this grid
-      if (rho < depth) depth = rho;  // update depth to closest point
+    const auto pixel = getPixel(getKey(theta, phi));
+    if (pixel >= 0) {
+      if (!has_points[pixel]) {
+        has_points[pixel] = 1;
+        depth[pixel] = rho;
+      } else if (rho < depth[pixel]) {
+        depth[pixel] = rho;  // update depth to closest point
+      }
+      point_pixels[i] = pixel;  // need to record all points in this pixel
     }
     // distinguish real and fake points
     if (clear) pcd.at(i).flex24 = 0.0;
   }
 
-  // for each face
-  for (size_t ind = 0; ind < faces_.size(); ++ind) {
+  // candidate rays of each face, empty if the face is culled
+  std::vector<CandidateRays> face_rays(faces_.size());
+#pragma omp parallel for schedule(dynamic, 64) num_threads(config_.num_threads)
+  for (int ind = 0; ind < (int)faces_.size(); ++ind) {
     const auto& f = faces_.at(ind);
-    // vertices and normal
     const auto& p1 = vertices_org.at(f[0]);
-    const auto& p2 = vertices_org.at(f[1]);
-    const auto& p3 = vertices_org.at(f[2]);
     const auto& n = normals_org.at(f[3]);
+    if (config_.cull_back_faces && n.dot(p1) > 0) continue;
+    // all points of the face are beyond the distance to its plane, with a
+    // margin for rounding errors
+    const float plane_dist = std::abs(p1.dot(n)) / n.norm();
+    if (plane_dist > config_.range_max * (1 + 1e-4)) continue;
+    face_rays[ind] = getCandidateRays(ind, vertices_polar);
+  }
+
+  // faces of each band of theta rows, in face order
+  const int num_bands = std::min(num_rows_, 8 * config_.num_threads);
+  const int band_rows =
+      num_bands > 0 ? (num_rows_ + num_bands - 1) / num_bands : 1;
+  std::vector<std::vector<int>> band_faces(num_bands);
+  for (int ind = 0; ind < (int)faces_.size(); ++ind) {
+    const auto& thetas = face_rays[ind].thetas;
+    if (thetas.empty() || face_rays[ind].phis.empty()) continue;
+    const int row_lb = std::max(thetas.front() - theta_offset_, 0);
+    const int row_ub = std::min(thetas.back() - theta_offset_, num_rows_ - 1);
+    if (row_lb > row_ub) continue;
+    for (int b = row_lb / band_rows; b <= row_ub / band_rows; ++b)
+      band_faces[b].emplace_back(ind);
+  }
+
+  // rasterize the faces into the depth image, every pixel belongs to exactly
+  // one band and sees the faces in order, so the closest face of a pixel is
+  // the first one reaching the minimum depth
+  std::vector<int> pixel_face(num_pixels, -1);
+  std::vector<int> pixel_first_face(num_pixels, -1);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(config_.num_threads)
+  for (int b = 0; b < num_bands; ++b) {
+    const int row_lb = b * band_rows;
+    const int row_ub = std::min(row_lb + band_rows, num_rows_);
+    for (const auto& ind : band_faces[b]) {
+      const auto& f = faces_.at(ind);
+      // vertices and normal
+      const auto& p1 = vertices_org.at(f[0]);
+      const auto& p2 = vertices_org.at(f[1]);
+      const auto& p3 = vertices_org.at(f[2]);
+      const auto& n = normals_org.at(f[3]);
+
+      const auto& rays = face_rays[ind];
+      for (const auto& i : rays.thetas) {
+        const int row = i - theta_offset_;
+        if (row < row_lb || row >= row_ub) continue;
+        for (const auto& j : rays.phis) {
+          const int col = j - phi_offset_;
+          if (col < 0 || col >= num_cols_) continue;
+          const int pixel = row * num_cols_ + col;
+
+          // get point on the triangular plane
+          const auto& l = rays_[pixel];
+          const auto q = utils::intersection(l, p1, n);
+
+          // check if the point is in the triangle
+          if (!utils::inside(q, p1, p2, p3, n)) continue;
+
+          // get the distance to the query point
+          const auto rho = q.norm();
+          if (rho < config_.range_min || rho > config_.range_max) continue;
 
-    // bounding box
-    const auto rays = getCandidateRays(ind, vertices_polar);
-    for (const auto& i : rays.thetas) {
-      for (const auto& j : rays.phis) {
-        const auto theta = i * config_.theta_res;
-        const auto phi = j * config_.phi_res;
-
-        // get point on the triangular plane
-        const auto l = utils::pol2cart(Eigen::Vector3f(1.0, theta, phi));
-        const auto q = utils::intersection(l, p1, n);
-
-        // check if the point is in the triangle
-        if (!utils::inside(q, p1, p2, p3, n)) continue;
-
-        // get the distance to the query point
-        const auto rho = q.norm();
-        if (rho < config_.range_min || rho > config_.range_max) continue;
-
-        // insert into the grid
-        Key k{i, j};  // theta, phi
-        auto res =
-            key2depthidx.try_emplace(k, rho, std::vector<size_t>{pcd.size()});
-        if (res.second /* insertion is successful */) {
-          PointT pt;
-          pt.getVector3fMap() = q;
-          pt.getNormalVector3fMap() = n.dot(q) > 0 ? -n : n;
-          // distinguish real and fake points
-          pt.flex24 = 1.0;
-          pcd.push_back(pt);
-        } else {
-          auto& depthidx = res.first->second;
-          auto& depth = depthidx.first;
-          auto& idxs = depthidx.second;
-          if (rho < depth) {
-            for (const auto& idx : idxs) {
-              auto& pt = pcd.at(idx);
-              pt.getVector3fMap() = q;
-              pt.getNormalVector3fMap() = n.dot(q) > 0 ? -n : n;
-              // distinguish real and fake points
-              pt.flex24 = 1.0;
-            }
-            depth = rho;
+          // update the depth image
+          if (!has_points[pixel] && pixel_face[pixel] < 0) {
+            pixel_first_face[pixel] = ind;
+          } else if (!(rho < depth[pixel])) {
+            continue;
           }
-        }
-      }  // end for each phi
-    }    // end for each theta
-  }      // end for each face
+          depth[pixel] = rho;
+          pixel_face[pixel] = ind;
+        }  // end for each phi
+      }    // end for each theta
+    }      // end for each face
+  }        // end for each band
+
+  const auto set_point = [&](PointT& pt, const int& pixel) {
+    const auto& f = faces_.at(pixel_face[pixel]);
+    const auto& p1 = vertices_org.at(f[0]);
+    const auto& n = normals_org.at(f[3]);
+    const auto q = utils::intersection(rays_[pixel], p1, n);
+    pt.getVector3fMap() = q;
+    pt.getNormalVector3fMap() = n.dot(q) > 0 ? -n : n;
+    // distinguish real and fake points
+    pt.flex24 = 1.0;
+  };
+
+  // existing points behind the mesh are replaced by the mesh
+  for (size_t i = 0; i < point_pixels.size(); ++i) {
+    const auto& pixel = point_pixels[i];
+    if (pixel >= 0 && pixel_face[pixel] >= 0) set_point(pcd.at(i), pixel);
+  }
+
+  // new points in the order they are first hit, i.e. by face then by ray
+  std::vector<std::pair<int, int>> new_pixels;  // first face, pixel
+  for (int pixel = 0; pixel < num_pixels; ++pixel) {
+    if (!has_points[pixel] && pixel_face[pixel] >= 0)
+      new_pixels.emplace_back(pixel_first_face[pixel], pixel);
+  }
+  std::sort(new_pixels.begin(), new_pixels.end());
+  pcd.reserve(pcd.size() + new_pixels.size());
+  for (const auto& new_pixel : new_pixels) {
+    PointT pt;
+    set_point(pt, new_pixel.second);
+    pcd.push_back(pt);
+  }
 }
 
 }  // namespace mesh2pcd
@@ -25,6 +25,7 @@
 #include "nav_msgs/msg/occupancy_grid.hpp"
 
 #include "vtr_lidar/cache.hpp"
+#include "vtr_lidar/data_types/costmap_history.hpp"
 #include "vtr_tactic/modules/base_module.hpp"
 #include "vtr_tactic/task_queue.hpp"
 
@@ -57,8 +58,15 @@ class ChangeDetectionModuleV3 : public tactic::BaseModule {
     float support_variance = 0.1;
     float support_threshold = 0.0;
 
+    int num_threads = 4;
+
     // cost map
     int costmap_history_size = 10;
+    /** \brief min number of cost maps in history a cell must be changed in */
+    int costmap_vote_threshold = 3;
+    /** \brief size of the robot-centered history grid [m], must cover the
+     * cost maps and the distance traveled within the history */
+    float costmap_history_range = 50.0;
     float resolution = 1.0;
     float size_x = 20.0;
     float size_y = 20.0;
@@ -76,7 +84,11 @@ class ChangeDetectionModuleV3 : public tactic::BaseModule {
       const Config::ConstPtr &config,
       const std::shared_ptr<tactic::ModuleFactory> &module_factory = nullptr,
       const std::string &name = static_name)
-      : tactic::BaseModule{module_factory, name}, config_(config) {}
+      : tactic::BaseModule{module_factory, name},
+        config_(config),
+        costmap_history_(
+            config->costmap_history_size, config->costmap_vote_threshold,
+            (int)std::ceil(config->costmap_history_range / config->resolution)) {}
 
  private:
   void run_(tactic::QueryCache &qdata, tactic::OutputCache &output,
@@ -93,11 +105,10 @@ class ChangeDetectionModuleV3 : public tactic::BaseModule {
   rclcpp::Publisher<PointCloudMsg>::SharedPtr costpcd_pub_;
   rclcpp::Publisher<PointCloudMsg>::SharedPtr diffpcd_pub_;
 
-  VTR_REGISTER_MODULE_DEC_TYPE(ChangeDetectionModuleV3);
-
+  /** \brief temporal cost map filtering */
+  CostMapHistory costmap_history_;
 
-  // Modificatons for Temporal costmap filter
-  std::vector<std::unordered_map<std::pair<float, float>, float>> costmap_history;
+  VTR_REGISTER_MODULE_DEC_TYPE(ChangeDetectionModuleV3);
 };
 
 }  // namespace lidar
@@ -0,0 +1,46 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file costmap_storage.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ * \brief Per-vertex cost maps stored in the pose graph next to the point map
+ * they are computed from.
+ */
+#pragma once
+
+#include "vtr_lidar/data_types/costmap.hpp"
+#include "vtr_tactic/types.hpp"
+
+namespace vtr {
+namespace lidar {
+
+/**
+ * \brief Returns the cost map stored in stream_name of vertex vid, or nullptr
+ * if there is none or if it was computed from another version of the point map
+ * or with other parameters.
+ */
+SparseCostMap::Ptr recallCostMap(const tactic::Graph::Ptr& graph,
+                                 const tactic::VertexId& vid,
+                                 const std::string& stream_name,
+                                 const unsigned& map_version,
+                                 const size_t& params_hash);
+
+/** \brief Stores the cost map in stream_name of vertex vid (replacing) */
+void storeCostMap(const tactic::Graph::Ptr& graph, const tactic::VertexId& vid,
+                  const std::string& stream_name,
+                  const SparseCostMap& costmap);
+
+}  // namespace lidar
+}  // namespace vtr
@@ -25,6 +25,7 @@
 #include "nav_msgs/msg/occupancy_grid.hpp"
 
 #include "vtr_lidar/cache.hpp"
+#include "vtr_lidar/modules/planning/costmap_storage.hpp"
 #include "vtr_lidar/segmentation/himmelsbach.hpp"
 #include "vtr_tactic/modules/base_module.hpp"
 #include "vtr_tactic/task_queue.hpp"
@@ -60,12 +61,16 @@ class GroundExtractionModule : public tactic::BaseModule {
     float bin_size_small = 3.0;
     size_t num_bins_large = 30;
     float bin_size_large = 3.0;
+    int num_threads = 4;
 
     // ogm
     float resolution = 1.0;
     float size_x = 20.0;
     float size_y = 20.0;
 
+    /// recall the cost map stored with the submap, store it once computed
+    bool persist_costmap = true;
+
     bool run_async = false;
     bool visualize = false;
 
@@ -78,6 +83,26 @@ class GroundExtractionModule : public tactic::BaseModule {
       const std::shared_ptr<tactic::ModuleFactory> &module_factory = nullptr,
       const std::string &name = static_name);
 
+  /** \brief Graph stream the cost map of a submap is stored in */
+  static constexpr auto costmap_stream = "ground_extraction_costmap";
+
+  /**
+   * \brief Computes the ground cost map of a submap, in the frame of the
+   * vertex the submap is attached to.
+   * \param[out] labeled_points if not null, the submap points in the vertex
+   * frame with flex11 set to 1 for ground points (for visualization)
+   */
+  SparseCostMap::Ptr computeCostMap(
+      const PointMapViews &submap,
+      pcl::PointCloud<PointWithInfo> *labeled_points = nullptr) const;
+
+  /**
+   * \brief Returns the cost map stored with the submap, computes and stores it
+   * if there is none or if it is out of date.
+   */
+  SparseCostMap::Ptr getCostMap(const tactic::Graph::Ptr &graph,
+                                const PointMapViews &submap) const;
+
  private:
   void run_(tactic::QueryCache &qdata, tactic::OutputCache &output,
             const tactic::Graph::Ptr &graph,
@@ -94,6 +119,9 @@ class GroundExtractionModule : public tactic::BaseModule {
   /** \brief */
   Himmelsbach<PointWithInfo> himmelsbach_;
 
+  /** \brief hash of the parameters the cost map depends on */
+  size_t params_hash_ = 0;
+
   /** \brief mutex to make publisher thread safe */
   std::mutex mutex_;
 
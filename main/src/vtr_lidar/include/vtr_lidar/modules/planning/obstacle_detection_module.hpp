@@ -25,6 +25,7 @@
 #include "nav_msgs/msg/occupancy_grid.hpp"
 
 #include "vtr_lidar/cache.hpp"
+#include "vtr_lidar/modules/planning/costmap_storage.hpp"
 #include "vtr_tactic/modules/base_module.hpp"
 #include "vtr_tactic/task_queue.hpp"
 
@@ -52,6 +53,9 @@ class ObstacleDetectionModule : public tactic::BaseModule {
     float size_x = 20.0;
     float size_y = 20.0;
 
+    /// recall the cost map stored with the submap, store it once computed
+    bool persist_costmap = true;
+
     bool run_async = false;
     bool visualize = false;
 
@@ -64,6 +68,26 @@ class ObstacleDetectionModule : public tactic::BaseModule {
       const std::shared_ptr<tactic::ModuleFactory> &module_factory = nullptr,
       const std::string &name = static_name);
 
+  /** \brief Graph stream the cost map of a submap is stored in */
+  static constexpr auto costmap_stream = "obstacle_detection_costmap";
+
+  /**
+   * \brief Computes the obstacle cost map of a submap, in the frame of the
+   * vertex the submap is attached to.
+   * \param[out] labeled_points if not null, the submap points in the vertex
+   * frame with flex11 set to 1 for obstacle points (for visualization)
+   */
+  SparseCostMap::Ptr computeCostMap(
+      const PointMapViews &submap,
+      pcl::PointCloud<PointWithInfo> *labeled_points = nullptr) const;
+
+  /**
+   * \brief Returns the cost map stored with the submap, computes and stores it
+   * if there is none or if it is out of date.
+   */
+  SparseCostMap::Ptr getCostMap(const tactic::Graph::Ptr &graph,
+                                const PointMapViews &submap) const;
+
  private:
   void run_(tactic::QueryCache &qdata, tactic::OutputCache &output,
             const tactic::Graph::Ptr &graph,
@@ -77,6 +101,9 @@ class ObstacleDetectionModule : public tactic::BaseModule {
 
   Config::ConstPtr config_;
 
+  /** \brief hash of the parameters the cost map depends on */
+  size_t params_hash_ = 0;
+
   /** \brief mutex to make publisher thread safe */
   std::mutex mutex_;
 
@@ -50,6 +50,7 @@ class TerrainAssessmentModule : public tactic::BaseModule {
     float corridor_width = 1.0;
 
     // terrain assessment
+    bool assess_terrain = false;
     float search_radius = 1.0;
 
     // cost map
@@ -0,0 +1,162 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file terrain_assessment_ops.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include <array>
+
+#include "vtr_lidar/data_types/costmap.hpp"
+
+namespace vtr {
+namespace lidar {
+
+/**
+ * \brief Sets cells within width of the path (a polyline of (x, y) vertices)
+ * to 1. Each segment only visits cells in its bounding box.
+ */
+inline void rasterizeCorridor(DenseCostMap &costmap,
+                              const std::vector<Eigen::Vector2f> &path,
+                              const float &width) {
+  if (path.empty()) return;
+  const auto stamp = [&](const Eigen::Vector2f &xs, const Eigen::Vector2f &xe) {
+    // use the following convention (all points are (x, y)):
+    //   q  - query point (center of the cell)
+    //   p  - projected point on to the line segment
+    //   xs - start point of the line segment
+    //   xe - end point of the line segment
+    const auto sq_length = (xe - xs).squaredNorm();
+    const Eigen::Vector2f margin =
+        Eigen::Vector2f::Constant(width + costmap.dl() / 2.0f);
+    costmap.update(xs.cwiseMin(xe) - margin, xs.cwiseMax(xe) + margin,
+                   [&](const Eigen::Vector2f &q, float &v) {
+                     float alpha = 0.0f;
+                     if (sq_length > 0.0f)
+                       alpha = std::clamp((q - xs).dot(xe - xs) / sq_length,
+                                          0.0f, 1.0f);
+                     const Eigen::Vector2f p = xs + alpha * (xe - xs);
+                     if ((q - p).norm() <= width) v = 1;
+                   });
+  };
+  if (path.size() == 1) stamp(path.front(), path.front());
+  for (size_t i = 0; i + 1 < path.size(); ++i) stamp(path[i], path[i + 1]);
+}
+
+/**
+ * \brief Terrain roughness (smallest eigenvalue of the point scatter matrix)
+ * of the points around each cell.
+ * \details Points are accumulated into a grid with the cost map resolution as
+ * running sums (count, sum of coordinates, sum of outer products) in one pass,
+ * then summed-area tables give the sums over a square neighborhood of any cell
+ * in constant time. The neighborhood is the box of cells within search_radius
+ * of the query cell in x and y.
+ */
+class AssessTerrainOp {
+ public:
+  template <typename PointCloud>
+  AssessTerrainOp(const PointCloud &points, const float &dl,
+                  const float &size_x, const float &size_y,
+                  const float &search_radius, const size_t &min_num_points = 5)
+      : dl_(dl),
+        radius_((int)std::round(search_radius / dl)),
+        min_num_points_(min_num_points),
+        origin_x_(-(int)std::round(std::abs(size_x) / 2.0f / dl) - radius_),
+        origin_y_(-(int)std::round(std::abs(size_y) / 2.0f / dl) - radius_),
+        width_(-2 * origin_x_ + 1),
+        height_(-2 * origin_y_ + 1),
+        sat_((size_t)(width_ + 1) * (height_ + 1), Sums{}) {
+    // per-cell sums, stored shifted by one in the summed-area table
+    for (size_t n = 0; n < points.size(); ++n) {
+      const auto &p = points[n];
+      const int i = (int)std::round(p.x / dl_) - origin_x_;
+      const int j = (int)std::round(p.y / dl_) - origin_y_;
+      if (i < 0 || i >= width_ || j < 0 || j >= height_) continue;
+      const double x = p.x, y = p.y, z = p.z;
+      auto &s = sat_[index(i + 1, j + 1)];
+      const std::array<double, NumSums> sample{
+          1.0, x, y, z, x * x, x * y, x * z, y * y, y * z, z * z};
+      for (size_t k = 0; k < NumSums; ++k) s[k] += sample[k];
+    }
+    // summed-area table
+    for (int i = 1; i <= width_; ++i)
+      for (int j = 1; j <= height_; ++j) {
+        auto &s = sat_[index(i, j)];
+        const auto &a = sat_[index(i - 1, j)];
+        const auto &b = sat_[index(i, j - 1)];
+        const auto &c = sat_[index(i - 1, j - 1)];
+        for (size_t k = 0; k < NumSums; ++k) s[k] += a[k] + b[k] - c[k];
+      }
+  }
+
+  void operator()(const Eigen::Vector2f &q, float &value) const {
+    const int i = (int)std::round(q.x() / dl_) - origin_x_;
+    const int j = (int)std::round(q.y() / dl_) - origin_y_;
+    // sums over cells [i0, i1) x [j0, j1) in table coordinates
+    const int i0 = std::clamp(i - radius_, 0, width_);
+    const int i1 = std::clamp(i + radius_ + 1, 0, width_);
+    const int j0 = std::clamp(j - radius_, 0, height_);
+    const int j1 = std::clamp(j + radius_ + 1, 0, height_);
+    const auto &a = sat_[index(i1, j1)];
+    const auto &b = sat_[index(i0, j1)];
+    const auto &c = sat_[index(i1, j0)];
+    const auto &d = sat_[index(i0, j0)];
+    Sums s;
+    for (size_t k = 0; k < NumSums; ++k) s[k] = a[k] - b[k] - c[k] + d[k];
+
+    const double n = s[0];
+    if (n < (double)min_num_points_ - 0.5) {
+      // \todo 0.0 should not mean no enough neighbors
+      value = 0.0;
+      return;
+    }
+
+    // scatter matrix about the centroid, same as pcl::computeCovarianceMatrix
+    const Eigen::Vector3d mean(s[1] / n, s[2] / n, s[3] / n);
+    Eigen::Matrix3d scatter;
+    // clang-format off
+    scatter << s[4], s[5], s[6],
+               s[5], s[7], s[8],
+               s[6], s[8], s[9];
+    // clang-format on
+    scatter -= n * mean * mean.transpose();
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
+    es.compute(scatter, Eigen::EigenvaluesOnly);
+    value = (float)std::abs(es.eigenvalues()(0));
+  }
+
+ private:
+  static constexpr size_t NumSums = 10;
+  using Sums = std::array<double, NumSums>;
+
+  size_t index(const int &i, const int &j) const {
+    return (size_t)i * (height_ + 1) + (size_t)j;
+  }
+
+  const float dl_;
+  /** \brief neighborhood half size in number of cells */
+  const int radius_;
+  const size_t min_num_points_;
+  /** \brief grid covers the cost map padded by the neighborhood size */
+  const int origin_x_, origin_y_;
+  const int width_, height_;
+  /** \brief summed-area table of size (width_ + 1) x (height_ + 1) */
+  std::vector<Sums> sat_;
+};
+
+}  // namespace lidar
+}  // namespace vtr
@@ -53,6 +53,8 @@ class DynamicDetectionModule : public tactic::BaseModule {
     int min_num_observations = 0;
     float dynamic_threshold = 0.5;
 
+    int num_threads = 4;
+
     bool visualize = false;
 
     static ConstPtr fromROS(const rclcpp::Node::SharedPtr &node,
@@ -47,6 +47,8 @@ class InterExpMergingModuleV2 : public tactic::BaseModule {
 
     int dynamic_obs_threshold = 5;
 
+    int num_threads = 4;
+
     // general
     bool visualize = false;
 
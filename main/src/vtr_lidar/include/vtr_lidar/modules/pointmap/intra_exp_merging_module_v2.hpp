@@ -40,6 +40,10 @@ class IntraExpMergingModuleV2 : public tactic::BaseModule {
 
     // merge
     double depth = 1.0;
+    /// memory of the submaps held at once while merging, in MB; submaps
+    /// are read from the graph one per thread at a time without being cached,
+    /// those already loaded by other modules are not accounted for
+    double memory_budget = 1024.0;
 
     // point map
     float map_voxel_size = 0.2;
@@ -47,6 +51,7 @@ class IntraExpMergingModuleV2 : public tactic::BaseModule {
     float back_over_front_ratio = 0.5;
 
     // general
+    int num_threads = 4;
     bool visualize = false;
 
     static ConstPtr fromROS(const rclcpp::Node::SharedPtr &node,
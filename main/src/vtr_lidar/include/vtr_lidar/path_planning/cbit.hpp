@@ -44,6 +44,7 @@ class LidarCBIT : public vtr::path_planning::CBIT {
 
  private:
   Command computeCommand(RobotState& robot_state) override;
+  void onCommandDropped(const Command& sent) override;
 
  private:
   const Config::ConstPtr config_;
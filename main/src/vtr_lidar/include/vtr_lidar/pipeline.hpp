@@ -105,6 +105,8 @@ class LidarPipeline : public tactic::BasePipeline {
   /// localization cached data
   /** \brief Current submap for localization */
   std::shared_ptr<const PointMap<PointWithInfo>> submap_loc_;
+  /** \brief Derived views of the current submap, shared by all modules */
+  std::shared_ptr<const PointMapViews> submap_loc_views_;
 
   VTR_REGISTER_PIPELINE_DEC_TYPE(LidarPipeline);
 };
@@ -18,6 +18,10 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "pcl/point_cloud.h"
 
 #include "vtr_logging/logging.hpp"
@@ -56,6 +60,41 @@ class Himmelsbach {
     float xe;
   };
 
+  /**
+   * \brief Least squares fit of z = m * r + b from running (centered) sums, so
+   * that adding a point and evaluating the fit are both O(1).
+   * \note The fit is computed in double and comes with a bound on the error of
+   * fitLine, which solves the same problem in float, so that line acceptance
+   * can fall back to fitLine whenever the two may disagree on a threshold.
+   */
+  struct LineFit {
+    void add(const double r, const double z) {
+      ++n;
+      const double dr = r - mean_r;
+      const double dz = z - mean_z;
+      mean_r += dr / (double)n;
+      mean_z += dz / (double)n;
+      crr += dr * (r - mean_r);
+      crz += dr * (z - mean_z);
+      czz += dz * (z - mean_z);
+      sabs_z += std::abs(z);
+      sabs_rz += std::abs(r * z);
+      rmax = std::max(rmax, std::abs(r));
+      zmax = std::max(zmax, std::abs(z));
+    }
+
+    size_t n = 0;
+    double mean_r = 0.0;
+    double mean_z = 0.0;
+    double crr = 0.0;  // sum of (r - mean_r)^2
+    double crz = 0.0;  // sum of (r - mean_r) * (z - mean_z)
+    double czz = 0.0;  // sum of (z - mean_z)^2
+    double sabs_z = 0.0;   // sum of |z|
+    double sabs_rz = 0.0;  // sum of |r * z|
+    double rmax = 0.0;
+    double zmax = 0.0;
+  };
+
  private:
   /** \brief */
   std::vector<std::vector<size_t>> sortPointsSegments(
@@ -63,6 +102,16 @@ class Himmelsbach {
   /** \brief */
   std::vector<int> sortPointsBins(const PointCloud& points,
                                   const std::vector<size_t>& segment) const;
+  /** \brief Returns ground point indices of one angular segment */
+  std::vector<size_t> segmentGround(const PointCloud& points,
+                                    const std::vector<size_t>& segment) const;
+  /**
+   * \brief Whether the line fitted to line_set + idx passes the slope, offset
+   * and rmse thresholds, same result as thresholding fitLine(line_set + idx)
+   * \param[in] fit running fit of line_set + idx
+   */
+  bool acceptLine(const PointCloud& points, const std::vector<size_t>& line_set,
+                  const size_t idx, const LineFit& fit) const;
   /** \brief */
   using FitLineRval = std::tuple<float, float, float>; /* [m, b, rmse] */
   FitLineRval fitLine(const PointCloud& points,
@@ -86,87 +135,163 @@ class Himmelsbach {
   float bin_size_small = 3.0;
   size_t num_bins_large = 30;
   float bin_size_large = 3.0;
+
+  /** \brief number of threads processing angular segments */
+  int num_threads = 1;
 };
 
 template <class PointT>
 std::vector<size_t> Himmelsbach<PointT>::operator()(
     const PointCloud& points) const {
-  std::vector<size_t> ground_idx;
   // sort points into segments
   const auto segments = sortPointsSegments(points);
+  // segments are independent, their ground points are concatenated in segment
+  // order so that the result does not depend on the number of threads
+  std::vector<std::vector<size_t>> segment_ground_idx(segments.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+  for (int i = 0; i < (int)segments.size(); ++i) {
+    if (segments[i].empty()) continue;
+    segment_ground_idx[i] = segmentGround(points, segments[i]);
+  }
+  size_t num_ground = 0;
+  for (const auto& idx : segment_ground_idx) num_ground += idx.size();
+  std::vector<size_t> ground_idx;
+  ground_idx.reserve(num_ground);
+  for (const auto& idx : segment_ground_idx)
+    ground_idx.insert(ground_idx.end(), idx.begin(), idx.end());
+  return ground_idx;
+}
+
+template <class PointT>
+std::vector<size_t> Himmelsbach<PointT>::segmentGround(
+    const PointCloud& points, const std::vector<size_t>& segment) const {
+  const auto radius = [&](const size_t idx) {
+    const auto& point = points[idx];
+    return std::sqrt(point.x * point.x + point.y * point.y);
+  };
   // Sort points into bins
-  for (const auto& segment : segments) {
-    if (segment.empty()) continue;
-    //
-    const auto bins = sortPointsBins(points, segment);
-    //
-    std::vector<Line> lines;       // extracted lines
-    std::vector<size_t> line_set;  // current set of point index forming a line
-    size_t i = 0;                  // current bin index
-    while (i < bins.size() - 1) {
-      const auto& idx = bins[i];
-      if (idx < 0) {
+  const auto bins = sortPointsBins(points, segment);
+  //
+  std::vector<Line> lines;       // extracted lines
+  std::vector<size_t> line_set;  // current set of point index forming a line
+  LineFit fit;                   // running fit of line_set
+  size_t i = 0;                  // current bin index
+  while (i < bins.size() - 1) {
+    const auto& idx = bins[i];
+    if (idx < 0) {
+      ++i;
+      continue;
+    } else if (line_set.size() >= 2) {
+      auto tmp = fit;
+      tmp.add(radius(idx), points[idx].z);
+      if (acceptLine(points, line_set, idx, tmp)) {
+        line_set.emplace_back(idx);
+        fit = tmp;
         ++i;
-        continue;
-      } else if (line_set.size() >= 2) {
-        std::vector<size_t> tmp(line_set);
-        tmp.emplace_back(idx);
-        const auto [m, b, rmse] = fitLine(points, tmp);
-        if (std::abs(m) <= Tm &&
-            (std::abs(m) > Tm_small || std::abs(b + z_offset) <= Tb) &&
-            rmse <= Trmse) {
-          line_set.emplace_back(idx);
-          ++i;
-        } else {
-          const auto [m, b, rmse] = fitLine(points, line_set);
-          lines.emplace_back(points, line_set, m, b);
-          line_set.clear();
-        }
       } else {
-        // this mprev condition prevents initialization issues, especially when
-        // first first two representative points are not both on the ground
-        const auto mprev = lines.empty() ? 0 : std::abs(lines.back().m);
-        const auto dprev =
-            lines.empty() ? -1 : distPointLine(points[idx], lines.back());
-        if (mprev > Tm || dprev <= Tdprev || lines.empty() || !line_set.empty())
-          line_set.emplace_back(idx);
-        ++i;
+        const auto [m, b, rmse] = fitLine(points, line_set);
+        lines.emplace_back(points, line_set, m, b);
+        line_set.clear();
+        fit = LineFit();
       }
-    }
-    ///
-    if (line_set.size() >= 2) {
-      const auto [m, b, rmse] = fitLine(points, line_set);
-      lines.emplace_back(points, line_set, m, b);
-      line_set.clear();
-    }
-    // assign points as inliers if they are within a threshold of the ground
-    // model
-    for (const auto& idx : segment) {
-      const auto& point = points[idx];
-      const auto& r = std::sqrt(point.x * point.x + point.y * point.y);
-      // get line that's closest to the candidate point based on distance to
-      // endpoints
-      int closest = -1;
-      float dmin = std::numeric_limits<float>::max();
-      for (size_t i = 0; i < lines.size(); ++i) {
-        const auto& line = lines[i];
-        const auto ds = std::abs(line.xs - r);
-        const auto de = std::abs(line.xe - r);
-        const auto d = std::min(ds, de);
-        if (d < dmin && std::abs(line.m) < Tm) {
-          dmin = d;
-          closest = i;
-        }
-      }
-      if (closest >= 0) {
-        const auto e = distPointLine(point, lines[closest]);
-        if (e < tolerance) ground_idx.emplace_back(idx);
+    } else {
+      // this mprev condition prevents initialization issues, especially when
+      // first first two representative points are not both on the ground
+      const auto mprev = lines.empty() ? 0 : std::abs(lines.back().m);
+      const auto dprev =
+          lines.empty() ? -1 : distPointLine(points[idx], lines.back());
+      if (mprev > Tm || dprev <= Tdprev || lines.empty() || !line_set.empty()) {
+        line_set.emplace_back(idx);
+        fit.add(radius(idx), points[idx].z);
       }
+      ++i;
     }
   }
+  ///
+  if (line_set.size() >= 2) {
+    const auto [m, b, rmse] = fitLine(points, line_set);
+    lines.emplace_back(points, line_set, m, b);
+    line_set.clear();
+  }
+  // endpoints of the lines that can be ground, lines are built from bins of
+  // increasing radius so the endpoints are sorted
+  std::vector<float> endpoints;
+  std::vector<size_t> endpoint_lines;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    if (std::abs(lines[i].m) >= Tm) continue;
+    endpoints.push_back(lines[i].xs);
+    endpoints.push_back(lines[i].xe);
+    endpoint_lines.push_back(i);
+    endpoint_lines.push_back(i);
+  }
+  // assign points as inliers if they are within a threshold of the ground
+  // model
+  std::vector<size_t> ground_idx;
+  for (const auto& idx : segment) {
+    const auto& point = points[idx];
+    const auto r = radius(idx);
+    // get line that's closest to the candidate point based on distance to
+    // endpoints, i.e. one of the endpoints around r, ties go to the first line
+    if (endpoints.empty()) continue;
+    const auto dist = [&](const size_t j) { return std::abs(endpoints[j] - r); };
+    size_t j = std::lower_bound(endpoints.begin(), endpoints.end(), r) -
+               endpoints.begin();
+    if (j == endpoints.size() || (j > 0 && dist(j - 1) <= dist(j))) --j;
+    while (j > 0 && dist(j - 1) == dist(j)) --j;
+    if (!(dist(j) < std::numeric_limits<float>::max())) continue;
+    const auto e = distPointLine(point, lines[endpoint_lines[j]]);
+    if (e < tolerance) ground_idx.emplace_back(idx);
+  }
   return ground_idx;
 }
 
+template <class PointT>
+bool Himmelsbach<PointT>::acceptLine(const PointCloud& points,
+                                     const std::vector<size_t>& line_set,
+                                     const size_t idx,
+                                     const LineFit& fit) const {
+  const auto accept = [&](const auto m, const auto b, const auto rmse) {
+    return std::abs(m) <= Tm &&
+           (std::abs(m) > Tm_small || std::abs(b + z_offset) <= Tb) &&
+           rmse <= Trmse;
+  };
+  const double n = (double)fit.n;
+  const double m = fit.crz / fit.crr;
+  const double b = fit.mean_z - m * fit.mean_r;
+  const double rmse = std::sqrt(std::max(0.0, fit.czz - m * fit.crz) / n);
+  // bound on the error of fitLine, which forms the normal equations in float:
+  // first order propagation of the rounding errors of the sums to m and b
+  const double eps = std::numeric_limits<float>::epsilon();
+  const double gamma = 2.0 * (n + 4.0) * eps;
+  const double sr = n * fit.mean_r;
+  const double srr = fit.crr + n * fit.mean_r * fit.mean_r;
+  const double sz = n * fit.mean_z;
+  const double det = n * fit.crr;  // n * srr - sr * sr
+  const double err_m =
+      2.0 * gamma *
+      (n * std::abs(m) * srr + std::abs(2.0 * m * sr - sz) * sr +
+       n * fit.sabs_rz + sr * fit.sabs_z + std::abs(b) * sr * n) /
+      det;
+  const double err_b =
+      err_m * sr / n + 2.0 * gamma * (fit.sabs_z + std::abs(m) * sr) / n +
+      4.0 * eps * (std::abs(b) + std::abs(z_offset));
+  const double err_rmse =
+      err_m * fit.rmax + err_b + 4.0 * n * eps * rmse +
+      4.0 * eps * (std::abs(m) * fit.rmax + std::abs(b) + fit.zmax);
+  const bool certain =
+      fit.crr > 0.0 && std::isfinite(err_m) &&
+      std::abs(std::abs(m) - Tm) > err_m &&
+      std::abs(std::abs(m) - Tm_small) > err_m &&
+      std::abs(std::abs(b + z_offset) - Tb) > err_b &&
+      std::abs(rmse - Trmse) > err_rmse;
+  if (certain) return accept(m, b, rmse);
+  // too close to a threshold to tell, refit as fitLine would
+  std::vector<size_t> tmp(line_set);
+  tmp.emplace_back(idx);
+  const auto [mf, bf, rmsef] = fitLine(points, tmp);
+  return accept(mf, bf, rmsef);
+}
+
 template <class PointT>
 std::vector<std::vector<size_t>> Himmelsbach<PointT>::sortPointsSegments(
     const PointCloud& points) const {
@@ -18,7 +18,14 @@
  */
 #pragma once
 
+#include <unordered_map>
+#include <vector>
+
+#include "lgmath.hpp"
+
+#include "vtr_common/utils/hash.hpp"
 #include "vtr_lidar/data_types/point.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 
 namespace vtr {
 namespace lidar {
@@ -72,108 +79,184 @@ struct hash<vtr::lidar::ray_tracing::PixKey> {
 namespace vtr {
 namespace lidar {
 
+namespace ray_tracing {
+
+inline PixKey getKey(const float& theta, const float& phi,
+                     const float& phi_res, const float& theta_res) {
+  // Position of point in sample map
+  return PixKey((int)std::floor(theta / theta_res),
+                (int)std::floor(phi / phi_res));
+}
+
+}  // namespace ray_tracing
+
 template <class PointT>
 inline ray_tracing::PixKey getKey(const PointT& p, const float& phi_res,
                                   const float& theta_res) {
-  // Position of point in sample map
-  return ray_tracing::PixKey((int)std::floor(p.theta / theta_res),
-                             (int)std::floor(p.phi / phi_res));
+  return ray_tracing::getKey(p.theta, p.phi, phi_res, theta_res);
 }
 
-template <class PointT>
-void detectDynamicObjects(
-    const pcl::PointCloud<PointT>& /* point scan */ reference,
-    pcl::PointCloud<PointT>& /* point map */ query,
-    const lgmath::se3::TransformationWithCovariance& T_ref_qry,
-    const float& phi_res, const float& theta_res, const float& max_num_obs,
-    const float& min_num_obs, const float& /* dynamic_threshold */) {
-  // Parameters
-  const auto inner_ratio = 1 - std::max(phi_res, theta_res) / 2;
-  (void)inner_ratio;
-  const auto outer_ratio = 1 + std::max(phi_res, theta_res) / 2;
-  // this takes into account surface orientation
-#if false
-  const auto tighter_inner_ratio =
-      1 - (std::max(phi_res, theta_res) / 2) / std::tan(M_PI / 12);
-#endif
+namespace ray_tracing {
 
-  // Create and fill in the frustum grid
-  std::unordered_map<ray_tracing::PixKey, float> frustum_grid;
-  for (const auto& p : reference) {
-    const auto k = getKey(p, phi_res, theta_res);
-    if (frustum_grid.count(k) == 0)
-      frustum_grid[k] = p.rho;
-    else
-      /// // always choose the further point
-      // frustum_grid.at(k) = std::max(p.x, frustum_grid.at(k));
-      /// always choose the closer point
-      frustum_grid.at(k) = std::min(p.rho, frustum_grid.at(k));
+/**
+ * \brief Closest range of a reference scan in each (theta, phi) pixel.
+ * \details The pixels are stored in a dense image over the pixel bounding box
+ * of the scan, whose storage is reused by the next scans. Scans whose bounding
+ * box is larger than MAX_DENSE_PIXELS (very fine resolutions or invalid polar
+ * coordinates) are stored in a hash map instead.
+ */
+class FrustumGrid {
+ public:
+  static constexpr int64_t MAX_DENSE_PIXELS = int64_t(1) << 22;
+
+  FrustumGrid(const float& phi_res, const float& theta_res)
+      : phi_res_(phi_res), theta_res_(theta_res) {}
+
+  /** \brief Fills the grid with the polar coordinates of a reference scan */
+  template <class PointT>
+  void reset(const pcl::PointCloud<PointT>& reference) {
+    keys_.resize(reference.size());
+    int64_t min_x = 0, max_x = -1, min_y = 0, max_y = -1;
+    for (size_t i = 0; i < reference.size(); i++) {
+      const auto k = getKey(reference[i], phi_res_, theta_res_);
+      keys_[i] = k;
+      if (i == 0) min_x = max_x = k.x, min_y = max_y = k.y;
+      min_x = std::min<int64_t>(min_x, k.x);
+      max_x = std::max<int64_t>(max_x, k.x);
+      min_y = std::min<int64_t>(min_y, k.y);
+      max_y = std::max<int64_t>(max_y, k.y);
+    }
+    const int64_t rows = max_x - min_x + 1, cols = max_y - min_y + 1;
+
+    dense_ = rows <= MAX_DENSE_PIXELS && cols <= MAX_DENSE_PIXELS &&
+             rows * cols <= MAX_DENSE_PIXELS;
+    sparse_.clear();
+    if (dense_) {
+      origin_ = PixKey((int)min_x, (int)min_y), rows_ = rows, cols_ = cols;
+      rho_.resize(rows * cols);
+      occupied_.assign(rows * cols, false);
+    }
+
+    for (size_t i = 0; i < reference.size(); i++) {
+      const float& rho = reference[i].rho;
+      if (dense_) {
+        const auto pixel =
+            index(keys_[i].x - origin_.x, keys_[i].y - origin_.y);
+        if (!occupied_[pixel])
+          rho_[pixel] = rho, occupied_[pixel] = true;
+        else
+          rho_[pixel] = std::min(rho, rho_[pixel]);  // choose the closer point
+      } else {
+        const auto res = sparse_.try_emplace(keys_[i], rho);
+        if (!res.second) res.first->second = std::min(rho, res.first->second);
+      }
+    }
   }
 
-  // Perform a transformation in to the frame of the reference point cloud
-  auto query_tmp = query;  // copy
-  const auto T_ref_qry_mat = T_ref_qry.matrix().cast<float>();
-  // eigen mapping
-  auto points_mat =
-      query_tmp.getMatrixXfMap(4, PointT::size(), PointT::cartesian_offset());
-  auto normal_mat =
-      query_tmp.getMatrixXfMap(4, PointT::size(), PointT::normal_offset());
-  // transform to the local frame of this vertex
-  points_mat = T_ref_qry_mat * points_mat;
-  normal_mat = T_ref_qry_mat * normal_mat;
-  ray_tracing::cart2pol(query_tmp);
-
-  // for honeycomb fov specifically
-#if false
-  float theta_min = 7 * M_PI / 18;
-  float theta_max = 15 * M_PI / 18;
-  float phi_min = -M_PI / 2;
-  float phi_max = M_PI / 2;
-#endif
-  float rho_max = 50.0f;
-
-  //
-  for (size_t i = 0; i < query.size(); i++) {
-    auto& qp = query[i];           // point with dynamic obs to be updated
-    const auto& p = query_tmp[i];  // expressed in the reference scan frame
+  /** \brief Range of the reference scan in pixel k, null if k is empty */
+  const float* find(const PixKey& k) const {
+    if (!dense_) {
+      const auto it = sparse_.find(k);
+      return it == sparse_.end() ? nullptr : &it->second;
+    }
+    const int64_t x = (int64_t)k.x - origin_.x, y = (int64_t)k.y - origin_.y;
+    if (x < 0 || x >= rows_ || y < 0 || y >= cols_) return nullptr;
+    const auto pixel = index(x, y);
+    return occupied_[pixel] ? &rho_[pixel] : nullptr;
+  }
+
+  const float& phiRes() const { return phi_res_; }
+  const float& thetaRes() const { return theta_res_; }
+
+ private:
+  size_t index(const int64_t x, const int64_t y) const {
+    return (size_t)(x * cols_ + y);
+  }
+
+  const float phi_res_;
+  const float theta_res_;
+
+  std::vector<PixKey> keys_;
 
-    // compute polar coordinates and key
-    const auto k = getKey(p, phi_res, theta_res);
+  bool dense_ = true;
+  PixKey origin_;
+  int rows_ = 0, cols_ = 0;
+  std::vector<float> rho_;
+  std::vector<uint8_t> occupied_;
 
-    if (!frustum_grid.count(k)) continue;
-    // if ((!frustum_grid.count(k)) &&
-    //     (p.phi < phi_min || p.phi > phi_max || p.theta < theta_min ||
-    //      p.theta > theta_max))
-    //   continue;
-    const float rho_ref = frustum_grid.count(k) ? frustum_grid.at(k) : rho_max;
+  std::unordered_map<PixKey, float> sparse_;
+};
+
+/** \brief Dynamic and total observation counts of the points of a map */
+struct Observations {
+  Observations(const size_t size = 0) : dynamic(size, 0.f), total(size, 0.f) {}
+
+  Observations& operator+=(const Observations& other) {
+    for (size_t i = 0; i < total.size(); i++) {
+      dynamic[i] += other.dynamic[i];
+      total[i] += other.total[i];
+    }
+    return *this;
+  }
+
+  std::vector<float> dynamic;
+  std::vector<float> total;
+};
+
+/**
+ * \brief Ray traces the query (map) points through a reference scan and counts
+ * the points it observes, and the ones it sees through (dynamic).
+ * \details Each query point is transformed and converted to polar coordinates
+ * on the fly, nothing is copied. Counts are added to obs, so that scans
+ * traced by different threads into different Observations can be summed.
+ */
+template <class PointT>
+void traceObservations(const FrustumGrid& grid,
+                       const pcl::PointCloud<PointT>& query,
+                       const Eigen::Matrix4f& T_ref_qry, Observations& obs) {
+  using pointcloud::transform_kernels::transformVector;
+
+  // Parameters
+  const auto inner_ratio = 1 - std::max(grid.phiRes(), grid.thetaRes()) / 2;
+  const auto outer_ratio = 1 + std::max(grid.phiRes(), grid.thetaRes()) / 2;
+
+  const pointcloud::transform_kernels::Columns T(T_ref_qry);
+  alignas(16) float data[4], data_n[4];
+  const Eigen::Map<const Eigen::Vector3f> xyz(data), normal(data_n);
+  for (size_t i = 0; i < query.size(); i++) {
+    // expressed in the reference scan frame
+    transformVector<true>(T, query[i].data, data);
+    transformVector<false>(T, query[i].data_n, data_n);
+    const float &x = data[0], &y = data[1], &z = data[2];
+    const float rho = std::sqrt(x * x + y * y + z * z);
+    const float theta = std::atan2(std::sqrt(x * x + y * y), z);
+    const float phi = std::atan2(y, x);
+
+    const auto k = getKey(theta, phi, grid.phiRes(), grid.thetaRes());
+    const float* rho_ref = grid.find(k);
+    if (rho_ref == nullptr) continue;
 
     // the current point is occluded in the current observation
-    if (p.rho > (rho_ref * outer_ratio)) continue;
+    if (rho > (*rho_ref * outer_ratio)) continue;
 
     // update this point only when we have a good normal
-    float angle = std::acos(std::min(
-        std::abs(p.getVector3fMap().dot(p.getNormalVector3fMap()) / p.rho),
-        1.0f));
+    float angle = std::acos(std::min(std::abs(xyz.dot(normal) / rho), 1.0f));
     if (angle > 5 * M_PI / 12) continue;
 
-#if true
-    qp.total_obs++;
-    if (p.rho < (rho_ref * inner_ratio)) qp.dynamic_obs++;
-#else
-    if (qp.total_obs < max_num_obs) {
-      qp.dynamic_obs += (p.rho < (rho_ref * inner_ratio));
-      qp.total_obs++;
-    } else {
-      if (p.rho < (rho_ref * inner_ratio))
-        qp.dynamic_obs = std::min(max_num_obs, qp.dynamic_obs + 1);
-      else
-        qp.dynamic_obs = std::max(0.f, qp.dynamic_obs - 1);
-    }
-#endif
+    obs.total[i]++;
+    if (rho < (*rho_ref * inner_ratio)) obs.dynamic[i]++;
   }
+}
 
+/** \brief Stores the observation counts and the static scores of the map */
+template <class PointT>
+void updateStaticScores(const Observations& obs,
+                        pcl::PointCloud<PointT>& query,
+                        const float& max_num_obs, const float& min_num_obs) {
   for (size_t i = 0; i < query.size(); i++) {
     auto& qp = query[i];  // point with dynamic obs to be updated
+    qp.dynamic_obs = obs.dynamic[i];
+    qp.total_obs = obs.total[i];
     // update the scores
     if (qp.total_obs < min_num_obs)
       qp.static_score = 0.0;
@@ -184,5 +267,37 @@ void detectDynamicObjects(
   }
 }
 
+}  // namespace ray_tracing
+
+/**
+ * \brief Adds the observations of a reference scan to the dynamic and total
+ * observation counts of the query (map) points, and updates their scores.
+ * \note to trace several scans, use ray_tracing::traceObservations with one
+ * FrustumGrid and one Observations per thread.
+ */
+template <class PointT>
+void detectDynamicObjects(
+    const pcl::PointCloud<PointT>& /* point scan */ reference,
+    pcl::PointCloud<PointT>& /* point map */ query,
+    const lgmath::se3::TransformationWithCovariance& T_ref_qry,
+    const float& phi_res, const float& theta_res, const float& max_num_obs,
+    const float& min_num_obs, const float& /* dynamic_threshold */) {
+  // Create and fill in the frustum grid
+  ray_tracing::FrustumGrid frustum_grid(phi_res, theta_res);
+  frustum_grid.reset(reference);
+
+  // start from the current counts of the query points
+  ray_tracing::Observations obs(query.size());
+  for (size_t i = 0; i < query.size(); i++) {
+    obs.dynamic[i] = query[i].dynamic_obs;
+    obs.total[i] = query[i].total_obs;
+  }
+
+  const Eigen::Matrix4f T_ref_qry_mat = T_ref_qry.matrix().cast<float>();
+  ray_tracing::traceObservations(frustum_grid, query, T_ref_qry_mat, obs);
+
+  ray_tracing::updateStaticScores(obs, query, max_num_obs, min_num_obs);
+}
+
 }  // namespace lidar
 }  // namespace vtr
\ No newline at end of file
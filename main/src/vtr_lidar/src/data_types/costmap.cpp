@@ -20,8 +20,66 @@
 
 #include "pcl_conversions/pcl_conversions.h"
 
+#include "vtr_logging/logging.hpp"
+
 namespace vtr {
 namespace lidar {
+namespace costmap {
+
+void closestPointDistance(std::vector<Eigen::Vector2f> points,
+                          const PixKey& origin, const float dl,
+                          const float max_distance, Eigen::MatrixXf& dists) {
+  const auto inf = std::numeric_limits<double>::infinity();
+  std::sort(points.begin(), points.end(),
+            [](const Eigen::Vector2f& a, const Eigen::Vector2f& b) {
+              return a.x() < b.x();
+            });
+  const int n = points.size();
+  // parabolas (x - vx)^2 + vh in the lower envelope and their boundaries
+  std::vector<double> vx(n), vh(n), z(n + 1);
+
+  for (int j = 0; j < dists.cols(); ++j) {
+    const float y = (j + origin.y) * dl;
+    int k = -1;
+    for (const auto& p : points) {
+      const double dy = p.y() - y;
+      if (std::abs(dy) > max_distance) continue;
+      const double px = p.x(), h = dy * dy;
+      // pop parabolas hidden by the new one
+      double s = -inf;
+      while (k >= 0) {
+        if (vx[k] == px) {
+          if (vh[k] <= h) break;  // the new one is hidden
+          --k;
+          continue;
+        }
+        s = ((h + px * px) - (vh[k] + vx[k] * vx[k])) / (2.0 * (px - vx[k]));
+        if (s > z[k]) break;
+        --k;
+      }
+      if (k >= 0 && vx[k] == px) continue;
+      ++k;
+      vx[k] = px;
+      vh[k] = h;
+      z[k] = (k == 0) ? -inf : s;
+      z[k + 1] = inf;
+    }
+
+    if (k < 0) {
+      dists.col(j).setConstant(std::numeric_limits<float>::infinity());
+      continue;
+    }
+    k = 0;
+    for (int i = 0; i < dists.rows(); ++i) {
+      const double x = (i + origin.x) * dl;
+      while (z[k + 1] < x) ++k;
+      const double dx = x - vx[k];
+      dists(i, j) = (float)std::sqrt(dx * dx + vh[k]);
+    }
+  }
+}
+
+}  // namespace costmap
 
 BaseCostMap::BaseCostMap(const float& dl, const float& size_x,
                          const float& size_y, const float& default_value)
@@ -160,6 +218,50 @@ SparseCostMap::SparseCostMap(const float& dl, const float& size_x,
                              const float& size_y, const float& default_value)
     : BaseCostMap(dl, size_x, size_y, default_value) {}
 
+auto SparseCostMap::fromStorable(const SparseCostMapMsg& storable) -> Ptr {
+  if (storable.keys_x.size() != storable.values.size() ||
+      storable.keys_y.size() != storable.values.size()) {
+    std::string err{"SparseCostMap fromStorable: inconsistent cell sizes."};
+    CLOG(ERROR, "lidar.costmap") << err;
+    throw std::runtime_error(err);
+  }
+  auto data = std::make_shared<SparseCostMap>(
+      storable.dl, storable.size_x, storable.size_y, storable.default_value);
+  data->map_version_ = storable.map_version;
+  data->params_hash_ = storable.params_hash;
+  data->values_.reserve(storable.values.size());
+  for (size_t i = 0; i < storable.values.size(); ++i)
+    data->values_.emplace(
+        costmap::PixKey(storable.keys_x[i], storable.keys_y[i]),
+        storable.values[i]);
+  data->vertex_id_ = tactic::VertexId(storable.vertex_id);
+  using namespace vtr::common;
+  conversions::fromROSMsg(storable.t_vertex_this, data->T_vertex_this_);
+  return data;
+}
+
+auto SparseCostMap::toStorable() const -> SparseCostMapMsg {
+  SparseCostMapMsg storable;
+  storable.map_version = map_version_;
+  storable.params_hash = params_hash_;
+  storable.dl = dl_;
+  storable.size_x = size_x_;
+  storable.size_y = size_y_;
+  storable.default_value = default_value_;
+  storable.keys_x.reserve(values_.size());
+  storable.keys_y.reserve(values_.size());
+  storable.values.reserve(values_.size());
+  for (const auto& [key, value] : values_) {
+    storable.keys_x.emplace_back(key.x);
+    storable.keys_y.emplace_back(key.y);
+    storable.values.emplace_back(value);
+  }
+  storable.vertex_id = vertex_id_;
+  using namespace vtr::common;
+  conversions::toROSMsg(T_vertex_this_, storable.t_vertex_this);
+  return storable;
+}
+
 DenseCostMap SparseCostMap::toDense() const {
   DenseCostMap dense_cost_map(dl_, size_x_, size_y_, default_value_);
   dense_cost_map.update(values_);
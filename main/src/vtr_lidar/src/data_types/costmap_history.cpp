@@ -0,0 +1,111 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file costmap_history.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include "vtr_lidar/data_types/costmap_history.hpp"
+
+#include "vtr_logging/logging.hpp"
+
+namespace vtr {
+namespace lidar {
+
+CostMapHistory::CostMapHistory(const int& history_size,
+                               const int& vote_threshold, const int& num_cells)
+    : vote_threshold_(vote_threshold), num_cells_(num_cells) {
+  if (history_size <= 0 || num_cells <= 0) {
+    std::string err{"CostMapHistory: history size and number of cells must be "
+                    "positive."};
+    CLOG(ERROR, "lidar.costmap") << err;
+    throw std::invalid_argument(err);
+  }
+  const auto total = (size_t)num_cells_ * (size_t)num_cells_;
+  layers_.resize(history_size);
+  for (auto& layer : layers_)
+    layer.values.resize(total, std::numeric_limits<float>::quiet_NaN());
+  votes_.resize(total, 0);
+  owners_.resize(total);
+}
+
+size_t CostMapHistory::slot(const costmap::PixKey& k) const {
+  const auto wrap = [this](const int& v) {
+    const int r = v % num_cells_;
+    return r < 0 ? r + num_cells_ : r;
+  };
+  return (size_t)wrap(k.x) + (size_t)wrap(k.y) * (size_t)num_cells_;
+}
+
+auto CostMapHistory::layer(const size_t& i) const -> const Layer& {
+  return layers_[(head_ + i) % layers_.size()];
+}
+
+void CostMapHistory::push(const Cells& cells) {
+  // reuse the oldest layer if full
+  if (full()) {
+    auto& oldest = layers_[head_];
+    for (const auto& k : oldest.keys) {
+      const auto s = slot(k);
+      oldest.values[s] = std::numeric_limits<float>::quiet_NaN();
+      --votes_[s];
+    }
+    oldest.keys.clear();
+    head_ = (head_ + 1) % layers_.size();
+    --size_;
+  }
+
+  auto& newest = layers_[(head_ + size_) % layers_.size()];
+  for (const auto& [k, v] : cells) {
+    const auto s = slot(k);
+    if (votes_[s] > 0 && !(owners_[s] == k)) {
+      CLOG_EVERY_N(10, WARNING, "lidar.costmap")
+          << "Cell (" << k.x << ", " << k.y << ") conflicts with ("
+          << owners_[s].x << ", " << owners_[s].y
+          << ") in the cost map history, ignored. Increase the grid size.";
+      continue;
+    }
+    auto& value = newest.values[s];
+    if (std::isnan(value)) {
+      value = v;
+      newest.keys.emplace_back(k);
+      owners_[s] = k;
+      ++votes_[s];
+    } else {
+      value = std::max(value, v);
+    }
+  }
+  ++size_;
+}
+
+auto CostMapHistory::filter() const -> CellMap {
+  CellMap filtered;
+  if (size_ == 0) return filtered;
+
+  const auto add = [&](const Layer& layer) {
+    for (const auto& k : layer.keys) {
+      const auto s = slot(k);
+      if (votes_[s] < vote_threshold_) continue;
+      filtered.try_emplace(k, layer.values[s]);
+    }
+  };
+  // the first cost map containing the cell determines its value
+  add(layer(size_ - 1));
+  for (size_t i = 0; i + 1 < size_; ++i) add(layer(i));
+
+  return filtered;
+}
+
+}  // namespace lidar
+}  // namespace vtr
@@ -0,0 +1,64 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file pointmap_views.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include "vtr_lidar/data_types/pointmap_views.hpp"
+
+#include "vtr_logging/logging.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
+
+namespace vtr {
+namespace lidar {
+
+PointMapViews::PointMapViews(
+    const std::shared_ptr<const PointMapType> &point_map)
+    : point_map_(point_map) {
+  if (point_map_ == nullptr) {
+    std::string err{"Creating point map views without a point map."};
+    CLOG(ERROR, "lidar.pointmap_views") << err;
+    throw std::invalid_argument{err};
+  }
+}
+
+auto PointMapViews::vertexFramePointCloud() const -> const PointCloudType & {
+  std::call_once(vertex_frame_flag_, [this] {
+    const Eigen::Matrix4f T_lv_pm =
+        point_map_->T_vertex_this().matrix().cast<float>();
+    pointcloud::transformPointCloud(T_lv_pm, point_map_->point_cloud(),
+                                    vertex_frame_point_cloud_);
+    CLOG(DEBUG, "lidar.pointmap_views")
+        << "Computed the vertex frame view of submap "
+        << point_map_->vertex_id();
+  });
+  return vertex_frame_point_cloud_;
+}
+
+const KDTree<PointWithInfo> &PointMapViews::kdtree() const {
+  std::call_once(kdtree_flag_, [this] {
+    adapter_ = std::make_unique<NanoFLANNAdapter<PointWithInfo>>(
+        point_map_->point_cloud());
+    kdtree_ = std::make_unique<KDTree<PointWithInfo>>(
+        3, *adapter_, KDTreeParams(10 /* max leaf */));
+    kdtree_->buildIndex();
+    CLOG(DEBUG, "lidar.pointmap_views")
+        << "Built the kd-tree of submap " << point_map_->vertex_id();
+  });
+  return *kdtree_;
+}
+
+}  // namespace lidar
+}  // namespace vtr
@@ -29,6 +29,22 @@ namespace mesh2pcd {
 Mesh2PcdConverter::Mesh2PcdConverter(const std::string& filename,
                                      const Config& config)
     : config_(config) {
+  // rays of the depth image, same bounds as in getCandidateRays
+  // clang-format off
+  theta_offset_ = std::ceil(config_.theta_min / config_.theta_res);
+  phi_offset_ = std::ceil(config_.phi_min / config_.phi_res);
+  num_rows_ = std::max((int)std::floor(config_.theta_max / config_.theta_res) - theta_offset_ + 1, 0);
+  num_cols_ = std::max((int)std::floor(config_.phi_max / config_.phi_res) - phi_offset_ + 1, 0);
+  // clang-format on
+  rays_.reserve(num_rows_ * num_cols_);
+  for (int i = theta_offset_; i < theta_offset_ + num_rows_; ++i) {
+    for (int j = phi_offset_; j < phi_offset_ + num_cols_; ++j) {
+      const auto theta = i * config_.theta_res;
+      const auto phi = j * config_.phi_res;
+      rays_.emplace_back(utils::pol2cart(Eigen::Vector3f(1.0, theta, phi)));
+    }
+  }
+
   std::ifstream in(filename);
   if (!in.is_open())
     throw std::runtime_error("Failed to open file: " + filename);
@@ -19,6 +19,8 @@
 #include "vtr_lidar/modules/odometry/odometry_icp_module.hpp"
 
 #include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_pointcloud/icp/icp_kernels.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 
 namespace vtr {
 namespace lidar {
@@ -123,12 +125,16 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
   auto &point_map = sliding_map_odo.point_cloud();
 
   /// Parameters
+  // fewer iterations when the load controller asks for degraded operation
+  const float iter_scale =
+      qdata.load_decision ? qdata.load_decision->icp_iteration_scale : 1.0f;
   int first_steps = config_->first_num_steps;
-  int max_it = config_->initial_max_iter;
+  int max_it = std::max((int)(config_->initial_max_iter * iter_scale), 1);
+  const int refined_max_it =
+      std::max((int)(config_->refined_max_iter * iter_scale), 1);
   float max_pair_d = config_->initial_max_pairing_dist;
   float max_planar_d = config_->initial_max_planar_dist;
   float max_pair_d2 = max_pair_d * max_pair_d;
-  KDTreeSearchParams search_params;
 
   // clang-format off
   /// Create robot to sensor transform variable, fixed.
@@ -200,11 +206,7 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
 
   /// Eigen matrix of original data (only shallow copy of ref clouds)
   const auto map_mat = point_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  const auto map_normals_mat = point_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
   const auto query_mat = query_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  const auto query_norms_mat = query_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-  auto aligned_mat = aligned_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto aligned_norms_mat = aligned_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
 
   /// create kd-tree of the map
   CLOG(DEBUG, "lidar.odometry_icp") << "Start building a kd-tree of the map.";
@@ -221,14 +223,12 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
       const auto &qry_time = query_points[i].timestamp;
       const auto T_r_m_intp_eval = trajectory->getPoseInterpolator(Time(qry_time));
       const auto T_m_s_intp_eval = inverse(compose(T_s_r_var, T_r_m_intp_eval));
-      const auto T_m_s = T_m_s_intp_eval->evaluate().matrix().cast<float>();
-      aligned_mat.block<4, 1>(0, i) = T_m_s * query_mat.block<4, 1>(0, i);
-      aligned_norms_mat.block<4, 1>(0, i) = T_m_s * query_norms_mat.block<4, 1>(0, i);
+      const Eigen::Matrix4f T_m_s = T_m_s_intp_eval->evaluate().matrix().cast<float>();
+      pointcloud::transformPoint(T_m_s, query_points[i], aligned_points[i]);
     }
   } else {
-    const auto T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
-    aligned_mat = T_m_s * query_mat;
-    aligned_norms_mat = T_m_s * query_norms_mat;
+    const Eigen::Matrix4f T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
+    pointcloud::transformPointCloud(T_m_s, query_points, aligned_points, true, config_->num_threads);
   }
 
   using Stopwatch = common::timing::Stopwatch<>;
@@ -272,31 +272,15 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
 
     /// find nearest neigbors and distances
     timer[1]->start();
-    std::vector<float> nn_dists(sample_inds.size());
-#pragma omp parallel for schedule(dynamic, 10) num_threads(config_->num_threads)
-    for (size_t i = 0; i < sample_inds.size(); i++) {
-      KDTreeResultSet result_set(1);
-      result_set.init(&sample_inds[i].second, &nn_dists[i]);
-      kdtree->findNeighbors(result_set, aligned_points[sample_inds[i].first].data, search_params);
-    }
+    std::vector<float> nn_dists;
+    pointcloud::icp::findNearestNeighbors(*kdtree, aligned_points, sample_inds, nn_dists, config_->num_threads);
     timer[1]->stop();
 
     /// filtering based on distances metrics
     timer[2]->start();
-    std::vector<std::pair<size_t, size_t>> filtered_sample_inds;
-    filtered_sample_inds.reserve(sample_inds.size());
-    for (size_t i = 0; i < sample_inds.size(); i++) {
-      if (nn_dists[i] < max_pair_d2) {
-        // Check planar distance (only after a few steps for initial alignment)
-        auto diff = aligned_points[sample_inds[i].first].getVector3fMap() -
-                    point_map[sample_inds[i].second].getVector3fMap();
-        float planar_dist = std::abs(
-            diff.dot(point_map[sample_inds[i].second].getNormalVector3fMap()));
-        if (step < first_steps || planar_dist < max_planar_d) {
-          filtered_sample_inds.push_back(sample_inds[i]);
-        }
-      }
-    }
+    const pointcloud::icp::PointToPlanePolicy policy(first_steps, max_planar_d);
+    const auto filtered_sample_inds = pointcloud::icp::filterAssociations(
+        aligned_points, point_map, sample_inds, nn_dists, max_pair_d2, step, policy);
     timer[2]->stop();
 
     /// point to plane optimization
@@ -319,9 +303,8 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
 #pragma omp parallel for schedule(dynamic, 10) num_threads(config_->num_threads)
     for (const auto &ind : filtered_sample_inds) {
       // noise model W = n * n.T (information matrix)
-      if (point_map[ind.second].normal_score <= 0.0) continue;
-      Eigen::Vector3d nrm = map_normals_mat.block<3, 1>(0, ind.second).cast<double>();
-      Eigen::Matrix3d W(point_map[ind.second].normal_score * (nrm * nrm.transpose()) + 1e-5 * Eigen::Matrix3d::Identity());
+      Eigen::Matrix3d W;
+      if (!policy.information(point_map[ind.second], W)) continue;
       auto noise_model = StaticNoiseModel<3>::MakeShared(W, NoiseType::INFORMATION);
 
       // query and reference point
@@ -369,14 +352,12 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
         const auto &qry_time = query_points[i].timestamp;
         const auto T_r_m_intp_eval = trajectory->getPoseInterpolator(Time(qry_time));
         const auto T_m_s_intp_eval = inverse(compose(T_s_r_var, T_r_m_intp_eval));
-        const auto T_m_s = T_m_s_intp_eval->evaluate().matrix().cast<float>();
-        aligned_mat.block<4, 1>(0, i) = T_m_s * query_mat.block<4, 1>(0, i);
-        aligned_norms_mat.block<4, 1>(0, i) = T_m_s * query_norms_mat.block<4, 1>(0, i);
+        const Eigen::Matrix4f T_m_s = T_m_s_intp_eval->evaluate().matrix().cast<float>();
+        pointcloud::transformPoint(T_m_s, query_points[i], aligned_points[i]);
       }
     } else {
-      const auto T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
-      aligned_mat = T_m_s * query_mat;
-      aligned_norms_mat = T_m_s * query_norms_mat;
+      const Eigen::Matrix4f T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
+      pointcloud::transformPointCloud(T_m_s, query_points, aligned_points, true, config_->num_threads);
     }
 
     // Update all result matrices
@@ -421,7 +402,7 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
         // enter the second refine stage
         refinement_stage = true;
 
-        max_it = step + config_->refined_max_iter;
+        max_it = step + refined_max_it;
 
         // reduce the max distance
         max_pair_d = config_->refined_max_pairing_dist;
@@ -473,9 +454,8 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
   /// Outputs
   if (matched_points_ratio > config_->min_matched_ratio) {
     // undistort the preprocessed pointcloud
-    const auto T_s_m = T_m_s_eval->evaluate().matrix().inverse().cast<float>();
-    aligned_mat = T_s_m * aligned_mat;
-    aligned_norms_mat = T_s_m * aligned_norms_mat;
+    const Eigen::Matrix4f T_s_m = T_m_s_eval->evaluate().matrix().inverse().cast<float>();
+    pointcloud::transformPointCloud(T_s_m, aligned_points, true, config_->num_threads);
 
     auto undistorted_point_cloud = std::make_shared<pcl::PointCloud<PointWithInfo>>(aligned_points);
     cart2pol(*undistorted_point_cloud);  // correct polar coordinates.
@@ -485,14 +465,13 @@ void OdometryICPModule::run_(QueryCache &qdata0, OutputCache &,
     auto undistorted_raw_point_cloud = std::make_shared<pcl::PointCloud<PointWithInfo>>(*qdata.raw_point_cloud);
     if (config_->use_trajectory_estimation) {
       auto &raw_points = *undistorted_raw_point_cloud;
-      auto points_mat = raw_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
 #pragma omp parallel for schedule(dynamic, 10) num_threads(config_->num_threads)
       for (unsigned i = 0; i < raw_points.size(); i++) {
         const auto &qry_time = raw_points[i].timestamp;
         const auto T_rintp_m_eval = trajectory->getPoseInterpolator(Time(qry_time));
         const auto T_s_sintp_eval = inverse(compose(T_s_r_eval, compose(T_rintp_m_eval, T_m_s_eval)));
-        const auto T_s_sintp = T_s_sintp_eval->evaluate().matrix().cast<float>();
-        points_mat.block<4, 1>(0, i) = T_s_sintp * points_mat.block<4, 1>(0, i);
+        const Eigen::Matrix4f T_s_sintp = T_s_sintp_eval->evaluate().matrix().cast<float>();
+        pointcloud::transformPoint(T_s_sintp, raw_points[i], false);
       }
     }
     cart2pol(*undistorted_raw_point_cloud);
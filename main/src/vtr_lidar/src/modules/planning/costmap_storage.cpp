@@ -0,0 +1,75 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file costmap_storage.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include "vtr_lidar/modules/planning/costmap_storage.hpp"
+
+#include <mutex>
+
+#include "vtr_logging/logging.hpp"
+
+namespace vtr {
+namespace lidar {
+
+namespace {
+/// \note stored as the ROS2 message so that it can be replaced in place
+using CostMapMsg = SparseCostMap::SparseCostMapMsg;
+constexpr auto costmap_type = "vtr_lidar_msgs/msg/CostMap";
+/// makes retrieving and inserting a new cost map atomic
+std::mutex store_mutex;
+}  // namespace
+
+SparseCostMap::Ptr recallCostMap(const tactic::Graph::Ptr& graph,
+                                 const tactic::VertexId& vid,
+                                 const std::string& stream_name,
+                                 const unsigned& map_version,
+                                 const size_t& params_hash) {
+  const auto vertex = graph->at(vid);
+  const auto msg = vertex->retrieve<CostMapMsg>(stream_name, costmap_type);
+  if (msg == nullptr) return nullptr;
+  auto locked_msg = msg->sharedLocked();
+  const auto& costmap_msg = locked_msg.get().getData();
+  if (costmap_msg.map_version != map_version ||
+      costmap_msg.params_hash != params_hash) {
+    CLOG(DEBUG, "lidar.costmap")
+        << "Stored " << stream_name << " of vertex " << vid
+        << " is out of date (map version " << costmap_msg.map_version
+        << ", expected " << map_version << ").";
+    return nullptr;
+  }
+  return SparseCostMap::fromStorable(costmap_msg);
+}
+
+void storeCostMap(const tactic::Graph::Ptr& graph, const tactic::VertexId& vid,
+                  const std::string& stream_name,
+                  const SparseCostMap& costmap) {
+  const auto vertex = graph->at(vid);
+  std::lock_guard<std::mutex> lock(store_mutex);
+  const auto msg = vertex->retrieve<CostMapMsg>(stream_name, costmap_type);
+  if (msg != nullptr) {
+    auto locked_msg_ref = msg->locked();
+    locked_msg_ref.get().setData(costmap.toStorable());
+    return;
+  }
+  using CostMapLM = storage::LockableMessage<CostMapMsg>;
+  auto costmap_msg = std::make_shared<CostMapLM>(
+      std::make_shared<CostMapMsg>(costmap.toStorable()), vertex->vertexTime());
+  vertex->insert<CostMapMsg>(stream_name, costmap_type, costmap_msg);
+}
+
+}  // namespace lidar
+}  // namespace vtr
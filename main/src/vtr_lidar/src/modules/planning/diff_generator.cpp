@@ -22,6 +22,7 @@
 #include "vtr_lidar/filters/voxel_downsample.hpp"
 
 #include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 
 namespace vtr {
 namespace lidar {
@@ -105,51 +106,30 @@ void DifferenceDetector::run_(QueryCache &qdata0, OutputCache &output0,
   
   voxelDownsample(query_points, config_->voxel_size);
 
-  // Eigen matrix of original data (only shallow copy of ref clouds)
-  const auto query_mat = query_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  const auto query_norms_mat = query_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-
-
-  const auto map_mat = map_point_cloud.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  const auto map_norms_mat = map_point_cloud.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
+  const Eigen::Matrix4f T_s_m = (T_s_r * T_r_v_loc * T_v_m_loc).matrix().cast<float>();
+  const Eigen::Matrix4f T_m_s = (T_s_r * T_r_v_loc * T_v_m_loc).inverse().matrix().cast<float>();
 
   // retrieve the pre-processed scan and convert it to the local map frame
-  pcl::PointCloud<PointWithInfo> aligned_points(query_points);
-  auto aligned_mat = aligned_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto aligned_norms_mat = aligned_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-
-  const auto T_s_m = (T_s_r * T_r_v_loc * T_v_m_loc).matrix();
-  const auto T_m_s = (T_s_r * T_r_v_loc * T_v_m_loc).inverse().matrix();
-  aligned_mat = T_m_s.cast<float>() * query_mat;
-  aligned_norms_mat = T_m_s.cast<float>() * query_norms_mat;
-
-  pcl::PointCloud<PointWithInfo> aligned_map(map_point_cloud);
-  auto aligned_map_mat = aligned_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto aligned_map_norms_mat = aligned_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
+  pcl::PointCloud<PointWithInfo> aligned_points;
+  pointcloud::transformPointCloud(T_m_s, query_points, aligned_points);
 
   //Put map into lidar frame
-  aligned_map_mat = T_s_m.cast<float>() * map_mat;
-  aligned_map_norms_mat = T_s_m.cast<float>() * map_norms_mat;
-
+  pcl::PointCloud<PointWithInfo> aligned_map;
+  pointcloud::transformPointCloud(T_s_m, map_point_cloud, aligned_map);
 
   velodyneCart2Pol(aligned_map);
 
   // create kd-tree of the map
   //Could this be done ahead of time and stored?
   NanoFLANNAdapter<PointWithInfo> adapter(aligned_map);//, config_->angle_weight);
-  KDTreeSearchParams search_params;
   KDTreeParams tree_params(10 /* max leaf */);
   auto kdtree = std::make_unique<KDTree<PointWithInfo>>(3, adapter, tree_params);
   kdtree->buildIndex();
 
-  std::vector<long unsigned> nn_inds(query_points.size());
-  std::vector<float> nn_dists(query_points.size(), -1.0f);
+  std::vector<size_t> nn_inds;
+  std::vector<float> nn_dists;
   // compute nearest neighbors and point to point distances
-  for (size_t i = 0; i < query_points.size(); i++) {
-    KDTreeResultSet result_set(1);
-    result_set.init(&nn_inds[i], &nn_dists[i]);
-    kdtree->findNeighbors(result_set, query_points[i].data, search_params);
-  }
+  batchNearestNeighbors(*kdtree, query_points, nn_inds, nn_dists);
 
   std::vector<int> diff_indices;
   for (size_t i = 0; i < query_points.size(); i++) {
@@ -162,15 +142,8 @@ void DifferenceDetector::run_(QueryCache &qdata0, OutputCache &output0,
   // add support region
  
   // retrieve the pre-processed scan and convert it to the vertex frame
-  pcl::PointCloud<PointWithInfo> aligned_points2(aligned_points);
-  // clang-format off
-  auto aligned_mat2 = aligned_points2.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto aligned_norms_mat2 = aligned_points2.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-  // clang-format on
-
-  // transform to vertex frame
-  aligned_mat2 = T_v_m_loc.matrix().cast<float>() * aligned_mat;
-  aligned_norms_mat2 = T_v_m_loc.matrix().cast<float>() * aligned_norms_mat;
+  pcl::PointCloud<PointWithInfo> aligned_points2;
+  pointcloud::transformPointCloud(T_v_m_loc.matrix().cast<float>(), aligned_points, aligned_points2);
 
   pcl::PointCloud<PointWithInfo> filtered_points(aligned_points2, diff_indices);
 
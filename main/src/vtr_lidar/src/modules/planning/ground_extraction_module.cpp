@@ -42,11 +42,14 @@ auto GroundExtractionModule::Config::fromROS(
   config->bin_size_small = node->declare_parameter<float>(param_prefix + ".bin_size_small", config->bin_size_small);
   config->num_bins_large = (size_t)node->declare_parameter<int>(param_prefix + ".num_bins_large", config->num_bins_large);
   config->bin_size_large = node->declare_parameter<float>(param_prefix + ".bin_size_large", config->bin_size_large);
+  config->num_threads = node->declare_parameter<int>(param_prefix + ".num_threads", config->num_threads);
   // occupancy grid
   config->resolution = node->declare_parameter<float>(param_prefix + ".resolution", config->resolution);
   config->size_x = node->declare_parameter<float>(param_prefix + ".size_x", config->size_x);
   config->size_y = node->declare_parameter<float>(param_prefix + ".size_y", config->size_y);
 
+  config->persist_costmap = node->declare_parameter<bool>(param_prefix + ".persist_costmap", config->persist_costmap);
+
   config->run_async = node->declare_parameter<bool>(param_prefix + ".run_async", config->run_async);
   config->visualize = node->declare_parameter<bool>(param_prefix + ".visualize", config->visualize);
   // clang-format on
@@ -72,6 +75,72 @@ GroundExtractionModule::GroundExtractionModule(
   himmelsbach_.bin_size_small = config_->bin_size_small;
   himmelsbach_.num_bins_large = config_->num_bins_large;
   himmelsbach_.bin_size_large = config_->bin_size_large;
+  himmelsbach_.num_threads = config_->num_threads;
+  // the cost map depends on all parameters but the number of threads
+  common::hash_combine(params_hash_, config_->z_offset, config_->alpha,
+                       config_->tolerance, config_->Tm, config_->Tm_small,
+                       config_->Tb, config_->Trmse, config_->Tdprev,
+                       config_->rmin, config_->num_bins_small,
+                       config_->bin_size_small, config_->num_bins_large,
+                       config_->bin_size_large, config_->resolution,
+                       config_->size_x, config_->size_y);
+}
+
+SparseCostMap::Ptr GroundExtractionModule::computeCostMap(
+    const PointMapViews &submap,
+    pcl::PointCloud<PointWithInfo> *labeled_points) const {
+  const auto &point_map = submap.pointMap();
+  // shared with the other modules, already in vertex frame
+  const auto &point_cloud = submap.vertexFramePointCloud();
+
+  // ground extraction
+  const auto ground_idx = himmelsbach_(point_cloud);
+
+  // construct occupancy grid map
+  std::vector<PointWithInfo> ground_points;
+  ground_points.reserve(ground_idx.size());
+  std::vector<float> scores;
+  scores.reserve(ground_idx.size());
+  for (const auto &idx : ground_idx) {
+    ground_points.emplace_back(point_cloud[idx]);
+    /// \note use a range of 0.05 to 1.0 for visualization
+    /// normal of 1 maps to 0.05, 0.95- maps to 1.0
+    scores.emplace_back(
+        0.05 +
+        0.95 * std::clamp((20.0 * (1.0 - point_cloud[idx].normal_z)), 0., 1.));
+  }
+  // project to 2d and construct the grid map
+  const auto ogm = std::make_shared<SparseCostMap>(
+      config_->resolution, config_->size_x, config_->size_y);
+  ogm->update(ground_points, scores);  /// \todo currently just average scores
+  ogm->T_vertex_this() = tactic::EdgeTransform(true);  // already transformed
+  ogm->vertex_id() = point_map.vertex_id();
+  ogm->map_version() = point_map.version();
+  ogm->params_hash() = params_hash_;
+
+  if (labeled_points != nullptr) {
+    // color the points for visualization
+    *labeled_points = point_cloud;
+    for (auto &&point : *labeled_points) point.flex11 = 0;
+    for (const auto &idx : ground_idx) (*labeled_points)[idx].flex11 = 1;
+  }
+  return ogm;
+}
+
+SparseCostMap::Ptr GroundExtractionModule::getCostMap(const Graph::Ptr &graph,
+                                       const PointMapViews &submap) const {
+  const auto &point_map = submap.pointMap();
+  const auto &map_vid = point_map.vertex_id();
+  auto ogm = recallCostMap(graph, map_vid, costmap_stream, point_map.version(),
+                           params_hash_);
+  if (ogm != nullptr) {
+    CLOG(DEBUG, "lidar.ground_extraction")
+        << "Recalled the cost map stored with submap " << map_vid;
+    return ogm;
+  }
+  ogm = computeCostMap(submap);
+  storeCostMap(graph, map_vid, costmap_stream, *ogm);
+  return ogm;
 }
 
 void GroundExtractionModule::run_(QueryCache &qdata0, OutputCache &output0,
@@ -97,7 +166,7 @@ void GroundExtractionModule::run_(QueryCache &qdata0, OutputCache &output0,
 }
 
 void GroundExtractionModule::runAsync_(QueryCache &qdata0, OutputCache &output0,
-                                       const Graph::Ptr &,
+                                       const Graph::Ptr &graph,
                                        const TaskExecutor::Ptr &,
                                        const Task::Priority &,
                                        const Task::DepId &) {
@@ -126,44 +195,21 @@ void GroundExtractionModule::runAsync_(QueryCache &qdata0, OutputCache &output0,
   // input
   const auto &loc_vid = *qdata.vid_loc;
   const auto &loc_sid = *qdata.sid_loc;
-  const auto &point_map = *qdata.submap_loc;
-  const auto &T_lv_pm = point_map.T_vertex_this().matrix();
-  auto point_cloud = point_map.point_cloud();  // copy for changing
+  const auto &submap = *qdata.submap_loc_views;
 
   CLOG(INFO, "lidar.ground_extraction")
       << "Ground Extraction for vertex: " << loc_vid;
 
-  // transform into vertex frame
-  // clang-format off
-  auto points_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto normal_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::normal_offset());
-  // clang-format on
-  Eigen::Matrix3f C_lv_pm = (T_lv_pm.block<3, 3>(0, 0)).cast<float>();
-  Eigen::Vector3f r_lv_pm = (T_lv_pm.block<3, 1>(0, 3)).cast<float>();
-  points_mat = ((C_lv_pm * points_mat).colwise() + r_lv_pm).eval();
-  normal_mat = (C_lv_pm * normal_mat).eval();
-
-  // ground extraction
-  const auto ground_idx = himmelsbach_(point_cloud);
-
-  // construct occupancy grid map
-  std::vector<PointWithInfo> ground_points;
-  ground_points.reserve(ground_idx.size());
-  std::vector<float> scores;
-  scores.reserve(ground_idx.size());
-  for (const auto &idx : ground_idx) {
-    ground_points.emplace_back(point_cloud[idx]);
-    /// \note use a range of 0.05 to 1.0 for visualization
-    /// normal of 1 maps to 0.05, 0.95- maps to 1.0
-    scores.emplace_back(
-        0.05 +
-        0.95 * std::clamp((20.0 * (1.0 - point_cloud[idx].normal_z)), 0., 1.));
-  }
-  // project to 2d and construct the grid map
-  const auto ogm = std::make_shared<SparseCostMap>(
-      config_->resolution, config_->size_x, config_->size_y);
-  ogm->update(ground_points, scores);  /// \todo currently just average scores
-  ogm->T_vertex_this() = tactic::EdgeTransform(true);  // already transformed
+  // the labeled submap points are only published offline
+  const bool offline = !(output.chain.valid() && qdata.sid_loc.valid());
+  pcl::PointCloud<PointWithInfo> point_cloud;
+  SparseCostMap::Ptr ogm;
+  if (config_->visualize && offline)
+    ogm = computeCostMap(submap, &point_cloud);
+  else if (config_->persist_costmap)
+    ogm = getCostMap(graph, submap);
+  else
+    ogm = computeCostMap(submap);
   ogm->vertex_id() = loc_vid;
   ogm->vertex_sid() = loc_sid;
 
@@ -186,10 +232,7 @@ void GroundExtractionModule::runAsync_(QueryCache &qdata0, OutputCache &output0,
     msg.child_frame_id = "ground extraction";
     tf_bc_->sendTransform(msg);
 
-    if (!(output.chain.valid() && qdata.sid_loc.valid())) {
-      // color the points for visualization
-      for (auto &&point : point_cloud) point.flex11 = 0;
-      for (const auto &idx : ground_idx) point_cloud[idx].flex11 = 1;
+    if (offline) {
       // publish the transformed map (now in vertex frame)
       PointCloudMsg pc2_msg;
       pcl::toROSMsg(point_cloud, pc2_msg);
@@ -36,6 +36,8 @@ auto ObstacleDetectionModule::Config::fromROS(
   config->size_x = node->declare_parameter<float>(param_prefix + ".size_x", config->size_x);
   config->size_y = node->declare_parameter<float>(param_prefix + ".size_y", config->size_y);
 
+  config->persist_costmap = node->declare_parameter<bool>(param_prefix + ".persist_costmap", config->persist_costmap);
+
   config->run_async = node->declare_parameter<bool>(param_prefix + ".run_async", config->run_async);
   config->visualize = node->declare_parameter<bool>(param_prefix + ".visualize", config->visualize);
   // clang-format on
@@ -46,7 +48,68 @@ ObstacleDetectionModule::ObstacleDetectionModule(
     const Config::ConstPtr &config,
     const std::shared_ptr<tactic::ModuleFactory> &module_factory,
     const std::string &name)
-    : tactic::BaseModule{module_factory, name}, config_(config) {}
+    : tactic::BaseModule{module_factory, name}, config_(config) {
+  common::hash_combine(params_hash_, config_->z_min, config_->z_max,
+                       config_->resolution, config_->size_x, config_->size_y);
+}
+
+SparseCostMap::Ptr ObstacleDetectionModule::computeCostMap(
+    const PointMapViews &submap,
+    pcl::PointCloud<PointWithInfo> *labeled_points) const {
+  const auto &point_map = submap.pointMap();
+  // shared with the other modules, already in vertex frame
+  const auto &point_cloud = submap.vertexFramePointCloud();
+
+  // obstacle detection
+  std::vector<size_t> obstacle_idx;
+  obstacle_idx.reserve(point_cloud.size());
+  for (size_t i = 0; i < point_cloud.size(); ++i) {
+    if (point_cloud[i].z > config_->z_min && point_cloud[i].z < config_->z_max)
+      obstacle_idx.emplace_back(i);
+  }
+
+  // construct occupancy grid map
+  std::vector<PointWithInfo> obstacle_points;
+  obstacle_points.reserve(obstacle_idx.size());
+  std::vector<float> scores;
+  scores.reserve(obstacle_idx.size());
+  for (const auto &idx : obstacle_idx) {
+    obstacle_points.emplace_back(point_cloud[idx]);
+    scores.emplace_back(1.0f);
+  }
+  // project to 2d and construct the grid map
+  const auto ogm = std::make_shared<SparseCostMap>(
+      config_->resolution, config_->size_x, config_->size_y);
+  ogm->update(obstacle_points, scores);  /// \todo currently just average scores
+  ogm->T_vertex_this() = tactic::EdgeTransform(true);  // already transformed
+  ogm->vertex_id() = point_map.vertex_id();
+  ogm->map_version() = point_map.version();
+  ogm->params_hash() = params_hash_;
+
+  if (labeled_points != nullptr) {
+    // color the points for visualization
+    *labeled_points = point_cloud;
+    for (auto &&point : *labeled_points) point.flex11 = 0;
+    for (const auto &idx : obstacle_idx) (*labeled_points)[idx].flex11 = 1;
+  }
+  return ogm;
+}
+
+SparseCostMap::Ptr ObstacleDetectionModule::getCostMap(const Graph::Ptr &graph,
+                                       const PointMapViews &submap) const {
+  const auto &point_map = submap.pointMap();
+  const auto &map_vid = point_map.vertex_id();
+  auto ogm = recallCostMap(graph, map_vid, costmap_stream, point_map.version(),
+                           params_hash_);
+  if (ogm != nullptr) {
+    CLOG(DEBUG, "lidar.obstacle_detection")
+        << "Recalled the cost map stored with submap " << map_vid;
+    return ogm;
+  }
+  ogm = computeCostMap(submap);
+  storeCostMap(graph, map_vid, costmap_stream, *ogm);
+  return ogm;
+}
 
 void ObstacleDetectionModule::run_(QueryCache &qdata0, OutputCache &output0,
                                    const Graph::Ptr &graph,
@@ -71,7 +134,7 @@ void ObstacleDetectionModule::run_(QueryCache &qdata0, OutputCache &output0,
 }
 
 void ObstacleDetectionModule::runAsync_(
-    QueryCache &qdata0, OutputCache &output0, const Graph::Ptr &,
+    QueryCache &qdata0, OutputCache &output0, const Graph::Ptr &graph,
     const TaskExecutor::Ptr &, const Task::Priority &, const Task::DepId &) {
   auto &qdata = dynamic_cast<LidarQueryCache &>(qdata0);
   auto &output = dynamic_cast<LidarOutputCache &>(output0);
@@ -97,45 +160,21 @@ void ObstacleDetectionModule::runAsync_(
 
   // input
   const auto &loc_vid = *qdata.vid_loc;
-  const auto &point_map = *qdata.submap_loc;
-  const auto &T_lv_pm = point_map.T_vertex_this().matrix();
-  auto point_cloud = point_map.point_cloud();  // copy for changing
+  const auto &submap = *qdata.submap_loc_views;
 
   CLOG(INFO, "lidar.obstacle_detection")
       << "Obstacle Detection for vertex: " << loc_vid;
 
-  // transform into vertex frame
-  // clang-format off
-  auto points_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto normal_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::normal_offset());
-  // clang-format on
-  Eigen::Matrix3f C_lv_pm = (T_lv_pm.block<3, 3>(0, 0)).cast<float>();
-  Eigen::Vector3f r_lv_pm = (T_lv_pm.block<3, 1>(0, 3)).cast<float>();
-  points_mat = ((C_lv_pm * points_mat).colwise() + r_lv_pm).eval();
-  normal_mat = (C_lv_pm * normal_mat).eval();
-
-  // obstacle detection
-  std::vector<size_t> obstacle_idx;
-  obstacle_idx.reserve(point_cloud.size());
-  for (size_t i = 0; i < point_cloud.size(); ++i) {
-    if (point_cloud[i].z > config_->z_min && point_cloud[i].z < config_->z_max)
-      obstacle_idx.emplace_back(i);
-  }
-
-  // construct occupancy grid map
-  std::vector<PointWithInfo> obstacle_points;
-  obstacle_points.reserve(obstacle_idx.size());
-  std::vector<float> scores;
-  scores.reserve(obstacle_idx.size());
-  for (const auto &idx : obstacle_idx) {
-    obstacle_points.emplace_back(point_cloud[idx]);
-    scores.emplace_back(1.0f);
-  }
-  // project to 2d and construct the grid map
-  const auto ogm = std::make_shared<SparseCostMap>(
-      config_->resolution, config_->size_x, config_->size_y);
-  ogm->update(obstacle_points, scores);  /// \todo currently just average scores
-  ogm->T_vertex_this() = tactic::EdgeTransform(true);  // already transformed
+  // the labeled submap points are only published offline
+  const bool offline = !(output.chain.valid() && qdata.sid_loc.valid());
+  pcl::PointCloud<PointWithInfo> point_cloud;
+  SparseCostMap::Ptr ogm;
+  if (config_->visualize && offline)
+    ogm = computeCostMap(submap, &point_cloud);
+  else if (config_->persist_costmap)
+    ogm = getCostMap(graph, submap);
+  else
+    ogm = computeCostMap(submap);
   ogm->vertex_id() = loc_vid;
 
   /// publish the transformed pointcloud
@@ -154,10 +193,7 @@ void ObstacleDetectionModule::runAsync_(
     msg.child_frame_id = "obstacle detection";
     tf_bc_->sendTransform(msg);
 
-    if (!(output.chain.valid() && qdata.sid_loc.valid())) {
-      // color the points for visualization
-      for (auto &&point : point_cloud) point.flex11 = 0;
-      for (const auto &idx : obstacle_idx) point_cloud[idx].flex11 = 1;
+    if (offline) {
       // publish the transformed map (now in vertex frame)
       PointCloudMsg pc2_msg;
       pcl::toROSMsg(point_cloud, pc2_msg);
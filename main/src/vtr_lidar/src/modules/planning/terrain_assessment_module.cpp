@@ -18,9 +18,7 @@
  */
 #include "vtr_lidar/modules/planning/terrain_assessment_module.hpp"
 
-#include "pcl/features/normal_3d.h"
-
-#include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_lidar/modules/planning/terrain_assessment_ops.hpp"
 
 namespace vtr {
 namespace lidar {
@@ -53,39 +51,9 @@ class ComputeCorridorOp {
     }
   }
 
-  void operator()(const Eigen::Vector2f &q, float &v) const {
-    // use the following convention (all points are (x, y)):
-    //   q  - query point (center of the cell)
-    //   p  - projected point on to the line segment
-    //   xs - start point of the line segment
-    //   xe - end point of the line segment
-    std::vector<float> distances;
-    distances.reserve(T_curr_query_xy_vec.size() + 1);
-
-    // distance to the first vertex along the map
-    distances.emplace_back((q - T_curr_query_xy_vec.front()).norm());
-    // distance to intermediate line segments
-    if (T_curr_query_xy_vec.size() > 1) {
-      for (size_t i = 0; i < T_curr_query_xy_vec.size() - 1; ++i) {
-        const auto &xs = T_curr_query_xy_vec[i];
-        const auto &xe = T_curr_query_xy_vec[i + 1];
-        float alpha = (q - xs).dot(xe - xs) / (xe - xs).squaredNorm();
-        alpha = std::clamp(alpha, 0.0f, 1.0f);
-        const auto p = xs + alpha * (xe - xs);
-        distances.emplace_back((q - p).norm());
-      }
-    }
-    // distance to the last vertex along the path
-    distances.emplace_back((q - T_curr_query_xy_vec.back()).norm());
-
-    // find the minimum distance
-    const auto min_dist = *std::min_element(distances.begin(), distances.end());
-#if false
-    CLOG(DEBUG, "lidar.terrain_assessment")
-        << "distances of: <" << q(0) << "," << q(1) << ">: " << distances;
-#endif
-    // update the value of v
-    v = min_dist > width_ ? v : 1;
+  /** \brief Sets cells within the corridor to 1 */
+  void rasterize(DenseCostMap &costmap) const {
+    rasterizeCorridor(costmap, T_curr_query_xy_vec, width_);
   }
 
   std::vector<Eigen::Matrix4d> T_curr_query_vec;
@@ -96,92 +64,6 @@ class ComputeCorridorOp {
   const float width_;
 };
 
-template <typename PointT>
-class AssessTerrainOp {
- public:
-  AssessTerrainOp(const pcl::PointCloud<PointT> &points,
-                  const float &search_radius)
-      : points_(points),
-        sq_search_radius_(search_radius * search_radius),
-        adapter_(points) {
-    /// create kd-tree of the point cloud for radius search
-    kdtree_ = std::make_unique<KDTree<PointT>>(2, adapter_,
-                                               KDTreeParams(10 /* max leaf */));
-    kdtree_->buildIndex();
-    // search params setup
-    search_params_.sorted = false;
-  }
-
-  void operator()(const Eigen::Vector2f &point, float &value) const {
-    /// find the nearest neighbors
-    std::vector<std::pair<size_t, float>> inds_dists;
-    size_t num_neighbors = kdtree_->radiusSearch(
-        point.data(), sq_search_radius_, inds_dists, search_params_);
-
-    if (num_neighbors < 5) {
-#if false
-      CLOG(WARNING, "lidar.terrain_assessment")
-          << "looking at point: <" << x << "," << y << ">, roughness: 0"
-          << " (no enough neighbors)";
-#endif
-      // \todo 0.0 should not mean no enough neighbors
-      value = 0.0;
-      return;
-    }
-
-    std::vector<int> indices(num_neighbors);
-    for (size_t i = 0; i < num_neighbors; i++) indices[i] = inds_dists[i].first;
-
-    /// apply pca to compute the roughness
-    // get points for computation
-    const pcl::PointCloud<PointT> query_points(points_, indices);
-
-    // Placeholder for the 3x3 covariance matrix at each surface patch
-    Eigen::Matrix3f covariance_matrix;
-    // 16-bytes aligned placeholder for the XYZ centroid of a surface patch
-    Eigen::Vector4f xyz_centroid;
-
-    // Estimate the XYZ centroid
-    pcl::compute3DCentroid(query_points, xyz_centroid);
-    // Compute the 3x3 covariance matrix
-    pcl::computeCovarianceMatrix(query_points, xyz_centroid, covariance_matrix);
-
-    // Compute pca
-    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> es;
-    es.compute(covariance_matrix);
-
-    // compute the roughness (smallest eigenvalue)
-    float roughness = std::abs(es.eigenvalues()(0));
-#if false
-    // compute the slope of the surface (1 is vertical, 0 is horizontal)
-    float slope = std::abs(es.eigenvectors()(0, 2));
-    // compute the step height (max difference between points)
-    std::vector<float> z_values(num_neighbors);
-    for (size_t i = 0; i < num_neighbors; i++) z_values[i] = query_points[i].z;
-    std::sort(z_values.begin(), z_values.end());
-    // \todo consider using the 90 percentile
-    float step_height = z_values[num_neighbors - 1] - z_values[0];
-#endif
-#if false
-    CLOG(DEBUG, "lidar.terrain_assessment")
-        << "looking at point: <" << x << "," << y
-        << ">, roughness: " << roughness;
-#endif
-    value = roughness;  /// \todo use slope and step height as well
-  }
-
- private:
-  /** \brief reference to the point cloud */
-  const pcl::PointCloud<PointT> &points_;
-
-  /** \brief squared search radius */
-  const float sq_search_radius_;
-
-  KDTreeSearchParams search_params_;
-  NanoFLANNAdapter<PointT> adapter_;
-  std::unique_ptr<KDTree<PointT>> kdtree_;
-};
-
 }  // namespace
 
 using namespace tactic;
@@ -195,6 +77,7 @@ auto TerrainAssessmentModule::Config::fromROS(
   config->corridor_lookahead_distance = node->declare_parameter<float>(param_prefix + ".corridor_lookahead_distance", config->corridor_lookahead_distance);
   config->corridor_width = node->declare_parameter<float>(param_prefix + ".corridor_width", config->corridor_width);
   // terrain assessment
+  config->assess_terrain = node->declare_parameter<bool>(param_prefix + ".assess_terrain", config->assess_terrain);
   config->search_radius = node->declare_parameter<float>(param_prefix + ".search_radius", config->search_radius);
   // cost map
   config->resolution = node->declare_parameter<float>(param_prefix + ".resolution", config->resolution);
@@ -267,35 +150,27 @@ void TerrainAssessmentModule::runAsync_(
   const auto &chain = *output.chain;
   const auto &loc_vid = *qdata.vid_loc;
   const auto &loc_sid = *qdata.sid_loc;
-  const auto &point_map = *qdata.submap_loc;
-  const auto &T_lv_pm = point_map.T_vertex_this().matrix();
-  auto point_cloud = point_map.point_cloud();  // copy for changing
+  // shared with the other modules, already in vertex frame
+  const auto &point_cloud = qdata.submap_loc_views->vertexFramePointCloud();
 
   CLOG(INFO, "lidar.terrain_assessment")
       << "Terrain Assessment for vertex: " << loc_vid;
 
-  // transform into vertex frame
-  // clang-format off
-  auto points_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto normal_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::normal_offset());
-  // clang-format on
-  Eigen::Matrix3f C_lv_pm = (T_lv_pm.block<3, 3>(0, 0)).cast<float>();
-  Eigen::Vector3f r_lv_pm = (T_lv_pm.block<3, 1>(0, 3)).cast<float>();
-  points_mat = ((C_lv_pm * points_mat).colwise() + r_lv_pm).eval();
-  normal_mat = (C_lv_pm * normal_mat).eval();
-
   // construct the cost map
   const auto costmap = std::make_shared<DenseCostMap>(
       config_->resolution, config_->size_x, config_->size_y);
-  // // update cost map based on terrain assessment result
-  // AssessTerrainOp<PointWithInfo> assess_terrain_op(point_cloud,
-  //                                                  config_->search_radius);
-  // costmap->update(assess_terrain_op);
+  // update cost map based on terrain assessment result
+  if (config_->assess_terrain) {
+    AssessTerrainOp assess_terrain_op(point_cloud, config_->resolution,
+                                      config_->size_x, config_->size_y,
+                                      config_->search_radius);
+    costmap->update(assess_terrain_op);
+  }
   // mask out the robot footprint during teach pass
   ComputeCorridorOp compute_corridor_op(loc_sid, chain,
                                         config_->corridor_lookahead_distance,
                                         config_->corridor_width);
-  costmap->update(compute_corridor_op);
+  compute_corridor_op.rasterize(*costmap);
   // add transform to the localization vertex
   costmap->T_vertex_this() = tactic::EdgeTransform(true);
   costmap->vertex_id() = loc_vid;
@@ -45,6 +45,7 @@ auto DynamicDetectionModule::Config::fromROS(
   config->max_num_observations = node->declare_parameter<int>(param_prefix + ".max_num_observations", config->max_num_observations);
   config->min_num_observations = node->declare_parameter<int>(param_prefix + ".min_num_observations", config->min_num_observations);
   config->dynamic_threshold = node->declare_parameter<float>(param_prefix + ".dynamic_threshold", config->dynamic_threshold);
+  config->num_threads = node->declare_parameter<int>(param_prefix + ".num_threads", config->num_threads);
   // general
   config->visualize = node->declare_parameter<bool>(param_prefix + ".visualize", config->visualize);
   // clang-format on
@@ -185,7 +186,9 @@ void DynamicDetectionModule::runAsync_(QueryCache &qdata0, OutputCache &,
   // cache all the transforms so we only calculate them once
   pose_graph::PoseCache<GraphBase> pose_cache(subgraph, target_vid);
 
-  size_t num_scan_used = 0;
+  // collect the vertices to ray trace through with their transforms (pose
+  // cache is not thread safe)
+  std::vector<std::pair<Vertex::Ptr, EdgeTransform>> scan_vertices;
   auto itr = subgraph->begin(target_vid);
   for (; itr != subgraph->end(); itr++) {
     //
@@ -195,51 +198,58 @@ void DynamicDetectionModule::runAsync_(QueryCache &qdata0, OutputCache &,
     auto T_target_curr = pose_cache.T_root_query(vertex->id());
     CLOG(DEBUG, "lidar.dynamic_detection")
         << "T_target_curr is " << T_target_curr.vec().transpose();
+    scan_vertices.emplace_back(vertex, T_target_curr);
+  }
 
-    // retrieve point scan from this vertex
-    const auto scan_msg = vertex->retrieve<PointScan<PointWithInfo>>(
-        "filtered_point_cloud", "vtr_lidar_msgs/msg/PointScan");
-
-    /// \note follow the convention to lock point map first then these scans.
-    auto pointscan = scan_msg->sharedLocked().get().getData();
+  common::timing::Stopwatch<> timer;
 
-    //
-    const auto &reference = pointscan.point_cloud();
-    auto &query = updated_map.point_cloud();
-    const auto T_ref_qry =
-        (T_target_curr * pointscan.T_vertex_this()).inverse() *
-        updated_map.T_vertex_this();
-
-    //
-    detectDynamicObjects(
-        reference, query, T_ref_qry, config_->horizontal_resolution,
-        config_->vertical_resolution, config_->max_num_observations,
-        config_->min_num_observations, config_->dynamic_threshold);
-
-#if false  // debugging
-    if (config_->visualize) {
-      const auto T_qry_ref = T_ref_qry.inverse().matrix().cast<float>();
-      auto reference_tmp = reference;
-      auto reference_mat = reference_tmp.getMatrixXfMap(
-          4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-      reference_mat = T_qry_ref * reference_mat;
-
-      std::unique_lock<std::mutex> lock(mutex_);
+  // load and ray trace the scans in parallel, so that loading a scan overlaps
+  // with tracing the others; each thread counts the observations of its scans,
+  // the counts are merged at the end
+  const int num_scans = (int)scan_vertices.size();
+  const auto &query = updated_map.point_cloud();
+  ray_tracing::Observations observations(query.size());
+#pragma omp parallel num_threads(config_->num_threads)
+  {
+    // frustum grid and counts reused for all scans traced by this thread
+    ray_tracing::FrustumGrid frustum_grid(config_->horizontal_resolution,
+                                          config_->vertical_resolution);
+    ray_tracing::Observations thread_observations(query.size());
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < num_scans; ++i) {
+      const auto &[vertex, T_target_curr] = scan_vertices[i];
+
+      // retrieve point scan from this vertex
+      const auto scan_msg = vertex->retrieve<PointScan<PointWithInfo>>(
+          "filtered_point_cloud", "vtr_lidar_msgs/msg/PointScan");
+      Eigen::Matrix4f T_ref_qry;
       {
-        PointCloudMsg pc2_msg;
-        pcl::toROSMsg(reference_tmp, pc2_msg);
-        pc2_msg.header.frame_id = "world";
-        // pc2_msg.header.stamp = 0;
-        scan_pub_->publish(pc2_msg);
+        auto locked_scan_msg_ref = scan_msg->sharedLocked();  // lock the msg
+        const auto &pointscan = locked_scan_msg_ref.get().getData();
+        T_ref_qry = ((T_target_curr * pointscan.T_vertex_this()).inverse() *
+                     updated_map.T_vertex_this())
+                        .matrix()
+                        .cast<float>();
+        frustum_grid.reset(pointscan.point_cloud());
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+      ray_tracing::traceObservations(frustum_grid, query, T_ref_qry,
+                                     thread_observations);
     }
-#endif
-    //
-    ++num_scan_used;
+#pragma omp critical(dynamic_detection_merge_observations)
+    observations += thread_observations;
   }
+  if (num_scans > 0)
+    ray_tracing::updateStaticScores(observations, updated_map.point_cloud(),
+                                    config_->max_num_observations,
+                                    config_->min_num_observations);
+
+  timer.stop();
+  const double time_per_scan =
+      timer.count<std::chrono::microseconds>() / 1e3 / std::max(num_scans, 1);
   CLOG(DEBUG, "lidar.dynamic_detection")
-      << "Number of scan used: " << num_scan_used;
+      << "Number of scan used: " << num_scans << ", ray tracing time: "
+      << timer << " (" << time_per_scan << "ms per scan)";
 
   // update version
   updated_map.version() = PointMap<PointWithInfo>::DYNAMIC_REMOVED;
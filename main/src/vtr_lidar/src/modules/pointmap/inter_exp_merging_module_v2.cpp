@@ -18,10 +18,11 @@
  */
 #include "vtr_lidar/modules/pointmap/inter_exp_merging_module_v2.hpp"
 
+#include "vtr_common/timing/stopwatch.hpp"
 #include "vtr_lidar/data_types/multi_exp_pointmap.hpp"
 #include "vtr_lidar/data_types/pointmap.hpp"
 #include "vtr_lidar/data_types/pointmap_pointer.hpp"
-#include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 #include "vtr_pose_graph/path/pose_cache.hpp"
 
 namespace vtr {
@@ -41,6 +42,7 @@ auto InterExpMergingModuleV2::Config::fromROS(
   config->planar_threshold = node->declare_parameter<float>(param_prefix + ".planar_threshold", config->planar_threshold);
   config->normal_threshold = node->declare_parameter<float>(param_prefix + ".normal_threshold", config->normal_threshold);
   config->dynamic_obs_threshold = node->declare_parameter<int>(param_prefix + ".dynamic_obs_threshold", config->dynamic_obs_threshold);
+  config->num_threads = node->declare_parameter<int>(param_prefix + ".num_threads", config->num_threads);
   // general
   config->visualize = node->declare_parameter<bool>(param_prefix + ".visualize", config->visualize);
   // clang-format on
@@ -92,34 +94,22 @@ void InterExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
     }
   }
 
-  /// retrieve the map for the curr vertex
-  const auto curr_map_msg = curr_vertex->retrieve<PointMap<PointWithInfo>>(
-      "pointmap", "vtr_lidar_msgs/msg/PointMap");
-  auto pointmap = curr_map_msg->sharedLocked().get().getData();
-  auto &pointcloud = pointmap.point_cloud();
-
-#if true
-  // remove dynamic points
-  auto filter_cb = [&config = config_](PointWithInfo &query_pt) {
-    return bool(query_pt.dynamic_obs <= config->dynamic_obs_threshold);
-  };
-  pointmap.filter(filter_cb);
-#endif
-
+  /// retrieve the static points of the map for the curr vertex
+  pcl::PointCloud<PointWithInfo> points;
+  Eigen::Matrix4f T_v_m;
+  {
+    const auto curr_map_msg = curr_vertex->retrieve<PointMap<PointWithInfo>>(
+        "pointmap", "vtr_lidar_msgs/msg/PointMap");
+    auto locked_msg = curr_map_msg->sharedLocked();
+    const auto &pointmap = locked_msg.get().getData();
+    // remove dynamic points
+    points.reserve(pointmap.size());
+    for (const auto &p : pointmap.point_cloud())
+      if (p.dynamic_obs <= config_->dynamic_obs_threshold) points.push_back(p);
+    T_v_m = (T_priv_curr * pointmap.T_vertex_this()).matrix().cast<float>();
+  }
   // transform to the local frame of this vertex
-  // clang-format off
-  auto point_mat = pointcloud.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto normal_mat = pointcloud.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-  const auto T_v_m = (T_priv_curr * pointmap.T_vertex_this()).matrix().cast<float>();
-  // clang-format on
-  point_mat = T_v_m * point_mat;
-  normal_mat = T_v_m * normal_mat;
-
-  // initialize bits and multi exp obs
-  std::for_each(pointcloud.begin(), pointcloud.end(), [&](auto &p) {
-    p.bits = 1;
-    p.multi_exp_obs = 1.0;
-  });
+  pointcloud::transformPointCloud(T_v_m, points, true, config_->num_threads);
 
   /// check if we have the multiexp map for priv vertex
   using MultiExpPointMapLM =
@@ -141,74 +131,44 @@ void InterExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
         << "Created a new map for vertex: " << priv_vid;
     return mepointmap_msg;
   }();
-  auto mepointmap = mepointmap_msg->sharedLocked().get().getData();
-
-  /// Perform the map update
-  auto &exps = mepointmap.exps();
-  auto &mepointcloud = mepointmap.point_cloud();
-
-  // update transform
-  mepointmap.T_vertex_this() = tactic::EdgeTransform(true);
-  mepointmap.vertex_id() = priv_vid;
-
-  // update the experiences
-  if (exps.empty() || exps.back() != curr_vid.majorId()) {
-    // add a new experience
-    exps.push_back(curr_vid.majorId());
-    // remove oldest experience
-    if (exps.size() > mepointmap.max_num_exps()) exps.pop_front();
-    //
-    std::for_each(mepointmap.point_cloud().begin(),
-                  mepointmap.point_cloud().end(),
-                  [&](auto &p) { p.bits <<= 1; });
-    /// \todo filter out points with no observations
 
-    CLOG(INFO, "lidar.inter_exp_merging")
-        << "Added a new experience with id: " << curr_vid.majorId();
-  }
+  /// Perform the map update in place
+  PointCloudMsg mepointmap_pc2_msg;
+  {
+    common::timing::Stopwatch<> timer;
+    auto locked_msg = mepointmap_msg->locked();
+    auto &mepointmap = locked_msg.get().getDataMutable();
+
+    // update transform
+    mepointmap.T_vertex_this() = tactic::EdgeTransform(true);
+    mepointmap.vertex_id() = priv_vid;
+
+    // update the experiences
+    const auto &exps = mepointmap.exps();
+    if (exps.empty() || exps.back() != curr_vid.majorId()) {
+      // add a new experience (bit vectors of the points are aged lazily)
+      mepointmap.addExperience(curr_vid.majorId());
+      /// \todo filter out points with no observations
 
-  // update existing point observations
-  NanoFLANNAdapter<PointWithInfo> adapter(mepointcloud);
-  KDTreeSearchParams search_params;
-  KDTreeParams tree_params(/* max leaf */ 10);
-  auto kdtree =
-      std::make_unique<KDTree<PointWithInfo>>(3, adapter, tree_params);
-  kdtree->buildIndex();
-
-  const auto sq_radius =
-      config_->distance_threshold * config_->distance_threshold;
-  for (const auto &pt : pointcloud) {
-    std::vector<float> dists;
-    std::vector<int> indices;
-    NanoFLANNRadiusResultSet<float, int> result(sq_radius, dists, indices);
-    kdtree->radiusSearchCustomCallback(pt.data, result, search_params);
-
-    for (const auto &idx : indices) {
-      auto &pt2 = mepointcloud[idx];
-
-      // check point to plane distance - todo: replace by
-      const auto diff = pt.getVector3fMap() - pt2.getVector3fMap();
-      const auto planar_dist = std::abs(pt2.getNormalVector3fMap().dot(diff));
-      if (planar_dist > config_->planar_threshold) continue;
-
-      // check normal consistency
-      const auto normal_dist =
-          std::abs(pt2.getNormalVector3fMap().dot(pt.getNormalVector3fMap()));
-      if (normal_dist < config_->normal_threshold) continue;
-
-      // updated the point
-      if ((pt2.bits & 1) == 0) {
-        pt2.bits++;
-        pt2.multi_exp_obs += 1.0;
-      }
+      CLOG(INFO, "lidar.inter_exp_merging")
+          << "Added a new experience with id: " << curr_vid.majorId();
     }
-  }
 
-  // update the map with new points
-  mepointmap.update(pointcloud);
+    // update existing point observations
+    mepointmap.observe(points, config_->distance_threshold,
+                       config_->planar_threshold, config_->normal_threshold,
+                       config_->num_threads);
 
-  // update the point map of this vertex
-  mepointmap_msg->locked().get().setData(mepointmap);
+    // update the map with new points
+    mepointmap.addPoints(points);
+
+    CLOG(DEBUG, "lidar.inter_exp_merging")
+        << "Merged " << points.size() << " points into a map of "
+        << mepointmap.size() << " points in " << timer;
+
+    if (config_->visualize)
+      pcl::toROSMsg(mepointmap.point_cloud(), mepointmap_pc2_msg);
+  }
 
   if (config_->visualize) {
     std::unique_lock<std::mutex> lock(mutex_);
@@ -216,7 +176,7 @@ void InterExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
     // publish the curr map
     {
       PointCloudMsg pc2_msg;
-      pcl::toROSMsg(pointmap.point_cloud(), pc2_msg);
+      pcl::toROSMsg(points, pc2_msg);
       pc2_msg.header.frame_id = "world";
       // pc2_msg.header.stamp = 0;
       single_exp_map_pub_->publish(pc2_msg);
@@ -224,11 +184,9 @@ void InterExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
 
     // publish the updated map (will already be in vertex frame)
     {
-      PointCloudMsg pc2_msg;
-      pcl::toROSMsg(mepointmap.point_cloud(), pc2_msg);
-      pc2_msg.header.frame_id = "world";
+      mepointmap_pc2_msg.header.frame_id = "world";
       // pc2_msg.header.stamp = 0;
-      multi_exp_map_pub_->publish(pc2_msg);
+      multi_exp_map_pub_->publish(mepointmap_pc2_msg);
     }
   }
 
@@ -19,6 +19,7 @@
 #include "vtr_lidar/modules/pointmap/intra_exp_merging_module.hpp"
 
 #include "vtr_lidar/data_types/pointmap.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 #include "vtr_pose_graph/path/pose_cache.hpp"
 
 namespace vtr {
@@ -137,18 +138,11 @@ void IntraExpMergingModule::runAsync_(QueryCache &qdata0, OutputCache &,
 
     for (const auto &scan_msg : scan_msgs) {
       auto point_scan = scan_msg->sharedLocked().get().getData();  // COPY!
-      const auto &T_v_s = (T_target_curr * point_scan.T_vertex_this()).matrix();
+      const Eigen::Matrix4f T_v_s =
+          (T_target_curr * point_scan.T_vertex_this()).matrix().cast<float>();
       auto &point_cloud = point_scan.point_cloud();
-      // eigen mapping
-      auto scan_mat = point_cloud.getMatrixXfMap(
-          3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-      auto scan_normal_mat = point_cloud.getMatrixXfMap(
-          3, PointWithInfo::size(), PointWithInfo::normal_offset());
       // transform to the local frame of this vertex
-      Eigen::Matrix3f C_v_s = (T_v_s.block<3, 3>(0, 0)).cast<float>();
-      Eigen::Vector3f r_s_v_in_v = (T_v_s.block<3, 1>(0, 3)).cast<float>();
-      scan_mat = (C_v_s * scan_mat).colwise() + r_s_v_in_v;
-      scan_normal_mat = C_v_s * scan_normal_mat;
+      pointcloud::transformPointCloud(T_v_s, point_cloud);
       // store this scan into the updatd map;
       updated_map.update(point_cloud);
     }
@@ -182,15 +176,12 @@ void IntraExpMergingModule::runAsync_(QueryCache &qdata0, OutputCache &,
 
     // publish the old map
     {
-      auto point_cloud = old_map_copy.point_cloud();  // COPY!
-      const auto &T_v_m = old_map_copy.T_vertex_this().matrix();
-      // eigen mapping
-      auto points_mat = point_cloud.getMatrixXfMap(
-          3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
       // transform to the local frame of this vertex
-      Eigen::Matrix3f C_v_m = (T_v_m.block<3, 3>(0, 0)).cast<float>();
-      Eigen::Vector3f r_m_v_in_v = (T_v_m.block<3, 1>(0, 3)).cast<float>();
-      points_mat = (C_v_m * points_mat).colwise() + r_m_v_in_v;
+      const Eigen::Matrix4f T_v_m =
+          old_map_copy.T_vertex_this().matrix().cast<float>();
+      pcl::PointCloud<PointWithInfo> point_cloud;
+      pointcloud::transformPointCloud(T_v_m, old_map_copy.point_cloud(),
+                                      point_cloud, false);
 
       PointCloudMsg pc2_msg;
       pcl::toROSMsg(point_cloud, pc2_msg);
@@ -20,6 +20,8 @@
 
 #include "vtr_lidar/data_types/pointmap.hpp"
 #include "vtr_lidar/data_types/pointmap_pointer.hpp"
+#include "vtr_pointcloud/data_types/pointmap_merging.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 #include "vtr_pose_graph/path/pose_cache.hpp"
 
 namespace vtr {
@@ -34,11 +36,13 @@ auto IntraExpMergingModuleV2::Config::fromROS(
   // clang-format off
   // merge
   config->depth = node->declare_parameter<double>(param_prefix + ".depth", config->depth);
+  config->memory_budget = node->declare_parameter<double>(param_prefix + ".memory_budget", config->memory_budget);
   // point map
   config->map_voxel_size = node->declare_parameter<float>(param_prefix + ".map_voxel_size", config->map_voxel_size);
   config->crop_range_front = node->declare_parameter<float>(param_prefix + ".crop_range_front", config->crop_range_front);
   config->back_over_front_ratio = node->declare_parameter<float>(param_prefix + ".back_over_front_ratio", config->back_over_front_ratio);
   // general
+  config->num_threads = node->declare_parameter<int>(param_prefix + ".num_threads", config->num_threads);
   config->visualize = node->declare_parameter<bool>(param_prefix + ".visualize", config->visualize);
   // clang-format on
   return config;
@@ -133,7 +137,9 @@ void IntraExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
   // cache all the transforms so we only calculate them once
   pose_graph::PoseCache<GraphBase> pose_cache(subgraph, target_vid);
 
-  size_t num_map_merged = 0;
+  // collect the vertices with a map in traversal order, which is the order
+  // their points are merged in (pose cache is not thread safe)
+  std::vector<std::pair<Vertex::Ptr, EdgeTransform>> map_vertices;
   auto itr = subgraph->begin(target_vid);
   for (; itr != subgraph->end(); itr++) {
     //
@@ -152,31 +158,43 @@ void IntraExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
     auto T_target_curr = pose_cache.T_root_query(vertex->id());
     CLOG(DEBUG, "lidar.intra_exp_merging")
         << "T_target_curr is " << T_target_curr.vec().transpose();
+    map_vertices.emplace_back(vertex, T_target_curr);
+  }
+
+  common::timing::Stopwatch<> timer;
 
+  // stream the maps through the merge, loading and transforming them in
+  // parallel batches sized to the memory budget from the maps loaded so far;
+  // the points beyond the crop range are dropped as they are loaded, so the
+  // merged map stays bounded. The maps are retrieved without caching them in
+  // their vertex, so a map not already loaded is released once transformed
+  const auto load_map = [&map_vertices](const size_t i,
+                                        pcl::PointCloud<PointWithInfo> &out) {
+    const auto &[vertex, T_target_curr] = map_vertices[i];
     // retrieve point map v0 (initial map) from this vertex
-    const auto map_msg = vertex->retrieve<PointMap<PointWithInfo>>(
+    const auto map_msg = vertex->retrieveUncached<PointMap<PointWithInfo>>(
         "pointmap_v0", "vtr_lidar_msgs/msg/PointMap");
-
-    auto pointmap = map_msg->sharedLocked().get().getData();
-    const auto &T_v_m = (T_target_curr * pointmap.T_vertex_this()).matrix();
-    auto &point_cloud = pointmap.point_cloud();
-
-    // transform to the local frame of this vertex
-    auto scan_mat = point_cloud.getMatrixXfMap(
-        4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-    auto scan_normal_mat = point_cloud.getMatrixXfMap(
-        4, PointWithInfo::size(), PointWithInfo::normal_offset());
-    scan_mat = T_v_m.cast<float>() * scan_mat;
-    scan_normal_mat = T_v_m.cast<float>() * scan_normal_mat;
-
-    // store this scan into the updatd map;
-    updated_map.update(point_cloud);
-
-    //
-    ++num_map_merged;
-  }
+    auto locked_map_msg_ref = map_msg->sharedLocked();  // lock the msg
+    const auto &pointmap = locked_map_msg_ref.get().getData();
+    // copy to the local frame of the target vertex
+    const Eigen::Matrix4f T_v_m =
+        (T_target_curr * pointmap.T_vertex_this()).matrix().cast<float>();
+    pointcloud::transformPointCloud(T_v_m, pointmap.point_cloud(), out);
+  };
+  const int num_maps = (int)map_vertices.size();
+  const float max_range = config_->crop_range_front *
+                          std::max(1.0f, config_->back_over_front_ratio);
+  pointcloud::streamingMerge(updated_map, map_vertices.size(), load_map,
+                             max_range,
+                             size_t(config_->memory_budget * 1024 * 1024),
+                             config_->num_threads);
+
+  timer.stop();
+  const double merge_time_per_map =
+      timer.count<std::chrono::microseconds>() / 1e3 / std::max(num_maps, 1);
   CLOG(DEBUG, "lidar.intra_exp_merging")
-      << "Number of map merged: " << num_map_merged;
+      << "Number of map merged: " << num_maps << ", merge time: " << timer
+      << " (" << merge_time_per_map << "ms per map)";
 
   // sanity check
   if (updated_map.size() == 0) {
@@ -203,20 +221,19 @@ void IntraExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
   // update version
   updated_map.version() = PointMap<PointWithInfo>::INTRA_EXP_MERGED;
 
-  // update the point map of this vertex
+  // store a copy of the updated map for debugging, and move the updated map
+  // into the point map of this vertex
+  using PointMapLM = storage::LockableMessage<PointMap<PointWithInfo>>;
+  const auto updated_map_copy =
+      std::make_shared<PointMap<PointWithInfo>>(updated_map);
   {
     const auto map_msg = target_vertex->retrieve<PointMap<PointWithInfo>>(
         "pointmap", "vtr_lidar_msgs/msg/PointMap");
     auto locked_map_msg_ref = map_msg->locked();  // lock the msg
     auto &locked_map_msg = locked_map_msg_ref.get();
-    locked_map_msg.setData(updated_map);
+    locked_map_msg.setData(std::move(updated_map));
   }
-
-  // store a copy of the updated map for debugging
   {
-    using PointMapLM = storage::LockableMessage<PointMap<PointWithInfo>>;
-    auto updated_map_copy =
-        std::make_shared<PointMap<PointWithInfo>>(updated_map);
     auto updated_map_copy_msg = std::make_shared<PointMapLM>(
         updated_map_copy, target_vertex->vertexTime());
     target_vertex->insert<PointMap<PointWithInfo>>(
@@ -237,13 +254,12 @@ void IntraExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
       auto &locked_map_msg = locked_map_msg_ref.get();
       auto pointmap = locked_map_msg.getData();
 
-      auto point_cloud = pointmap.point_cloud();  // COPY!
-      const auto &T_v_m = pointmap.T_vertex_this().matrix();
-
       // transform to the local frame of this vertex
-      auto points_mat = point_cloud.getMatrixXfMap(
-          4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-      points_mat = T_v_m.cast<float>() * points_mat;
+      const Eigen::Matrix4f T_v_m =
+          pointmap.T_vertex_this().matrix().cast<float>();
+      pcl::PointCloud<PointWithInfo> point_cloud;
+      pointcloud::transformPointCloud(T_v_m, pointmap.point_cloud(),
+                                      point_cloud, false);
 
       PointCloudMsg pc2_msg;
       pcl::toROSMsg(point_cloud, pc2_msg);
@@ -255,7 +271,7 @@ void IntraExpMergingModuleV2::runAsync_(QueryCache &qdata0, OutputCache &,
     // publish the updated map (will already be in vertex frame)
     {
       PointCloudMsg pc2_msg;
-      pcl::toROSMsg(updated_map.point_cloud(), pc2_msg);
+      pcl::toROSMsg(updated_map_copy->point_cloud(), pc2_msg);
       pc2_msg.header.frame_id = "world";
       // pc2_msg.header.stamp = 0;
       new_map_pub_->publish(pc2_msg);
@@ -141,8 +141,12 @@ void PreprocessingModule::run_(QueryCache &qdata0, OutputCache &,
 
   /// Grid subsampling
 
-  // Get subsampling of the frame in carthesian coordinates
-  voxelDownsample(*filtered_point_cloud, config_->frame_voxel_size);
+  // Get subsampling of the frame in carthesian coordinates, coarser when the
+  // load controller asks for degraded resolution
+  const float resolution_scale =
+      qdata.load_decision ? qdata.load_decision->resolution_scale : 1.0f;
+  voxelDownsample(*filtered_point_cloud,
+                  config_->frame_voxel_size * resolution_scale);
   voxelDownsample(*nn_downsampled_cloud, config_->nn_voxel_size);
 
   CLOG(DEBUG, "lidar.preprocessing")
@@ -90,8 +90,12 @@ void PreprocessingModuleV2::run_(QueryCache &qdata0, OutputCache &,
 
   /// Grid subsampling
 
-  // Get subsampling of the frame in carthesian coordinates
-  voxelDownsample(*filtered_point_cloud, config_->frame_voxel_size);
+  // Get subsampling of the frame in carthesian coordinates, coarser when the
+  // load controller asks for degraded resolution
+  const float resolution_scale =
+      qdata.load_decision ? qdata.load_decision->resolution_scale : 1.0f;
+  voxelDownsample(*filtered_point_cloud,
+                  config_->frame_voxel_size * resolution_scale);
 
   CLOG(DEBUG, "lidar.preprocessing")
       << "grid subsampled point cloud size: " << filtered_point_cloud->size();
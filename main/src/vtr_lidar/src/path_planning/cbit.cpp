@@ -17,7 +17,7 @@
  * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
  */
 #include "vtr_lidar/path_planning/cbit.hpp"
-#include "vtr_lidar/path_planning/mpc_path_planner2.hpp"
+#include "vtr_path_planning/mpc/mpc_path_planner2.hpp"
 #include "vtr_path_planning/cbit/utils.hpp"
 #include "vtr_lidar/cache.hpp"
 
@@ -40,6 +40,7 @@ auto LidarCBIT::Config::fromROS(const rclcpp::Node::SharedPtr& node, const std::
 
   // Base planner configs
   config->control_period = (unsigned int)node->declare_parameter<int>(prefix + ".control_period", config->control_period);
+  config->command_fallback = node->declare_parameter<bool>(prefix + ".command_fallback", config->command_fallback);
 
   // robot configuration
   config->robot_model = node->declare_parameter<std::string>(prefix + ".teb.robot_model", config->robot_model);
@@ -79,6 +80,7 @@ auto LidarCBIT::Config::fromROS(const rclcpp::Node::SharedPtr& node, const std::
   config->max_ang_vel = node->declare_parameter<double>(prefix + ".mpc.max_ang_vel", config->max_ang_vel);
   config->robot_linear_velocity_scale = node->declare_parameter<double>(prefix + ".robot_linear_velocity_scale", config->robot_linear_velocity_scale);
   config->robot_angular_velocity_scale = node->declare_parameter<double>(prefix + ".robot_angular_velocity_scale", config->robot_angular_velocity_scale);
+  config->mpc_solver = node->declare_parameter<std::string>(prefix + ".mpc.solver", config->mpc_solver);
 
 
   // COST FUNCTION Covariances
@@ -142,6 +144,7 @@ auto LidarCBIT::computeCommand(RobotState& robot_state0) -> Command {
   if (!chain.isLocalized()) {
     CLOG(WARNING, "path_planning.cbit") << "Robot is not localized, commanding the robot to stop";
     applied_vel << 0.0, 0.0;
+    mpc_ptr->Reset();
     // Update history:
     vel_history.erase(vel_history.begin());
     vel_history.push_back(applied_vel);
@@ -198,6 +201,8 @@ auto LidarCBIT::computeCommand(RobotState& robot_state0) -> Command {
     // Store the grid resoltuion
     CLOG(DEBUG, "obstacle_detection.cbit") << "The costmap to world transform is: " << T_start_vertex.inverse();
     costmap_ptr->grid_resolution = change_detection_costmap->dl();
+    // Rebuild the dense obstacle grid used for collision checking, published atomically to the planner thread
+    costmap_ptr->update_grid();
 
     // Storing sequences of costmaps for temporal filtering purposes
     // For the first x iterations, fill the obstacle vector
@@ -549,8 +554,10 @@ auto LidarCBIT::computeCommand(RobotState& robot_state0) -> Command {
     try
     {
       CLOG(INFO, "mpc.cbit") << "Attempting to solve the MPC problem";
-      // Using new sychronized measurements:
-      auto mpc_result = SolveMPC2(applied_vel, T0, measurements4, measurements, barrier_q_left_test, barrier_q_right_test, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight);
+      // Using new sychronized measurements, solved with the corridor mpc of the base planner warm started from the previous cycle
+      // and limited to the remaining control period
+      const double time_budget_ms = remainingBudget();
+      auto mpc_result = mpc_ptr->Solve(applied_vel, T0, measurements4, measurements, barrier_q_left_test, barrier_q_right_test, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight, time_budget_ms);
 
       // Solve using corridor mpc
       //auto mpc_result = SolveMPC2(applied_vel, T0, measurements3, measurements, barrier_q_left, barrier_q_right, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization3, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight);
@@ -612,12 +619,23 @@ auto LidarCBIT::computeCommand(RobotState& robot_state0) -> Command {
     CLOG(INFO, "mpc.cbit") << "There is not a valid plan yet, returning zero velocity commands";
 
     applied_vel << 0.0, 0.0;
+    mpc_ptr->Reset();
     vel_history.erase(vel_history.begin());
     vel_history.push_back(applied_vel);
     return Command();
   }
 }
 
+// The command of the last cycle missed the deadline and the safe command was sent instead, so roll back the velocity state
+// and the MPC warm start, which the next cycle would otherwise start from as if the dropped command had been applied
+void LidarCBIT::onCommandDropped(const Command& sent) {
+  CLOG(WARNING, "path_planning.cbit") << "Command dropped for missing the deadline, resetting the velocity state to the safe command";
+  applied_vel << sent.linear.x / config_->robot_linear_velocity_scale,
+                 sent.angular.z / config_->robot_angular_velocity_scale;
+  vel_history.back() = applied_vel;
+  mpc_ptr->Reset();
+}
+
 
 
 }  // namespace lidar
@@ -78,6 +78,7 @@ void LidarPipeline::reset() {
   T_sv_m_odo_ = tactic::EdgeTransform(true);
   // localization cached data
   submap_loc_ = nullptr;
+  submap_loc_views_ = nullptr;
 }
 
 void LidarPipeline::preprocess_(const QueryCache::Ptr &qdata0,
@@ -121,13 +122,19 @@ void LidarPipeline::runLocalization_(const QueryCache::Ptr &qdata0,
   auto qdata = std::dynamic_pointer_cast<LidarQueryCache>(qdata0);
 
   // set the current map for localization
-  if (submap_loc_ != nullptr) qdata->submap_loc = submap_loc_;
+  if (submap_loc_ != nullptr) {
+    qdata->submap_loc = submap_loc_;
+    qdata->submap_loc_views = submap_loc_views_;
+  }
 
   for (const auto &module : localization_)
     module->run(*qdata0, *output0, graph, executor);
 
   /// store the current map for localization
-  if (qdata->submap_loc) submap_loc_ = qdata->submap_loc.ptr();
+  if (qdata->submap_loc) {
+    submap_loc_ = qdata->submap_loc.ptr();
+    submap_loc_views_ = qdata->submap_loc_views.ptr();
+  }
 }
 
 void LidarPipeline::onVertexCreation_(const QueryCache::Ptr &qdata0,
@@ -0,0 +1,117 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_costmap.cpp
+ * \brief Compares the change detection cost map generation using a kd-tree
+ * nearest neighbor query per cell against the closest point distance sweep
+ * (DenseCostMap::updateFromDistance), at several cost map resolutions.
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <random>
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_lidar/data_types/costmap.hpp"
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+constexpr float d0 = 0.5, d1 = 0.9;  // influence and minimum distance
+constexpr float size_x = 16.0, size_y = 8.0;
+constexpr int num_iterations = 20;
+
+void distanceToCost(const float &dist, float &v) {
+  v = std::min(std::max(1 - (dist - d1) / d0, 0.0f), 0.9f);
+}
+
+/** \brief A few clusters of change points, similar to detected obstacles */
+pcl::PointCloud<PointWithInfo> changePoints(const size_t num_clusters,
+                                            const size_t cluster_size) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> center_x(-size_x / 2, size_x / 2);
+  std::uniform_real_distribution<float> center_y(-size_y / 2, size_y / 2);
+  std::normal_distribution<float> offset(0.0, 0.3);
+  pcl::PointCloud<PointWithInfo> points;
+  for (size_t i = 0; i < num_clusters; ++i) {
+    const float cx = center_x(gen), cy = center_y(gen);
+    for (size_t j = 0; j < cluster_size; ++j) {
+      PointWithInfo p;
+      p.x = cx + offset(gen);
+      p.y = cy + offset(gen);
+      p.z = 0.0f;
+      points.push_back(p);
+    }
+  }
+  return points;
+}
+
+}  // namespace
+
+int main(int, char **) {
+  configureLogging("", false);
+
+  const auto points = changePoints(10, 50);
+
+  for (const float dl : {0.05f, 0.1f, 0.25f, 0.5f}) {
+    timing::Stopwatch<> kdtree_timer(false), dt_timer(false);
+    for (int i = 0; i < num_iterations; ++i) {
+      // kd-tree nearest neighbor for every cell
+      kdtree_timer.start();
+      {
+        NanoFLANNAdapter<PointWithInfo> adapter(points);
+        KDTree<PointWithInfo> kdtree(2, adapter, KDTreeParams(10));
+        kdtree.buildIndex();
+        KDTreeSearchParams search_params;
+        DenseCostMap costmap(dl, size_x, size_y);
+        costmap.update([&](const Eigen::Vector2f &q, float &v) {
+          size_t ind;
+          float dist;
+          KDTreeResultSet result_set(1);
+          result_set.init(&ind, &dist);
+          kdtree.findNeighbors(result_set, q.data(), search_params);
+          distanceToCost(std::sqrt(dist), v);
+        });
+      }
+      kdtree_timer.stop();
+
+      // closest point distance
+      dt_timer.start();
+      {
+        DenseCostMap costmap(dl, size_x, size_y);
+        costmap.updateFromDistance(points, d0 + d1, distanceToCost);
+      }
+      dt_timer.stop();
+    }
+
+    const auto avg = [](const timing::Stopwatch<> &timer) {
+      return (double)timer.count<std::chrono::microseconds>() / 1000.0 /
+             num_iterations;
+    };
+    CLOG(INFO, "test") << "resolution: " << dl << ", cells: "
+                       << (int)(size_x / dl + 1) * (int)(size_y / dl + 1)
+                       << ", points: " << points.size()
+                       << ", kd-tree: " << avg(kdtree_timer)
+                       << " ms, closest point distance: " << avg(dt_timer)
+                       << " ms";
+  }
+
+  return 0;
+}
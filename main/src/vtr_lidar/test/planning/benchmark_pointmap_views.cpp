@@ -0,0 +1,126 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_pointmap_views.cpp
+ * \brief Per-frame cost of preparing the localization submap for the planning
+ * modules: every module transforming its own copy of the submap and building
+ * its own kd-tree, against the views shared through PointMapViews and
+ * computed once per submap.
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <random>
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_lidar/data_types/pointmap_views.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+constexpr int num_frames = 100;
+constexpr int frames_per_submap = 10;  // frames localized against a submap
+constexpr int num_vertex_frame_users = 3;  // ground, obstacle, terrain
+
+std::shared_ptr<PointMap<PointWithInfo>> submap(const size_t size,
+                                                std::mt19937 &gen) {
+  std::uniform_real_distribution<float> xy(-20.0, 20.0);
+  std::normal_distribution<float> z(0.0, 0.5);
+  pcl::PointCloud<PointWithInfo> points;
+  for (size_t i = 0; i < size; ++i) {
+    PointWithInfo p;
+    p.x = xy(gen), p.y = xy(gen), p.z = z(gen);
+    p.normal_x = 0.0, p.normal_y = 0.0, p.normal_z = 1.0;
+    points.push_back(p);
+  }
+  auto point_map = std::make_shared<PointMap<PointWithInfo>>(0.1);
+  point_map->update(points);
+  Eigen::Matrix4d T_vertex_this = Eigen::Matrix4d::Identity();
+  T_vertex_this.block<3, 1>(0, 3) << 1.0, 2.0, 0.0;
+  point_map->T_vertex_this() = tactic::EdgeTransform(T_vertex_this);
+  return point_map;
+}
+
+/** \brief What each module used to do with the submap on every frame */
+pcl::PointCloud<PointWithInfo> vertexFrameCopy(
+    const PointMap<PointWithInfo> &point_map) {
+  const auto &T_lv_pm = point_map.T_vertex_this().matrix();
+  auto point_cloud = point_map.point_cloud();
+  // clang-format off
+  auto points_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
+  auto normal_mat = point_cloud.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::normal_offset());
+  // clang-format on
+  Eigen::Matrix3f C_lv_pm = (T_lv_pm.block<3, 3>(0, 0)).cast<float>();
+  Eigen::Vector3f r_lv_pm = (T_lv_pm.block<3, 1>(0, 3)).cast<float>();
+  points_mat = ((C_lv_pm * points_mat).colwise() + r_lv_pm).eval();
+  normal_mat = (C_lv_pm * normal_mat).eval();
+  return point_cloud;
+}
+
+}  // namespace
+
+int main(int, char **) {
+  configureLogging("", false);
+
+  std::mt19937 gen(42);
+  for (const size_t size : {20000, 80000, 320000}) {
+    std::vector<std::shared_ptr<PointMap<PointWithInfo>>> submaps;
+    for (int i = 0; i < num_frames / frames_per_submap; ++i)
+      submaps.push_back(submap(size, gen));
+
+    timing::Stopwatch<> copy_timer(false), views_timer(false);
+    size_t checksum = 0;  // keeps the work from being optimized out
+
+    // every module prepares its own data on every frame
+    for (int frame = 0; frame < num_frames; ++frame) {
+      const auto &point_map = *submaps[frame / frames_per_submap];
+      copy_timer.start();
+      for (int i = 0; i < num_vertex_frame_users; ++i)
+        checksum += vertexFrameCopy(point_map).size();
+      NanoFLANNAdapter<PointWithInfo> adapter(point_map.point_cloud());
+      KDTree<PointWithInfo> kdtree(3, adapter, KDTreeParams(10));
+      kdtree.buildIndex();
+      checksum += kdtree.size(kdtree);
+      copy_timer.stop();
+    }
+
+    // views created when a new submap is recalled and shared by the modules
+    PointMapViews::ConstPtr views;
+    for (int frame = 0; frame < num_frames; ++frame) {
+      views_timer.start();
+      if (frame % frames_per_submap == 0)
+        views = std::make_shared<PointMapViews>(
+            submaps[frame / frames_per_submap]);
+      for (int i = 0; i < num_vertex_frame_users; ++i)
+        checksum += views->vertexFramePointCloud().size();
+      checksum += views->kdtree().size(views->kdtree());
+      views_timer.stop();
+    }
+
+    const auto avg = [](const timing::Stopwatch<> &timer) {
+      return (double)timer.count<std::chrono::microseconds>() / 1000.0 /
+             num_frames;
+    };
+    CLOG(INFO, "test") << "submap points: " << submaps.front()->size()
+                       << ", per-module copies: " << avg(copy_timer)
+                       << " ms/frame, shared views: " << avg(views_timer)
+                       << " ms/frame (" << checksum << ")";
+  }
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_terrain_assessment.cpp
+ * \brief Compares the per-cell radius search + pca and per-cell corridor
+ * distance against the summed-area table and the rasterized corridor, with
+ * the default terrain assessment cost map resolution and size.
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <random>
+
+#include "pcl/features/normal_3d.h"
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/modules/planning/terrain_assessment_ops.hpp"
+#include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+constexpr float dl = 0.5, size_x = 40.0, size_y = 20.0;
+constexpr float search_radius = 1.0, corridor_width = 1.0;
+constexpr int num_iterations = 5;
+
+/** \brief Radius search and pca for every cell */
+class KDTreeAssessTerrainOp {
+ public:
+  KDTreeAssessTerrainOp(const pcl::PointCloud<PointWithInfo> &points)
+      : points_(points), adapter_(points) {
+    kdtree_ = std::make_unique<KDTree<PointWithInfo>>(2, adapter_,
+                                                      KDTreeParams(10));
+    kdtree_->buildIndex();
+    search_params_.sorted = false;
+  }
+
+  void operator()(const Eigen::Vector2f &q, float &value) const {
+    std::vector<std::pair<size_t, float>> inds_dists;
+    const auto num_neighbors =
+        kdtree_->radiusSearch(q.data(), search_radius * search_radius,
+                              inds_dists, search_params_);
+    if (num_neighbors < 5) {
+      value = 0.0;
+      return;
+    }
+    std::vector<int> indices(num_neighbors);
+    for (size_t i = 0; i < num_neighbors; i++) indices[i] = inds_dists[i].first;
+    const pcl::PointCloud<PointWithInfo> query_points(points_, indices);
+    Eigen::Matrix3f cov;
+    Eigen::Vector4f centroid;
+    pcl::compute3DCentroid(query_points, centroid);
+    pcl::computeCovarianceMatrix(query_points, centroid, cov);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> es(cov);
+    value = std::abs(es.eigenvalues()(0));
+  }
+
+ private:
+  const pcl::PointCloud<PointWithInfo> &points_;
+  KDTreeSearchParams search_params_;
+  NanoFLANNAdapter<PointWithInfo> adapter_;
+  std::unique_ptr<KDTree<PointWithInfo>> kdtree_;
+};
+
+/** \brief Distance from every cell to every path segment */
+void perCellCorridor(DenseCostMap &costmap,
+                     const std::vector<Eigen::Vector2f> &path) {
+  costmap.update([&](const Eigen::Vector2f &q, float &v) {
+    float min_dist = std::numeric_limits<float>::max();
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+      const auto &xs = path[i];
+      const auto &xe = path[i + 1];
+      float alpha = (q - xs).dot(xe - xs) / (xe - xs).squaredNorm();
+      alpha = std::clamp(alpha, 0.0f, 1.0f);
+      min_dist = std::min(min_dist, (q - (xs + alpha * (xe - xs))).norm());
+    }
+    v = min_dist > corridor_width ? v : 1;
+  });
+}
+
+double average(const timing::Stopwatch<> &timer) {
+  return (double)timer.count<std::chrono::microseconds>() / 1000.0 /
+         num_iterations;
+}
+
+}  // namespace
+
+int main(int, char **) {
+  configureLogging("", false);
+
+  // a submap sized point cloud of uneven terrain
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> x(-size_x / 2 - 1, size_x / 2 + 1);
+  std::uniform_real_distribution<float> y(-size_y / 2 - 1, size_y / 2 + 1);
+  std::normal_distribution<float> noise(0.0, 0.05);
+  pcl::PointCloud<PointWithInfo> points;
+  for (int i = 0; i < 100000; ++i) {
+    PointWithInfo p;
+    p.x = x(gen);
+    p.y = y(gen);
+    p.z = 0.2f * std::sin(0.3f * p.x) + noise(gen);
+    points.push_back(p);
+  }
+
+  // a 15 m lookahead path with a vertex every 0.25 m
+  std::vector<Eigen::Vector2f> path;
+  for (int i = 0; i < 60; ++i)
+    path.emplace_back(0.25f * i, 2.0f * std::sin(0.05f * i));
+
+  timing::Stopwatch<> kdtree_timer(false), sat_timer(false);
+  timing::Stopwatch<> per_cell_timer(false), raster_timer(false);
+  for (int i = 0; i < num_iterations; ++i) {
+    kdtree_timer.start();
+    {
+      DenseCostMap costmap(dl, size_x, size_y);
+      KDTreeAssessTerrainOp op(points);
+      costmap.update(op);
+    }
+    kdtree_timer.stop();
+
+    sat_timer.start();
+    {
+      DenseCostMap costmap(dl, size_x, size_y);
+      AssessTerrainOp op(points, dl, size_x, size_y, search_radius);
+      costmap.update(op);
+    }
+    sat_timer.stop();
+
+    per_cell_timer.start();
+    {
+      DenseCostMap costmap(dl, size_x, size_y);
+      perCellCorridor(costmap, path);
+    }
+    per_cell_timer.stop();
+
+    raster_timer.start();
+    {
+      DenseCostMap costmap(dl, size_x, size_y);
+      rasterizeCorridor(costmap, path, corridor_width);
+    }
+    raster_timer.stop();
+  }
+
+  CLOG(INFO, "test") << "resolution: " << dl << ", size: " << size_x << "x"
+                     << size_y << ", points: " << points.size();
+  CLOG(INFO, "test") << "terrain - kd-tree + pca: " << average(kdtree_timer)
+                     << " ms, summed-area table: " << average(sat_timer)
+                     << " ms";
+  CLOG(INFO, "test") << "corridor - per cell: " << average(per_cell_timer)
+                     << " ms, rasterized: " << average(raster_timer) << " ms";
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_inter_exp_merging.cpp
+ * \brief Merge time and peak memory of the inter-experience merging of a
+ * street map: the original update, which copies the map out of its message,
+ * shifts every bit vector, builds a kd-tree and copies the map back, against
+ * the in-place update with lazily aged bit vectors and the hash grid search.
+ * Each variant runs in its own process so that peak memory (VmHWM, reset
+ * before every merge) is not polluted by the other.
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <omp.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <random>
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_lidar/data_types/multi_exp_pointmap.hpp"
+#include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_logging/logging_init.hpp"
+#include "vtr_storage/stream/message.hpp"
+
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+using Map = MultiExpPointMap<PointWithInfo>;
+using MapLM = storage::LockableMessage<Map>;
+
+constexpr int num_init_exps = 20;  // experiences in the map before timing
+constexpr int num_merges = 5;
+// default config
+constexpr float map_voxel_size = 0.1;
+constexpr size_t max_num_exps = 128;
+constexpr float distance_threshold = 0.6;
+constexpr float planar_threshold = 0.2;
+constexpr float normal_threshold = 0.8;
+
+PointWithInfo makePoint(const float x, const float y, const float z,
+                        const float nx, const float ny, const float nz) {
+  PointWithInfo p;
+  p.x = x, p.y = y, p.z = z;
+  p.normal_x = nx, p.normal_y = ny, p.normal_z = nz;
+  return p;
+}
+
+/** \brief Static points of a street (road and facades) seen in experience */
+PointCloud street(const int exp) {
+  std::mt19937 gen(exp);
+  std::normal_distribution<float> noise(0.0, 0.03);
+  std::uniform_real_distribution<float> unit(0.0, 1.0);
+  const float offset = 0.01 * exp;  // localization error
+  PointCloud points;
+  for (float x = -40; x < 40; x += 0.1) {
+    for (float y = -12; y < 12; y += 0.1)
+      if (unit(gen) < 0.8)
+        points.push_back(makePoint(x + offset, y, -1.5 + noise(gen), 0, 0, 1));
+    for (float z = -1.5; z < 12; z += 0.1) {
+      if (unit(gen) < 0.8)
+        points.push_back(makePoint(x, -12 + noise(gen), z + offset, 0, 1, 0));
+      if (unit(gen) < 0.8)
+        points.push_back(makePoint(x, 12 + noise(gen), z + offset, 0, -1, 0));
+    }
+  }
+  // parked cars come and go
+  for (float x = -36; x < 40; x += 6) {
+    if (unit(gen) < 0.5) continue;
+    for (float y = -8.4; y < -6.6; y += 0.1)
+      for (float z = -1.5; z < 0; z += 0.1) {
+        points.push_back(makePoint(x - 2.2, y, z, -1, 0, 0));
+        points.push_back(makePoint(x + 2.2, y, z, 1, 0, 0));
+      }
+  }
+  return points;
+}
+
+/** \brief The original module, starting from the map in its message */
+void copyMerge(MapLM &map_msg, PointCloud points, const uint32_t exp) {
+  for (auto &p : points) {
+    p.bits = 1;
+    p.multi_exp_obs = 1.0;
+  }
+  auto map = map_msg.sharedLocked().get().getData();
+  auto &exps = map.exps();
+  auto &map_points = map.point_cloud();
+  if (exps.empty() || exps.back() != exp) {
+    exps.push_back(exp);
+    if (exps.size() > map.max_num_exps()) exps.pop_front();
+    for (auto &p : map_points) p.bits <<= 1;
+  }
+
+  NanoFLANNAdapter<PointWithInfo> adapter(map_points);
+  KDTree<PointWithInfo> kdtree(3, adapter, KDTreeParams(10));
+  kdtree.buildIndex();
+  const auto sq_radius = distance_threshold * distance_threshold;
+  for (const auto &pt : points) {
+    std::vector<float> dists;
+    std::vector<int> indices;
+    NanoFLANNRadiusResultSet<float, int> result(sq_radius, dists, indices);
+    kdtree.radiusSearchCustomCallback(pt.data, result, KDTreeSearchParams());
+    for (const auto &idx : indices) {
+      auto &pt2 = map_points[idx];
+      const auto diff = pt.getVector3fMap() - pt2.getVector3fMap();
+      const auto planar_dist = std::abs(pt2.getNormalVector3fMap().dot(diff));
+      if (planar_dist > planar_threshold) continue;
+      const auto normal_dist =
+          std::abs(pt2.getNormalVector3fMap().dot(pt.getNormalVector3fMap()));
+      if (normal_dist < normal_threshold) continue;
+      if ((pt2.bits & 1) == 0) {
+        pt2.bits++;
+        pt2.multi_exp_obs += 1.0;
+      }
+    }
+  }
+  map.update(points);
+  map_msg.locked().get().setData(map);
+}
+
+/** \brief The module now, updating the map in its message */
+void inPlaceMerge(MapLM &map_msg, const PointCloud &points, const uint32_t exp,
+                  const int num_threads) {
+  auto locked_msg = map_msg.locked();
+  auto &map = locked_msg.get().getDataMutable();
+  const auto &exps = map.exps();
+  if (exps.empty() || exps.back() != exp) map.addExperience(exp);
+  map.observe(points, distance_threshold, planar_threshold, normal_threshold,
+              num_threads);
+  map.addPoints(points);
+}
+
+/** \brief Reads a field of /proc/self/status in kB */
+long procStatus(const std::string &field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (line.rfind(field + ":", 0) == 0) return std::stol(line.substr(7));
+  return -1;
+}
+
+struct Result {
+  double ms_per_merge = 0.0;
+  double peak_mb = 0.0;  // max increase of the peak resident memory
+  double map_mb = 0.0;
+  size_t map_size = 0;
+  double checksum = 0.0;
+};
+
+/** \brief Runs a variant (0: copy, >0: in place on that many threads) */
+Result run(const int variant) {
+  const auto map = std::make_shared<Map>(map_voxel_size, max_num_exps);
+  MapLM map_msg(map, 0);
+  for (int exp = 0; exp < num_init_exps; ++exp)
+    inPlaceMerge(map_msg, street(exp), exp, 1);
+
+  Result result;
+  timing::Stopwatch<> timer(false);
+  for (int exp = num_init_exps; exp < num_init_exps + num_merges; ++exp) {
+    const auto points = street(exp);
+    std::ofstream("/proc/self/clear_refs") << "5";  // reset VmHWM
+    const auto rss = procStatus("VmRSS");
+    timer.start();
+    if (variant == 0)
+      copyMerge(map_msg, points, exp);
+    else
+      inPlaceMerge(map_msg, points, exp, variant);
+    timer.stop();
+    result.peak_mb =
+        std::max(result.peak_mb, (procStatus("VmHWM") - rss) / 1024.0);
+  }
+  result.ms_per_merge =
+      timer.count<std::chrono::microseconds>() / 1e3 / num_merges;
+  result.map_size = map->size();
+  result.map_mb = map->size() * sizeof(PointWithInfo) / 1024.0 / 1024.0;
+  for (const auto &p : map->point_cloud()) {
+    const auto bits = map->bits(p);
+    result.checksum += __builtin_popcountll((uint64_t)bits) +
+                       __builtin_popcountll((uint64_t)(bits >> 64)) +
+                       p.multi_exp_obs;
+  }
+  return result;
+}
+
+Result runInChild(const int variant) {
+  int fds[2];
+  if (pipe(fds) != 0) throw std::runtime_error{"pipe failed"};
+  const auto pid = fork();
+  if (pid == 0) {
+    const auto result = run(variant);
+    if (write(fds[1], &result, sizeof(result)) != sizeof(result)) _exit(1);
+    _exit(0);
+  }
+  Result result;
+  if (read(fds[0], &result, sizeof(result)) != sizeof(result))
+    throw std::runtime_error{"variant " + std::to_string(variant) + " failed"};
+  waitpid(pid, nullptr, 0);
+  close(fds[0]), close(fds[1]);
+  return result;
+}
+
+}  // namespace
+
+int main(int, char **) {
+  configureLogging("", false);
+
+  const int max_threads = omp_get_max_threads();
+  const auto copy = runInChild(0);
+  const auto in_place = runInChild(1);
+  const auto in_place_mt = runInChild(max_threads);
+
+  CLOG(INFO, "test") << "map points: " << copy.map_size << " ("
+                     << copy.map_mb << " MB), experience points: "
+                     << street(0).size() << ", experiences: "
+                     << num_init_exps + num_merges;
+  const auto print = [](const std::string &name, const Result &result) {
+    CLOG(INFO, "test") << name << ": " << result.ms_per_merge
+                       << " ms/merge, peak memory increase: "
+                       << result.peak_mb << " MB";
+  };
+  print("copy, shift and kd-tree", copy);
+  print("in place, 1 thread", in_place);
+  print("in place, " + std::to_string(max_threads) + " threads", in_place_mt);
+
+  const bool same = copy.map_size == in_place.map_size &&
+                    copy.checksum == in_place.checksum &&
+                    copy.checksum == in_place_mt.checksum;
+  CLOG(INFO, "test") << "same maps: " << (same ? "yes" : "no");
+  return same ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_intra_exp_merging.cpp
+ * \brief Peak memory and time of the intra-experience merging of the submaps
+ * along a long route into the map of its middle vertex: the original merge,
+ * which holds every reduced submap and the uncropped merged map at once,
+ * against the streaming merge under a few memory budgets. Each variant runs
+ * in its own process so that peak memory (VmHWM, reset before the merge) is
+ * not polluted by the others.
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <omp.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <random>
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/data_types/pointmap.hpp"
+#include "vtr_logging/logging_init.hpp"
+#include "vtr_pointcloud/data_types/pointmap_merging.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
+
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+constexpr int num_submaps = 41;  // one every 5m, 200m of route
+constexpr float submap_spacing = 5.0;
+// default config
+constexpr float map_voxel_size = 0.1;
+constexpr float crop_range_front = 40.0;
+constexpr float back_over_front_ratio = 0.5;
+
+PointWithInfo makePoint(const float x, const float y, const float z,
+                        const float nx, const float ny, const float nz) {
+  PointWithInfo p;
+  p.x = x, p.y = y, p.z = z;
+  p.normal_x = nx, p.normal_y = ny, p.normal_z = nz;
+  return p;
+}
+
+/** \brief Submap of a vertex at x: street surfaces within 40m, vertex frame */
+PointCloud submap(const int i) {
+  std::mt19937 gen(i);
+  std::normal_distribution<float> noise(0.0, 0.02);
+  std::uniform_real_distribution<float> unit(0.0, 1.0);
+  const float x0 = submap_spacing * i;
+  PointCloud points;
+  for (float x = x0 - 40; x < x0 + 40; x += 0.15) {
+    for (float y = -12; y < 12; y += 0.15)
+      if (unit(gen) < 0.5)
+        points.push_back(makePoint(x - x0, y, -1.5 + noise(gen), 0, 0, 1));
+    for (float z = -1.5; z < 12; z += 0.15) {
+      if (unit(gen) < 0.5)
+        points.push_back(makePoint(x - x0, -12 + noise(gen), z, 0, 1, 0));
+      if (unit(gen) < 0.5)
+        points.push_back(makePoint(x - x0, 12 + noise(gen), z, 0, -1, 0));
+    }
+  }
+  return points;
+}
+
+/** \brief Crop box filter of the module */
+bool inCropBox(const PointWithInfo &p) {
+  const float rho = p.getVector3fMap().norm();
+  const float phi = std::atan2(p.y, p.x);
+  float ratio_w_phi = back_over_front_ratio +
+                      (1 - std::abs(phi) / M_PI) * (1 - back_over_front_ratio);
+  return bool(rho <= crop_range_front * ratio_w_phi);
+}
+
+/** \brief The submaps of the route, as stored in the graph */
+struct Route {
+  std::vector<PointCloud> submaps;
+  std::vector<Eigen::Matrix4f> T_target_submap;
+
+  Route() {
+    for (int i = 0; i < num_submaps; ++i) {
+      submaps.push_back(submap(i));
+      Eigen::Matrix4f T = Eigen::Matrix4f::Identity();
+      T(0, 3) = submap_spacing * (i - num_submaps / 2);
+      T_target_submap.push_back(T);
+    }
+  }
+
+  void load(const size_t i, PointCloud &out) const {
+    pointcloud::transformPointCloud(T_target_submap[i], submaps[i], out);
+  }
+};
+
+/** \brief The original module: reduce all submaps, merge, then crop */
+void originalMerge(const Route &route, PointMap<PointWithInfo> &map,
+                   const int num_threads) {
+  const int num_maps = (int)route.submaps.size();
+  std::vector<std::unique_ptr<PointMap<PointWithInfo>>> vertex_maps(num_maps);
+#pragma omp parallel num_threads(num_threads)
+  {
+    PointCloud point_cloud;
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < num_maps; ++i) {
+      route.load(i, point_cloud);
+      vertex_maps[i] = std::make_unique<PointMap<PointWithInfo>>(map.dl());
+      vertex_maps[i]->update(point_cloud);
+    }
+  }
+  for (auto &vertex_map : vertex_maps) {
+    map.update(vertex_map->point_cloud());
+    vertex_map.reset();
+  }
+  map.filter(inCropBox);
+}
+
+/** \brief The module now: stream the submaps within the budget, then crop */
+void streamingMerge(const Route &route, PointMap<PointWithInfo> &map,
+                    const size_t memory_budget, const int num_threads) {
+  const auto load = [&route](const size_t i, PointCloud &out) {
+    route.load(i, out);
+  };
+  const float max_range =
+      crop_range_front * std::max(1.0f, back_over_front_ratio);
+  pointcloud::streamingMerge(map, route.submaps.size(), load, max_range,
+                             memory_budget, num_threads);
+  map.filter(inCropBox);
+}
+
+/** \brief Reads a field of /proc/self/status in kB */
+long procStatus(const std::string &field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (line.rfind(field + ":", 0) == 0) return std::stol(line.substr(7));
+  return -1;
+}
+
+struct Result {
+  double ms = 0.0;
+  double peak_mb = 0.0;  // increase of the peak resident memory
+  size_t map_size = 0;
+  double checksum = 0.0;
+};
+
+/** \brief Runs a variant: budget 0 is the original merge */
+Result run(const Route &route, const size_t memory_budget,
+           const int num_threads) {
+  PointMap<PointWithInfo> map(map_voxel_size);
+  std::ofstream("/proc/self/clear_refs") << "5";  // reset VmHWM
+  const auto rss = procStatus("VmRSS");
+  timing::Stopwatch<> timer;
+  if (memory_budget == 0)
+    originalMerge(route, map, num_threads);
+  else
+    streamingMerge(route, map, memory_budget, num_threads);
+  timer.stop();
+
+  Result result;
+  result.ms = timer.count<std::chrono::microseconds>() / 1e3;
+  result.peak_mb = (procStatus("VmHWM") - rss) / 1024.0;
+  result.map_size = map.size();
+  // positions and order of the points
+  const auto &points = map.point_cloud();
+  for (size_t i = 0; i < points.size(); ++i)
+    result.checksum += (i % 7 + 1) * points[i].getVector3fMap().sum();
+  return result;
+}
+
+Result runInChild(const Route &route, const size_t memory_budget,
+                  const int num_threads) {
+  int fds[2];
+  if (pipe(fds) != 0) throw std::runtime_error{"pipe failed"};
+  const auto pid = fork();
+  if (pid == 0) {
+    const auto result = run(route, memory_budget, num_threads);
+    if (write(fds[1], &result, sizeof(result)) != sizeof(result)) _exit(1);
+    _exit(0);
+  }
+  Result result;
+  if (read(fds[0], &result, sizeof(result)) != sizeof(result))
+    throw std::runtime_error{"variant failed"};
+  waitpid(pid, nullptr, 0);
+  close(fds[0]), close(fds[1]);
+  return result;
+}
+
+}  // namespace
+
+int main(int, char **) {
+  configureLogging("", false);
+
+  const Route route;
+  size_t route_points = 0;
+  for (const auto &submap : route.submaps) route_points += submap.size();
+  CLOG(INFO, "test") << "submaps: " << num_submaps << ", points: "
+                     << route_points << " ("
+                     << route_points * sizeof(PointWithInfo) / 1024 / 1024
+                     << " MB)";
+
+  const int max_threads = omp_get_max_threads();
+  const auto original = runInChild(route, 0, max_threads);
+  CLOG(INFO, "test") << "original: " << original.ms
+                     << " ms, peak memory increase: " << original.peak_mb
+                     << " MB, merged points: " << original.map_size;
+
+  bool same = true;
+  for (const size_t budget_mb : {1024, 256, 64}) {
+    const auto streaming =
+        runInChild(route, budget_mb * 1024 * 1024, max_threads);
+    CLOG(INFO, "test") << "streaming (" << budget_mb << " MB budget): "
+                       << streaming.ms << " ms, peak memory increase: "
+                       << streaming.peak_mb
+                       << " MB, merged points: " << streaming.map_size;
+    same &= streaming.map_size == original.map_size &&
+            streaming.checksum == original.checksum;
+  }
+  CLOG(INFO, "test") << "same maps: " << (same ? "yes" : "no");
+  return same ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_dynamic_detection.cpp
+ * \brief Per-vertex cost of the dynamic object detection on a dense urban
+ * scene (street lined with facades, parked cars, poles and pedestrians): the
+ * original serial hash grid ray tracing, which copies every scan and the map
+ * once per scan, against the dense frustum grid traced on 1 and all threads.
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <omp.h>
+
+#include <random>
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/segmentation/ray_tracing.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+constexpr int num_vertices = 5;
+constexpr int num_scans = 25;  // scans within 12m of the vertex, both ways
+constexpr float phi_res = 0.041, theta_res = 0.026;  // default config
+constexpr float max_num_obs = 10000, min_num_obs = 4;
+
+PointWithInfo makePoint(const float x, const float y, const float z,
+                        const float nx, const float ny, const float nz) {
+  PointWithInfo p;
+  p.x = x, p.y = y, p.z = z;
+  p.normal_x = nx, p.normal_y = ny, p.normal_z = nz;
+  return p;
+}
+
+/** \brief Surface points of the street, pedestrians moved by offset */
+PointCloud street(const float spacing, const float offset, std::mt19937 &gen) {
+  std::normal_distribution<float> noise(0.0, 0.01);
+  PointCloud points;
+  const auto box = [&](const float cx, const float cy, const float lx,
+                       const float ly, const float h) {
+    for (float x = cx - lx / 2; x < cx + lx / 2; x += spacing)
+      for (float z = -1.5; z < -1.5 + h; z += spacing) {
+        points.push_back(makePoint(x, cy - ly / 2, z, 0, -1, 0));
+        points.push_back(makePoint(x, cy + ly / 2, z, 0, 1, 0));
+      }
+    for (float y = cy - ly / 2; y < cy + ly / 2; y += spacing)
+      for (float z = -1.5; z < -1.5 + h; z += spacing) {
+        points.push_back(makePoint(cx - lx / 2, y, z, -1, 0, 0));
+        points.push_back(makePoint(cx + lx / 2, y, z, 1, 0, 0));
+      }
+  };
+  for (float x = -40; x < 40; x += spacing) {
+    // road and sidewalks
+    for (float y = -12; y < 12; y += spacing)
+      points.push_back(makePoint(x, y, -1.5 + noise(gen), 0, 0, 1));
+    // facades with recessed windows
+    for (float z = -1.5; z < 12; z += spacing) {
+      const float recess = std::fmod(x + 40, 4.f) < 1.5 ? 0.3 : 0.0;
+      points.push_back(makePoint(x, -12 - recess + noise(gen), z, 0, 1, 0));
+      points.push_back(makePoint(x, 12 + recess + noise(gen), z, 0, -1, 0));
+    }
+  }
+  for (float x = -36; x < 40; x += 6) {
+    box(x, -7.5, 4.5, 1.8, 1.5);  // parked cars
+    box(x + 3, 9.5, 0.3, 0.3, 6.0);  // poles
+    box(x + 1.5 + offset, 10.5, 0.5, 0.5, 1.8);  // pedestrians
+    box(x - 1.5 - offset, -10.5, 0.5, 0.5, 1.8);
+  }
+  for (auto &p : points) p.raw_flex1 = 0;
+  return points;
+}
+
+Eigen::Matrix4f sensorPose(const float x) {
+  Eigen::Matrix4f T = Eigen::Matrix4f::Identity();
+  T.block<3, 1>(0, 3) << x, 0.3 * std::sin(x), 0.0;
+  return T;
+}
+
+/** \brief Scan from a sensor at x, in the sensor frame, within 40m */
+PointCloud scan(const float x, std::mt19937 &gen) {
+  auto points = street(0.15, 0.7 * x, gen);
+  pointcloud::transformPointCloud(sensorPose(x).inverse(), points);
+  PointCloud scan;
+  for (const auto &p : points)
+    if (p.getVector3fMap().norm() < 40.0) scan.push_back(p);
+  ray_tracing::cart2pol(scan);
+  return scan;
+}
+
+/** \brief What the module used to do for every scan */
+void hashGridDetection(const PointCloud &stored_scan, PointCloud &query,
+                       const Eigen::Matrix4f &T_ref_qry) {
+  const auto reference = stored_scan;  // copied out of the graph
+  const auto inner_ratio = 1 - std::max(phi_res, theta_res) / 2;
+  const auto outer_ratio = 1 + std::max(phi_res, theta_res) / 2;
+
+  std::unordered_map<ray_tracing::PixKey, float> frustum_grid;
+  for (const auto &p : reference) {
+    const auto k = getKey(p, phi_res, theta_res);
+    if (frustum_grid.count(k) == 0)
+      frustum_grid[k] = p.rho;
+    else
+      frustum_grid.at(k) = std::min(p.rho, frustum_grid.at(k));
+  }
+
+  PointCloud query_tmp;
+  pointcloud::transformPointCloud(T_ref_qry, query, query_tmp);
+  ray_tracing::cart2pol(query_tmp);
+
+  for (size_t i = 0; i < query.size(); i++) {
+    auto &qp = query[i];
+    const auto &p = query_tmp[i];
+    const auto k = getKey(p, phi_res, theta_res);
+    if (!frustum_grid.count(k)) continue;
+    const float rho_ref = frustum_grid.at(k);
+    if (p.rho > (rho_ref * outer_ratio)) continue;
+    float angle = std::acos(std::min(
+        std::abs(p.getVector3fMap().dot(p.getNormalVector3fMap()) / p.rho),
+        1.0f));
+    if (angle > 5 * M_PI / 12) continue;
+    qp.total_obs++;
+    if (p.rho < (rho_ref * inner_ratio)) qp.dynamic_obs++;
+  }
+
+  for (auto &qp : query) {
+    if (qp.total_obs < min_num_obs)
+      qp.static_score = 0.0;
+    else
+      qp.static_score =
+          1.0 -
+          std::min(1.0f, qp.dynamic_obs / std::max(qp.total_obs, max_num_obs));
+  }
+}
+
+void denseGridDetection(const std::vector<PointCloud> &scans,
+                        PointCloud &query,
+                        const std::vector<Eigen::Matrix4f> &T_ref_qry,
+                        const int num_threads) {
+  ray_tracing::Observations observations(query.size());
+#pragma omp parallel num_threads(num_threads)
+  {
+    ray_tracing::FrustumGrid frustum_grid(phi_res, theta_res);
+    ray_tracing::Observations thread_observations(query.size());
+#pragma omp for schedule(dynamic, 1)
+    for (int i = 0; i < (int)scans.size(); ++i) {
+      frustum_grid.reset(scans[i]);
+      ray_tracing::traceObservations(frustum_grid, query, T_ref_qry[i],
+                                     thread_observations);
+    }
+#pragma omp critical
+    observations += thread_observations;
+  }
+  ray_tracing::updateStaticScores(observations, query, max_num_obs,
+                                  min_num_obs);
+}
+
+}  // namespace
+
+int main(int, char **) {
+  configureLogging("", false);
+
+  std::mt19937 gen(42);
+  const int max_threads = omp_get_max_threads();
+  timing::Stopwatch<> hash_timer(false), dense_timer(false),
+      dense_mt_timer(false);
+  size_t map_size = 0, scan_size = 0, mismatches = 0;
+  for (int v = 0; v < num_vertices; ++v) {
+    const float x_v = -6.0 + 3.0 * v;
+    // submap of the vertex, in the vertex frame
+    auto map = street(0.1, 0.0, gen);
+    pointcloud::transformPointCloud(sensorPose(x_v).inverse(), map);
+    std::vector<PointCloud> scans;
+    std::vector<Eigen::Matrix4f> T_ref_qry;
+    for (int i = 0; i < num_scans; ++i) {
+      const float x_s = x_v - 12.0 + 24.0 * i / (num_scans - 1);
+      scans.push_back(scan(x_s, gen));
+      T_ref_qry.push_back(sensorPose(x_s).inverse() * sensorPose(x_v));
+    }
+    map_size += map.size(), scan_size += scans.front().size();
+
+    auto expected = map;
+    hash_timer.start();
+    for (int i = 0; i < num_scans; ++i)
+      hashGridDetection(scans[i], expected, T_ref_qry[i]);
+    hash_timer.stop();
+
+    auto actual = map;
+    dense_timer.start();
+    denseGridDetection(scans, actual, T_ref_qry, 1);
+    dense_timer.stop();
+
+    auto actual_mt = map;
+    dense_mt_timer.start();
+    denseGridDetection(scans, actual_mt, T_ref_qry, max_threads);
+    dense_mt_timer.stop();
+
+    for (size_t i = 0; i < map.size(); ++i) {
+      mismatches += actual[i].raw_flex1 != expected[i].raw_flex1;
+      mismatches += actual_mt[i].raw_flex1 != expected[i].raw_flex1;
+    }
+  }
+
+  const auto avg = [](const timing::Stopwatch<> &timer) {
+    return (double)timer.count<std::chrono::microseconds>() / 1000.0 /
+           num_vertices;
+  };
+  CLOG(INFO, "test") << "map points: " << map_size / num_vertices
+                     << ", scan points: " << scan_size / num_vertices
+                     << ", scans per vertex: " << num_scans;
+  CLOG(INFO, "test") << "hash grid: " << avg(hash_timer)
+                     << " ms/vertex, dense grid (1 thread): "
+                     << avg(dense_timer) << " ms/vertex, dense grid ("
+                     << max_threads << " threads): " << avg(dense_mt_timer)
+                     << " ms/vertex, mismatches: " << mismatches;
+
+  return mismatches == 0 ? 0 : 1;
+}
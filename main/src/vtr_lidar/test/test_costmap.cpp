@@ -0,0 +1,197 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_costmap.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "vtr_lidar/data_types/costmap.hpp"
+#include "vtr_lidar/data_types/costmap_history.hpp"
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+/** \brief Same cost function as the change detection module */
+void distanceToCost(const float &dist, float &v) {
+  const float d0 = 0.5, d1 = 0.9;
+  v = std::min(std::max(1 - (dist - d1) / d0, 0.0f), 0.9f);
+}
+
+pcl::PointCloud<PointWithInfo> randomPoints(const size_t num,
+                                            const float &range) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-range, range);
+  pcl::PointCloud<PointWithInfo> points;
+  for (size_t i = 0; i < num; ++i) {
+    PointWithInfo p;
+    p.x = dist(gen);
+    p.y = dist(gen);
+    p.z = 0.0f;
+    points.push_back(p);
+  }
+  return points;
+}
+
+}  // namespace
+
+TEST(LIDAR, closest_point_distance) {
+  // ties: duplicated points and points sharing an x coordinate
+  auto points = randomPoints(40, 3.0);
+  points.push_back(points[0]);
+  for (int i = 1; i < 10; ++i) {
+    auto p = points[i];
+    p.y += 0.37f * i;
+    points.push_back(p);
+  }
+  std::vector<Eigen::Vector2f> points_xy;
+  for (const auto &p : points) points_xy.emplace_back(p.x, p.y);
+
+  const costmap::PixKey origin(-20, -12);
+  const float dl = 0.2, max_distance = 1.0;
+  Eigen::MatrixXf dists(41, 25);
+  costmap::closestPointDistance(points_xy, origin, dl, max_distance, dists);
+
+  for (int i = 0; i < dists.rows(); ++i)
+    for (int j = 0; j < dists.cols(); ++j) {
+      const Eigen::Vector2f q((i + origin.x) * dl, (j + origin.y) * dl);
+      float expected = std::numeric_limits<float>::infinity();
+      for (const auto &p : points_xy)
+        expected = std::min(expected, (p - q).norm());
+      // only nearby points are considered, farther distances are not exact
+      if (expected > max_distance)
+        EXPECT_GT(dists(i, j), max_distance) << "at (" << i << ", " << j << ")";
+      else
+        EXPECT_NEAR(dists(i, j), expected, 1e-5f)
+            << "at (" << i << ", " << j << ")";
+    }
+}
+
+TEST(LIDAR, dense_costmap_update_from_distance) {
+  // points also lie outside of the cost map to check the padding
+  const auto points = randomPoints(50, 12.0);
+
+  for (const float dl : {0.1f, 0.25f, 0.5f}) {
+    // reference: nearest neighbor by brute force for every cell
+    DenseCostMap expected(dl, 16.0, 8.0);
+    expected.update([&](const Eigen::Vector2f &q, float &v) {
+      float min_dist = std::numeric_limits<float>::max();
+      for (const auto &p : points)
+        min_dist = std::min(min_dist, (Eigen::Vector2f(p.x, p.y) - q).norm());
+      distanceToCost(min_dist, v);
+    });
+
+    DenseCostMap costmap(dl, 16.0, 8.0);
+    costmap.updateFromDistance(points, 0.5 + 0.9, distanceToCost);
+
+    // exact distance to the closest point, up to floating point error
+    const float tolerance = 1e-5f;
+    const auto expected_values = expected.filter(-1.0f);
+    const auto values = costmap.filter(-1.0f);
+    ASSERT_EQ(values.size(), expected_values.size());
+    for (const auto &[key, value] : expected_values) {
+      ASSERT_EQ(values.count(key), (size_t)1);
+      EXPECT_NEAR(values.at(key), value, tolerance)
+          << "at (" << key.first << ", " << key.second << "), dl: " << dl;
+    }
+  }
+}
+
+TEST(LIDAR, costmap_history_matches_sliding_window_filter) {
+  const int history_size = 5, vote_threshold = 3;
+  const float dl = 0.25;
+  CostMapHistory history(history_size, vote_threshold, 100);
+
+  // reference: float keyed maps shifted and merged every frame
+  using FloatMap = std::unordered_map<std::pair<float, float>, float>;
+  std::vector<FloatMap> reference;
+
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> offset(-8, 8);
+  std::uniform_real_distribution<float> value(0.01, 0.9);
+  for (int frame = 0; frame < 40; ++frame) {
+    // a window moving with the robot, with cells persisting across frames
+    std::unordered_map<costmap::PixKey, float> cells;
+    const int center = frame * 2;
+    for (int i = 0; i < 30; ++i)
+      cells.emplace(costmap::PixKey(center + offset(gen), offset(gen) / 2),
+                    value(gen));
+
+    CostMapHistory::Cells cells_vec(cells.begin(), cells.end());
+    history.push(cells_vec);
+
+    FloatMap float_cells;
+    for (const auto &[k, v] : cells)
+      float_cells.emplace(std::make_pair(k.x * dl, k.y * dl), v);
+    if (reference.size() == (size_t)history_size)
+      reference.erase(reference.begin());
+    reference.push_back(float_cells);
+
+    ASSERT_EQ(history.size(), reference.size());
+    if (!history.full()) continue;
+
+    FloatMap merged = reference.back();
+    for (size_t i = 0; i + 1 < reference.size(); ++i)
+      merged.merge(FloatMap(reference[i]));
+    FloatMap expected;
+    for (const auto &[k, v] : merged) {
+      int votes = 0;
+      for (const auto &map : reference) votes += map.count(k);
+      if (votes >= vote_threshold) expected.emplace(k, v);
+    }
+
+    const auto filtered = history.filter();
+    ASSERT_EQ(filtered.size(), expected.size()) << "frame: " << frame;
+    for (const auto &[k, v] : filtered) {
+      const auto key = std::make_pair(k.x * dl, k.y * dl);
+      ASSERT_EQ(expected.count(key), (size_t)1) << "frame: " << frame;
+      EXPECT_EQ(expected.at(key), v) << "frame: " << frame;
+    }
+  }
+}
+
+TEST(LIDAR, sparse_costmap_storable_round_trip) {
+  const auto points = randomPoints(200, 6.0);
+  std::vector<float> values;
+  for (size_t i = 0; i < points.size(); ++i) values.push_back(0.01f * (i % 97));
+
+  SparseCostMap costmap(0.3, 10.0, 8.0);
+  costmap.update(points, values);
+  costmap.vertex_id() = tactic::VertexId(1, 42);
+  costmap.map_version() = 2;
+  costmap.params_hash() = 12345;
+
+  const auto loaded = SparseCostMap::fromStorable(costmap.toStorable());
+  EXPECT_EQ(loaded->vertex_id(), costmap.vertex_id());
+  EXPECT_EQ(loaded->map_version(), costmap.map_version());
+  EXPECT_EQ(loaded->params_hash(), costmap.params_hash());
+  EXPECT_EQ(loaded->dl(), costmap.dl());
+  EXPECT_EQ(loaded->filter(0.0), costmap.filter(0.0));
+  EXPECT_EQ(loaded->toDense().filter(0.0), costmap.toDense().filter(0.0));
+}
+
+int main(int argc, char **argv) {
+  configureLogging("", true);
+  InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,221 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_himmelsbach.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/segmentation/himmelsbach.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+/**
+ * \brief Reference ground extraction: every candidate bin refits the current
+ * line from scratch and every point scans all lines for the closest one.
+ */
+std::vector<size_t> referenceGround(const Himmelsbach<PointWithInfo> &params,
+                                    const PointCloud &points) {
+  const auto radius = [&](const size_t idx) {
+    return std::sqrt(points[idx].x * points[idx].x +
+                     points[idx].y * points[idx].y);
+  };
+  const auto fit_line = [&](const std::vector<size_t> &line_set) {
+    Eigen::MatrixXf A(line_set.size(), 2);
+    Eigen::VectorXf b(line_set.size());
+    for (size_t i = 0; i < line_set.size(); ++i) {
+      A(i, 0) = radius(line_set[i]);
+      A(i, 1) = 1;
+      b(i) = points[line_set[i]].z;
+    }
+    const auto soln = (A.transpose() * A).ldlt().solve(A.transpose() * b).eval();
+    const auto err = A * soln - b;
+    const auto mse = ((err.transpose() * err) / (float)line_set.size()).value();
+    return std::make_tuple(soln(0), soln(1), std::sqrt(mse));
+  };
+  struct Line {
+    float m, b, xs, xe;
+  };
+  const auto dist_point_line = [&](const size_t idx, const Line &line) {
+    const auto line_z = line.m * radius(idx) + line.b;
+    return std::abs(line_z - points[idx].z) / std::sqrt(line.m * line.m + 1);
+  };
+
+  // segments and bins (lowest point of each bin)
+  std::vector<std::vector<size_t>> segments(
+      static_cast<size_t>(std::ceil(2 * M_PI / params.alpha)));
+  for (size_t i = 0; i < points.size(); ++i) {
+    auto angle = std::atan2(points[i].y, points[i].x);
+    if (angle < 0) angle += 2 * M_PI;
+    segments[(size_t)std::floor(angle / params.alpha)].push_back(i);
+  }
+  const auto num_bins = params.num_bins_small + params.num_bins_large;
+  const auto rsmall = params.rmin + params.bin_size_small * params.num_bins_small;
+  const auto rlarge = rsmall + params.bin_size_large * params.num_bins_large;
+
+  std::vector<size_t> ground_idx;
+  for (const auto &segment : segments) {
+    std::vector<int> bins(num_bins, -1);
+    for (const auto &idx : segment) {
+      const auto r = radius(idx);
+      int bin = -1;
+      if (params.rmin <= r && r < rsmall)
+        bin = (r - params.rmin) / params.bin_size_small;
+      else if (rsmall <= r && r < rlarge)
+        bin = params.num_bins_small + (r - rsmall) / params.bin_size_large;
+      if (bin >= 0 && (bins[bin] < 0 || points[idx].z < points[bins[bin]].z))
+        bins[bin] = idx;
+    }
+
+    std::vector<Line> lines;
+    std::vector<size_t> line_set;
+    const auto close_line = [&] {
+      const auto [m, b, rmse] = fit_line(line_set);
+      lines.push_back({m, b, radius(line_set.front()), radius(line_set.back())});
+      line_set.clear();
+    };
+    size_t i = 0;
+    while (i < bins.size() - 1) {
+      const auto idx = bins[i];
+      if (idx < 0) {
+        ++i;
+      } else if (line_set.size() >= 2) {
+        std::vector<size_t> tmp(line_set);
+        tmp.emplace_back(idx);
+        const auto [m, b, rmse] = fit_line(tmp);
+        if (std::abs(m) <= params.Tm &&
+            (std::abs(m) > params.Tm_small ||
+             std::abs(b + params.z_offset) <= params.Tb) &&
+            rmse <= params.Trmse) {
+          line_set.emplace_back(idx);
+          ++i;
+        } else {
+          close_line();
+        }
+      } else {
+        const auto mprev = lines.empty() ? 0 : std::abs(lines.back().m);
+        const auto dprev = lines.empty() ? -1 : dist_point_line(idx, lines.back());
+        if (mprev > params.Tm || dprev <= params.Tdprev || lines.empty() ||
+            !line_set.empty())
+          line_set.emplace_back(idx);
+        ++i;
+      }
+    }
+    if (line_set.size() >= 2) close_line();
+
+    for (const auto &idx : segment) {
+      const auto r = radius(idx);
+      int closest = -1;
+      float dmin = std::numeric_limits<float>::max();
+      for (size_t i = 0; i < lines.size(); ++i) {
+        const auto d =
+            std::min(std::abs(lines[i].xs - r), std::abs(lines[i].xe - r));
+        if (d < dmin && std::abs(lines[i].m) < params.Tm) {
+          dmin = d;
+          closest = i;
+        }
+      }
+      if (closest >= 0 &&
+          dist_point_line(idx, lines[closest]) < params.tolerance)
+        ground_idx.emplace_back(idx);
+    }
+  }
+  return ground_idx;
+}
+
+/**
+ * \brief Scan of a multi-beam lidar over sloped, bumpy terrain with boxes on
+ * it, the terrain slope can be set to a threshold of the line fit
+ */
+PointCloud makeScan(std::mt19937 &rng, const float slope, const float noise,
+                    const float z_offset) {
+  std::normal_distribution<float> gaussian(0.0, noise);
+  std::uniform_real_distribution<float> uniform(0.0, 1.0);
+  std::vector<Eigen::Vector4f> boxes;  // x, y, half size, height
+  for (int i = 0; i < 20; ++i)
+    boxes.emplace_back(-40.0 + 80.0 * uniform(rng), -40.0 + 80.0 * uniform(rng),
+                       0.3 + 2.0 * uniform(rng), 3.0 * uniform(rng));
+  PointCloud points;
+  for (int beam = 0; beam < 32; ++beam) {
+    const float range = 2.0 + 1.5 * beam * (1.0 + 0.05 * beam);
+    for (int k = 0; k < 720; ++k) {
+      const float theta = 2.0 * M_PI * (k + uniform(rng)) / 720.0;
+      PointWithInfo p;
+      p.x = range * std::cos(theta);
+      p.y = range * std::sin(theta);
+      p.z = -z_offset + slope * range + 0.1 * std::sin(0.3 * p.x) +
+            (noise > 0.0 ? gaussian(rng) : 0.0);
+      for (const auto &box : boxes) {
+        if (std::abs(p.x - box(0)) < box(2) && std::abs(p.y - box(1)) < box(2))
+          p.z += box(3) * uniform(rng);
+      }
+      points.push_back(p);
+    }
+  }
+  return points;
+}
+
+}  // namespace
+
+TEST(LIDAR, himmelsbach_matches_reference) {
+  std::mt19937 rng(0);
+  for (const int setting : {0, 1}) {
+    Himmelsbach<PointWithInfo> himmelsbach;
+    if (setting == 1) {
+      // small bins close to the sensor
+      himmelsbach.z_offset = 0.2;
+      himmelsbach.alpha = 0.035;
+      himmelsbach.Tm = 0.3;
+      himmelsbach.Tm_small = 0.1;
+      himmelsbach.Tb = 0.5;
+      himmelsbach.rmin = 2.0;
+      himmelsbach.bin_size_small = 0.5;
+      himmelsbach.num_bins_large = 10;
+      himmelsbach.bin_size_large = 1.0;
+    }
+    // slopes on the fitted line thresholds and noise levels around the rmse
+    // threshold exercise the exact decision path
+    for (const float slope :
+         {0.0f, 0.05f, himmelsbach.Tm_small, 0.3f, himmelsbach.Tm}) {
+      for (const float noise : {0.0f, 0.02f, 0.1f}) {
+        const auto points = makeScan(rng, slope, noise, himmelsbach.z_offset);
+        const auto expected = referenceGround(himmelsbach, points);
+        for (const int num_threads : {1, 4}) {
+          himmelsbach.num_threads = num_threads;
+          EXPECT_EQ(himmelsbach(points), expected)
+              << "setting: " << setting << ", slope: " << slope
+              << ", noise: " << noise << ", threads: " << num_threads;
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  configureLogging("", true);
+  InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,333 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_mesh2pcd.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gmock/gmock.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <unordered_map>
+
+#include <Eigen/Geometry>
+
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/mesh2pcd/mesh2pcd.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+using namespace vtr::lidar::mesh2pcd;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+struct Mesh {
+  std::vector<Eigen::Vector4f> vertices;
+  std::vector<Eigen::Vector4f> normals;
+  std::vector<std::array<int, 4>> faces;
+
+  void addFace(const Eigen::Vector3f &p1, const Eigen::Vector3f &p2,
+               const Eigen::Vector3f &p3, const Eigen::Vector3f &n) {
+    const int v = vertices.size();
+    vertices.emplace_back(p1.x(), p1.y(), p1.z(), 1.0);
+    vertices.emplace_back(p2.x(), p2.y(), p2.z(), 1.0);
+    vertices.emplace_back(p3.x(), p3.y(), p3.z(), 1.0);
+    normals.emplace_back(n.x(), n.y(), n.z(), 0.0);
+    faces.push_back({v, v + 1, v + 2, (int)normals.size() - 1});
+  }
+
+  /// triangulated sphere with outward normals
+  void addSphere(const Eigen::Vector3f &c, const float r, const int n_lat,
+                 const int n_lon) {
+    const auto point = [&](const int i, const int j) -> Eigen::Vector3f {
+      const float theta = M_PI * i / n_lat, phi = 2 * M_PI * j / n_lon;
+      return c + r * Eigen::Vector3f(std::sin(theta) * std::cos(phi),
+                                     std::sin(theta) * std::sin(phi),
+                                     std::cos(theta));
+    };
+    for (int i = 0; i < n_lat; ++i) {
+      for (int j = 0; j < n_lon; ++j) {
+        const auto p00 = point(i, j), p01 = point(i, j + 1);
+        const auto p10 = point(i + 1, j), p11 = point(i + 1, j + 1);
+        const auto n = ((p00 + p01 + p10 + p11) / 4 - c).normalized();
+        if (i > 0) addFace(p00, p10, p01, n);
+        if (i < n_lat - 1) addFace(p01, p10, p11, n);
+      }
+    }
+  }
+
+  void write(const std::string &filename) const {
+    std::ofstream out(filename);
+    out << std::setprecision(9) << "# test mesh\n";
+    for (const auto &v : vertices)
+      out << "v " << v.x() << " " << v.y() << " " << v.z() << "\n";
+    for (const auto &n : normals)
+      out << "vn " << n.x() << " " << n.y() << " " << n.z() << "\n";
+    for (const auto &f : faces)
+      out << "f " << f[0] + 1 << "//" << f[3] + 1 << " " << f[1] + 1 << "//"
+          << f[3] + 1 << " " << f[2] + 1 << "//" << f[3] + 1 << "\n";
+  }
+};
+
+/**
+ * \brief Reference conversion: every candidate ray of every face is traced
+ * and the depth of each (theta, phi) ray is kept in a hash map.
+ */
+class ReferenceConverter {
+ public:
+  ReferenceConverter(const Mesh &mesh, const Mesh2PcdConverter::Config &config)
+      : mesh_(mesh), config_(config) {}
+
+  void addToPcd(PointCloud &pcd, const Eigen::Matrix4f &T_pcd_obj,
+                const bool clear) const {
+    std::vector<Eigen::Vector3f> vertices_org, normals_org;
+    for (const auto &v : mesh_.vertices)
+      vertices_org.emplace_back((T_pcd_obj * v).head<3>());
+    for (const auto &n : mesh_.normals)
+      normals_org.emplace_back((T_pcd_obj * n).head<3>());
+    std::vector<Eigen::Vector2f> vertices_polar;
+    for (auto &v : vertices_org)
+      vertices_polar.emplace_back(utils::cart2pol(v).tail<2>());
+
+    const auto key = [](const int x, const int y) {
+      return ((int64_t)x << 32) | (uint32_t)y;
+    };
+    std::unordered_map<int64_t, std::pair<float, std::vector<size_t>>>
+        key2depthidx;
+    for (size_t i = 0; i < pcd.size(); ++i) {
+      const auto pt_polar = utils::cart2pol(pcd.at(i).getVector3fMap());
+      const auto k = key((int)std::round(pt_polar(1) / config_.theta_res),
+                         (int)std::round(pt_polar(2) / config_.phi_res));
+      auto res = key2depthidx.try_emplace(k, pt_polar(0),
+                                          std::vector<size_t>{i});
+      if (!res.second) {
+        res.first->second.second.emplace_back(i);
+        if (pt_polar(0) < res.first->second.first)
+          res.first->second.first = pt_polar(0);
+      }
+      if (clear) pcd.at(i).flex24 = 0.0;
+    }
+
+    for (size_t ind = 0; ind < mesh_.faces.size(); ++ind) {
+      const auto &f = mesh_.faces.at(ind);
+      const auto &p1 = vertices_org.at(f[0]);
+      const auto &p2 = vertices_org.at(f[1]);
+      const auto &p3 = vertices_org.at(f[2]);
+      const auto &n = normals_org.at(f[3]);
+      std::vector<int> thetas, phis;
+      candidateRays(f, vertices_polar, thetas, phis);
+      for (const auto &i : thetas) {
+        for (const auto &j : phis) {
+          const auto theta = i * config_.theta_res;
+          const auto phi = j * config_.phi_res;
+          const auto l = utils::pol2cart(Eigen::Vector3f(1.0, theta, phi));
+          const auto q = utils::intersection(l, p1, n);
+          if (!utils::inside(q, p1, p2, p3, n)) continue;
+          const auto rho = q.norm();
+          if (rho < config_.range_min || rho > config_.range_max) continue;
+          const auto set_point = [&](PointWithInfo &pt) {
+            pt.getVector3fMap() = q;
+            pt.getNormalVector3fMap() = n.dot(q) > 0 ? -n : n;
+            pt.flex24 = 1.0;
+          };
+          auto res = key2depthidx.try_emplace(key(i, j), rho,
+                                              std::vector<size_t>{pcd.size()});
+          if (res.second) {
+            PointWithInfo pt;
+            set_point(pt);
+            pcd.push_back(pt);
+          } else if (rho < res.first->second.first) {
+            for (const auto &idx : res.first->second.second)
+              set_point(pcd.at(idx));
+            res.first->second.first = rho;
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  void candidateRays(const std::array<int, 4> &face,
+                     const std::vector<Eigen::Vector2f> &points,
+                     std::vector<int> &thetas, std::vector<int> &phis) const {
+    // clang-format off
+    float theta_min = std::numeric_limits<float>::max();
+    float theta_max = std::numeric_limits<float>::min();
+    float phi_min = std::numeric_limits<float>::max();
+    float phi_max = std::numeric_limits<float>::min();
+    float dphi = std::numeric_limits<float>::min();
+    for (size_t i = 0; i < 3; ++i) {
+      const auto &p1 = points.at(face[i]);
+      const auto &p2 = points.at(face[(i + 1) % 3]);
+      theta_min = std::min(theta_min, p1[0]);
+      theta_max = std::max(theta_max, p1[0]);
+      const float phi_min_tmp = std::min(p1[1], p2[1]);
+      const float phi_max_tmp = std::max(p1[1], p2[1]);
+      float dphi_tmp = phi_max_tmp - phi_min_tmp;
+      dphi_tmp = dphi_tmp < M_PI ? dphi_tmp : 2 * M_PI - dphi_tmp;
+      if (dphi_tmp > dphi) {
+        dphi = dphi_tmp;
+        phi_min = phi_min_tmp;
+        phi_max = phi_max_tmp;
+      }
+    }
+    {
+      float dphi = phi_max - phi_min;
+      dphi = dphi < M_PI ? dphi : 2 * M_PI - dphi;
+      const float xy_min = std::cos(dphi / 2.0) * std::sin(theta_min);
+      const float xy_max = std::cos(dphi / 2.0) * std::sin(theta_max);
+      const float z_min = std::cos(theta_min), z_max = std::cos(theta_max);
+      theta_min = std::min(theta_min, std::atan2(xy_min, z_min));
+      theta_max = std::max(theta_max, std::atan2(xy_max, z_max));
+    }
+    const int theta_lb = std::max((int)std::floor(theta_min / config_.theta_res), (int)std::ceil(config_.theta_min / config_.theta_res));
+    const int theta_ub = std::min((int)std::ceil(theta_max / config_.theta_res), (int)std::floor(config_.theta_max / config_.theta_res));
+    for (int i = theta_lb; i <= theta_ub; ++i) thetas.emplace_back(i);
+    if ((phi_max - phi_min) < M_PI) {
+      const int phi_lb = std::max((int)std::floor(phi_min / config_.phi_res), (int)std::ceil(config_.phi_min / config_.phi_res));
+      const int phi_ub = std::min((int)std::ceil(phi_max / config_.phi_res), (int)std::floor(config_.phi_max / config_.phi_res));
+      for (int i = phi_lb; i <= phi_ub; ++i) phis.emplace_back(i);
+    } else {
+      const int phi_lb1 = std::ceil(config_.phi_min / config_.phi_res);
+      const int phi_ub1 = std::max((int)std::ceil(phi_min / config_.phi_res), (int)std::ceil(config_.phi_min / config_.phi_res));
+      for (int i = phi_lb1; i <= phi_ub1; ++i) phis.emplace_back(i);
+      const int phi_lb2 = std::min((int)std::floor(phi_max / config_.phi_res), (int)std::floor(config_.phi_max / config_.phi_res));
+      const int phi_ub2 = std::floor(config_.phi_max / config_.phi_res);
+      for (int i = phi_lb2; i <= phi_ub2; ++i) phis.emplace_back(i);
+    }
+    // clang-format on
+  }
+
+  const Mesh &mesh_;
+  const Mesh2PcdConverter::Config config_;
+};
+
+/// a box and a sphere behind the sensor (across phi = +/-pi), a ground plane
+/// and small random triangles with arbitrary normal directions
+Mesh makeMesh(std::mt19937 &rng) {
+  Mesh mesh;
+  // ground
+  const float g = 20.0, z = -1.2;
+  mesh.addFace({-g, -g, z}, {g, -g, z}, {g, g, z}, {0, 0, 1});
+  mesh.addFace({-g, -g, z}, {g, g, z}, {-g, g, z}, {0, 0, 1});
+  // spheres
+  mesh.addSphere({-5.0, 0.3, 0.2}, 1.5, 12, 24);
+  mesh.addSphere({6.0, 2.0, -0.5}, 1.0, 8, 16);
+  // random triangles
+  std::uniform_real_distribution<float> unit(-1.0, 1.0);
+  std::uniform_real_distribution<float> range(2.0, 15.0);
+  for (int i = 0; i < 200; ++i) {
+    const Eigen::Vector3f dir =
+        Eigen::Vector3f(unit(rng), unit(rng), 0.3 * unit(rng)).normalized();
+    const Eigen::Vector3f c = range(rng) * dir;
+    const Eigen::Vector3f p1 = c + Eigen::Vector3f(unit(rng), unit(rng), unit(rng));
+    const Eigen::Vector3f p2 = c + Eigen::Vector3f(unit(rng), unit(rng), unit(rng));
+    const Eigen::Vector3f p3 = c + Eigen::Vector3f(unit(rng), unit(rng), unit(rng));
+    Eigen::Vector3f n = (p2 - p1).cross(p3 - p1).normalized();
+    if (unit(rng) < 0) n = -n;
+    mesh.addFace(p1, p2, p3, n);
+  }
+  return mesh;
+}
+
+/// points along random rays, some of them sharing a ray of the converter
+PointCloud makeScan(std::mt19937 &rng) {
+  std::uniform_real_distribution<float> unit(-1.0, 1.0);
+  std::uniform_real_distribution<float> range(1.0, 30.0);
+  PointCloud scan;
+  for (int i = 0; i < 3000; ++i) {
+    const Eigen::Vector3f dir =
+        Eigen::Vector3f(unit(rng), unit(rng), 0.5 * unit(rng)).normalized();
+    for (int k = 0; k < (i % 3 == 0 ? 2 : 1); ++k) {
+      PointWithInfo pt;
+      pt.getVector3fMap() = range(rng) * dir;
+      pt.getNormalVector3fMap() = Eigen::Vector3f::UnitZ();
+      pt.flex24 = 2.0;
+      scan.push_back(pt);
+    }
+  }
+  return scan;
+}
+
+}  // namespace
+
+TEST(Mesh2Pcd, same_points_as_reference) {
+  std::mt19937 rng(42);
+  const auto mesh = makeMesh(rng);
+  const auto scan = makeScan(rng);
+  const auto filename =
+      (std::filesystem::temp_directory_path() / "test_mesh2pcd.obj").string();
+  mesh.write(filename);
+
+  std::vector<Mesh2PcdConverter::Config> configs(2);
+  configs[0].theta_res = 0.02;
+  configs[0].phi_res = 0.02;
+  configs[1].theta_min = 1.2;
+  configs[1].theta_max = 2.0;
+  configs[1].theta_res = 0.005;
+  configs[1].phi_min = -2.5;
+  configs[1].phi_max = 3.0;
+  configs[1].phi_res = 0.01;
+  configs[1].range_min = 3.0;
+  configs[1].range_max = 12.0;
+
+  Eigen::Matrix4f T_pcd_obj = Eigen::Matrix4f::Identity();
+  T_pcd_obj.block<3, 3>(0, 0) =
+      Eigen::AngleAxisf(0.3, Eigen::Vector3f(0.1, 0.2, 1.0).normalized())
+          .toRotationMatrix();
+  T_pcd_obj.block<3, 1>(0, 3) << 0.5, -0.3, 0.1;
+
+  for (size_t c = 0; c < configs.size(); ++c) {
+    const ReferenceConverter reference(mesh, configs[c]);
+    for (const int num_threads : {1, 4}) {
+      auto config = configs[c];
+      config.num_threads = num_threads;
+      const Mesh2PcdConverter converter(filename, config);
+      for (const bool clear : {false, true}) {
+        auto expected = scan, actual = scan;
+        reference.addToPcd(expected, T_pcd_obj, clear);
+        converter.addToPcd(actual, T_pcd_obj, clear);
+        EXPECT_GT(expected.size(), scan.size());
+
+        ASSERT_EQ(actual.size(), expected.size())
+            << "config " << c << ", threads " << num_threads;
+        size_t num_different = 0;
+        for (size_t i = 0; i < expected.size(); ++i) {
+          if (actual[i].getVector3fMap() != expected[i].getVector3fMap() ||
+              actual[i].getNormalVector3fMap() !=
+                  expected[i].getNormalVector3fMap() ||
+              actual[i].flex24 != expected[i].flex24)
+            ++num_different;
+        }
+        EXPECT_EQ(num_different, (size_t)0)
+            << "config " << c << ", threads " << num_threads;
+      }
+    }
+  }
+  std::filesystem::remove(filename);
+}
+
+int main(int argc, char **argv) {
+  configureLogging("", true);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -19,9 +19,11 @@
 #include <gmock/gmock.h>
 
 #include <bitset>
+#include <random>
 
 #include "vtr_lidar/data_types/multi_exp_pointmap.hpp"
 #include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/utils/nanoflann_utils.hpp"
 #include "vtr_logging/logging_init.hpp"
 
 using namespace ::testing;  // NOLINT
@@ -302,6 +304,202 @@ TEST(LIDAR, point_map_read_write) {
   }
 }
 #endif
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+using Map = MultiExpPointMap<PointWithInfo>;
+
+constexpr float distance_threshold = 0.3;
+constexpr float planar_threshold = 0.05;
+constexpr float normal_threshold = 0.8;
+
+/** \brief Noisy ground and wall with random holes, shifted by offset */
+PointCloud makeExperience(const float offset, std::mt19937 &gen) {
+  std::normal_distribution<float> noise(0.0, 0.02);
+  std::uniform_real_distribution<float> unit(0.0, 1.0);
+  PointCloud points;
+  for (float u = -4.0; u < 4.0; u += 0.12)
+    for (float v = 0.0; v < 3.0; v += 0.12) {
+      if (unit(gen) < 0.3) continue;
+      PointWithInfo p;
+      // ground, and a wall every other point
+      if (unit(gen) < 0.5) {
+        p.x = u + offset, p.y = v + offset, p.z = noise(gen);
+        p.normal_x = noise(gen), p.normal_y = noise(gen), p.normal_z = 1.0;
+      } else {
+        p.x = 3.0 + noise(gen), p.y = u + offset, p.z = v;
+        p.normal_x = 1.0, p.normal_y = noise(gen), p.normal_z = noise(gen);
+      }
+      // tilted normals to be rejected by the normal check
+      if (unit(gen) < 0.1) p.getNormalVector3fMap() << 1.0, 1.0, 1.0;
+      p.getNormalVector3fMap().normalize();
+      // leftover of other fields (e.g. timestamp)
+      p.raw_flex2 = ~__uint128_t(0);
+      points.push_back(p);
+    }
+  return points;
+}
+
+/**
+ * \brief What the inter-experience merging module used to do on a copy of
+ * the map: shift all bit vectors for a new experience, then search the points
+ * of the experience in a kd-tree of the map.
+ */
+void eagerUpdate(Map &map, PointCloud points, const uint32_t exp) {
+  for (auto &p : points) {
+    p.bits = 1;
+    p.multi_exp_obs = 1.0;
+    p.bits_epoch = 0;
+  }
+  auto &exps = map.exps();
+  if (exps.empty() || exps.back() != exp) {
+    exps.push_back(exp);
+    if (exps.size() > map.max_num_exps()) exps.pop_front();
+    for (auto &p : map.point_cloud()) p.bits <<= 1;
+  }
+
+  auto &map_points = map.point_cloud();
+  NanoFLANNAdapter<PointWithInfo> adapter(map_points);
+  KDTree<PointWithInfo> kdtree(3, adapter, KDTreeParams(10));
+  kdtree.buildIndex();
+  for (const auto &pt : points) {
+    std::vector<float> dists;
+    std::vector<int> indices;
+    NanoFLANNRadiusResultSet<float, int> result(
+        distance_threshold * distance_threshold, dists, indices);
+    kdtree.radiusSearchCustomCallback(pt.data, result, KDTreeSearchParams());
+    for (const auto &idx : indices) {
+      auto &pt2 = map_points[idx];
+      const auto diff = pt.getVector3fMap() - pt2.getVector3fMap();
+      const auto planar_dist = std::abs(pt2.getNormalVector3fMap().dot(diff));
+      if (planar_dist > planar_threshold) continue;
+      const auto normal_dist =
+          std::abs(pt2.getNormalVector3fMap().dot(pt.getNormalVector3fMap()));
+      if (normal_dist < normal_threshold) continue;
+      if ((pt2.bits & 1) == 0) {
+        pt2.bits++;
+        pt2.multi_exp_obs += 1.0;
+      }
+    }
+  }
+  map.update(points);
+}
+
+void lazyUpdate(Map &map, const PointCloud &points, const uint32_t exp,
+                const int num_threads) {
+  const auto &exps = map.exps();
+  if (exps.empty() || exps.back() != exp) map.addExperience(exp);
+  map.observe(points, distance_threshold, planar_threshold, normal_threshold,
+              num_threads);
+  map.addPoints(points);
+}
+
+/** \brief Returns the number of points observed more than once */
+size_t expectSameMap(const Map &expected, const Map &actual) {
+  EXPECT_EQ(expected.size(), actual.size());
+  if (expected.size() != actual.size()) return 0;
+  EXPECT_EQ(expected.exps(), actual.exps());
+  size_t observed = 0;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    const auto &p = expected.point_cloud()[i];
+    const auto &q = actual.point_cloud()[i];
+    EXPECT_EQ(p.getVector3fMap(), q.getVector3fMap()) << "point " << i;
+    EXPECT_TRUE(p.bits == actual.bits(q)) << "point " << i;
+    EXPECT_EQ(p.multi_exp_obs, q.multi_exp_obs) << "point " << i;
+    observed += p.multi_exp_obs > 1.0;
+  }
+  return observed;
+}
+
+}  // namespace
+
+TEST(LIDAR, multi_exp_point_map_lazy_update_matches_eager_update) {
+  for (const int num_threads : {1, 4}) {
+    std::mt19937 gen(42);
+    Map expected(0.1, 3), actual(0.1, 3);
+    size_t observed = 0;
+    // experience 2 is merged twice, experiences beyond 3 drop the oldest
+    for (const uint32_t exp : {0, 1, 2, 2, 3, 4, 5}) {
+      const auto points = makeExperience(0.05 * exp, gen);
+      eagerUpdate(expected, points, exp);
+      lazyUpdate(actual, points, exp, num_threads);
+      observed = expectSameMap(expected, actual);
+    }
+    // make sure the comparison is not trivial
+    EXPECT_GT(observed, expected.size() / 4);
+  }
+}
+
+TEST(LIDAR, multi_exp_point_map_lazy_ageing_drops_old_bits) {
+  std::mt19937 gen(7);
+  Map expected(0.1, 128), actual(0.1, 128);
+  const auto points = makeExperience(0.0, gen);
+  eagerUpdate(expected, points, 0);
+  lazyUpdate(actual, points, 0, 1);
+  // the first half of the points is observed again every 50 experiences, the
+  // other half is never observed again and its bits are eventually shifted out
+  PointCloud half;
+  for (size_t i = 0; i < points.size() / 2; ++i) half.push_back(points[i]);
+  for (uint32_t exp = 1; exp <= 200; ++exp) {
+    const auto &observed = exp % 50 == 0 ? half : PointCloud();
+    eagerUpdate(expected, observed, exp);
+    lazyUpdate(actual, observed, exp, 1);
+  }
+  EXPECT_EQ(actual.epoch(), 201u);
+  ASSERT_EQ(expected.size(), actual.size());
+  size_t zeros = 0;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    const auto &p = expected.point_cloud()[i];
+    ASSERT_TRUE(p.bits == actual.bits(actual.point_cloud()[i]));
+    zeros += p.bits == 0;
+  }
+  EXPECT_GT(zeros, 0u);
+}
+
+TEST(LIDAR, multi_exp_point_map_storable_keeps_lazy_bits) {
+  std::mt19937 gen(3);
+  Map map(0.1, 4);
+  for (const uint32_t exp : {0, 1, 2})
+    lazyUpdate(map, makeExperience(0.05 * exp, gen), exp, 1);
+
+  // the message stores up-to-date bit vectors and the loaded map restarts at
+  // epoch 0, so the message is unchanged and old maps load as they are
+  const auto storable = map.toStorable();
+  const auto loaded = Map::fromStorable(storable);
+  EXPECT_EQ(loaded->epoch(), 0u);
+  EXPECT_EQ(loaded->exps(), map.exps());
+  ASSERT_EQ(loaded->size(), map.size());
+  for (size_t i = 0; i < map.size(); ++i) {
+    ASSERT_EQ(loaded->point_cloud()[i].bits_epoch, 0u);
+    ASSERT_TRUE(loaded->point_cloud()[i].bits ==
+                map.bits(map.point_cloud()[i]));
+  }
+
+  // the loaded map keeps ageing like the original one
+  for (const uint32_t exp : {3, 4}) {
+    const auto points = makeExperience(0.05 * exp, gen);
+    lazyUpdate(map, points, exp, 1);
+    lazyUpdate(*loaded, points, exp, 1);
+  }
+  ASSERT_EQ(loaded->size(), map.size());
+  for (size_t i = 0; i < map.size(); ++i)
+    ASSERT_TRUE(loaded->bits(loaded->point_cloud()[i]) ==
+                map.bits(map.point_cloud()[i]));
+
+  // maps saved before lazy ageing have the unused field in place of
+  // bits_epoch, whatever it holds the stored bit vectors are up to date
+  PointCloud legacy_points;
+  pcl::fromROSMsg(storable.point_cloud, legacy_points);
+  for (auto &p : legacy_points) p.bits_epoch = 0x3f800000;  // 1.0f
+  auto legacy = storable;
+  pcl::toROSMsg(legacy_points, legacy.point_cloud);
+  const auto legacy_loaded = Map::fromStorable(legacy);
+  for (size_t i = 0; i < legacy_points.size(); ++i)
+    ASSERT_TRUE(legacy_loaded->bits(legacy_loaded->point_cloud()[i]) ==
+                legacy_points[i].bits);
+}
+
 int main(int argc, char** argv) {
   configureLogging("", true);
   InitGoogleTest(&argc, argv);
@@ -18,8 +18,11 @@
  */
 #include <gmock/gmock.h>
 
+#include <thread>
+
 #include "vtr_lidar/data_types/point.hpp"
 #include "vtr_lidar/data_types/pointmap.hpp"
+#include "vtr_lidar/data_types/pointmap_views.hpp"
 #include "vtr_logging/logging_init.hpp"
 
 using namespace ::testing;  // NOLINT
@@ -176,6 +179,73 @@ TEST(LIDAR, point_map_read_write) {
   }
 }
 
+TEST(LIDAR, point_map_views) {
+  auto point_map = std::make_shared<PointMap<PointWithInfo>>(0.1);
+  pcl::PointCloud<PointWithInfo> point_cloud;
+  for (int i = 0; i < 200; i++) {
+    PointWithInfo p;
+    // clang-format off
+    p.x = 0.3 * (i % 20); p.y = 0.3 * (i / 20); p.z = 0.01 * i;
+    p.normal_x = 0; p.normal_y = 0; p.normal_z = 1;
+    // clang-format on
+    point_cloud.push_back(p);
+  }
+  point_map->update(point_cloud);
+  Eigen::Matrix4d T_vertex_this = Eigen::Matrix4d::Identity();
+  T_vertex_this.block<3, 3>(0, 0) =
+      Eigen::AngleAxisd(0.5, Eigen::Vector3d(0.2, -0.1, 1.0).normalized())
+          .toRotationMatrix();
+  T_vertex_this.block<3, 1>(0, 3) << 1.0, -2.0, 0.5;
+  point_map->T_vertex_this() = tactic::EdgeTransform(T_vertex_this);
+
+  const PointMapViews views(point_map);
+
+  // concurrent modules get the same views
+  std::vector<const pcl::PointCloud<PointWithInfo> *> vertex_frame(4);
+  std::vector<const KDTree<PointWithInfo> *> kdtrees(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i)
+    threads.emplace_back([&, i] {
+      vertex_frame[i] = &views.vertexFramePointCloud();
+      kdtrees[i] = &views.kdtree();
+    });
+  for (auto &thread : threads) thread.join();
+  for (size_t i = 1; i < 4; ++i) {
+    EXPECT_EQ(vertex_frame[i], vertex_frame[0]);
+    EXPECT_EQ(kdtrees[i], kdtrees[0]);
+  }
+
+  // points and normals in the vertex frame, the map is unchanged
+  const auto &map_points = point_map->point_cloud();
+  ASSERT_EQ(vertex_frame[0]->size(), map_points.size());
+  const Eigen::Matrix4f T = T_vertex_this.cast<float>();
+  for (size_t i = 0; i < map_points.size(); ++i) {
+    const auto &p = map_points[i];
+    const auto &q = (*vertex_frame[0])[i];
+    const Eigen::Vector3f expected =
+        T.block<3, 3>(0, 0) * p.getVector3fMap() + T.block<3, 1>(0, 3);
+    EXPECT_LT((q.getVector3fMap() - expected).norm(), 1e-4);
+    EXPECT_LT((q.getNormalVector3fMap() -
+               T.block<3, 3>(0, 0) * p.getNormalVector3fMap())
+                  .norm(),
+              1e-4);
+  }
+
+  // the kd-tree is on the map points in the map frame
+  KDTreeSearchParams search_params;
+  for (size_t i = 0; i < map_points.size(); ++i) {
+    size_t ind;
+    float dist;
+    KDTreeResultSet result_set(1);
+    result_set.init(&ind, &dist);
+    kdtrees[0]->findNeighbors(result_set, map_points[i].data, search_params);
+    EXPECT_EQ(ind, i);
+    EXPECT_EQ(dist, 0.0f);
+  }
+
+  EXPECT_THROW(PointMapViews(nullptr), std::invalid_argument);
+}
+
 int main(int argc, char** argv) {
   configureLogging("", true);
   InitGoogleTest(&argc, argv);
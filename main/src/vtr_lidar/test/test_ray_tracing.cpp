@@ -0,0 +1,215 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_ray_tracing.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/segmentation/ray_tracing.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+PointWithInfo makePoint(const float x, const float y, const float z,
+                        const float nx, const float ny, const float nz) {
+  PointWithInfo p;
+  p.x = x, p.y = y, p.z = z;
+  p.normal_x = nx, p.normal_y = ny, p.normal_z = nz;
+  return p;
+}
+
+/**
+ * \brief A street between two building facades with a parked car, and a car
+ * that is only there when with_moving_car is true.
+ */
+PointCloud street(const bool with_moving_car, std::mt19937 &gen) {
+  std::normal_distribution<float> noise(0.0, 0.01);
+  PointCloud points;
+  for (float x = -20; x < 20; x += 0.2) {
+    for (float y = -10; y < 10; y += 0.2)
+      points.push_back(makePoint(x, y, -1.5 + noise(gen), 0, 0, 1));
+    for (float z = -1.5; z < 6; z += 0.2) {
+      points.push_back(makePoint(x, -10 + noise(gen), z, 0, 1, 0));
+      points.push_back(makePoint(x, 10 + noise(gen), z, 0, -1, 0));
+    }
+  }
+  const auto add_car = [&](const float cx, const float cy) {
+    for (float x = cx - 2; x < cx + 2; x += 0.1)
+      for (float z = -1.5; z < 0; z += 0.1) {
+        points.push_back(makePoint(x, cy - 1, z, 0, -1, 0));
+        points.push_back(makePoint(x, cy + 1, z, 0, 1, 0));
+      }
+  };
+  add_car(5, -5);
+  if (with_moving_car) add_car(-3, 3);
+  return points;
+}
+
+Eigen::Matrix4f sensorPose(const int i) {
+  Eigen::Matrix4f T = Eigen::Matrix4f::Identity();
+  const float yaw = 0.05 * i;
+  T.block<2, 2>(0, 0) << std::cos(yaw), -std::sin(yaw), std::sin(yaw),
+      std::cos(yaw);
+  T.block<3, 1>(0, 3) << -12.0 + 3.0 * i, 0.5 * (i % 3), 0.0;
+  return T;
+}
+
+/**
+ * \brief Scan of the street from pose i in the sensor frame, with the polar
+ * coordinates unwrapped past pi like the conversion modules do.
+ */
+PointCloud scan(const int i, std::mt19937 &gen) {
+  PointCloud points = street(i == 0, gen);
+  const Eigen::Matrix4f T_s_m = sensorPose(i).inverse();
+  pointcloud::transformPointCloud(T_s_m, points);
+  ray_tracing::cart2pol(points);
+  for (auto &p : points)
+    if (p.phi > 3.0) p.phi -= 2 * M_PI;
+  return points;
+}
+
+/** \brief Hash grid ray tracing of a single scan, as originally implemented */
+void referenceDetection(const PointCloud &reference, PointCloud &query,
+                        const Eigen::Matrix4f &T_ref_qry, const float &phi_res,
+                        const float &theta_res, const float &max_num_obs,
+                        const float &min_num_obs) {
+  const auto inner_ratio = 1 - std::max(phi_res, theta_res) / 2;
+  const auto outer_ratio = 1 + std::max(phi_res, theta_res) / 2;
+
+  std::unordered_map<ray_tracing::PixKey, float> frustum_grid;
+  for (const auto &p : reference) {
+    const auto k = getKey(p, phi_res, theta_res);
+    if (frustum_grid.count(k) == 0)
+      frustum_grid[k] = p.rho;
+    else
+      frustum_grid.at(k) = std::min(p.rho, frustum_grid.at(k));
+  }
+
+  PointCloud query_tmp;
+  pointcloud::transformPointCloud(T_ref_qry, query, query_tmp);
+  ray_tracing::cart2pol(query_tmp);
+
+  for (size_t i = 0; i < query.size(); i++) {
+    auto &qp = query[i];
+    const auto &p = query_tmp[i];
+    const auto k = getKey(p, phi_res, theta_res);
+    if (!frustum_grid.count(k)) continue;
+    const float rho_ref = frustum_grid.at(k);
+    if (p.rho > (rho_ref * outer_ratio)) continue;
+    float angle = std::acos(std::min(
+        std::abs(p.getVector3fMap().dot(p.getNormalVector3fMap()) / p.rho),
+        1.0f));
+    if (angle > 5 * M_PI / 12) continue;
+    qp.total_obs++;
+    if (p.rho < (rho_ref * inner_ratio)) qp.dynamic_obs++;
+  }
+
+  for (auto &qp : query) {
+    if (qp.total_obs < min_num_obs)
+      qp.static_score = 0.0;
+    else
+      qp.static_score =
+          1.0 -
+          std::min(1.0f, qp.dynamic_obs / std::max(qp.total_obs, max_num_obs));
+  }
+}
+
+void expectSameObservations(const PointCloud &actual,
+                            const PointCloud &expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); i++) {
+    EXPECT_EQ(actual[i].dynamic_obs, expected[i].dynamic_obs) << "point " << i;
+    EXPECT_EQ(actual[i].total_obs, expected[i].total_obs) << "point " << i;
+    EXPECT_EQ(actual[i].static_score, expected[i].static_score)
+        << "point " << i;
+  }
+}
+
+}  // namespace
+
+TEST(LIDAR, ray_tracing_matches_hash_grid_detection) {
+  std::mt19937 gen(0);
+  constexpr int num_scans = 9;
+  std::vector<PointCloud> scans;
+  for (int i = 0; i < num_scans; i++) scans.push_back(scan(i, gen));
+  // map in the frame of the first scan
+  PointCloud map = street(true, gen);
+  pointcloud::transformPointCloud(sensorPose(0).inverse(), map);
+  for (auto &p : map) p.raw_flex1 = 0;
+
+  const float max_num_obs = 10000, min_num_obs = 4;
+  // the finest resolution does not fit in the dense image
+  for (const auto &[phi_res, theta_res] :
+       {std::make_pair(0.041f, 0.026f), std::make_pair(0.0005f, 0.0005f)}) {
+    std::vector<Eigen::Matrix4f> T_ref_qry;
+    for (int i = 0; i < num_scans; i++)
+      T_ref_qry.push_back(sensorPose(i).inverse() * sensorPose(0));
+
+    auto expected = map;
+    for (int i = 0; i < num_scans; i++)
+      referenceDetection(scans[i], expected, T_ref_qry[i], phi_res, theta_res,
+                         max_num_obs, min_num_obs);
+    size_t num_dynamic = 0;
+    for (const auto &p : expected) num_dynamic += p.dynamic_obs > 0;
+    EXPECT_GT(num_dynamic, (size_t)0);
+
+    // one scan at a time
+    auto serial = map;
+    for (int i = 0; i < num_scans; i++)
+      detectDynamicObjects(
+          scans[i], serial,
+          lgmath::se3::TransformationWithCovariance(
+              Eigen::Matrix4d(T_ref_qry[i].cast<double>())),
+          phi_res, theta_res, max_num_obs, min_num_obs, 0.0f);
+    expectSameObservations(serial, expected);
+
+    // scans traced in parallel, counts merged at the end
+    auto parallel = map;
+    ray_tracing::Observations observations(map.size());
+#pragma omp parallel num_threads(4)
+    {
+      ray_tracing::FrustumGrid frustum_grid(phi_res, theta_res);
+      ray_tracing::Observations thread_observations(map.size());
+#pragma omp for schedule(dynamic, 1)
+      for (int i = 0; i < num_scans; i++) {
+        frustum_grid.reset(scans[i]);
+        ray_tracing::traceObservations(frustum_grid, map, T_ref_qry[i],
+                                       thread_observations);
+      }
+#pragma omp critical
+      observations += thread_observations;
+    }
+    ray_tracing::updateStaticScores(observations, parallel, max_num_obs,
+                                    min_num_obs);
+    expectSameObservations(parallel, expected);
+  }
+}
+
+int main(int argc, char **argv) {
+  configureLogging("", true);
+  InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_terrain_assessment.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "vtr_lidar/data_types/point.hpp"
+#include "vtr_lidar/modules/planning/terrain_assessment_ops.hpp"
+#include "vtr_logging/logging_init.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::lidar;
+
+TEST(LIDAR, rasterize_corridor) {
+  const float width = 1.0;
+  std::vector<Eigen::Vector2f> path;
+  for (int i = 0; i < 30; ++i)
+    path.emplace_back(-8.0f + 0.5f * i, 3.0f * std::sin(0.2f * i));
+
+  for (const float dl : {0.1f, 0.25f, 0.5f}) {
+    // reference: min distance from every cell to every segment
+    DenseCostMap expected(dl, 40.0, 20.0);
+    expected.update([&](const Eigen::Vector2f &q, float &v) {
+      float min_dist = std::numeric_limits<float>::max();
+      for (size_t i = 0; i + 1 < path.size(); ++i) {
+        const auto &xs = path[i];
+        const auto &xe = path[i + 1];
+        float alpha = (q - xs).dot(xe - xs) / (xe - xs).squaredNorm();
+        alpha = std::clamp(alpha, 0.0f, 1.0f);
+        min_dist = std::min(min_dist, (q - (xs + alpha * (xe - xs))).norm());
+      }
+      v = min_dist > width ? v : 1;
+    });
+
+    DenseCostMap costmap(dl, 40.0, 20.0);
+    rasterizeCorridor(costmap, path, width);
+
+    const auto expected_values = expected.filter(0.5f);
+    const auto values = costmap.filter(0.5f);
+    EXPECT_EQ(values.size(), expected_values.size()) << "dl: " << dl;
+    for (const auto &[key, value] : expected_values)
+      EXPECT_EQ(values.count(key), (size_t)1)
+          << "at (" << key.first << ", " << key.second << "), dl: " << dl;
+  }
+}
+
+TEST(LIDAR, assess_terrain_summed_area_table) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> xy(-11.0, 11.0);
+  std::normal_distribution<float> noise(0.0, 0.05);
+  pcl::PointCloud<PointWithInfo> points;
+  for (int i = 0; i < 5000; ++i) {
+    PointWithInfo p;
+    p.x = xy(gen);
+    p.y = xy(gen);
+    // rough on one side, flat on the other
+    p.z = 0.1f * p.x + (p.x > 0 ? noise(gen) : 0.0f);
+    points.push_back(p);
+  }
+
+  const float dl = 0.5, size = 20.0, search_radius = 1.0;
+  AssessTerrainOp op(points, dl, size, size, search_radius);
+
+  // reference: pca of points binned into the cells of the neighborhood
+  const int r = std::round(search_radius / dl);
+  DenseCostMap expected(dl, size, size), costmap(dl, size, size);
+  expected.update([&](const Eigen::Vector2f &q, float &v) {
+    const int qi = std::round(q.x() / dl), qj = std::round(q.y() / dl);
+    std::vector<Eigen::Vector3d> neighbors;
+    for (const auto &p : points) {
+      const int pi = std::round(p.x / dl), pj = std::round(p.y / dl);
+      if (std::abs(pi - qi) <= r && std::abs(pj - qj) <= r)
+        neighbors.emplace_back(p.x, p.y, p.z);
+    }
+    if (neighbors.size() < 5) {
+      v = 0.0;
+      return;
+    }
+    Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+    for (const auto &n : neighbors) mean += n;
+    mean /= (double)neighbors.size();
+    Eigen::Matrix3d scatter = Eigen::Matrix3d::Zero();
+    for (const auto &n : neighbors)
+      scatter += (n - mean) * (n - mean).transpose();
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es(scatter);
+    v = std::abs(es.eigenvalues()(0));
+  });
+  costmap.update(op);
+
+  const auto expected_values = expected.filter(-1.0f);
+  const auto values = costmap.filter(-1.0f);
+  ASSERT_EQ(values.size(), expected_values.size());
+  for (const auto &[key, value] : expected_values)
+    EXPECT_NEAR(values.at(key), value, 1e-3 + 1e-3 * value)
+        << "at (" << key.first << ", " << key.second << ")";
+}
+
+int main(int argc, char **argv) {
+  configureLogging("", true);
+  InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
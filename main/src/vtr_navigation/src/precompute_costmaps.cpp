@@ -0,0 +1,198 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file precompute_costmaps.cpp
+ * \brief Offline pass computing the ground extraction and obstacle detection
+ * cost maps of every submap in an existing graph.
+ * \details The cost maps are stored in the graph next to their submap, so that
+ * the modules recall them at repeat time instead of recomputing them. After
+ * storing, the graph is reloaded from disk and the cost maps are recalled
+ * again; the compute and recall times of every submap are written to
+ * precompute_costmaps.csv in the output directory.
+ *
+ * Example:
+ *   ros2 run vtr_navigation vtr_navigation_precompute_costmaps --ros-args
+ *     --params-file <config>.yaml -p data_dir:=<graph dir>
+ */
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_common/utils/filesystem.hpp"
+#include "vtr_lidar/data_types/pointmap_pointer.hpp"
+#include "vtr_lidar/modules/planning/ground_extraction_module.hpp"
+#include "vtr_lidar/modules/planning/obstacle_detection_module.hpp"
+#include "vtr_logging/logging_init.hpp"
+#include "vtr_tactic/types.hpp"
+
+namespace fs = std::filesystem;
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::tactic;
+using namespace vtr::lidar;
+
+namespace {
+
+/** \brief Returns the vertices that own a submap, in graph order */
+std::vector<VertexId> getMapVertices(const Graph::Ptr& graph) {
+  std::vector<VertexId> map_vids;
+  std::set<VertexId> seen;
+  for (auto it = graph->beginVertex(); it != graph->endVertex(); ++it) {
+    const auto msg = it->retrieve<PointMapPointer>(
+        "pointmap_ptr", "vtr_lidar_msgs/msg/PointMapPointer");
+    if (msg == nullptr) continue;
+    const auto map_vid = msg->sharedLocked().get().getData().map_vid;
+    if (seen.insert(map_vid).second) map_vids.push_back(map_vid);
+  }
+  return map_vids;
+}
+
+std::shared_ptr<PointMap<PointWithInfo>> getPointMap(
+    const Graph::Ptr& graph, const VertexId& vid, const std::string& version) {
+  const auto msg = graph->at(vid)->retrieve<PointMap<PointWithInfo>>(
+      version, "vtr_lidar_msgs/msg/PointMap");
+  if (msg == nullptr) return nullptr;
+  return std::make_shared<PointMap<PointWithInfo>>(
+      msg->sharedLocked().get().getData());
+}
+
+double toMs(const timing::Stopwatch<>& timer) {
+  return (double)timer.count<std::chrono::microseconds>() / 1000.0;
+}
+
+/** \brief Compute and recall times of a submap [ms] */
+struct Timing {
+  size_t num_points = 0;
+  double ground_compute = 0.0;
+  double obstacle_compute = 0.0;
+  double ground_recall = 0.0;
+  double obstacle_recall = 0.0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  rclcpp::init(argc, argv);
+  auto node = rclcpp::Node::make_shared("precompute_costmaps");
+
+  /// Setup logging
+  const auto data_dir_str =
+      node->declare_parameter<std::string>("data_dir", "/tmp");
+  fs::path data_dir{utils::expand_user(utils::expand_env(data_dir_str))};
+
+  const auto log_debug = node->declare_parameter<bool>("log_debug", false);
+  const auto log_enabled = node->declare_parameter<std::vector<std::string>>(
+      "log_enabled", std::vector<std::string>{});
+  configureLogging("", log_debug, log_enabled);
+
+  // clang-format off
+  const auto map_version = node->declare_parameter<std::string>("localization.recall.map_version", "pointmap");
+  const auto output_dir_str = node->declare_parameter<std::string>("precompute.output_dir", data_dir_str);
+  // clang-format on
+  fs::path output_dir{utils::expand_user(utils::expand_env(output_dir_str))};
+  fs::create_directories(output_dir);
+
+  /// Same parameters as the modules of the pipeline, the stored cost maps are
+  /// only recalled with matching parameters
+  const auto ground_extraction = std::make_shared<GroundExtractionModule>(
+      GroundExtractionModule::Config::fromROS(
+          node, "localization.ground_extraction"));
+  const auto obstacle_detection = std::make_shared<ObstacleDetectionModule>(
+      ObstacleDetectionModule::Config::fromROS(
+          node, "localization.obstacle_detection"));
+
+  const auto graph_dir = (data_dir / "graph").string();
+  std::map<VertexId, Timing> timings;
+
+  /// Compute and store
+  {
+    auto graph = Graph::MakeShared(graph_dir, true);
+    for (const auto& map_vid : getMapVertices(graph)) {
+      const auto point_map = getPointMap(graph, map_vid, map_version);
+      if (point_map == nullptr) {
+        CLOG(WARNING, "navigation") << "Could not find map " << map_version
+                                    << " at vertex " << map_vid;
+        continue;
+      }
+      auto& timing = timings[map_vid];
+      timing.num_points = point_map->size();
+      const PointMapViews submap(point_map);
+
+      timing::Stopwatch<> ground_timer;
+      const auto ground_costmap = ground_extraction->computeCostMap(submap);
+      ground_timer.stop();
+      timing::Stopwatch<> obstacle_timer;
+      const auto obstacle_costmap = obstacle_detection->computeCostMap(submap);
+      obstacle_timer.stop();
+      timing.ground_compute = toMs(ground_timer);
+      timing.obstacle_compute = toMs(obstacle_timer);
+
+      storeCostMap(graph, map_vid, GroundExtractionModule::costmap_stream,
+                   *ground_costmap);
+      storeCostMap(graph, map_vid, ObstacleDetectionModule::costmap_stream,
+                   *obstacle_costmap);
+    }
+    // saves the graph including the cost maps
+  }
+
+  /// Recall from the reloaded graph, as at repeat time
+  {
+    auto graph = Graph::MakeShared(graph_dir, true);
+    for (auto& [map_vid, timing] : timings) {
+      const PointMapViews submap(getPointMap(graph, map_vid, map_version));
+
+      timing::Stopwatch<> ground_timer;
+      ground_extraction->getCostMap(graph, submap);
+      ground_timer.stop();
+      timing::Stopwatch<> obstacle_timer;
+      obstacle_detection->getCostMap(graph, submap);
+      obstacle_timer.stop();
+      timing.ground_recall = toMs(ground_timer);
+      timing.obstacle_recall = toMs(obstacle_timer);
+    }
+  }
+
+  std::ofstream timing_file(output_dir / "precompute_costmaps.csv");
+  timing_file << "map_vid,num_points,ground_compute_ms,ground_recall_ms,"
+                 "obstacle_compute_ms,obstacle_recall_ms\n";
+  Timing total;
+  for (const auto& [map_vid, timing] : timings) {
+    timing_file << map_vid << "," << timing.num_points << ","
+                << timing.ground_compute << "," << timing.ground_recall << ","
+                << timing.obstacle_compute << "," << timing.obstacle_recall
+                << "\n";
+    total.ground_compute += timing.ground_compute;
+    total.ground_recall += timing.ground_recall;
+    total.obstacle_compute += timing.obstacle_compute;
+    total.obstacle_recall += timing.obstacle_recall;
+  }
+
+  const double num_maps = std::max<double>(1.0, (double)timings.size());
+  CLOG(INFO, "navigation")
+      << "Precomputed the cost maps of " << timings.size()
+      << " submaps, mean compute / recall time [ms]: ground "
+      << total.ground_compute / num_maps << " / "
+      << total.ground_recall / num_maps << ", obstacle "
+      << total.obstacle_compute / num_maps << " / "
+      << total.obstacle_recall / num_maps;
+
+  rclcpp::shutdown();
+  return 0;
+}
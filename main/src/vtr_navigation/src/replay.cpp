@@ -0,0 +1,266 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file replay.cpp
+ * \brief Offline replay of a recorded dataset through the tactic.
+ * \details Reads sensor messages directly from the sqlite dataset and feeds
+ * them to the tactic on a virtual clock driven by the message timestamps. No
+ * executor is spun, so the results do not depend on ROS scheduling. Per-frame
+ * module timing and pose estimates are written to csv files in the output
+ * directory so that runs can be compared across builds.
+ *
+ * Example:
+ *   ros2 run vtr_navigation vtr_navigation_replay --ros-args
+ *     --params-file <config>.yaml -p data_dir:=<graph dir>
+ *     -p replay.dataset_dir:=<dataset dir> -p replay.stream:=<lidar topic>
+ */
+#include <filesystem>
+#include <fstream>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+
+#include "vtr_common/timing/stopwatch.hpp"
+#include "vtr_common/timing/utils.hpp"
+#include "vtr_common/utils/filesystem.hpp"
+#include "vtr_lidar/pipeline.hpp"
+#include "vtr_logging/logging_init.hpp"
+#include "vtr_route_planning/route_planning.hpp"
+#include "vtr_storage/stream/data_stream_accessor.hpp"
+#include "vtr_tactic/pipelines/factory.hpp"
+#include "vtr_tactic/tactic.hpp"
+
+namespace fs = std::filesystem;
+using namespace vtr;
+using namespace vtr::common;
+using namespace vtr::logging;
+using namespace vtr::tactic;
+
+namespace {
+
+/** \brief Sets the ros time of the node's clock, used by modules via now() */
+void setVirtualTime(const rclcpp::Node::SharedPtr& node, const Timestamp& t) {
+  auto clock_handle = node->get_clock()->get_clock_handle();
+  if (rcl_set_ros_time_override(clock_handle, t) != RCL_RET_OK)
+    throw std::runtime_error("Failed to set virtual time.");
+}
+
+/** \brief Writes vertex id and the top 3x4 block of T_v_r */
+template <typename VertexIdCache>
+void writePose(std::ofstream& os, const VertexIdCache& vid,
+               const Cache<EdgeTransform>& T_r_v) {
+  if (!vid || !T_r_v) {
+    os << std::string(13, ',');
+    return;
+  }
+  const auto T_v_r = T_r_v->inverse().matrix();
+  os << "," << *vid;
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 4; ++j) os << "," << T_v_r(i, j);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  rclcpp::init(argc, argv);
+  // the virtual clock overrides ros time, which requires sim time enabled
+  auto node = rclcpp::Node::make_shared(
+      "replay", rclcpp::NodeOptions().parameter_overrides(
+                    {rclcpp::Parameter("use_sim_time", true)}));
+
+  /// Setup logging
+  const auto data_dir_str =
+      node->declare_parameter<std::string>("data_dir", "/tmp");
+  fs::path data_dir{utils::expand_user(utils::expand_env(data_dir_str))};
+
+  const auto log_to_file = node->declare_parameter<bool>("log_to_file", false);
+  const auto log_debug = node->declare_parameter<bool>("log_debug", false);
+  const auto log_enabled = node->declare_parameter<std::vector<std::string>>(
+      "log_enabled", std::vector<std::string>{});
+  std::string log_filename;
+  if (log_to_file) {
+    auto log_name = "vtr-replay-" + timing::toIsoFilename(timing::clock::now());
+    log_filename = data_dir / (log_name + ".log");
+  }
+  configureLogging(log_filename, log_debug, log_enabled);
+
+  // disable eigen multi-threading
+  Eigen::setNbThreads(1);
+
+  /// Replay parameters
+  // clang-format off
+  const auto dataset_dir_str = node->declare_parameter<std::string>("replay.dataset_dir", "");
+  const auto stream = node->declare_parameter<std::string>("replay.stream", "points");
+  const auto output_dir_str = node->declare_parameter<std::string>("replay.output_dir", data_dir_str);
+  const auto mode = node->declare_parameter<std::string>("replay.mode", "teach");
+  const auto waypoints = node->declare_parameter<std::vector<int64_t>>("replay.waypoints", std::vector<int64_t>{});
+  const auto lockstep = node->declare_parameter<bool>("replay.lockstep", true);
+  const auto rate = node->declare_parameter<double>("replay.rate", 1.0);
+  const auto start_index = node->declare_parameter<int>("replay.start_index", 1);
+  const auto stop_index = node->declare_parameter<int>("replay.stop_index", -1);
+  const auto xi_sensor_robot = node->declare_parameter<std::vector<double>>("replay.xi_sensor_robot", std::vector<double>(6, 0.0));
+  // clang-format on
+  fs::path dataset_dir{
+      utils::expand_user(utils::expand_env(dataset_dir_str))};
+  fs::path output_dir{utils::expand_user(utils::expand_env(output_dir_str))};
+  fs::create_directories(output_dir);
+
+  if (xi_sensor_robot.size() != 6) {
+    std::string err{"replay.xi_sensor_robot must have 6 elements."};
+    CLOG(ERROR, "navigation") << err;
+    throw std::invalid_argument(err);
+  }
+  Eigen::Matrix<double, 6, 1> xi_s_r;
+  for (int i = 0; i < 6; ++i) xi_s_r(i) = xi_sensor_robot[i];
+  EdgeTransform T_s_r(xi_s_r);
+  T_s_r.setCovariance(Eigen::Matrix<double, 6, 6>::Zero());
+
+  /// Pose graph and tactic, same construction as the navigator but without
+  /// any graph map server or state machine
+  const bool repeat = (mode == "repeat");
+  auto graph = Graph::MakeShared((data_dir / "graph").string(), repeat);
+  auto pipeline_factory = std::make_shared<ROSPipelineFactory>(node);
+  auto pipeline = pipeline_factory->get("pipeline");
+  auto output = pipeline->createOutputCache();
+  output->node = node;
+  auto tactic = std::make_shared<Tactic>(Tactic::Config::fromROS(node),
+                                         pipeline, output, graph);
+
+  /// Replaces the state machine: teach always branches on a new run, repeat
+  /// follows the privileged path through the specified waypoints
+  {
+    auto lock = tactic->lockPipeline();
+    if (repeat) {
+      if (!graph->contains(VertexId(0, 0)) || waypoints.empty()) {
+        std::string err{"Repeat requires an existing graph and waypoints."};
+        CLOG(ERROR, "navigation") << err;
+        throw std::runtime_error(err);
+      }
+      tactic->setTrunk(VertexId(0, 0));
+      tactic->addRun(false);
+      VertexId::List waypoint_ids;
+      for (const auto& w : waypoints)
+        waypoint_ids.push_back(VertexId((uint64_t)w));
+      std::list<uint64_t> waypoint_seq;
+      route_planning::BFSPlanner route_planner(graph);
+      const auto persistent_loc = tactic->getPersistentLoc();
+      const auto path =
+          route_planner.path(persistent_loc.v, waypoint_ids, waypoint_seq);
+      tactic->setPath(path, 0, persistent_loc.T, false);
+      tactic->setPipeline(PipelineMode::RepeatMetricLoc);
+    } else {
+      tactic->addRun(true);
+      tactic->setPipeline(PipelineMode::TeachBranch);
+    }
+  }
+
+  /// Output files
+  std::ofstream timing_file(output_dir / "replay_timing.csv");
+  std::ofstream pose_file(output_dir / "replay_poses.csv");
+  timing_file << "index,stamp,frame_ms,module,module_ms,async\n";
+  pose_file << "index,stamp,frame_ms,odo_success,vid_odo";
+  for (int i = 0; i < 12; ++i) pose_file << ",T_v_r_odo_" << i;
+  pose_file << ",loc_success,vid_loc";
+  for (int i = 0; i < 12; ++i) pose_file << ",T_v_r_loc_" << i;
+  pose_file << "\n";
+
+  /// Dataset
+  storage::DataStreamAccessor<sensor_msgs::msg::PointCloud2> accessor{
+      dataset_dir.string(), stream, "sensor_msgs/msg/PointCloud2"};
+
+  timing::Stopwatch total_timer;
+  Timestamp first_stamp = -1;
+  bool following = false;
+  size_t num_frames = 0;
+  for (int index = start_index; stop_index < 0 || index <= stop_index;
+       ++index) {
+    const auto message = accessor.readAtIndex(index);
+    if (message == nullptr) break;
+    const auto msg = std::make_shared<sensor_msgs::msg::PointCloud2>(
+        message->locked().get().getData());
+    const Timestamp stamp =
+        msg->header.stamp.sec * (Timestamp)1e9 + msg->header.stamp.nanosec;
+
+    // virtual clock
+    setVirtualTime(node, stamp);
+    if (!lockstep) {
+      // pace the input at the recorded rate, frames may be dropped as online
+      if (first_stamp < 0) first_stamp = stamp;
+      const auto target = std::chrono::nanoseconds(
+          (int64_t)((double)(stamp - first_stamp) / rate));
+      const auto elapsed = std::chrono::nanoseconds(
+          total_timer.count<std::chrono::nanoseconds>());
+      if (target > elapsed) std::this_thread::sleep_for(target - elapsed);
+    }
+
+    auto qdata = std::make_shared<lidar::LidarQueryCache>();
+    qdata->node = node;
+    qdata->stamp.emplace(stamp);
+    qdata->env_info.emplace(EnvInfo());
+    qdata->pointcloud_msg = msg;
+    qdata->T_s_r.emplace(T_s_r);
+    qdata->module_timing.emplace();
+
+    timing::Stopwatch frame_timer;
+    if (lockstep)
+      tactic->inputLockstep(qdata);
+    else
+      tactic->input(qdata);
+    frame_timer.stop();
+    const double frame_ms =
+        (double)frame_timer.count<std::chrono::microseconds>() / 1000.0;
+
+    // follow the state machine: start path following once localized
+    if (repeat && !following && tactic->isLocalized()) {
+      auto lock = tactic->lockPipeline();
+      tactic->setPipeline(PipelineMode::RepeatFollow);
+      following = true;
+    }
+
+    ++num_frames;
+
+    /// \note in free-running mode the frame may still be in the pipeline or
+    /// have been dropped, so per-frame results are only written in lock-step
+    if (!lockstep) continue;
+
+    // tasks dispatched by the frame have finished, lock-step waits for them
+    for (const auto& entry : qdata->module_timing->entries())
+      timing_file << index << "," << stamp << "," << frame_ms << ","
+                  << entry.module << "," << entry.ms << "," << entry.async
+                  << "\n";
+
+    pose_file << index << "," << stamp << "," << frame_ms;
+    pose_file << "," << (qdata->odo_success && *qdata->odo_success);
+    writePose(pose_file, qdata->vid_odo, qdata->T_r_v_odo);
+    pose_file << "," << (qdata->loc_success && *qdata->loc_success);
+    writePose(pose_file, qdata->vid_loc, qdata->T_r_v_loc);
+    pose_file << "\n";
+  }
+
+  {
+    auto lock = tactic->lockPipeline();
+    tactic->finishRun();
+  }
+  total_timer.stop();
+
+  CLOG(INFO, "navigation") << "Replayed " << num_frames << " frames in "
+                           << total_timer << ", results written to "
+                           << output_dir.string();
+
+  tactic.reset();
+  graph.reset();
+  rclcpp::shutdown();
+  return 0;
+}
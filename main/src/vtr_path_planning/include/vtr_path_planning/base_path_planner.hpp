@@ -20,6 +20,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <iostream>
 #include <mutex>
 #include <thread>
 
@@ -77,6 +78,11 @@ class BasePathPlanner : public PathPlannerInterface {
     PTR_TYPEDEFS(Config);
 
     unsigned int control_period = 0;
+    /**
+     * \brief Whether to send the safe command when the command computation
+     * misses the end of the control period (the late command is dropped)
+     */
+    bool command_fallback = true;
 
     virtual ~Config() = default;
 
@@ -84,28 +90,73 @@ class BasePathPlanner : public PathPlannerInterface {
                        const std::string& prefix = "path_planning");
   };
 
+  /** \brief Time spent computing commands relative to the control period */
+  struct BudgetStatistics {
+    size_t num_cycles = 0;
+    /** \brief cycles where the safe command was sent instead */
+    size_t num_fallbacks = 0;
+    /** \brief cycles that took longer than the control period */
+    size_t num_overruns = 0;
+    /** \brief computation time / control period of the last cycle */
+    double last_usage = 0.0;
+    double mean_usage = 0.0;
+    double max_usage = 0.0;
+  };
+
   BasePathPlanner(const Config::ConstPtr& config,
                   const RobotState::Ptr& robot_state,
                   const Callback::Ptr& callback);
   ~BasePathPlanner() override;
 
+  BudgetStatistics budgetStatistics() const;
+
   /// for state machine use
  public:
   /** \brief Sets whether control command should be computed */
   void setRunning(const bool running) override;
 
  private:
-  /** \brief Subclass override this method to compute a control command */
+  /**
+   * \brief Subclass override this method to compute a control command
+   * \note Must return by deadline() (anytime), otherwise the safe command is
+   * sent in its place and the returned command is dropped. Runs in a separate
+   * thread when command_fallback is set.
+   */
   virtual Command computeCommand(RobotState& robot_state) = 0;
+  /**
+   * \brief Called when the command returned by computeCommand was dropped for
+   * missing the deadline. Subclass override this method to roll back state
+   * that assumes its command was sent (e.g. the applied velocity or a solver
+   * warm start) to the safe command that was sent instead.
+   * \note Called from the process thread after the late computeCommand has
+   * returned and before the next one starts.
+   */
+  virtual void onCommandDropped(const Command& /* sent */) {}
 
  protected:
   /** \brief Subclass use this function to get current time */
   tactic::Timestamp now() const { return callback_->getCurrentTime(); }
+  /**
+   * \brief End of the current control period, only valid within
+   * computeCommand (time_point::max() if there is no control period)
+   */
+  std::chrono::steady_clock::time_point deadline() const { return deadline_; }
+  /** \brief Time left until deadline() in ms, infinity if no control period */
+  double remainingBudget() const;
+  /**
+   * \brief Sets the command sent when computeCommand misses the deadline,
+   * defaults to zero velocity and is kept until set again
+   */
+  void setSafeCommand(const Command& command);
   /** \brief Derived class must call this upon destruction */
   void stop();
 
  private:
   void process();
+  /** \brief Runs computeCommand for the process thread (command_fallback) */
+  void compute();
+  Command getSafeCommand() const;
+  void recordCycle(const double compute_time, const bool fallback);
 
  private:
   const Config::ConstPtr config_;
@@ -135,6 +186,30 @@ class BasePathPlanner : public PathPlannerInterface {
   /** \brief the event processing thread */
  private:
   std::thread process_thread_;
+  /** \brief the command computation thread, kept for all control cycles */
+  std::thread compute_thread_;
+
+  /** \brief protects the members below, shared with the compute thread */
+  Mutex compute_mutex_;
+  CondVar cv_compute_requested_;
+  CondVar cv_command_computed_;
+  bool compute_requested_ = false;
+  bool command_computed_ = false;
+  bool compute_terminate_ = false;
+  Command computed_command_;
+
+  /**
+   * \brief set by the process thread before each computeCommand call
+   * \note requesting the computation synchronizes with this write
+   */
+  std::chrono::steady_clock::time_point deadline_ =
+      std::chrono::steady_clock::time_point::max();
+  /** \brief protects safe_command_, may be set while the deadline expires */
+  mutable Mutex safe_command_mutex_;
+  Command safe_command_;
+  /** \brief protects budget_stats_ */
+  mutable Mutex stats_mutex_;
+  BudgetStatistics budget_stats_;
 
   /// factory handlers (note: local static variable constructed on first use)
  private:
@@ -196,6 +271,9 @@ struct PathPlannerRegister {
   }
 };
 
+std::ostream& operator<<(std::ostream& os,
+                         const BasePathPlanner::BudgetStatistics& stats);
+
 /// \brief Register a path planner
 /// \todo probably need to add a dummy use of this variable for initialization
 #define VTR_REGISTER_PATH_PLANNER_DEC_TYPE(NAME) \
@@ -45,6 +45,8 @@
 
 #include "steam.hpp"
 
+// Persistent MPC problem, see mpc_path_planner2.hpp
+class CorridorMPC;
 
 namespace vtr {
 namespace path_planning {
@@ -107,6 +109,9 @@ class CBIT : public BasePathPlanner {
 
     // Add unicycle model param
 
+    // Gauss-Newton linear solver, "sparse" (generic STEAM) or "banded" (horizon solver, linear in horizon_steps)
+    std::string mpc_solver = "sparse";
+
     // Covariance tuning weights
     Eigen::Matrix<double, 6, 6> pose_error_cov = Eigen::Matrix<double, 6, 6>::Zero();
     Eigen::Matrix<double, 2, 2> vel_error_cov = Eigen::Matrix<double, 2, 2>::Zero();
@@ -145,6 +150,7 @@ class CBIT : public BasePathPlanner {
  protected:
   void initializeRoute(RobotState& robot_state);
   Command computeCommand(RobotState& robot_state) override;
+  void onCommandDropped(const Command& sent) override;
   void visualize(const tactic::Timestamp& stamp, const tactic::EdgeTransform& T_w_p,const tactic::EdgeTransform& T_p_r, const tactic::EdgeTransform& T_p_r_extp, const tactic::EdgeTransform& T_p_r_extp_mpc, std::vector<lgmath::se3::Transformation> mpc_prediction, std::vector<lgmath::se3::Transformation> robot_prediction, std::vector<lgmath::se3::Transformation> ref_pose_vec1, std::vector<lgmath::se3::Transformation> ref_pose_vec2);
   Node curve_to_euclid(Node node);
   Pose lin_interpolate(int p_ind, double p_val);
@@ -201,6 +207,9 @@ class CBIT : public BasePathPlanner {
   Eigen::Matrix<double, 2, 1> applied_vel;
   std::vector<Eigen::Matrix<double, 2, 1>> vel_history;
 
+  // MPC problem kept between control cycles so each solve is warm started from the previous one
+  std::shared_ptr<CorridorMPC> mpc_ptr;
+
   //create vector to store the robots path for visualization purposes
   std::vector<lgmath::se3::Transformation> robot_poses;
 
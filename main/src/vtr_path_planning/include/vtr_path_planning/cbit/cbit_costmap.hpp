@@ -21,9 +21,12 @@
 
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <cstdint>
 
 #include "vtr_tactic/tactic.hpp"
 #include "vtr_common/utils/hash.hpp"  // for std::pair hash
+#include "vtr_path_planning/cbit/utils.hpp"
 
 #pragma once
 
@@ -53,4 +56,75 @@ class CBITCostmap {
         float grid_resolution;
 
         // todo, may add a constructor and associated cpp file which does some more sophisticated temporal processing of the occupancy grid
+
+
+        // Dense obstacle grid used for collision checking.
+        // The obs_map is keyed on rounded floats, so looking it up needs float hashing and a caught exception for every free cell.
+        // Instead, update_grid() copies it into a dense, integer indexed grid covering the (robot centred) costmap, with an occupancy
+        // layer for both collision thresholds and a distance layer. It must be called whenever obs_map or grid_resolution change.
+        // Cell (i,j) holds the obs_map value with key (i*grid_resolution, j*grid_resolution), and a point is checked against the cell
+        // found by flooring its costmap frame coordinates, exactly like the obs_map lookup did, so the collision decisions are identical.
+        // The grid (with a copy of T_c_w and grid_resolution) is built separately and then published atomically, so the planner thread
+        // can keep checking collisions without a lock while the costmap is updated: every check sees either the old or the new grid.
+        void update_grid();
+
+        // Collision check of a point in the world frame, same as a lookup in obs_map with a miss being free:
+        // value > 0.0 is a collision, or value >= 0.89 if tight (only out to the "minimum_distance" obs config param)
+        bool collision(const Node& euclid_pt, bool tight) const;
+
+        // Distance from the centre of the cell containing the point (world frame) to the nearest cell centre with a value above 0.0
+        // Returns 0.0 outside the grid, and infinity if there are no obstacles
+        double clearance(const Node& euclid_pt) const;
+
+    private:
+        struct Grid;
+
+    public:
+        // Collision checker for a sequence of nearby points, i.e. an edge discretized into points which are then converted to euclidean.
+        // The points are rasterized into grid cells as they are swept, points in the same cell as the previous point are not looked up again,
+        // and points inside the obstacle free disc (from the distance layer) around the last looked up cell are free without a lookup.
+        // Intended to be used with an early exit on the first collision. The whole edge is checked against the grid current at construction.
+        class EdgeChecker {
+            public:
+                EdgeChecker(const CBITCostmap& costmap, bool tight);
+                bool collision(const Node& euclid_pt);
+
+            private:
+                std::shared_ptr<const Grid> grid_;
+                bool tight_;
+                int64_t prev_cell_ = -1;
+                bool prev_collision_ = false;
+                // Centre and radius of the current obstacle free disc (costmap frame)
+                double free_x_ = 0.0;
+                double free_y_ = 0.0;
+                double free_radius_ = 0.0;
+        };
+
+    private:
+        enum CellFlags : uint8_t
+        {
+            COLLISION = 1, // value > 0.0
+            COLLISION_TIGHT = 2 // value >= 0.89
+        };
+
+        // Immutable once published
+        struct Grid
+        {
+            vtr::tactic::EdgeTransform T_c_w;
+            float resolution = 0.0;
+            int min_i = 0;
+            int min_j = 0;
+            int width = 0;
+            int height = 0;
+            std::vector<uint8_t> flags;
+            std::vector<float> clearance;
+
+            // Transforms the point to the costmap frame (x,y) and finds its cell, returns -1 if outside of the grid
+            int64_t cell_index(const Node& euclid_pt, double& x, double& y) const;
+        };
+
+        // Snapshot of the current grid, only accessed through std::atomic_load/std::atomic_store
+        std::shared_ptr<const Grid> grid() const;
+
+        std::shared_ptr<const Grid> grid_ = std::make_shared<const Grid>();
 };
\ No newline at end of file
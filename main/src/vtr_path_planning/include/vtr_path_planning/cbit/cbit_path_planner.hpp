@@ -60,7 +60,7 @@ class CBITPlanner {
         double sample_box_width;
         double dynamic_window_width;
         Tree tree;
-        std::vector<std::shared_ptr<Node>> samples;
+        NodeSet samples{SAMPLE_SET};
 
         //int control_period_ms;
         //std::chrono::time_point<std::chrono::high_resolution_clock> state_update_time;
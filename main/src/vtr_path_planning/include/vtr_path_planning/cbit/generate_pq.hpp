@@ -20,6 +20,7 @@
 // Header for generating the curvilinear pq space by pre-processing the taught path
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
@@ -46,8 +47,38 @@ class CBITPath {
         CBITPath() = default;
         Pose interp_pose(double p_in); // Function to interpolate a pose from the teach path given a p value
         double delta_p_calc(Pose start_pose, Pose end_pose, double alpha); // Function for computing delta p intervals in p,q space
+
+        // Converting p,q coordinates to euclidean. Same result as the bisection + linear interpolation of the path poses, but the segment
+        // of the path is found in constant time from a lookup table on a uniform grid of p values, and the per segment interpolation terms are precomputed.
+        // The lookup table is built in the constructor, call build_euclid_lut() again if p or path are modified afterwards
+        void build_euclid_lut();
+        Node curve_to_euclid(const Node& node) const;
+        // Batch version for discretized edges, euclid_out is resized to the number of input points
+        void curve_to_euclid(const std::vector<double>& p_in, const std::vector<double>& q_in, std::vector<Node>& euclid_out) const;
+
     // Internal function declarations
     private:
+        // Linear interpolation terms of the path between pose i and i + 1
+        struct Segment {
+            double p_lower;
+            double p_upper;
+            double x;
+            double y;
+            double z;
+            double yaw;
+            double dx;
+            double dy;
+            double dz;
+            double dyaw; // wrapped to [-pi, pi)
+        };
+        int segment_index(double p_val) const;
+        Node segment_to_euclid(int segment_ind, double p_val, double q_val) const;
+
+        std::vector<Segment> segments;
+        std::vector<int> segment_lut; // index of the last segment starting at or before each lut bin
+        double lut_p_min = 0.0;
+        double lut_inv_bin_width = 0.0;
+
         Eigen::Spline<double, 2> spline_path_xy(std::vector<Pose> input_path); // Processes the input discrete path into a cubic spline
         Eigen::Spline<double, 2> spline_path_xz_yz(std::vector<Pose> input_path); // Processes the input discrete path into a cubic spline
 
@@ -0,0 +1,249 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file indexed_heap.hpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+
+// Indexed d-ary min heap used for the cbit vertex and edge queues
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#pragma once
+
+// Min heap of (key, item) entries. Entries are stored in a pool and referred to by their pool index (handle), the heap itself only
+// moves integer handles around, and freed pool slots are reused so that after the first batch pushing does not allocate.
+// Entries with equal keys are popped in insertion order (same as a std::multimap), re-keying an entry with update() counts as a new insertion.
+// erase() is lazy: the entry is only flagged and is discarded once it reaches the top (or when stale entries make up most of the heap).
+template <typename T, int D = 4>
+class IndexedHeap {
+    public:
+        using Handle = int;
+
+        size_t size() const { return num_live_; }
+        bool empty() const { return num_live_ == 0; }
+        void reserve(size_t n) { pool_.reserve(n); heap_.reserve(n); }
+
+        // True if the handle refers to an entry which is in the heap and not erased
+        bool contains(Handle h) const
+        {
+            return (h >= 0) && (h < static_cast<Handle>(pool_.size())) && (pool_[h].pos >= 0) && !pool_[h].erased;
+        }
+        const T& item(Handle h) const { return pool_[h].item; }
+        double key(Handle h) const { return pool_[h].key; }
+
+        Handle push(double key, const T& item)
+        {
+            Handle h;
+            if (!free_.empty())
+            {
+                h = free_.back();
+                free_.pop_back();
+            }
+            else
+            {
+                h = pool_.size();
+                pool_.emplace_back();
+            }
+            Entry& entry = pool_[h];
+            entry.key = key;
+            entry.seq = next_seq_++;
+            entry.item = item;
+            entry.erased = false;
+            entry.pos = heap_.size();
+            heap_.push_back(h);
+            sift_up(entry.pos);
+            num_live_++;
+            return h;
+        }
+
+        // Changes the key of an entry in the heap (decrease or increase)
+        void update(Handle h, double key)
+        {
+            pool_[h].key = key;
+            pool_[h].seq = next_seq_++;
+            sift_up(pool_[h].pos);
+            sift_down(pool_[h].pos);
+        }
+
+        void erase(Handle h)
+        {
+            pool_[h].erased = true;
+            pool_[h].item = T();
+            num_live_--;
+            // Rebuild once stale entries dominate, so they do not slow down every sift
+            if (heap_.size() > 2 * num_live_ + 64)
+            {
+                rebuild();
+            }
+        }
+
+        // Best key, or infinity if the heap is empty
+        double top_key()
+        {
+            discard_erased();
+            return heap_.empty() ? INFINITY : pool_[heap_[0]].key;
+        }
+
+        // Handle of the best entry, or -1 if the heap is empty
+        Handle top_handle()
+        {
+            discard_erased();
+            return heap_.empty() ? -1 : heap_[0];
+        }
+
+        // Removes and returns the best item, the heap must not be empty
+        T pop()
+        {
+            discard_erased();
+            T item = std::move(pool_[heap_[0]].item);
+            remove_root();
+            num_live_--;
+            return item;
+        }
+
+        // Clears the heap but keeps the allocated memory
+        void clear()
+        {
+            pool_.clear();
+            heap_.clear();
+            free_.clear();
+            num_live_ = 0;
+        }
+
+    private:
+        struct Entry {
+            double key = 0.0;
+            uint64_t seq = 0;
+            T item;
+            int pos = -1; // position in heap_, -1 if the slot is free
+            bool erased = false;
+        };
+
+        bool before(Handle a, Handle b) const
+        {
+            return (pool_[a].key < pool_[b].key) || ((pool_[a].key == pool_[b].key) && (pool_[a].seq < pool_[b].seq));
+        }
+
+        void place(size_t i, Handle h)
+        {
+            heap_[i] = h;
+            pool_[h].pos = i;
+        }
+
+        void sift_up(size_t i)
+        {
+            const Handle h = heap_[i];
+            while (i > 0)
+            {
+                const size_t parent = (i - 1) / D;
+                if (!before(h, heap_[parent]))
+                {
+                    break;
+                }
+                place(i, heap_[parent]);
+                i = parent;
+            }
+            place(i, h);
+        }
+
+        void sift_down(size_t i)
+        {
+            const Handle h = heap_[i];
+            const size_t n = heap_.size();
+            while (true)
+            {
+                const size_t first = D * i + 1;
+                if (first >= n)
+                {
+                    break;
+                }
+                size_t best = first;
+                const size_t last = std::min(first + D, n);
+                for (size_t c = first + 1; c < last; c++)
+                {
+                    if (before(heap_[c], heap_[best]))
+                    {
+                        best = c;
+                    }
+                }
+                if (!before(heap_[best], h))
+                {
+                    break;
+                }
+                place(i, heap_[best]);
+                i = best;
+            }
+            place(i, h);
+        }
+
+        void remove_root()
+        {
+            const Handle h = heap_[0];
+            pool_[h].pos = -1;
+            free_.push_back(h);
+            const Handle last = heap_.back();
+            heap_.pop_back();
+            if (!heap_.empty() && (last != h))
+            {
+                place(0, last);
+                sift_down(0);
+            }
+        }
+
+        void discard_erased()
+        {
+            while (!heap_.empty() && pool_[heap_[0]].erased)
+            {
+                remove_root();
+            }
+        }
+
+        // Drops all erased entries and re-heapifies
+        void rebuild()
+        {
+            size_t j = 0;
+            for (size_t i = 0; i < heap_.size(); i++)
+            {
+                const Handle h = heap_[i];
+                if (pool_[h].erased)
+                {
+                    pool_[h].pos = -1;
+                    free_.push_back(h);
+                }
+                else
+                {
+                    place(j++, h);
+                }
+            }
+            heap_.resize(j);
+            for (size_t i = heap_.size() / D + 1; i-- > 0;)
+            {
+                if (i < heap_.size())
+                {
+                    sift_down(i);
+                }
+            }
+        }
+
+        std::vector<Entry> pool_;
+        std::vector<Handle> heap_;
+        std::vector<Handle> free_;
+        size_t num_live_ = 0;
+        uint64_t next_seq_ = 0;
+};
@@ -25,6 +25,10 @@
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <unordered_map>
+#include <cstdint>
+
+#include "vtr_path_planning/cbit/indexed_heap.hpp"
 
 #pragma once
 
@@ -57,6 +61,15 @@ class Pose {
 };
 
 
+// Identifiers for the node sets a node can be a member of (see NodeSet below)
+enum NodeSetId
+{
+    VERTEX_SET = 0,
+    SAMPLE_SET = 1,
+    NUM_NODE_SETS = 2
+};
+
+
 class Node {
     public:
         double p;
@@ -67,6 +80,12 @@ class Node {
         std::shared_ptr<Node> parent; // Shared pointer method (safer) // NOTE: Shared pointers initialize to null
         std::shared_ptr<Node> child; // Shared pointer method (safer)
         bool worm_hole = false;
+        // Position of this node in each NodeSet (-1 if not a member). Only valid while the set stores this exact node,
+        // so copies of a node are never considered members
+        int set_index[NUM_NODE_SETS] = {-1, -1};
+        // Handle of the first edge ending at this node in the edge queue (-1 if none).
+        // Like set_index it is checked against the queue contents before use
+        int edge_queue_head = -1;
         Node(double p_in, double q_in) // Node constructor
         : p{p_in}
         , q{q_in}
@@ -86,18 +105,238 @@ class Node {
 };
 
 
+// Unordered set of nodes used for the tree vertices and the samples.
+// Insertion, removal and membership checks are constant time as each node stores its own position in the set (Node::set_index),
+// and a uniform grid of buckets in p,q is kept up to date with the nodes so radius searches only visit the nearby cells
+// instead of scanning every node. Iteration order is the insertion order, except that erase() moves the last node into the gap.
+class NodeSet {
+    public:
+        using const_iterator = std::vector<std::shared_ptr<Node>>::const_iterator;
+
+        NodeSet(NodeSetId id, double cell_size = 1.0)
+        : id_{id}
+        , cell_size_{cell_size}
+        {
+        }
+        ~NodeSet() { clear(); }
+
+        // Nodes remember their position in the set, so copying a set would corrupt the membership flags
+        NodeSet(const NodeSet&) = delete;
+        NodeSet& operator=(const NodeSet&) = delete;
+
+        // Replaces the content of the set (duplicates are ignored)
+        NodeSet& operator=(const std::vector<std::shared_ptr<Node>>& nodes);
+
+        // Sets the bucket size of the spatial grid (should be about the expansion radius) and rebuilds the grid
+        void set_cell_size(double cell_size);
+
+        size_t size() const { return nodes_.size(); }
+        bool empty() const { return nodes_.empty(); }
+        void reserve(size_t n) { nodes_.reserve(n); cells_.reserve(n); }
+        const std::shared_ptr<Node>& operator[](size_t i) const { return nodes_[i]; }
+        const_iterator begin() const { return nodes_.begin(); }
+        const_iterator end() const { return nodes_.end(); }
+
+        bool contains(const std::shared_ptr<Node>& node) const;
+
+        // Returns false (and does nothing) if the node is already in the set
+        bool push_back(const std::shared_ptr<Node>& node);
+        void insert(const std::vector<std::shared_ptr<Node>>& nodes);
+
+        // Returns false if the node is not in the set
+        bool erase(const std::shared_ptr<Node>& node);
+        void clear();
+
+        // Removes all nodes for which pred(node) is true in a single pass, the remaining nodes keep their relative order
+        template <typename Predicate>
+        void erase_if(Predicate pred)
+        {
+            size_t j = 0;
+            for (size_t i = 0; i < nodes_.size(); i++)
+            {
+                if (pred(nodes_[i]))
+                {
+                    remove_from_grid(i);
+                    nodes_[i]->set_index[id_] = -1;
+                }
+                else
+                {
+                    if (j != i)
+                    {
+                        move_slot(i, j);
+                    }
+                    j++;
+                }
+            }
+            nodes_.resize(j);
+            cells_.resize(j);
+        }
+
+        // Calls func(node) for every node within radius of (p,q) (same distance as calc_dist).
+        // The set must not be modified from within func.
+        template <typename Function>
+        void radius_search(double p, double q, double radius, Function func) const
+        {
+            const int p_min = cell_coord(p - radius);
+            const int p_max = cell_coord(p + radius);
+            const int q_min = cell_coord(q - radius);
+            const int q_max = cell_coord(q + radius);
+            for (int i = p_min; i <= p_max; i++)
+            {
+                for (int j = q_min; j <= q_max; j++)
+                {
+                    auto bucket = grid_.find(cell_key(i, j));
+                    if (bucket == grid_.end())
+                    {
+                        continue;
+                    }
+                    for (const int slot : bucket->second)
+                    {
+                        const std::shared_ptr<Node>& node = nodes_[slot];
+                        double dp = node->p - p;
+                        double dq = node->q - q;
+                        if (sqrt((dp * dp) + (dq * dq)) <= radius)
+                        {
+                            func(node);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        // Grid bucket of the node in each slot, and the position of the slot inside that bucket
+        struct Cell {
+            int64_t key;
+            int pos;
+        };
+
+        int cell_coord(double x) const { return static_cast<int>(std::floor(x / cell_size_)); }
+        static int64_t cell_key(int i, int j) { return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(i)) << 32) | static_cast<uint32_t>(j)); }
+
+        void add_to_grid(size_t slot);
+        void remove_from_grid(size_t slot);
+        void move_slot(size_t from, size_t to);
+
+        NodeSetId id_;
+        double cell_size_;
+        std::vector<std::shared_ptr<Node>> nodes_;
+        std::vector<Cell> cells_;
+        std::unordered_map<int64_t, std::vector<int>> grid_;
+};
+
+
+// Vector of tree edges (parent, child) which also indexes the edges by their end node,
+// so checking whether an edge is in the tree and removing the edges ending at a node does not scan the whole tree
+class EdgeSet {
+    public:
+        using Edge = std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>;
+        using const_iterator = std::vector<Edge>::const_iterator;
+
+        EdgeSet() = default;
+        EdgeSet& operator=(const std::vector<Edge>& edges);
+
+        size_t size() const { return edges_.size(); }
+        bool empty() const { return edges_.empty(); }
+        void reserve(size_t n) { edges_.reserve(n); end_index_.reserve(n); }
+        const Edge& operator[](size_t i) const { return edges_[i]; }
+        const_iterator begin() const { return edges_.begin(); }
+        const_iterator end() const { return edges_.end(); }
+
+        void push_back(const Edge& edge);
+        bool contains(const std::shared_ptr<Node>& v, const std::shared_ptr<Node>& x) const;
+        // Removes all edges ending at x (order of the remaining edges is not preserved)
+        void erase_to(const std::shared_ptr<Node>& x);
+        void clear();
+
+        // Removes all edges for which pred(edge) is true, the remaining edges keep their relative order
+        template <typename Predicate>
+        void erase_if(Predicate pred)
+        {
+            std::vector<Edge> kept;
+            kept.reserve(edges_.size());
+            for (const auto& edge : edges_)
+            {
+                if (!pred(edge))
+                {
+                    kept.push_back(edge);
+                }
+            }
+            *this = kept;
+        }
+
+    private:
+        void erase_at(size_t i);
+
+        std::vector<Edge> edges_;
+        // end node -> indices of the edges ending at it
+        std::unordered_multimap<const Node*, size_t> end_index_;
+};
+
+
+// Priority queue of candidate edges (keyed on the estimated solution cost through the edge). Entries with equal keys are popped
+// in insertion order. The queued edges ending at each node are chained in a list (head stored in Node::edge_queue_head)
+// so that the edges to a rewired node can be dropped without scanning the whole queue.
+class EdgeQueue {
+    public:
+        using Edge = std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>;
+        using Handle = IndexedHeap<Edge>::Handle;
+
+        size_t size() const { return heap_.size(); }
+        bool empty() const { return heap_.empty(); }
+        void reserve(size_t n) { heap_.reserve(n); links_.reserve(n); }
+
+        void push(double key, const Edge& edge);
+        // Best key, or infinity if the queue is empty
+        double top_key() { return heap_.top_key(); }
+        Edge pop();
+        void clear() { heap_.clear(); }
+
+        // Removes the queued edges ending at x for which pred(edge) is true
+        template <typename Predicate>
+        void erase_if_to(const std::shared_ptr<Node>& x, Predicate pred)
+        {
+            Handle h = head(*x);
+            while (h != -1)
+            {
+                const Handle next = links_[h].next;
+                if (pred(heap_.item(h)))
+                {
+                    unlink(h);
+                    heap_.erase(h);
+                }
+                h = next;
+            }
+        }
+
+    private:
+        struct Link {
+            Handle prev = -1;
+            Handle next = -1;
+        };
+
+        // First queued edge ending at x, or -1
+        Handle head(const Node& x) const;
+        void unlink(Handle h);
+
+        IndexedHeap<Edge> heap_;
+        // Links of the per end node lists, indexed by heap handle
+        std::vector<Link> links_;
+};
+
+
 // Class for storing the tree in unordered sets
 class Tree {
     public:
-        std::vector<std::shared_ptr<Node>> V;
+        NodeSet V{VERTEX_SET};
         std::vector<std::shared_ptr<Node>> V_Old;
         std::vector<std::shared_ptr<Node>> V_Repair_Backup;
-        std::vector<std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>  E;
+        EdgeSet E;
         std::vector<std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>  E_Old;
         std::vector<std::shared_ptr<Node>> QV; // using shared pointers
-        std::multimap<double, std::shared_ptr<Node>> QV2;
+        IndexedHeap<std::shared_ptr<Node>> QV2; // vertex queue, a vertex may be queued more than once
         std::vector<std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>> QE;
-        std::multimap<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>> QE2;
+        EdgeQueue QE2;
         Tree() = default;
 };
 
@@ -123,7 +362,7 @@ double calc_dist(Node start_node, Node end_node);
 
 double exp_radius(double q, double sample_box_height, double sample_box_width, double eta);
 
-int bisection(std::vector<double> array, double value);
+int bisection(const std::vector<double>& array, double value);
 
 std::vector<double> linspace(double start_in, double end_in, int num_in);
 
@@ -0,0 +1,121 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file banded_cholesky.hpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+namespace vtr {
+namespace path_planning {
+
+/**
+ * \brief Cholesky factorization of a symmetric positive definite banded
+ * matrix, A = L * L^T.
+ * \details The bandwidth w is the largest |i - j| of the stored entries, so
+ * factorization is O(n w^2) and solving is O(n w). For stage-wise problems
+ * (e.g. an MPC horizon with the variables ordered by time step) w only
+ * depends on the size of a stage, so both are linear in the horizon length.
+ * Row i of L is stored contiguously as L(i, i - w), ..., L(i, i).
+ */
+class BandedCholesky {
+ public:
+  /**
+   * \brief Factorizes A, only one triangle of A is read (the upper one if A
+   * has any entries above the diagonal, the lower one otherwise).
+   * \return false if A is not positive definite
+   */
+  bool compute(const Eigen::SparseMatrix<double>& A) {
+    n_ = (int)A.rows();
+    bool upper = false;
+    w_ = 0;
+    for (int c = 0; c < A.outerSize(); ++c)
+      for (Eigen::SparseMatrix<double>::InnerIterator it(A, c); it; ++it) {
+        upper |= it.row() < it.col();
+        w_ = std::max(w_, (int)std::abs(it.row() - it.col()));
+      }
+
+    // copy the lower triangle of A into the band
+    band_.assign((size_t)n_ * (w_ + 1), 0.0);
+    for (int c = 0; c < A.outerSize(); ++c)
+      for (Eigen::SparseMatrix<double>::InnerIterator it(A, c); it; ++it) {
+        const int r = (int)it.row(), cc = (int)it.col();
+        if (upper ? (r > cc) : (r < cc)) continue;
+        at(std::max(r, cc), std::min(r, cc)) = it.value();
+      }
+
+    // L(i, j) = (A(i, j) - sum_m L(i, m) L(j, m)) / L(j, j), m < j
+    for (int i = 0; i < n_; ++i) {
+      const int first = std::max(0, i - w_);
+      for (int j = first; j <= i; ++j) {
+        const double* li = &at(i, first);
+        const double* lj = &at(j, first);
+        double s = at(i, j);
+        for (int m = 0; m < j - first; ++m) s -= li[m] * lj[m];
+        if (j < i) {
+          at(i, j) = s / at(j, j);
+        } else {
+          if (!(s > 0.0)) return false;
+          at(i, i) = std::sqrt(s);
+        }
+      }
+    }
+    return true;
+  }
+
+  /** \brief Solves A x = b with the factorization from compute */
+  Eigen::VectorXd solve(const Eigen::VectorXd& b) const {
+    Eigen::VectorXd x = b;
+    // L y = b
+    for (int i = 0; i < n_; ++i) {
+      const int first = std::max(0, i - w_);
+      double s = x(i);
+      for (int m = first; m < i; ++m) s -= at(i, m) * x(m);
+      x(i) = s / at(i, i);
+    }
+    // L^T x = y
+    for (int i = n_ - 1; i >= 0; --i) {
+      const int last = std::min(n_ - 1, i + w_);
+      double s = x(i);
+      for (int m = i + 1; m <= last; ++m) s -= at(m, i) * x(m);
+      x(i) = s / at(i, i);
+    }
+    return x;
+  }
+
+  int bandwidth() const { return w_; }
+
+ private:
+  double& at(const int i, const int j) {
+    return band_[(size_t)i * (w_ + 1) + (j - i + w_)];
+  }
+  const double& at(const int i, const int j) const {
+    return band_[(size_t)i * (w_ + 1) + (j - i + w_)];
+  }
+
+  int n_ = 0;
+  int w_ = 0;
+  std::vector<double> band_;
+};
+
+}  // namespace path_planning
+}  // namespace vtr
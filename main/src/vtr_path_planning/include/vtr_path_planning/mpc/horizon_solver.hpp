@@ -0,0 +1,90 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file horizon_solver.hpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include <chrono>
+
+#include "steam.hpp"
+
+#include "vtr_path_planning/mpc/banded_cholesky.hpp"
+
+namespace vtr {
+namespace path_planning {
+
+/**
+ * \brief Line search Gauss-Newton solver for MPC horizon problems.
+ * \details Same iterations, line search and termination criteria as
+ * steam::LineSearchGaussNewtonSolver, but the Gauss-Newton system is solved
+ * with a banded Cholesky factorization instead of a general sparse one. The
+ * MPC cost terms only couple consecutive time steps, so with the state
+ * variables added to the problem in time order (v0, T1, v1, T2, ...) the
+ * approximate Hessian is block tridiagonal and each step is linear in the
+ * horizon length. Any other variable order still gives the same result,
+ * only with a wider band.
+ */
+class HorizonGaussNewtonSolver {
+ public:
+  struct Params {
+    bool verbose = false;
+    unsigned int max_iterations = 100;
+    double absolute_cost_threshold = 0.0;
+    double absolute_cost_change_threshold = 1e-4;
+    double relative_cost_change_threshold = 1e-4;
+    double backtrack_multiplier = 0.5;
+    unsigned int max_backtrack_steps = 10;
+    /**
+     * \brief No new iteration is started after this time, the state is then
+     * left at the last accepted (lowest cost) iterate
+     */
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
+  };
+
+  HorizonGaussNewtonSolver(steam::OptimizationProblem& problem,
+                           const Params& params);
+
+  /**
+   * \brief Iterates until convergence, max_iterations or the deadline.
+   * \throws std::runtime_error if the Hessian is not positive definite or no
+   * step in the line search decreases the cost (same as steam)
+   */
+  void optimize();
+
+  unsigned int curr_iteration() const { return curr_iteration_; }
+  /** \brief Bandwidth of the last factorized Hessian */
+  int bandwidth() const { return cholesky_.bandwidth(); }
+
+ private:
+  /** \return false if no step decreased the cost */
+  bool linearizeSolveAndUpdate(double& cost, double& grad_norm);
+
+  steam::OptimizationProblem& problem_;
+  const Params params_;
+  steam::StateVector::Ptr state_vector_;
+  /** \brief State values before the line search, restored on a rejected step */
+  steam::StateVector state_vector_backup_;
+  BandedCholesky cholesky_;
+
+  unsigned int curr_iteration_ = 0;
+  double prev_cost_ = 0.0;
+  double curr_cost_ = 0.0;
+};
+
+}  // namespace path_planning
+}  // namespace vtr
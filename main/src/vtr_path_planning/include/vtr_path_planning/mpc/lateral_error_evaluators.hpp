@@ -44,11 +44,14 @@ class LateralErrorEvaluatorLeft : public Evaluable<Eigen::Matrix<double, 1, 1>>
   void backward(const Eigen::MatrixXd& lhs, const Node<OutType>::Ptr& node,
                 Jacobians& jacs) const override;
 
+  /** \brief Updates the barrier point, used when the MPC problem is reused */
+  void setMeasurement(const InType& meas_pt) { meas_pt_ = meas_pt; }
+
  private:
   /** \brief Transform evaluable */
   const Evaluable<InType>::ConstPtr pt_;
   /** \brief Landmark state variable */
-  const InType meas_pt_;
+  InType meas_pt_;
   // constants
   Eigen::Matrix<double, 1, 4> D_ = Eigen::Matrix<double, 1, 4>::Zero();
 };
@@ -82,11 +85,14 @@ class LateralErrorEvaluatorRight : public Evaluable<Eigen::Matrix<double, 1, 1>>
   void backward(const Eigen::MatrixXd& lhs, const Node<OutType>::Ptr& node,
                 Jacobians& jacs) const override;
 
+  /** \brief Updates the barrier point, used when the MPC problem is reused */
+  void setMeasurement(const InType& meas_pt) { meas_pt_ = meas_pt; }
+
  private:
   /** \brief Transform evaluable */
   const Evaluable<InType>::ConstPtr pt_;
   /** \brief Landmark state variable */
-  const InType meas_pt_;
+  InType meas_pt_;
   // constants
   Eigen::Matrix<double, 1, 4> D_ = Eigen::Matrix<double, 1, 4>::Zero();
 };
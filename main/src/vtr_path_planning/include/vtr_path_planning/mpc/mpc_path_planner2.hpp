@@ -18,6 +18,8 @@
  */
 #include "vtr_path_planning/cbit/cbit.hpp"
 #include "steam.hpp"
+#include "vtr_path_planning/mpc/lateral_error_evaluators.hpp"
+#include "vtr_path_planning/mpc/horizon_solver.hpp"
 
 #pragma once
 
@@ -57,6 +59,85 @@ struct interp_result
 // Primary optimization function: Takes in the input configurations and the extrapolated robot pose, outputs a vector for the velocity to apply and the predicted horizon
 struct mpc_result SolveMPC2(Eigen::Matrix<double, 2, 1> previous_vel, lgmath::se3::Transformation T0, std::vector<lgmath::se3::Transformation> measurements, std::vector<lgmath::se3::Transformation> measurements_cbit, std::vector<double> barrier_q_left, std::vector<double> barrier_q_right, int K, double DT, double VF, Eigen::Matrix<double, 1, 1> lat_noise_vect, Eigen::Matrix<double, 6, 6> pose_noise_vect, Eigen::Matrix<double, 2, 2> vel_noise_vect, Eigen::Matrix<double, 2, 2> accel_noise_vect, Eigen::Matrix<double, 6, 6> kin_noise_vect, bool point_stabilization, double pose_error_weight, double vel_error_weight, double acc_error_weight, double kin_error_weight, double lat_error_weight);
 
+// Persistent version of the SolveMPC2 problem for consecutive control cycles
+// The STEAM state variables, cost terms and optimization problem are built once and kept between cycles. Each cycle only the locked
+// robot state, the reference measurements, the corridor barriers and the previously applied velocity are updated, and the free states are
+// warm started from the previous solution shifted forward by one step. The problem is rebuilt (cold started from the cbit measurements)
+// when the horizon length, the point stabilization mode or any of the weights/noise models change, and after a failed solve.
+// The Gauss-Newton steps are solved either with the generic STEAM sparse solver ("sparse") or with the banded horizon solver ("banded"),
+// which is linear in the horizon length and reaches the same optimum.
+class CorridorMPC
+{
+    public:
+        // Throws std::invalid_argument if the solver is neither "sparse" nor "banded"
+        explicit CorridorMPC(const std::string& solver = "sparse");
+
+        struct Statistics
+        {
+            int num_solves = 0;
+            int num_warm_starts = 0;
+            // Number of solves where the iteration cap from the time budget was below the configured maximum
+            int num_capped = 0;
+            double last_solve_time = 0.0; // ms
+            int last_iterations = 0;
+            // Solve times (ms) of the most recent solves, used to report the distribution
+            std::vector<double> recent_solve_times;
+        };
+
+        // Same as SolveMPC2, the number of solver iterations is capped so that the solve is expected to finish within time_budget_ms
+        // (pass infinity for no cap). Throws if the optimization throws, in which case the next call cold starts.
+        struct mpc_result Solve(Eigen::Matrix<double, 2, 1> previous_vel, lgmath::se3::Transformation T0, const std::vector<lgmath::se3::Transformation>& measurements, const std::vector<lgmath::se3::Transformation>& measurements_cbit, const std::vector<double>& barrier_q_left, const std::vector<double>& barrier_q_right, int K, double DT, double VF, Eigen::Matrix<double, 1, 1> lat_noise_vect, Eigen::Matrix<double, 6, 6> pose_noise_vect, Eigen::Matrix<double, 2, 2> vel_noise_vect, Eigen::Matrix<double, 2, 2> accel_noise_vect, Eigen::Matrix<double, 6, 6> kin_noise_vect, bool point_stabilization, double pose_error_weight, double vel_error_weight, double acc_error_weight, double kin_error_weight, double lat_error_weight, double time_budget_ms);
+
+        // Drops the problem so the next solve is cold started (e.g. after the robot was stopped)
+        void Reset();
+
+        const Statistics& statistics() const { return stats; }
+
+        // Mean, median, 90th, 99th percentile and max of the recent solve times (ms)
+        std::vector<double> SolveTimeSummary() const;
+
+    private:
+        // Everything that is baked into the structure of the problem, a change requires a rebuild
+        struct ProblemParams
+        {
+            int K;
+            double DT;
+            bool point_stabilization;
+            Eigen::Matrix<double, 1, 1> lat_noise_vect;
+            Eigen::Matrix<double, 6, 6> pose_noise_vect;
+            Eigen::Matrix<double, 2, 2> vel_noise_vect;
+            Eigen::Matrix<double, 2, 2> accel_noise_vect;
+            Eigen::Matrix<double, 6, 6> kin_noise_vect;
+            double pose_error_weight;
+            double vel_error_weight;
+            double acc_error_weight;
+            double kin_error_weight;
+            double lat_error_weight;
+            bool operator==(const ProblemParams& other) const;
+        };
+
+        void Build(const ProblemParams& problem_params, const Eigen::Matrix<double, 2, 1>& previous_vel, const lgmath::se3::Transformation& T0_inv, const std::vector<lgmath::se3::Transformation>& measurements, const std::vector<lgmath::se3::Transformation>& measurements_cbit, const std::vector<double>& barrier_q_left, const std::vector<double>& barrier_q_right);
+        void Update(const Eigen::Matrix<double, 2, 1>& previous_vel, const lgmath::se3::Transformation& T0_inv, const std::vector<lgmath::se3::Transformation>& measurements, const std::vector<double>& barrier_q_left, const std::vector<double>& barrier_q_right);
+        void RecordSolve(double solve_time, int iterations, bool capped);
+
+        ProblemParams params;
+        std::unique_ptr<steam::OptimizationProblem> opt_problem;
+        std::vector<steam::se3::SE3StateVar::Ptr> pose_state_vars;
+        std::vector<steam::vspace::VSpaceStateVar<2>::Ptr> vel_state_vars;
+        std::vector<steam::se3::SE3StateVar::Ptr> measurement_vars;
+        steam::vspace::VSpaceStateVar<2>::Ptr previous_vel_var;
+        steam::stereo::HomoPointStateVar::Ptr I_4_eval;
+        std::vector<steam::LateralErrorEvaluatorRight::Ptr> lat_error_right;
+        std::vector<steam::LateralErrorEvaluatorLeft::Ptr> lat_error_left;
+
+        // Use the banded horizon solver instead of the generic sparse one
+        bool banded_solver = false;
+
+        // Moving average of the solve time per iteration (ms), including the per solve overhead
+        double iteration_time = 0.0;
+        Statistics stats;
+};
+
 // Helper function for generating reference measurements poses from a discrete path to use for tracking the path at a desired forward velocity
 struct meas_result GenerateReferenceMeas2(std::shared_ptr<std::vector<Pose>> cbit_path_ptr,  std::tuple<double, double, double, double, double, double> robot_pose, int K, double DT, double VF);
 
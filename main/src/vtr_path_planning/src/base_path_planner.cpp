@@ -18,6 +18,9 @@
  */
 #include "vtr_path_planning/base_path_planner.hpp"
 
+#include <algorithm>
+#include <limits>
+
 namespace vtr {
 namespace path_planning {
 
@@ -26,6 +29,7 @@ auto BasePathPlanner::Config::fromROS(const rclcpp::Node::SharedPtr& node,
   auto config = std::make_shared<Config>();
   // clang-format off
   config->control_period = (unsigned int)node->declare_parameter<int>(prefix + ".control_period", config->control_period);
+  config->command_fallback = node->declare_parameter<bool>(prefix + ".command_fallback", config->command_fallback);
   // clang-format on
 
   return config;
@@ -38,10 +42,35 @@ BasePathPlanner::BasePathPlanner(const Config::ConstPtr& config,
   //
   thread_count_ = 1;
   process_thread_ = std::thread(&BasePathPlanner::process, this);
+  if (config_->control_period > 0 && config_->command_fallback)
+    compute_thread_ = std::thread(&BasePathPlanner::compute, this);
 }
 
 BasePathPlanner::~BasePathPlanner() { stop(); }
 
+auto BasePathPlanner::budgetStatistics() const -> BudgetStatistics {
+  LockGuard lock(stats_mutex_);
+  return budget_stats_;
+}
+
+double BasePathPlanner::remainingBudget() const {
+  if (deadline_ == std::chrono::steady_clock::time_point::max())
+    return std::numeric_limits<double>::infinity();
+  return std::chrono::duration<double, std::milli>(
+             deadline_ - std::chrono::steady_clock::now())
+      .count();
+}
+
+void BasePathPlanner::setSafeCommand(const Command& command) {
+  LockGuard lock(safe_command_mutex_);
+  safe_command_ = command;
+}
+
+auto BasePathPlanner::getSafeCommand() const -> Command {
+  LockGuard lock(safe_command_mutex_);
+  return safe_command_;
+}
+
 void BasePathPlanner::setRunning(const bool running) {
   UniqueLock lock(mutex_);
   running_ = running;
@@ -57,6 +86,14 @@ void BasePathPlanner::stop() {
   cv_terminate_or_state_changed_.notify_all();
   cv_thread_finish_.wait(lock, [this] { return thread_count_ == 0; });
   if (process_thread_.joinable()) process_thread_.join();
+  lock.unlock();
+  // the process thread no longer requests commands, stop the compute thread
+  {
+    LockGuard compute_lock(compute_mutex_);
+    compute_terminate_ = true;
+  }
+  cv_compute_requested_.notify_all();
+  if (compute_thread_.joinable()) compute_thread_.join();
 }
 
 void BasePathPlanner::process() {
@@ -86,25 +123,101 @@ void BasePathPlanner::process() {
     /// required to give other threads a chance to acquire the lock
     lock.unlock();
     //
+    const auto start_time = std::chrono::steady_clock::now();
     const auto wait_until_time =
-        std::chrono::steady_clock::now() +
-        std::chrono::milliseconds(config_->control_period);
-    const auto command = computeCommand(*robot_state_);
+        start_time + std::chrono::milliseconds(config_->control_period);
+    deadline_ = config_->control_period > 0
+                    ? wait_until_time
+                    : std::chrono::steady_clock::time_point::max();
+
+    bool fallback = false;
+    if (compute_thread_.joinable()) {
+      // compute in the compute thread so that a command is sent by the deadline
+      UniqueLock compute_lock(compute_mutex_);
+      compute_requested_ = true;
+      command_computed_ = false;
+      cv_compute_requested_.notify_all();
+      if (cv_command_computed_.wait_until(compute_lock, wait_until_time,
+                                          [this] { return command_computed_; })) {
+        const auto command = computed_command_;
+        compute_lock.unlock();
+        callback_->commandReceived(command);
+      } else {
+        compute_lock.unlock();
+        const auto safe_command = getSafeCommand();
+        callback_->commandReceived(safe_command);
+        fallback = true;
+        // the late command is out of date, wait for it and drop it
+        compute_lock.lock();
+        cv_command_computed_.wait(compute_lock,
+                                  [this] { return command_computed_; });
+        compute_lock.unlock();
+        onCommandDropped(safe_command);
+      }
+    } else {
+      const auto command = computeCommand(*robot_state_);
+      callback_->commandReceived(command);
+    }
 
-    callback_->commandReceived(command);
+    const double compute_time = std::chrono::duration<double, std::milli>(
+                                    std::chrono::steady_clock::now() - start_time)
+                                    .count();
+    recordCycle(compute_time, fallback);
     if (config_->control_period > 0 &&
         wait_until_time < std::chrono::steady_clock::now()) {
-      const auto dt = std::chrono::duration_cast<std::chrono::milliseconds>(
-                          std::chrono::steady_clock::now() - wait_until_time)
-                          .count();
       CLOG(WARNING, "path_planning")
-          << "Command computation takes " << (dt + config_->control_period)
+          << "Command computation takes " << compute_time
           << "ms, which is longer than the control period of "
-          << config_->control_period << "ms.";
+          << config_->control_period << "ms"
+          << (fallback ? ", sent the safe command instead." : ".")
+          << " Budget statistics: " << budgetStatistics();
     }
     std::this_thread::sleep_until(wait_until_time);
   }
 }
 
+void BasePathPlanner::compute() {
+  el::Helpers::setThreadName("path_planning.compute");
+  UniqueLock lock(compute_mutex_);
+  while (true) {
+    cv_compute_requested_.wait(
+        lock, [this] { return compute_terminate_ || compute_requested_; });
+    if (compute_terminate_) return;
+    compute_requested_ = false;
+
+    lock.unlock();
+    const auto command = computeCommand(*robot_state_);
+    lock.lock();
+
+    computed_command_ = command;
+    command_computed_ = true;
+    cv_command_computed_.notify_all();
+  }
+}
+
+void BasePathPlanner::recordCycle(const double compute_time,
+                                  const bool fallback) {
+  if (config_->control_period == 0) return;
+  const double usage = compute_time / config_->control_period;
+  LockGuard lock(stats_mutex_);
+  auto& stats = budget_stats_;
+  ++stats.num_cycles;
+  if (fallback) ++stats.num_fallbacks;
+  if (usage > 1.0) ++stats.num_overruns;
+  stats.last_usage = usage;
+  stats.mean_usage += (usage - stats.mean_usage) / stats.num_cycles;
+  stats.max_usage = std::max(stats.max_usage, usage);
+}
+
+std::ostream& operator<<(std::ostream& os,
+                         const BasePathPlanner::BudgetStatistics& stats) {
+  os << "cycles: " << stats.num_cycles
+     << ", fallbacks: " << stats.num_fallbacks
+     << ", overruns: " << stats.num_overruns
+     << ", budget usage [last, mean, max]: [" << stats.last_usage << ", "
+     << stats.mean_usage << ", " << stats.max_usage << "]";
+  return os;
+}
+
 }  // namespace path_planning
 }  // namespace vtr
\ No newline at end of file
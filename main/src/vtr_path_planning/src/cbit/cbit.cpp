@@ -43,6 +43,7 @@ auto CBIT::Config::fromROS(const rclcpp::Node::SharedPtr& node, const std::strin
 
   // Base planner configs
   config->control_period = (unsigned int)node->declare_parameter<int>(prefix + ".control_period", config->control_period);
+  config->command_fallback = node->declare_parameter<bool>(prefix + ".command_fallback", config->command_fallback);
 
   // robot configuration
   config->robot_model = node->declare_parameter<std::string>(prefix + ".teb.robot_model", config->robot_model);
@@ -82,6 +83,7 @@ auto CBIT::Config::fromROS(const rclcpp::Node::SharedPtr& node, const std::strin
   config->max_ang_vel = node->declare_parameter<double>(prefix + ".mpc.max_ang_vel", config->max_ang_vel);
   config->robot_linear_velocity_scale = node->declare_parameter<double>(prefix + ".robot_linear_velocity_scale", config->robot_linear_velocity_scale);
   config->robot_angular_velocity_scale = node->declare_parameter<double>(prefix + ".robot_angular_velocity_scale", config->robot_angular_velocity_scale);
+  config->mpc_solver = node->declare_parameter<std::string>(prefix + ".mpc.solver", config->mpc_solver);
 
 
   // COST FUNCTION COVARIANCE
@@ -176,6 +178,7 @@ CBIT::CBIT(const Config::ConstPtr& config,
   {
     vel_history.push_back(applied_vel);
   }
+  mpc_ptr = std::make_shared<CorridorMPC>(config_->mpc_solver);
 
   thread_count_ = 2;
   process_thread_cbit_ = std::thread(&CBIT::process_cbit, this);
@@ -299,6 +302,7 @@ auto CBIT::computeCommand(RobotState& robot_state) -> Command {
   if (!chain.isLocalized()) {
     CLOG(WARNING, "path_planning.cbit") << "Robot is not localized, commanding the robot to stop";
     applied_vel << 0.0, 0.0;
+    mpc_ptr->Reset();
     // Update history:
     vel_history.erase(vel_history.begin());
     vel_history.push_back(applied_vel);
@@ -553,8 +557,9 @@ auto CBIT::computeCommand(RobotState& robot_state) -> Command {
     try
     {
       CLOG(INFO, "mpc.cbit") << "Attempting to solve the MPC problem";
-      // Solve using corridor mpc
-      auto mpc_result = SolveMPC2(applied_vel, T0, measurements4, measurements, barrier_q_left, barrier_q_right, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight);
+      // Solve using corridor mpc, warm started from the previous cycle and limited to the remaining control period
+      const double time_budget_ms = remainingBudget();
+      auto mpc_result = mpc_ptr->Solve(applied_vel, T0, measurements4, measurements, barrier_q_left, barrier_q_right, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight, time_budget_ms);
       // Solve using tracking mpc
       //auto mpc_result = SolveMPC2(applied_vel, T0, measurements, measurements, barrier_q_left, barrier_q_right, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization3, pose_error_weight, acc_error_weight, kin_error_weight, lat_error_weight);
       //auto mpc_result = SolveMPC(applied_vel, T0, measurements, K, DT, VF, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization); // Tracking controller version
@@ -610,6 +615,7 @@ auto CBIT::computeCommand(RobotState& robot_state) -> Command {
     CLOG(INFO, "mpc.cbit") << "There is not a valid plan yet, returning zero velocity commands";
 
     applied_vel << 0.0, 0.0;
+    mpc_ptr->Reset();
     vel_history.erase(vel_history.begin());
     vel_history.push_back(applied_vel);
     return Command();
@@ -617,6 +623,17 @@ auto CBIT::computeCommand(RobotState& robot_state) -> Command {
 }
 
 
+// The command of the last cycle missed the deadline and the safe command was sent instead, so roll back the velocity state
+// and the MPC warm start, which the next cycle would otherwise start from as if the dropped command had been applied
+void CBIT::onCommandDropped(const Command& sent) {
+  CLOG(WARNING, "path_planning.cbit") << "Command dropped for missing the deadline, resetting the velocity state to the safe command";
+  applied_vel << sent.linear.x / config_->robot_linear_velocity_scale,
+                 sent.angular.z / config_->robot_angular_velocity_scale;
+  vel_history.back() = applied_vel;
+  mpc_ptr->Reset();
+}
+
+
 // Function for grabbing the robots velocity in planning frame, transform of robot into planning frame, and transform of planning frame to world frame
 auto CBIT::getChainInfo(RobotState& robot_state) -> ChainInfo {
   auto& chain = *robot_state.chain;
@@ -824,21 +841,8 @@ void CBIT::visualize(const tactic::Timestamp& stamp, const tactic::EdgeTransform
 // Function for converting a p,q coordinate value into a euclidean coordinate using the pre-processed path to follow
 Node CBIT::curve_to_euclid(Node node)
 {
-  double p_val = node.p;
-  double q_val = node.q;
-  int p_ind =  bisection(global_path_ptr->p, p_val);
-
-  // Linearly interpolate a Euclidean Pose using the euclidean path and the relative p_val,q_val
-  // TODO: need to use steam or lgmath se(3) classes for these poses, for now just using a vector
-  Pose pose_c = lin_interpolate(p_ind, p_val);
-
-  double x_i = pose_c.x - sin(pose_c.yaw)*q_val;
-  double y_i = pose_c.y + cos(pose_c.yaw)*q_val;
-
-  // Experimental, also interpolate the z value
-  double z_i = pose_c.z; //+ cos(pose_c.yaw)*q_val; // I think here we just want to set the z to whatever the pose_c.z value
-
-  return Node(x_i,y_i,z_i);
+  // The path finds the segment from its lookup table and linearly interpolates the pose (see CBITPath::curve_to_euclid)
+  return global_path_ptr->curve_to_euclid(node);
 }
 
 Pose CBIT::lin_interpolate(int p_ind, double p_val)
@@ -900,16 +904,16 @@ struct CBIT::collision_result CBIT::discrete_collision_v2(double discretization,
 
 
     // Loop through the test curvilinear points, convert to euclid, collision check obstacles
+    CBITCostmap::EdgeChecker edge_checker(*costmap_ptr, true);
+    std::vector<Node> euclid_test;
+    global_path_ptr->curve_to_euclid(p_test, q_test, euclid_test);
     Node curv_pt;
     for (int i = 0; i < p_test.size(); i++)
     {
         curv_pt = Node(p_test[i], q_test[i]);
+        Node euclid_pt = euclid_test[i];
 
-        // Convert to euclid TODO:
-        //Node euclid_pt = curv_pt; // DEBUG DO NOT LEAVE THIS HERE, NEED TO REPLACE WITH COLLISION CHECK FUNCTION
-        Node euclid_pt = curve_to_euclid(curv_pt);
-
-        if (costmap_col_tight(euclid_pt))
+        if (edge_checker.collision(euclid_pt))
         {
           return {true, curv_pt};
         }
@@ -925,47 +929,8 @@ struct CBIT::collision_result CBIT::discrete_collision_v2(double discretization,
 // Under normal operation we plan paths around a slightly more conservative buffer around each obstacle (equal to influence dist + min dist)
 bool CBIT::costmap_col_tight(Node node)
 {
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Original Node: x: " << node.p << " y: " << node.q << " z: " << node.z;
-  Eigen::Matrix<double, 4, 1> test_pt({node.p, node.q, node.z, 1});
-
-  // I am no longer temporally filtering here, instead this takes place in the costmap itself in the change detection module
-  // This means the costmap and transform size should never be more than 1
-  //for (int i = 0; i < cbit_costmap_ptr->T_c_w_vect.size(); i++)
-  //{
-
-
-  auto collision_pt = costmap_ptr->T_c_w * test_pt;
-
-  // Round the collision point x and y values down to the nearest grid resolution so that it can be found in the obstacle unordered_map
-  float x_key = floor(collision_pt[0] / costmap_ptr->grid_resolution) * costmap_ptr->grid_resolution;
-  float y_key = floor(collision_pt[1] / costmap_ptr->grid_resolution) * costmap_ptr->grid_resolution;
-
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "X_key:  " << x_key;
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Y_key:  " << y_key;
-
-  float grid_value;
-
-  // Check to see if the point is in the obstacle map
-  // We need to use a try/catch in this metod as if the key value pair doesnt exist (it usually wont) we catch an out of range error
-  try 
-  {
-  // Block of code to try
-    grid_value = costmap_ptr->obs_map.at(std::pair<float, float> (x_key, y_key));
-    //CLOG(ERROR, "path_planning.cbit_planner") << "Key Value:  " << grid_value;
-  }
-  catch (std::out_of_range) 
-  {
-    grid_value = 0.0;
-  }
-
-  if (grid_value >= 0.89) // By switching this from > 0.0 to 0.9, we effectively only collision check the path out to the "minimum_distance" obs config param
-  {
-    return true;
-  }
-  //}
-
-  // If we make it here can return false for no collision
-  return false;
+  // Lookup in the dense obstacle grid of the costmap (value >= 0.89), this effectively only collision checks the path out to the "minimum_distance" obs config param
+  return costmap_ptr->collision(node, true);
 }
 
 }  // namespace path_planning
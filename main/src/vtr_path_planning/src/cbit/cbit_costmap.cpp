@@ -0,0 +1,254 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file cbit_costmap.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+
+// Dense obstacle grid and collision checking for the cbit costmap
+
+#include "vtr_path_planning/cbit/cbit_costmap.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <limits>
+
+namespace {
+
+// Exact 1D squared distance transform of a sampled function (Felzenszwalb and Huttenlocher), f is overwritten with the result
+// Infinite samples (no obstacle) are skipped
+void distance_transform_1d(std::vector<double>& f, std::vector<int>& v, std::vector<double>& z, std::vector<double>& d)
+{
+    const int n = f.size();
+    int k = -1;
+    for (int q = 0; q < n; q++)
+    {
+        if (f[q] == std::numeric_limits<double>::infinity())
+        {
+            continue;
+        }
+        double s = 0.0;
+        while (k >= 0)
+        {
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * q - 2.0 * v[k]);
+            if (s > z[k])
+            {
+                break;
+            }
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = (k == 0) ? -std::numeric_limits<double>::infinity() : s;
+        z[k + 1] = std::numeric_limits<double>::infinity();
+    }
+    if (k < 0)
+    {
+        return; // no obstacles, everything stays infinite
+    }
+    int j = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[j + 1] < q)
+        {
+            j++;
+        }
+        d[q] = (q - v[j]) * (q - v[j]) + f[v[j]];
+    }
+    std::copy(d.begin(), d.begin() + n, f.begin());
+}
+
+}  // namespace
+
+
+void CBITCostmap::update_grid()
+{
+    auto grid = std::make_shared<Grid>();
+    grid->T_c_w = T_c_w;
+    grid->resolution = grid_resolution;
+    if (obs_map.empty())
+    {
+        std::atomic_store(&grid_, std::shared_ptr<const Grid>(std::move(grid)));
+        return;
+    }
+
+    // The keys are (i*grid_resolution, j*grid_resolution) rounded to float, so the indices are recovered by rounding
+    int max_i = std::numeric_limits<int>::min();
+    int max_j = std::numeric_limits<int>::min();
+    grid->min_i = std::numeric_limits<int>::max();
+    grid->min_j = std::numeric_limits<int>::max();
+    for (const auto& cell : obs_map)
+    {
+        const int i = std::lround(cell.first.first / grid_resolution);
+        const int j = std::lround(cell.first.second / grid_resolution);
+        grid->min_i = std::min(grid->min_i, i);
+        grid->min_j = std::min(grid->min_j, j);
+        max_i = std::max(max_i, i);
+        max_j = std::max(max_j, j);
+    }
+    const int width = grid->width = max_i - grid->min_i + 1;
+    const int height = grid->height = max_j - grid->min_j + 1;
+
+    // Occupancy layer, with the same thresholds as the obs_map lookups used
+    auto& flags = grid->flags;
+    flags.assign(static_cast<size_t>(width) * height, 0);
+    for (const auto& cell : obs_map)
+    {
+        const int i = std::lround(cell.first.first / grid_resolution) - grid->min_i;
+        const int j = std::lround(cell.first.second / grid_resolution) - grid->min_j;
+        uint8_t cell_flags = 0;
+        if (cell.second > 0.0)
+        {
+            cell_flags |= COLLISION;
+        }
+        if (cell.second >= 0.89)
+        {
+            cell_flags |= COLLISION_TIGHT;
+        }
+        flags[static_cast<size_t>(i) * height + j] = cell_flags;
+    }
+
+    // Distance layer: exact euclidean distance transform to the collision cells, columns then rows
+    const int n = std::max(width, height);
+    std::vector<double> f(n), d(n), z(n + 1);
+    std::vector<int> v(n);
+    std::vector<double> sq_dist(flags.size());
+    for (size_t k = 0; k < flags.size(); k++)
+    {
+        sq_dist[k] = (flags[k] & COLLISION) ? 0.0 : std::numeric_limits<double>::infinity();
+    }
+    for (int i = 0; i < width; i++)
+    {
+        f.resize(height);
+        std::copy(sq_dist.begin() + static_cast<size_t>(i) * height, sq_dist.begin() + static_cast<size_t>(i + 1) * height, f.begin());
+        distance_transform_1d(f, v, z, d);
+        std::copy(f.begin(), f.end(), sq_dist.begin() + static_cast<size_t>(i) * height);
+    }
+    for (int j = 0; j < height; j++)
+    {
+        f.resize(width);
+        for (int i = 0; i < width; i++)
+        {
+            f[i] = sq_dist[static_cast<size_t>(i) * height + j];
+        }
+        distance_transform_1d(f, v, z, d);
+        for (int i = 0; i < width; i++)
+        {
+            sq_dist[static_cast<size_t>(i) * height + j] = f[i];
+        }
+    }
+    grid->clearance.resize(sq_dist.size());
+    for (size_t k = 0; k < sq_dist.size(); k++)
+    {
+        grid->clearance[k] = std::sqrt(sq_dist[k]) * grid_resolution;
+    }
+
+    // Publish, checks already running keep the previous grid alive until they are done
+    std::atomic_store(&grid_, std::shared_ptr<const Grid>(std::move(grid)));
+}
+
+
+std::shared_ptr<const CBITCostmap::Grid> CBITCostmap::grid() const
+{
+    return std::atomic_load(&grid_);
+}
+
+
+int64_t CBITCostmap::Grid::cell_index(const Node& euclid_pt, double& x, double& y) const
+{
+    Eigen::Matrix<double, 4, 1> test_pt({euclid_pt.p, euclid_pt.q, euclid_pt.z, 1});
+    auto collision_pt = T_c_w * test_pt;
+    x = collision_pt[0];
+    y = collision_pt[1];
+
+    // Round down to the grid resolution, this is the cell the obs_map key was generated from
+    const double i = floor(x / resolution) - min_i;
+    const double j = floor(y / resolution) - min_j;
+    if ((i < 0) || (i >= width) || (j < 0) || (j >= height))
+    {
+        return -1;
+    }
+    return static_cast<int64_t>(i) * height + static_cast<int64_t>(j);
+}
+
+
+bool CBITCostmap::collision(const Node& euclid_pt, bool tight) const
+{
+    const auto grid = this->grid();
+    double x, y;
+    const int64_t cell = grid->cell_index(euclid_pt, x, y);
+    if (cell < 0)
+    {
+        return false;
+    }
+    return grid->flags[cell] & (tight ? COLLISION_TIGHT : COLLISION);
+}
+
+
+double CBITCostmap::clearance(const Node& euclid_pt) const
+{
+    const auto grid = this->grid();
+    if (grid->flags.empty())
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    double x, y;
+    const int64_t cell = grid->cell_index(euclid_pt, x, y);
+    if (cell < 0)
+    {
+        return 0.0;
+    }
+    return grid->clearance[cell];
+}
+
+
+CBITCostmap::EdgeChecker::EdgeChecker(const CBITCostmap& costmap, bool tight)
+: grid_{costmap.grid()}
+, tight_{tight}
+{
+}
+
+
+bool CBITCostmap::EdgeChecker::collision(const Node& euclid_pt)
+{
+    double x, y;
+    const int64_t cell = grid_->cell_index(euclid_pt, x, y);
+    if (cell < 0)
+    {
+        return false;
+    }
+    if (cell == prev_cell_)
+    {
+        return prev_collision_;
+    }
+    prev_cell_ = cell;
+
+    // Any cell whose centre is closer than the clearance to the centre of the last looked up cell is obstacle free,
+    // the point is at most half a cell diagonal away from the centre of its own cell
+    const double half_diagonal = grid_->resolution * M_SQRT1_2;
+    if (std::hypot(x - free_x_, y - free_y_) + half_diagonal < free_radius_)
+    {
+        prev_collision_ = false;
+        return false;
+    }
+
+    prev_collision_ = grid_->flags[cell] & (tight_ ? COLLISION_TIGHT : COLLISION);
+    const int64_t i = cell / grid_->height + grid_->min_i;
+    const int64_t j = cell % grid_->height + grid_->min_j;
+    free_x_ = (i + 0.5) * grid_->resolution;
+    free_y_ = (j + 0.5) * grid_->resolution;
+    free_radius_ = grid_->clearance[cell];
+    return prev_collision_;
+}
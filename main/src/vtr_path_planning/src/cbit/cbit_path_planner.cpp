@@ -115,6 +115,10 @@ void CBITPlanner::InitializePlanningSpace()
   tree.V_Old.reserve(10000);
   tree.E.reserve(10000);
   //tree.QV.reserve(10000);
+
+  // Radius searches in ExpandVertex use the expansion radius, so use it as the bucket size of the spatial grids
+  tree.V.set_cell_size(conf.initial_exp_rad);
+  samples.set_cell_size(conf.initial_exp_rad);
   //tree.QE.reserve(10000);
 
   // Set initial cost to comes
@@ -437,16 +441,14 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
         */
 
        // Alternative: Take all points in a radius of 2.0m around the new robot state (only if they are a ahead though)
-        double sample_dist;
-        for (int i = 0; i < tree.V.size(); i++)
+        tree.V.radius_search(p_goal->p, p_goal->q, 2.0, [&](const std::shared_ptr<Node>& vertex) // TODO: replace magic number with a param, represents radius to search for state update rewires
         {
-          sample_dist = calc_dist(*(tree.V[i]), *p_goal);
-          if ((sample_dist <= 2.0) && ((tree.V[i])->p > (p_goal->p + (conf.initial_exp_rad/2)))) // TODO: replace magic number with a param, represents radius to search for state update rewires
+          if (vertex->p > (p_goal->p + (conf.initial_exp_rad/2)))
           {
-            //tree.QV.push_back(tree.V[i]); // comment out when only taking closest point in the tree to consider
-            tree.QV2.insert(std::pair<double, std::shared_ptr<Node>>((tree.V[i]->g_T_weighted + h_estimated_admissible(*tree.V[i], *p_goal)), tree.V[i]));
+            //tree.QV.push_back(vertex); // comment out when only taking closest point in the tree to consider
+            tree.QV2.push((vertex->g_T_weighted + h_estimated_admissible(*vertex, *p_goal)), vertex);
           }
-        }
+        });
 
 
 
@@ -572,37 +574,21 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
 
           
           // Vertex Prune (maintain only vertices to the right of the collision free vertex)
-          std::vector<std::shared_ptr<Node>> pruned_vertex_tree;
-          pruned_vertex_tree.reserve(tree.V.size());
           int test_counter = 0;
           for (int i =0; i<tree.V.size(); i++)
           {
-            if (tree.V[i]->p >= col_free_vertex->p)
-            {
-              pruned_vertex_tree.push_back(tree.V[i]);
-            }
             if (tree.V[i]->p >= (p_goal->p + 11.0))
             {
               test_counter = test_counter + 1;
             }
           }
-          tree.V = pruned_vertex_tree;
+          tree.V.erase_if([&](const std::shared_ptr<Node>& vertex) {return vertex->p < col_free_vertex->p;});
           CLOG(ERROR, "path_planning.cbit_planner") << "The number of vertices in the tree outside of sliding window is:" << test_counter;
           CLOG(ERROR, "path_planning.cbit_planner") << "The corresponding p threshold was: " << (p_goal->p + 11.0);
 
 
           // Edge Prune (maintain only edges to the right of the collision free vertex)
-          std::vector<std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>  pruned_edge_tree;
-          pruned_edge_tree.reserve(tree.E.size());
-          for (int i = 0; i <tree.E.size(); i++)
-          {
-            if (std::get<1>(tree.E[i])->p >= col_free_vertex->p)
-            {
-              pruned_edge_tree.push_back(tree.E[i]);
-            }
-          }
-  
-          tree.E = pruned_edge_tree;
+          tree.E.erase_if([&](const EdgeSet::Edge& edge) {return std::get<1>(edge)->p < col_free_vertex->p;});
                  
 
           // Experimental, just trying to see whether not restoring at all yields better repair performance time
@@ -672,7 +658,7 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
         //std::cout << "Sample Box" << std::endl;
         std::vector<std::shared_ptr<Node>> new_samples = SampleBox(m); // TODO Sample rejection
         //std::vector<std::shared_ptr<Node>> new_samples = SampleFreeSpace(m); // DEBUG ONLY!!!
-        samples.insert(samples.end(), new_samples.begin(), new_samples.end());
+        samples.insert(new_samples);
 
       }
       
@@ -680,7 +666,7 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
       {
         //std::cout << "Sample Free Space " << std::endl;
         std::vector<std::shared_ptr<Node>> new_samples = SampleFreeSpace(m); // TODO Pre Seeds, Sample Rejection
-        samples.insert(samples.end(), new_samples.begin(), new_samples.end());
+        samples.insert(new_samples);
 
 
       }
@@ -689,15 +675,8 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
       // Backup the old tree:
       tree.V_Old.clear();
       tree.E_Old.clear();
-      for (int i = 0; i < tree.V.size(); i++)
-      {
-        tree.V_Old.push_back((tree.V[i]));
-      }
-
-      for (int i = 0; i < tree.E.size(); i++)
-      {
-        tree.E_Old.push_back(tree.E[i]);
-      }
+      tree.V_Old.assign(tree.V.begin(), tree.V.end());
+      tree.E_Old.assign(tree.E.begin(), tree.E.end());
 
 
       // Initialize the Vertex Queue with all nearby vertices in the tree;
@@ -726,14 +705,14 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
         if (k == 0)
         {
           //tree.QV.push_back(tree.V[i]);
-          tree.QV2.insert(std::pair<double, std::shared_ptr<Node>>((tree.V[i]->g_T_weighted + h_estimated_admissible(*tree.V[i], *p_goal)), tree.V[i]));
+          tree.QV2.push((tree.V[i]->g_T_weighted + h_estimated_admissible(*tree.V[i], *p_goal)), tree.V[i]);
         }
         // Otherwise, only add the portions of the tree within the sliding window to avoid processing preseeded vertices which are already optimal
         //else if (((tree.V[i]->p) <= p_goal->p + dynamic_window_width + (conf.sliding_window_freespace_padding*2)) && ((vertex_rej_prob / random_integer) >= 1.0))
         else if (((vertex_rej_prob / random_integer) >= 1.0)) // for some reason using the lookahead queue doesnt work reliably for collisions, not sure why, need to investigate
         {
           //tree.QV.push_back(tree.V[i]);
-          tree.QV2.insert(std::pair<double, std::shared_ptr<Node>>((tree.V[i]->g_T_weighted + h_estimated_admissible(*tree.V[i], *p_goal)), tree.V[i]));
+          tree.QV2.push((tree.V[i]->g_T_weighted + h_estimated_admissible(*tree.V[i], *p_goal)), tree.V[i]);
         }
 
       }
@@ -822,23 +801,8 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
           {
             // TODO: Needs some additional wormhole logic in here which I havent done yet
 
-            // loop through edges, delete those which have the same xm end node
-            int upper_edge_index = tree.E.size();
-            for (int i = 0; i < upper_edge_index; i++)
-            {
-              if (std::get<1>(tree.E[i]) == xm) // changed to equating pointer addresses
-              {
-                  // Once we process the vertex and have it ready to return, remove it from the edge queue (This is a fast way of doing so)
-                  
-                  auto it = tree.E.begin() + i; 
-                  *it = std::move(tree.E.back());
-                  tree.E.pop_back();
-
-                  // NEED TO BE VERY CAREFUL WITH THE INDEX HERE, ANYTIME WE DO A DELETION WE NEED TO DECREMENT, AS WELL AS ADJUST THE UPPER ITERATOR SIZE
-                  i = i - 1;
-                  upper_edge_index = upper_edge_index - 1;
-              }
-            }
+            // delete the edges which have the same xm end node (edges are indexed by their end node so this does not scan the tree)
+            tree.E.erase_to(xm);
 
             // Set cost to comes
             xm->g_T_weighted = vm->g_T_weighted + weighted_cost;
@@ -853,17 +817,7 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
           {
             // If the end point is not in the tree, it must have come from a random sample.
             // Remove it from the samples, add it to the vertex tree and vertex queue:
-            for (int i = 0; i < samples.size(); i++)
-            {
-              if (samples[i] == xm)
-              {
-                auto it = samples.begin() + i;
-                *it = std::move(samples.back());
-                samples.pop_back();
-
-                break; // Once we find the one to delete, it is safe to break, there should only every be one
-              }
-            }
+            samples.erase(xm);
             // Set cost to comes
             xm->g_T_weighted = vm->g_T_weighted + weighted_cost;
             xm->g_T = vm->g_T + actual_cost;
@@ -872,7 +826,7 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
 
             tree.V.push_back(xm);
             //tree.QV.push_back(xm);
-            tree.QV2.insert(std::pair<double, std::shared_ptr<Node>>(xm->g_T_weighted + h_estimated_admissible(*xm, *p_goal), xm));
+            tree.QV2.push(xm->g_T_weighted + h_estimated_admissible(*xm, *p_goal), xm);
           }
           stop_bench_time = std::chrono::high_resolution_clock::now();
           duration_bench = std::chrono::duration_cast<std::chrono::nanoseconds>(stop_bench_time - start_bench_time);
@@ -905,28 +859,12 @@ void CBITPlanner::Planning(vtr::path_planning::BasePathPlanner::RobotState& robo
           */
 
 
-          // Variation using multimap edge queue. In this case we kind of need to do the same procedure unfortunately (slow)
-          // Only here we have to use iterators to go through the queue
-          // NOTE THIS NEEDS SOME VERY GOOD DEBUGGING BEFORE TRUSTING THIS CODE, NOT SURE IF ITERATORS BEHAVE THE SAME WAY AS INDEXING WITH DELETION
-          // For iterators, we need to do this process in a while loop because we cannot just decrement the index like before (leads to bad pointer)
-          std::multimap<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>::iterator itr = tree.QE2.begin();
-          while (itr != tree.QE2.end())
+          // Edge queue variation: the queue chains the edges ending at each node, so only the edges into xm are visited
+          tree.QE2.erase_if_to(xm, [&](const std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>& edge)
           {
-            auto edge = itr->second;
             Node v = *std::get<0>(edge);
-            std::shared_ptr<Node> x = std::get<1>(edge);
-
-            if ((x == xm) && (v.g_T_weighted + calc_weighted_dist(v, *xm, conf.alpha) >= xm->g_T_weighted))
-            {
-              // Once again, be very careful with the iteration indices when deleting
-              // Need to decrement both the iterator and the total size
-              itr = tree.QE2.erase(itr); // Erase returns the itr of the value in the map following the previous iterator
-            }
-            else
-            {
-              itr++;
-            }
-          } 
+            return (v.g_T_weighted + calc_weighted_dist(v, *xm, conf.alpha) >= xm->g_T_weighted);
+          });
           stop_bench_time = std::chrono::high_resolution_clock::now();
           duration_bench = std::chrono::duration_cast<std::chrono::nanoseconds>(stop_bench_time - start_bench_time);
           CLOG(DEBUG, "path_planning_compute.cbit") << "Compute 3.75: " << duration_bench.count();
@@ -1217,53 +1155,36 @@ void CBITPlanner::Prune(double c_best, double c_best_weighted)
   }
 
   // Using the cost threshold, prune the samples (weighted eyeball prune)
-  // I think for vectors, its probably faster to just copy the samples to a new pointer vector which do satisfy the constraint,
-  // Then overwrite the samples, instead of doing many many deletions
-  std::vector<std::shared_ptr<Node>> samples_pruned;
-  for (int i = 0; i < samples.size(); i++)
+  // The sets are compacted in place in a single pass, instead of copying the kept shared pointers to new vectors
+  samples.erase_if([&](const std::shared_ptr<Node>& sample)
   {
-    if (f_estimated(*samples[i], *p_start, *p_goal, conf.alpha) < cost_threshold)// Also handles inf flagged values
-    {
-      samples_pruned.push_back(std::shared_ptr<Node> (samples[i]));
-    }
-  }
+    return !(f_estimated(*sample, *p_start, *p_goal, conf.alpha) < cost_threshold); // Also handles inf flagged values
+  });
 
   // We also check the tree and add samples for unconnected vertices back to the sample set
   //We also do a prune of the vertex tree by heuristic
   //&& (samples[i]->g_T != INFINITY)) 
-  std::vector<std::shared_ptr<Node>> vertex_pruned;
-  int vertices_size = tree.V.size(); 
-  for (int i = 0; i < vertices_size; i++)
+  for (int i = 0; i < tree.V.size(); i++)
   {
     if (tree.V[i]->g_T_weighted == INFINITY)
     {
-      samples_pruned.push_back(std::shared_ptr<Node> (tree.V[i]));
-    }
-    if ((f_estimated(*tree.V[i], *p_start, *p_goal, conf.alpha) <= cost_threshold) && (tree.V[i]->g_T_weighted < INFINITY))
-    {
-      
-      vertex_pruned.push_back(std::shared_ptr<Node> (tree.V[i]));
+      samples.push_back(tree.V[i]);
     }
   }
-  // After we do both the above loops update the sample vector
-  samples = samples_pruned;
-  tree.V = vertex_pruned;
+  tree.V.erase_if([&](const std::shared_ptr<Node>& vertex)
+  {
+    return !((f_estimated(*vertex, *p_start, *p_goal, conf.alpha) <= cost_threshold) && (vertex->g_T_weighted < INFINITY));
+  });
 
   // TODO: Wormhole accomodations  
 
   // Similar Prune of the Edges
   // TODO:Wormhole accomodations
-  std::vector<std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>  edge_pruned;
-  for (int i = 0; i <tree.E.size(); i++)
+  tree.E.erase_if([&](const EdgeSet::Edge& edge)
   {
     // In the below condition, I also include the prune of vertices with inf cost to come values
-    if ((f_estimated(*std::get<0>(tree.E[i]), *p_start, *p_goal, conf.alpha) <= cost_threshold) && (f_estimated(*std::get<1>(tree.E[i]), *p_start, *p_goal, conf.alpha) <= cost_threshold))
-    {
-      edge_pruned.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> (tree.E[i]));
-    }
-
-  }
-  tree.E = edge_pruned;
+    return !((f_estimated(*std::get<0>(edge), *p_start, *p_goal, conf.alpha) <= cost_threshold) && (f_estimated(*std::get<1>(edge), *p_start, *p_goal, conf.alpha) <= cost_threshold));
+  });
   
 
 }
@@ -1634,11 +1555,8 @@ double CBITPlanner::BestVertexQueueValue()
   }
   */
   
-  // New multimap implementation of this:
-  std::multimap<double, std::shared_ptr<Node>>::iterator itr = tree.QV2.begin();
-  double min_vertex_cost = itr -> first;
-
-  return min_vertex_cost;
+  // Heap queue implementation of this:
+  return tree.QV2.top_key();
 }
 
 
@@ -1673,11 +1591,8 @@ double CBITPlanner::BestEdgeQueueValue()
   }
   */
 
-  // Using multimaps to accomplish the same thing:
-  std::multimap<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>::iterator itr = tree.QE2.begin();
-  double min_edge_cost = itr -> first;
-    
-  return min_edge_cost;
+  // Using the heap queue to accomplish the same thing:
+  return tree.QE2.top_key();
 }
 
 
@@ -1692,6 +1607,7 @@ std::shared_ptr<Node> CBITPlanner::BestInVertexQueue()
   if (tree.QV2.size() == 0)
   {
     CLOG(INFO, "path_planning.cbit_planner") << "Vertex Queue is Empty, Something went Wrong!";
+    return nullptr;
   }
 
 
@@ -1718,11 +1634,8 @@ std::shared_ptr<Node> CBITPlanner::BestInVertexQueue()
   */
 
 
-  // New multimap implementation of this:
-  std::multimap<double, std::shared_ptr<Node>>::iterator itr = tree.QV2.begin();
-  std::shared_ptr<Node> best_vertex = itr -> second;
-  double min_vertex_cost = itr -> first;
-  tree.QV2.erase(itr);
+  // Heap queue implementation of this:
+  std::shared_ptr<Node> best_vertex = tree.QV2.pop();
 
   return best_vertex;
 }
@@ -1732,13 +1645,13 @@ std::shared_ptr<Node> CBITPlanner::BestInVertexQueue()
 void CBITPlanner::ExpandVertex(std::shared_ptr<Node> v)
 {
   // Note its easier in c++ to remove the vertex from the queue in the bestinvertexqueue function instead
-  // Find nearby samples and filter by heuristic potential
-  for (int i = 0; i < samples.size(); i++)
+  // Find nearby samples (using the spatial grid of the sample set) and filter by heuristic potential
+  samples.radius_search(v->p, v->q, conf.initial_exp_rad, [&](const std::shared_ptr<Node>& sample)
   {
-    if ((calc_dist(*samples[i], *v) <= conf.initial_exp_rad) && ((g_estimated_admissible(*v, *p_start) + calc_weighted_dist(*v, *samples[i], conf.alpha) + h_estimated_admissible(*samples[i], *p_goal)) <= p_goal->g_T_weighted))
+    if ((g_estimated_admissible(*v, *p_start) + calc_weighted_dist(*v, *sample, conf.alpha) + h_estimated_admissible(*sample, *p_goal)) <= p_goal->g_T_weighted)
     {
-      samples[i]->g_T = INFINITY;
-      samples[i]->g_T_weighted = INFINITY;
+      sample->g_T = INFINITY;
+      sample->g_T_weighted = INFINITY;
 
       // copying method
       //std::shared_ptr<Node> v_copy = v; 
@@ -1746,11 +1659,11 @@ void CBITPlanner::ExpandVertex(std::shared_ptr<Node> v)
       //tree.QE.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> (v_copy, x_copy));
 
       // direct method
-      //tree.QE.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (samples[i])});
-      tree.QE2.insert(std::pair<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>((v->g_T_weighted + calc_weighted_dist(*v,*samples[i],conf.alpha) + h_estimated_admissible(*samples[i], *p_goal)), std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (samples[i])}));
+      //tree.QE.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (sample)});
+      tree.QE2.push((v->g_T_weighted + calc_weighted_dist(*v,*sample,conf.alpha) + h_estimated_admissible(*sample, *p_goal)), std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (sample)});
 
     }
-  }
+  });
 
   // I found the below code, while does follow the original algorithm, tends not to hurt compute performance
   // yet allows the pre-seeded samples to much much better in subsequent iterations
@@ -1768,36 +1681,22 @@ void CBITPlanner::ExpandVertex(std::shared_ptr<Node> v)
   */
   
 
-  // find nearby vertices and filter by heuristic potential
-  for (int i = 0; i < tree.V.size(); i++)
+  // find nearby vertices (using the spatial grid of the tree) and filter by heuristic potential
+  tree.V.radius_search(v->p, v->q, conf.initial_exp_rad, [&](const std::shared_ptr<Node>& vertex)
   {
-    //auto test1 = calc_dist(*tree.V[i], *v);
-    //auto test2 = (g_estimated(*v, *p_start, conf.alpha) + calc_weighted_dist(*v, *tree.V[i], conf.alpha) + h_estimated(*tree.V[i], *p_goal, conf.alpha));
-    //auto test3 = (v->g_T_weighted + calc_weighted_dist(*v, *tree.V[i], conf.alpha));
-    if ((calc_dist(*tree.V[i], *v) <= conf.initial_exp_rad) && ((g_estimated_admissible(*v, *p_start) + calc_weighted_dist(*v, *tree.V[i], conf.alpha) + h_estimated_admissible(*tree.V[i], *p_goal)) < p_goal->g_T_weighted) && ((v->g_T_weighted + calc_weighted_dist(*v, *tree.V[i], conf.alpha)) < tree.V[i]->g_T_weighted))
+    if (((g_estimated_admissible(*v, *p_start) + calc_weighted_dist(*v, *vertex, conf.alpha) + h_estimated_admissible(*vertex, *p_goal)) < p_goal->g_T_weighted) && ((v->g_T_weighted + calc_weighted_dist(*v, *vertex, conf.alpha)) < vertex->g_T_weighted))
     {
-      if (edge_in_tree_v2(v, tree.V[i]) == false)
+      if (edge_in_tree_v2(v, vertex) == false)
       {
         // If all conditions satisfied, add the edge to the queue
-        //tree.V[i]->g_T = INFINITY; // huh actually looking at this again, im not sure if I should be doing this (yeah I think was a mistake)
-        //tree.V[i]->g_T_weighted = INFINITY; // huh actually looking at this again, im not sure if I should be doing this (yeah I think its a mistake)
-        //tree.QE.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (tree.V[i])});
-        tree.QE2.insert(std::pair<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>((v->g_T_weighted + calc_weighted_dist(*v,*tree.V[i],conf.alpha) + h_estimated_admissible(*tree.V[i], *p_goal)), std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (tree.V[i])}));
+        //vertex->g_T = INFINITY; // huh actually looking at this again, im not sure if I should be doing this (yeah I think was a mistake)
+        //vertex->g_T_weighted = INFINITY; // huh actually looking at this again, im not sure if I should be doing this (yeah I think its a mistake)
+        //tree.QE.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (vertex)});
+        tree.QE2.push((v->g_T_weighted + calc_weighted_dist(*v,*vertex,conf.alpha) + h_estimated_admissible(*vertex, *p_goal)), std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (vertex)});
 
       }
-      /*
-      // Also check whether the edge is in the tree or not
-      if (edge_in_tree(*v, *tree.V[i]) == false)
-      {
-        // If all conditions satisfied, add the edge to the queue
-        //tree.V[i]->g_T = INFINITY; //I think these two lines were a mistake, should not be here
-        //tree.V[i]->g_T_weighted = INFINITY; //I think these two lines were a mistake, should not be here
-        tree.QE.push_back(std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (tree.V[i])});
-        //tree.QE2.insert(std::pair<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>((v->g_T_weighted + calc_weighted_dist(*v,*tree.V[i],conf.alpha) + h_estimated_admissible(*tree.V[i], *p_goal)), std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> {(v), (tree.V[i])}));
-
-      */
     } 
-  }
+  });
 }
 
 
@@ -1841,11 +1740,8 @@ std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> CBITPlanner::BestInEdge
   return {v,x};
   */
 
-  // Equivalent code using multimaps:
-  std::multimap<double, std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>>>::iterator itr = tree.QE2.begin();
-  double min_edge_cost = itr -> first;
-  std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> edge_tuple = itr -> second;
-  tree.QE2.erase(itr);
+  // Equivalent code using the heap queue:
+  std::tuple<std::shared_ptr<Node>, std::shared_ptr<Node>> edge_tuple = tree.QE2.pop();
   return edge_tuple;
 }
 
@@ -1917,8 +1813,8 @@ std::vector<Pose>  CBITPlanner::ExtractEuclidPath()
   std::vector<double> path_q;
 
   // experimental, for grabing the yaw value from the teach path
-  std::vector<double> p = global_path->p;
-  std::vector<Pose> disc_path = global_path->disc_path;
+  const std::vector<double>& p = global_path->p;
+  const std::vector<Pose>& disc_path = global_path->disc_path;
   // End of experimental
 
   std::vector<Node> node_list = {node};
@@ -1959,10 +1855,12 @@ std::vector<Pose>  CBITPlanner::ExtractEuclidPath()
       }
     }
 
-    // Once we have built the discretized vectors, loop through them, convert each point to Euclidean space and store it in the Euclidean path vector
+    // Once we have built the discretized vectors, convert them to Euclidean space and store each point in the Euclidean path vector
+    std::vector<Node> euclid_disc;
+    global_path->curve_to_euclid(p_disc, q_disc, euclid_disc);
     for (int i=0; i < p_disc.size(); i ++)
     {
-      Node euclid_pt = curve_to_euclid(Node(p_disc[i], q_disc[i]));
+      Node euclid_pt = euclid_disc[i];
       path_x.push_back(euclid_pt.p);
       path_y.push_back(euclid_pt.q);
       path_z.push_back(euclid_pt.z);
@@ -2254,19 +2152,10 @@ bool CBITPlanner::edge_in_tree(Node v, Node x)
   return false;
 }
 // Function which takes in a beginning vertex v, and an end vertex x, and checks whether its in the tree or not already
-// This version uses address matching (safer)
+// This version uses address matching (safer), and only looks at the edges ending at x using the edge index of the tree
 bool CBITPlanner::edge_in_tree_v2(std::shared_ptr<Node> v, std::shared_ptr<Node> x)
 {
-  int edges_size = tree.E.size();
-  for (int i = 0; i < edges_size; i++ )
-  {
-    // Alternative way to do this using node addresses
-    if ((std::get<0>(tree.E[i]) == v) && (std::get<1>(tree.E[i]) == x))
-    {
-      return true;
-    }
-  }
-  return false;
+  return tree.E.contains(v, x);
 }
 
 
@@ -2289,19 +2178,10 @@ bool CBITPlanner::node_in_tree(Node x)
 }
 
 // Function for checking whether a node lives in the Vertex tree, updated to use address matching (safer)
+// Membership is stored on the node itself, so this is constant time
 bool CBITPlanner::node_in_tree_v2(std::shared_ptr<Node>  x)
 {
-  int vertices_size = tree.V.size();
-  for (int i = 0; i < vertices_size; i++ )
-  {
-      
-    if (x == tree.V[i])
-    {
-        return true;
-    }
-  }
-  return false;
-  
+  return tree.V.contains(x);
 }
 
 
@@ -2330,21 +2210,8 @@ double CBITPlanner::weighted_cost_col(std::vector<std::vector<double>> obs, Node
 // Function for converting a p,q coordinate value into a euclidean coordinate using the pre-processed path to follow
 Node CBITPlanner::curve_to_euclid(Node node)
 {
-  double p_val = node.p;
-  double q_val = node.q;
-  int p_ind =  bisection(global_path->p, p_val);
-
-  // Linearly interpolate a Euclidean Pose using the euclidean path and the relative p_val,q_val
-  // TODO: need to use steam or lgmath se(3) classes for these poses, for now just using a vector
-  Pose pose_c = lin_interpolate(p_ind, p_val);
-
-  double x_i = pose_c.x - sin(pose_c.yaw)*q_val;
-  double y_i = pose_c.y + cos(pose_c.yaw)*q_val;
-
-  // Experimental, also interpolate the z value
-  double z_i = pose_c.z; //+ cos(pose_c.yaw)*q_val; // I think here we just want to set the z to whatever the pose_c.z value
-
-  return Node(x_i,y_i,z_i);
+  // The path finds the segment from its lookup table and linearly interpolates the pose (see CBITPath::curve_to_euclid)
+  return global_path->curve_to_euclid(node);
 }
 
 Pose CBITPlanner::lin_interpolate(int p_ind, double p_val)
@@ -2407,49 +2274,11 @@ bool CBITPlanner::is_inside_obs(std::vector<std::vector<double>> obs, Node node)
 
 // This collision check is only used at the end of each batch and determines whether the path should be rewired using the bare minimum obstacle distance
 // Under normal operation we plan paths around a slightly more conservative buffer around each obstacle (equal to influence dist + min dist)
+// I am no longer temporally filtering here, instead this takes place in the costmap itself in the change detection module
 bool CBITPlanner::costmap_col_tight(Node node)
 {
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Original Node: x: " << node.p << " y: " << node.q << " z: " << node.z;
-  Eigen::Matrix<double, 4, 1> test_pt({node.p, node.q, node.z, 1});
-
-  // I am no longer temporally filtering here, instead this takes place in the costmap itself in the change detection module
-  // This means the costmap and transform size should never be more than 1
-  //for (int i = 0; i < cbit_costmap_ptr->T_c_w_vect.size(); i++)
-  //{
-
-
-  auto collision_pt = cbit_costmap_ptr->T_c_w * test_pt;
-
-  // Round the collision point x and y values down to the nearest grid resolution so that it can be found in the obstacle unordered_map
-  float x_key = floor(collision_pt[0] / cbit_costmap_ptr->grid_resolution) * cbit_costmap_ptr->grid_resolution;
-  float y_key = floor(collision_pt[1] / cbit_costmap_ptr->grid_resolution) * cbit_costmap_ptr->grid_resolution;
-
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "X_key:  " << x_key;
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Y_key:  " << y_key;
-
-  float grid_value;
-
-  // Check to see if the point is in the obstacle map
-  // We need to use a try/catch in this metod as if the key value pair doesnt exist (it usually wont) we catch an out of range error
-  try 
-  {
-  // Block of code to try
-    grid_value = cbit_costmap_ptr->obs_map.at(std::pair<float, float> (x_key, y_key));
-    //CLOG(ERROR, "path_planning.cbit_planner") << "Key Value:  " << grid_value;
-  }
-  catch (std::out_of_range) 
-  {
-    grid_value = 0.0;
-  }
-
-  if (grid_value >= 0.89) // By switching this from > 0.0 to 0.9, we effectively only collision check the path out to the "minimum_distance" obs config param
-  {
-    return true;
-  }
-  //}
-
-  // If we make it here can return false for no collision
-  return false;
+  // Lookup in the dense obstacle grid of the costmap (value >= 0.89), this effectively only collision checks the path out to the "minimum_distance" obs config param
+  return cbit_costmap_ptr->collision(node, true);
 }
 
 
@@ -2457,52 +2286,8 @@ bool CBITPlanner::costmap_col_tight(Node node)
 // More conservative costmap checking out to a distance of "influence_distance" + "minimum_distance" away
 bool CBITPlanner::costmap_col(Node node)
 {
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Original Node: x: " << node.p << " y: " << node.q << " z: " << node.z;
-  Eigen::Matrix<double, 4, 1> test_pt({node.p, node.q, node.z, 1});
-  // I am no longer temporally filtering here, instead this takes place in the costmap itself in the change detection module
-  // This means the costmap and transform size should never be more than 1
-  //for (int i = 0; i < cbit_costmap_ptr->T_c_w_vect.size(); i++)
-  //{
-
-  //auto collision_pt = cbit_costmap_ptr->T_c_w * test_pt;
-  auto collision_pt = cbit_costmap_ptr->T_c_w * test_pt;
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Displaying the point in the costmap frame we are trying to collision check: " << collision_pt;
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "X:  " << collision_pt[0];
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Y:  " << collision_pt[1];
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Resolution:  " << cbit_costmap_ptr->grid_resolution;
-
-
-  // Round the collision point x and y values down to the nearest grid resolution so that it can be found in the obstacle unordered_map
-  float x_key = floor(collision_pt[0] / cbit_costmap_ptr->grid_resolution) * cbit_costmap_ptr->grid_resolution;
-  float y_key = floor(collision_pt[1] / cbit_costmap_ptr->grid_resolution) * cbit_costmap_ptr->grid_resolution;
-
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "X_key:  " << x_key;
-  //CLOG(DEBUG, "path_planning.cbit_planner") << "Y_key:  " << y_key;
-
-  float grid_value;
-
-  // Check to see if the point is in the obstacle map
-  // If it isnt in the map we will catch an out of range error
-  try 
-  {
-      grid_value = cbit_costmap_ptr->obs_map.at(std::pair<float, float> (x_key, y_key));
-      //CLOG(DEBUG, "debug") << " The Grid value for this cell is: " << grid_value;
-  }
-  
-  catch (std::out_of_range) 
-  {
-
-    grid_value = 0.0;
-  }
-
-  if (grid_value > 0.0)
-    {
-      return true;
-    }
-
-  //}
-  // If we make it here, return false for no collision
-  return false;
+  // Lookup in the dense obstacle grid of the costmap (value > 0.0)
+  return cbit_costmap_ptr->collision(node, false);
 }
 
 
@@ -2533,15 +2318,15 @@ bool CBITPlanner::discrete_collision(std::vector<std::vector<double>> obs, doubl
 
 
     // Loop through the test curvilinear points, convert to euclid, collision check obstacles
+    // The edge checker sweeps the points through the obstacle grid, skipping lookups for repeated cells and known free space
+    CBITCostmap::EdgeChecker edge_checker(*cbit_costmap_ptr, false);
+    std::vector<Node> euclid_test;
+    global_path->curve_to_euclid(p_test, q_test, euclid_test);
     for (int i = 0; i < p_test.size(); i++)
     {
-        Node curv_pt = Node(p_test[i], q_test[i]);
-
-        // Convert to euclid TODO:
-        //Node euclid_pt = curv_pt; // DEBUG DO NOT LEAVE THIS HERE, NEED TO REPLACE WITH COLLISION CHECK FUNCTION
-        Node euclid_pt = curve_to_euclid(curv_pt);
+        Node euclid_pt = euclid_test[i];
         //if (is_inside_obs(obs, euclid_pt))
-        if (costmap_col(euclid_pt))
+        if (edge_checker.collision(euclid_pt))
         {
             return true;
         }
@@ -2585,28 +2370,18 @@ struct CBITPlanner::collision_result CBITPlanner::discrete_collision_v2(double d
 
 
     // Loop through the test curvilinear points, convert to euclid, collision check obstacles
+    CBITCostmap::EdgeChecker edge_checker(*cbit_costmap_ptr, tight);
+    std::vector<Node> euclid_test;
+    global_path->curve_to_euclid(p_test, q_test, euclid_test);
     Node curv_pt;
     for (int i = 0; i < p_test.size(); i++)
     {
         curv_pt = Node(p_test[i], q_test[i]);
-
-        // Convert to euclid TODO:
-        //Node euclid_pt = curv_pt; // DEBUG DO NOT LEAVE THIS HERE, NEED TO REPLACE WITH COLLISION CHECK FUNCTION
-        Node euclid_pt = curve_to_euclid(curv_pt);
+        Node euclid_pt = euclid_test[i];
         //if (is_inside_obs(obs, euclid_pt))
-        if (tight == false)
+        if (edge_checker.collision(euclid_pt))
         {
-          if (costmap_col(euclid_pt))
-          {
-            return {true, curv_pt};
-          }
-        }
-        else
-        {
-          if (costmap_col_tight(euclid_pt))
-          {
-            return {true, curv_pt};
-          }
+          return {true, curv_pt};
         }
 
     }
@@ -22,7 +22,7 @@ void initialize_plot()
 
 // Function for plotting all the edges in the current tree (Called at the conclusion of each batch)
 // Note this will also get triggered following state updates and repairs as well
-void plot_tree(Tree tree, Node robot_pq, std::vector<double> path_p, std::vector<double> path_q, std::vector<std::shared_ptr<Node>> samples)
+void plot_tree(const Tree& tree, Node robot_pq, std::vector<double> path_p, std::vector<double> path_q, const NodeSet& samples)
 {
     // Clear the figure
     matplotlibcpp::clf();
@@ -65,6 +65,8 @@ CBITPath::CBITPath(CBITConfig config, std::vector<Pose> initial_path)
     // TODO: Generate Radius of Curvature Wormhole regions 
 
 
+    // Lookup table for the p,q to euclidean conversions
+    build_euclid_lut();
 
     CLOG(INFO, "path_planning.cbit") << "Successfully Built a Path in generate_pq.cpp and Displayed log";
     
@@ -82,6 +84,156 @@ Pose CBITPath::interp_pose(double p_in)
     return interpolated_pose;
 }
 
+// Precomputes the interpolation terms of each path segment and the uniform p grid used to find the segment of a p value
+void CBITPath::build_euclid_lut()
+{
+    segments.clear();
+    segment_lut.clear();
+    const int num_poses = std::min(p.size(), path.size());
+    if (num_poses < 2)
+    {
+        return;
+    }
+
+    segments.reserve(num_poses - 1);
+    for (int i = 0; i < num_poses - 1; i++)
+    {
+        const Pose& start_pose = path[i];
+        const Pose& end_pose = path[i + 1];
+        Segment segment;
+        segment.p_lower = p[i];
+        segment.p_upper = p[i + 1];
+        segment.x = start_pose.x;
+        segment.y = start_pose.y;
+        segment.z = start_pose.z;
+        segment.yaw = start_pose.yaw;
+        segment.dx = end_pose.x - start_pose.x;
+        segment.dy = end_pose.y - start_pose.y;
+        segment.dz = end_pose.z - start_pose.z;
+        // For yaw need to be very careful of angle wrap around problem (same as the original lin_interpolate)
+        segment.dyaw = std::fmod((std::fmod((end_pose.yaw - start_pose.yaw),(2.0*M_PI)) + (3.0*M_PI)),(2.0*M_PI)) - M_PI;
+        segments.push_back(segment);
+    }
+
+    // Two bins per segment on average, so a lookup only has to step over a segment or two
+    const int num_bins = 2 * segments.size();
+    lut_p_min = p[0];
+    const double bin_width = (p[num_poses - 1] - p[0]) / num_bins;
+    lut_inv_bin_width = (bin_width > 0.0) ? (1.0 / bin_width) : 0.0;
+    segment_lut.resize(num_bins);
+    int segment_ind = 0;
+    for (int k = 0; k < num_bins; k++)
+    {
+        const double bin_p = lut_p_min + k * bin_width;
+        while ((segment_ind + 1 < static_cast<int>(segments.size())) && (segments[segment_ind + 1].p_lower <= bin_p))
+        {
+            segment_ind++;
+        }
+        segment_lut[k] = segment_ind;
+    }
+}
+
+// Index i of the segment with p[i] <= p_val < p[i+1] (the same segment bisection finds), p values below the path use the first segment
+int CBITPath::segment_index(double p_val) const
+{
+    const int num_segments = segments.size();
+    int k = static_cast<int>((p_val - lut_p_min) * lut_inv_bin_width);
+    k = std::max(0, std::min(k, static_cast<int>(segment_lut.size()) - 1));
+    int segment_ind = segment_lut[k];
+    while ((segment_ind + 1 < num_segments) && (segments[segment_ind + 1].p_lower <= p_val))
+    {
+        segment_ind++;
+    }
+    // Only needed when rounding put p_val in the bin after its own
+    while ((segment_ind > 0) && (segments[segment_ind].p_lower > p_val))
+    {
+        segment_ind--;
+    }
+    return segment_ind;
+}
+
+Node CBITPath::segment_to_euclid(int segment_ind, double p_val, double q_val) const
+{
+    double x_c, y_c, z_c, yaw_c;
+    if (segment_ind < 0) // if p_val is at or past the max (goal p) then use the final euclid pose
+    {
+        const Pose& end_pose = path[path.size() - 1];
+        x_c = end_pose.x;
+        y_c = end_pose.y;
+        z_c = end_pose.z;
+        yaw_c = end_pose.yaw;
+    }
+    else
+    {
+        const Segment& segment = segments[segment_ind];
+        const double t = (p_val - segment.p_lower) / (segment.p_upper - segment.p_lower);
+        x_c = segment.x + t * segment.dx;
+        y_c = segment.y + t * segment.dy;
+        z_c = segment.z + t * segment.dz;
+        yaw_c = segment.yaw + t * segment.dyaw;
+    }
+
+    double x_i = x_c - sin(yaw_c)*q_val;
+    double y_i = y_c + cos(yaw_c)*q_val;
+
+    // The z value is the interpolated path z
+    return Node(x_i, y_i, z_c);
+}
+
+Node CBITPath::curve_to_euclid(const Node& node) const
+{
+    if (segments.empty() || (node.p >= segments.back().p_upper))
+    {
+        return segment_to_euclid(-1, node.p, node.q);
+    }
+    return segment_to_euclid(segment_index(node.p), node.p, node.q);
+}
+
+void CBITPath::curve_to_euclid(const std::vector<double>& p_in, const std::vector<double>& q_in, std::vector<Node>& euclid_out) const
+{
+    const int num_points = p_in.size();
+    euclid_out.resize(num_points);
+    if (segments.empty())
+    {
+        for (int i = 0; i < num_points; i++)
+        {
+            euclid_out[i] = segment_to_euclid(-1, p_in[i], q_in[i]);
+        }
+        return;
+    }
+
+    const double p_max = segments.back().p_upper;
+    const int num_segments = segments.size();
+    auto in_segment = [&](int segment_ind, double p_val)
+    {
+        return (segment_ind >= 0) && (segment_ind < num_segments) && (segments[segment_ind].p_lower <= p_val) && (p_val < segments[segment_ind].p_upper);
+    };
+
+    int segment_ind = -1;
+    for (int i = 0; i < num_points; i++)
+    {
+        const double p_val = p_in[i];
+        if (p_val >= p_max)
+        {
+            euclid_out[i] = segment_to_euclid(-1, p_val, q_in[i]);
+            continue;
+        }
+        // Points along an edge are close together, so first try the segment of the previous point and the next one
+        if (!in_segment(segment_ind, p_val))
+        {
+            if ((segment_ind >= 0) && in_segment(segment_ind + 1, p_val))
+            {
+                segment_ind++;
+            }
+            else
+            {
+                segment_ind = segment_index(p_val);
+            }
+        }
+        euclid_out[i] = segment_to_euclid(segment_ind, p_val, q_in[i]);
+    }
+}
+
 // Calculating the distance between se(3) poses including a heading contribution
 double CBITPath::delta_p_calc(Pose start_pose, Pose end_pose, double alpha)
 {
@@ -294,7 +294,7 @@ Pose lin_interpolate2(int p_ind, double p_val)
 // Function for quickly finding the index j for the value in a sorted vector which is immediately below the function value.
 // in curve_to_euclid we use this function to efficiently find the index of the euclidean se(3) pose stored in the discrete path which
 // immediately preceders the current p,q point we are trying to convert back to euclidean.
-int bisection(std::vector<double> array, double value)
+int bisection(const std::vector<double>& array, double value)
 {
     int n = array.size();
     if (value < array[0])
@@ -417,4 +417,241 @@ Node curve_to_euclid(Node node, std::shared_ptr<Path> global_path)
   double y_i = pose_c.y + cos(pose_c.yaw)*q_val;
   return Node(x_i,y_i);
 }
-*/
\ No newline at end of file
+*/
+
+// NodeSet
+NodeSet& NodeSet::operator=(const std::vector<std::shared_ptr<Node>>& nodes)
+{
+    clear();
+    reserve(nodes.size());
+    for (const auto& node : nodes)
+    {
+        push_back(node);
+    }
+    return *this;
+}
+
+void NodeSet::set_cell_size(double cell_size)
+{
+    cell_size_ = cell_size;
+    grid_.clear();
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+        add_to_grid(i);
+    }
+}
+
+bool NodeSet::contains(const std::shared_ptr<Node>& node) const
+{
+    const int slot = node->set_index[id_];
+    return (slot >= 0) && (slot < static_cast<int>(nodes_.size())) && (nodes_[slot] == node);
+}
+
+bool NodeSet::push_back(const std::shared_ptr<Node>& node)
+{
+    if (contains(node))
+    {
+        return false;
+    }
+    node->set_index[id_] = nodes_.size();
+    nodes_.push_back(node);
+    cells_.push_back(Cell{0, -1});
+    add_to_grid(nodes_.size() - 1);
+    return true;
+}
+
+void NodeSet::insert(const std::vector<std::shared_ptr<Node>>& nodes)
+{
+    for (const auto& node : nodes)
+    {
+        push_back(node);
+    }
+}
+
+bool NodeSet::erase(const std::shared_ptr<Node>& node)
+{
+    if (!contains(node))
+    {
+        return false;
+    }
+    // Swap the last node into the freed slot
+    const size_t slot = node->set_index[id_];
+    const size_t last = nodes_.size() - 1;
+    remove_from_grid(slot);
+    node->set_index[id_] = -1;
+    if (slot != last)
+    {
+        move_slot(last, slot);
+    }
+    nodes_.pop_back();
+    cells_.pop_back();
+    return true;
+}
+
+void NodeSet::clear()
+{
+    for (const auto& node : nodes_)
+    {
+        node->set_index[id_] = -1;
+    }
+    nodes_.clear();
+    cells_.clear();
+    grid_.clear();
+}
+
+void NodeSet::add_to_grid(size_t slot)
+{
+    const int64_t key = cell_key(cell_coord(nodes_[slot]->p), cell_coord(nodes_[slot]->q));
+    std::vector<int>& bucket = grid_[key];
+    cells_[slot] = Cell{key, static_cast<int>(bucket.size())};
+    bucket.push_back(slot);
+}
+
+void NodeSet::remove_from_grid(size_t slot)
+{
+    // The bucket is keyed by the position at insertion so this stays consistent even if the node was moved since
+    auto bucket = grid_.find(cells_[slot].key);
+    std::vector<int>& slots = bucket->second;
+    const int pos = cells_[slot].pos;
+    slots[pos] = slots.back();
+    cells_[slots[pos]].pos = pos;
+    slots.pop_back();
+    if (slots.empty())
+    {
+        grid_.erase(bucket);
+    }
+}
+
+void NodeSet::move_slot(size_t from, size_t to)
+{
+    nodes_[to] = std::move(nodes_[from]);
+    cells_[to] = cells_[from];
+    nodes_[to]->set_index[id_] = to;
+    grid_[cells_[to].key][cells_[to].pos] = to;
+}
+
+
+// EdgeSet
+EdgeSet& EdgeSet::operator=(const std::vector<Edge>& edges)
+{
+    clear();
+    reserve(edges.size());
+    for (const auto& edge : edges)
+    {
+        push_back(edge);
+    }
+    return *this;
+}
+
+void EdgeSet::push_back(const Edge& edge)
+{
+    end_index_.emplace(std::get<1>(edge).get(), edges_.size());
+    edges_.push_back(edge);
+}
+
+bool EdgeSet::contains(const std::shared_ptr<Node>& v, const std::shared_ptr<Node>& x) const
+{
+    auto range = end_index_.equal_range(x.get());
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (std::get<0>(edges_[it->second]) == v)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EdgeSet::erase_to(const std::shared_ptr<Node>& x)
+{
+    auto it = end_index_.find(x.get());
+    while (it != end_index_.end())
+    {
+        erase_at(it->second);
+        it = end_index_.find(x.get());
+    }
+}
+
+void EdgeSet::clear()
+{
+    edges_.clear();
+    end_index_.clear();
+}
+
+void EdgeSet::erase_at(size_t i)
+{
+    // Drops the index entry of edge i, then swaps the last edge into its place and re-indexes it
+    auto find_entry = [this](size_t index)
+    {
+        auto range = end_index_.equal_range(std::get<1>(edges_[index]).get());
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == index)
+            {
+                return it;
+            }
+        }
+        return end_index_.end();
+    };
+
+    end_index_.erase(find_entry(i));
+    const size_t last = edges_.size() - 1;
+    if (i != last)
+    {
+        find_entry(last)->second = i;
+        edges_[i] = std::move(edges_[last]);
+    }
+    edges_.pop_back();
+}
+
+
+void EdgeQueue::push(double key, const Edge& edge)
+{
+    Node& x = *std::get<1>(edge);
+    const Handle old_head = head(x);
+    const Handle h = heap_.push(key, edge);
+    if (h >= static_cast<Handle>(links_.size()))
+    {
+        links_.resize(h + 1);
+    }
+    links_[h].prev = -1;
+    links_[h].next = old_head;
+    if (old_head != -1)
+    {
+        links_[old_head].prev = h;
+    }
+    x.edge_queue_head = h;
+}
+
+EdgeQueue::Edge EdgeQueue::pop()
+{
+    unlink(heap_.top_handle());
+    return heap_.pop();
+}
+
+EdgeQueue::Handle EdgeQueue::head(const Node& x) const
+{
+    const Handle h = x.edge_queue_head;
+    if (heap_.contains(h) && (std::get<1>(heap_.item(h)).get() == &x))
+    {
+        return h;
+    }
+    return -1;
+}
+
+void EdgeQueue::unlink(Handle h)
+{
+    const Link link = links_[h];
+    if (link.prev != -1)
+    {
+        links_[link.prev].next = link.next;
+    }
+    else
+    {
+        std::get<1>(heap_.item(h))->edge_queue_head = link.next;
+    }
+    if (link.next != -1)
+    {
+        links_[link.next].prev = link.prev;
+    }
+}
@@ -0,0 +1,111 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file horizon_solver.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#include "vtr_path_planning/mpc/horizon_solver.hpp"
+
+#include "vtr_logging/logging.hpp"
+
+namespace vtr {
+namespace path_planning {
+
+HorizonGaussNewtonSolver::HorizonGaussNewtonSolver(
+    steam::OptimizationProblem& problem, const Params& params)
+    : problem_(problem),
+      params_(params),
+      state_vector_(problem.getStateVector()) {
+  state_vector_backup_ = state_vector_->clone();
+  curr_cost_ = prev_cost_ = problem_.cost();
+}
+
+void HorizonGaussNewtonSolver::optimize() {
+  while (true) {
+    // same termination checks (and order) as steam::SolverBase
+    if (curr_iteration_ >= params_.max_iterations) {
+      if (params_.verbose)
+        CLOG(INFO, "mpc.cbit") << "Horizon solver: reached max iterations";
+      return;
+    }
+    if (std::chrono::steady_clock::now() >= params_.deadline) {
+      if (params_.verbose)
+        CLOG(INFO, "mpc.cbit") << "Horizon solver: reached the deadline";
+      return;
+    }
+    ++curr_iteration_;
+    prev_cost_ = curr_cost_;
+
+    double grad_norm = 0.0;
+    const bool step_success = linearizeSolveAndUpdate(curr_cost_, grad_norm);
+
+    if (params_.verbose)
+      CLOG(INFO, "mpc.cbit")
+          << "Horizon solver iteration: " << curr_iteration_
+          << ", cost: " << curr_cost_ << ", gradient norm: " << grad_norm
+          << ", bandwidth: " << cholesky_.bandwidth();
+
+    if (!step_success && std::abs(grad_norm) < 1e-6) {
+      return;  // converged, zero gradient
+    } else if (!step_success) {
+      std::string err{"Horizon solver: unable to find a step that decreases the cost."};
+      CLOG(ERROR, "mpc.cbit") << err;
+      throw std::runtime_error(err);
+    } else if (curr_cost_ <= params_.absolute_cost_threshold) {
+      return;
+    } else if (std::abs(prev_cost_ - curr_cost_) <=
+               params_.absolute_cost_change_threshold) {
+      return;
+    } else if (std::abs(prev_cost_ - curr_cost_) / prev_cost_ <=
+               params_.relative_cost_change_threshold) {
+      return;
+    }
+  }
+}
+
+bool HorizonGaussNewtonSolver::linearizeSolveAndUpdate(double& cost,
+                                                       double& grad_norm) {
+  Eigen::SparseMatrix<double> approximate_hessian;
+  Eigen::VectorXd gradient_vector;
+  problem_.buildGaussNewtonTerms(approximate_hessian, gradient_vector);
+  grad_norm = gradient_vector.norm();
+
+  if (!cholesky_.compute(approximate_hessian)) {
+    std::string err{"Horizon solver: Hessian is not positive definite."};
+    CLOG(ERROR, "mpc.cbit") << err;
+    throw std::runtime_error(err);
+  }
+  const Eigen::VectorXd perturbation = cholesky_.solve(gradient_vector);
+
+  // Backtracking line search, a rejected step is undone by restoring the
+  // state values from before the step (same as steam, undoing it with the
+  // opposite perturbation would drift on the SE3 states)
+  state_vector_backup_.copyValues(*state_vector_);
+  double backtrack_coeff = 1.0;
+  for (unsigned int i = 0; i < params_.max_backtrack_steps; ++i) {
+    state_vector_->update(backtrack_coeff * perturbation);
+    const double proposed_cost = problem_.cost();
+    if (proposed_cost <= cost) {
+      cost = proposed_cost;
+      return true;
+    }
+    state_vector_->copyValues(state_vector_backup_);
+    backtrack_coeff *= params_.backtrack_multiplier;
+  }
+  return false;
+}
+
+}  // namespace path_planning
+}  // namespace vtr
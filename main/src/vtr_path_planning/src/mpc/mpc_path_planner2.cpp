@@ -20,6 +20,11 @@
 #include "vtr_path_planning/mpc/lateral_error_evaluators.hpp"
 #include "vtr_path_planning/mpc/custom_loss_functions.hpp"
 #include "vtr_path_planning/mpc/scalar_log_barrier_evaluator.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
 //#include "vtr_lidar/cache.hpp" // For lidar version of the planner only
 
 
@@ -30,59 +35,28 @@
 
 
 // Main MPC problem solve function - TODO: dump all these arguments into an mpc config class
+// Single shot version: builds the problem, cold starts it from the cbit solution and solves without a time budget
 struct mpc_result SolveMPC2(Eigen::Matrix<double, 2, 1> previous_vel, lgmath::se3::Transformation T0, std::vector<lgmath::se3::Transformation> measurements, std::vector<lgmath::se3::Transformation> measurements_cbit, std::vector<double> barrier_q_left, std::vector<double> barrier_q_right, int K, double DT, double VF, Eigen::Matrix<double, 1, 1> lat_noise_vect, Eigen::Matrix<double, 6, 6> pose_noise_vect, Eigen::Matrix<double, 2, 2> vel_noise_vect, Eigen::Matrix<double, 2, 2> accel_noise_vect, Eigen::Matrix<double, 6, 6> kin_noise_vect, bool point_stabilization, double pose_error_weight, double vel_error_weight, double acc_error_weight, double kin_error_weight, double lat_error_weight)
 {
-    
-    // Pre-process the measurements to correct the cbit path yaw values depending on if the robot should be moving in forward or reverse
-    //Eigen::Matrix<double, 4, 4> T_ROT_YAW;
-    //T_ROT_YAW << -1, 0, 0, 0,
-    //            0, -1, 0, 0,
-    //            0, 0, 1, 0,
-    //            0, 0, 0, 1;
-    //lgmath::se3::Transformation T_ROT_YAW2(T_ROT_YAW);
-    //CLOG(ERROR, "mpc_debug.cbit") << "THE PI ROTATION MATRIX IS: " << T_ROT_YAW2;
-
-    //for (int i = 0; i < measurements_cbit.size(); i++)
-    //{
-    //  auto test1 = measurements[i].matrix().block(0, 0, 3, 3);
-    //  auto test2 = measurements_cbit[i].matrix().block<3, 1>(0, 3);
-    //  CLOG(ERROR, "mpc_debug.cbit") << "TEST2 IS: " << test2;
-    //  auto cbit_pose = measurements_cbit[i].matrix().block(0, 0, 3, 3);
-    //  auto teach_pose = measurements[i].matrix().block(0, 0, 3, 3);
-    //  CLOG(ERROR, "mpc_debug.cbit") << "THE CBIT MATRIX IS: " << measurements_cbit[i];
-    //  CLOG(ERROR, "mpc_debug.cbit") << "THE TEACH MATRIX IS: " << measurements[i];
-      //measurements_cbit[i] = measurements[i];
-    //  lgmath::se3::Transformation new_meas_cbit(test1,test2);
-    //  measurements_cbit[i] = new_meas_cbit;
-
-    //  CLOG(ERROR, "mpc_debug.cbit") << "THE ROTATED CBIT MATRIX IS: " << measurements_cbit[i];
-      //auto rel_pose = teach_pose.transpose() * cbit_pose;
-      //CLOG(ERROR, "mpc_debug.cbit") << "THE CBIT ROTATION MATRIX IS: " << cbit_pose;
-      //CLOG(ERROR, "mpc_debug.cbit") << "THE TEACH ROTATION MATRIX IS: " << teach_pose;
-      //CLOG(ERROR, "mpc_debug.cbit") << "THE RELATIVE ROTATION MATRIX IS: " << teach_pose.transpose() * cbit_pose;
-      //double relative_yaw = atan2(rel_pose(1,0),rel_pose(0,0));
-      //CLOG(ERROR, "mpc_debug.cbit") << "THE RELATIVE YAW IS: " << relative_yaw;
-      //if (fabs(relative_yaw) >= 1.57075)
-      //{
-      //  measurements_cbit[i] = measurements_cbit[i] * T_ROT_YAW2;
-      //  CLOG(ERROR, "mpc_debug.cbit") << "CORRECTED THE YAW";
-      //}
-      //CLOG(ERROR, "mpc_debug.cbit") << "THE ROTATED CBIT MATRIX IS: " << measurements_cbit[i];
-    //}
-    // End of pre-pre-processing measurement rotations
-
-
-
-    // Conduct an MPC Iteration given current configurations
-
-    // Velocity set-points (desired forward velocity and angular velocity), here we set a static forward target velocity, and try to minimize rotations (0rad/sec)
-    Eigen::Matrix<double, 2, 1> v_ref;
-    v_ref << VF,
-                0;
-
-
-    // Kinematic projection Matrix for Unicycle Model (note its -1's because our varpi lie algebra vector is of a weird frame)
-    // TODO, make the choice of projection matrix a configurable param for the desired vehicle model.
+    CorridorMPC mpc;
+    return mpc.Solve(previous_vel, T0, measurements, measurements_cbit, barrier_q_left, barrier_q_right, K, DT, VF, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, point_stabilization, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight, std::numeric_limits<double>::infinity());
+}
+
+
+namespace
+{
+// Maximum number of solver iterations per control cycle, the time budget can only lower it
+constexpr int mpc_max_iterations = 100;
+// Number of recent solves kept for the solve time distribution and how often it is logged
+constexpr size_t mpc_solve_time_window = 500;
+constexpr int mpc_report_period = 100;
+// Weight of a new sample in the moving average of the per iteration solve time
+constexpr double mpc_iteration_time_smoothing = 0.2;
+
+// Kinematic projection Matrix for Unicycle Model (note its -1's because our varpi lie algebra vector is of a weird frame)
+// TODO, make the choice of projection matrix a configurable param for the desired vehicle model.
+Eigen::Matrix<double, 6, 2> UnicycleProjection()
+{
     Eigen::Matrix<double, 6, 2> P_tran;
     P_tran << -1, 0,
                 0, 0,
@@ -90,103 +64,276 @@ struct mpc_result SolveMPC2(Eigen::Matrix<double, 2, 1> previous_vel, lgmath::se
                 0, 0,
                 0, 0,
                 0, -1;
+    return P_tran;
+}
 
-    // Lateral constraint projection matrices (Experimental)
-    Eigen::Matrix<double, 3, 1> I_4; // In steam, the homopoint vars automatically add the 4th row 1, so representing I_4 just needs the 3 zeros
-    I_4 << 0,
-           0,
-           0;
+// Lateral barrier points in homogenous coordinates
+Eigen::Matrix<double, 4, 1> BarrierPoint(double q)
+{
+    Eigen::Matrix<double, 4, 1> barrier;
+    barrier << 0.0,
+               q,
+               0.0,
+               1.0;
+    return barrier;
+}
 
+// STEAM state variables can only be perturbed, so their values are set by applying the difference to the current value
+void SetStateValue(const steam::se3::SE3StateVar::Ptr& state_var, const lgmath::se3::Transformation& value)
+{
+    state_var->update((value * state_var->value().inverse()).vec());
+}
 
-    // Setup shared loss functions and noise models for all cost terms
-    //const auto sharedLossFunc = steam::L2LossFunc::MakeShared(); // The default L2 loss function weights all cost terms with a value of 1.0 (not using this one anymore)
+void SetStateValue(const steam::vspace::VSpaceStateVar<2>::Ptr& state_var, const Eigen::Matrix<double, 2, 1>& value)
+{
+    state_var->update(value - state_var->value());
+}
+}
 
-    // The custom L2WeightedLossFunc allows you to dynamically set the weights of cost terms by providing the value as an argument
-    const auto poseLossFunc = steam::L2WeightedLossFunc::MakeShared(pose_error_weight);
-    const auto velLossFunc = steam::L2WeightedLossFunc::MakeShared(vel_error_weight);
-    const auto accelLossFunc = steam::L2WeightedLossFunc::MakeShared(acc_error_weight);
-    const auto kinLossFunc = steam::L2WeightedLossFunc::MakeShared(kin_error_weight);
-    const auto latLossFunc = steam::L2WeightedLossFunc::MakeShared(lat_error_weight); 
 
-    // Cost term Noise Covariance Initialization
-    const auto sharedPoseNoiseModel = steam::StaticNoiseModel<6>::MakeShared(pose_noise_vect);
-    const auto sharedVelNoiseModel = steam::StaticNoiseModel<2>::MakeShared(vel_noise_vect);
-    const auto sharedAccelNoiseModel = steam::StaticNoiseModel<2>::MakeShared(accel_noise_vect);
-    const auto sharedKinNoiseModel = steam::StaticNoiseModel<6>::MakeShared(kin_noise_vect);
-    const auto sharedLatNoiseModel = steam::StaticNoiseModel<1>::MakeShared(lat_noise_vect);
+CorridorMPC::CorridorMPC(const std::string& solver)
+{
+    if (solver == "banded")
+    {
+      banded_solver = true;
+    }
+    else if (solver != "sparse")
+    {
+      std::string err{"Unknown MPC solver: " + solver + ", must be sparse or banded"};
+      CLOG(ERROR, "mpc.cbit") << err;
+      throw std::invalid_argument(err);
+    }
+}
+
 
+bool CorridorMPC::ProblemParams::operator==(const ProblemParams& other) const
+{
+    return K == other.K && DT == other.DT && point_stabilization == other.point_stabilization &&
+           lat_noise_vect == other.lat_noise_vect && pose_noise_vect == other.pose_noise_vect &&
+           vel_noise_vect == other.vel_noise_vect && accel_noise_vect == other.accel_noise_vect &&
+           kin_noise_vect == other.kin_noise_vect && pose_error_weight == other.pose_error_weight &&
+           vel_error_weight == other.vel_error_weight && acc_error_weight == other.acc_error_weight &&
+           kin_error_weight == other.kin_error_weight && lat_error_weight == other.lat_error_weight;
+}
 
 
-    // Generate STEAM States for the velocity vector and SE3 state transforms
-    std::vector<lgmath::se3::Transformation> pose_states;
-    std::vector<Eigen::Matrix<double,2,1>> vel_states;
+struct mpc_result CorridorMPC::Solve(Eigen::Matrix<double, 2, 1> previous_vel, lgmath::se3::Transformation T0, const std::vector<lgmath::se3::Transformation>& measurements, const std::vector<lgmath::se3::Transformation>& measurements_cbit, const std::vector<double>& barrier_q_left, const std::vector<double>& barrier_q_right, int K, double DT, double VF, Eigen::Matrix<double, 1, 1> lat_noise_vect, Eigen::Matrix<double, 6, 6> pose_noise_vect, Eigen::Matrix<double, 2, 2> vel_noise_vect, Eigen::Matrix<double, 2, 2> accel_noise_vect, Eigen::Matrix<double, 6, 6> kin_noise_vect, bool point_stabilization, double pose_error_weight, double vel_error_weight, double acc_error_weight, double kin_error_weight, double lat_error_weight, double time_budget_ms)
+{
+    const auto solve_start = std::chrono::steady_clock::now();
 
-    // Invert the extrapolated robot state and use this as the state initialization
+    // Invert the extrapolated robot state, this is the (locked) first state of the horizon
     lgmath::se3::Transformation T0_inv = T0.inverse();
-    Eigen::Vector2d v0(0.0, 0.0);
 
-    // Push back the initial states (current robot state)
-    pose_states.push_back(T0_inv);
-    vel_states.push_back(v0);
+    // Reuse the problem from the last cycle if its structure is unchanged, otherwise build (and cold start) a new one
+    const ProblemParams problem_params{K, DT, point_stabilization, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, pose_error_weight, vel_error_weight, acc_error_weight, kin_error_weight, lat_error_weight};
+    const bool warm_start = (opt_problem != nullptr) && (problem_params == params);
+    if (warm_start)
+    {
+      Update(previous_vel, T0_inv, measurements, barrier_q_left, barrier_q_right);
+    }
+    else
+    {
+      Build(problem_params, previous_vel, T0_inv, measurements, measurements_cbit, barrier_q_left, barrier_q_right);
+    }
+
+    // Solve the optimization problem with GuassNewton solver
+    //using SolverType = steam::GaussNewtonSolver; // Old solver, does not have back stepping capability
+    using SolverType = steam::LineSearchGaussNewtonSolver;
+    //using SolverType = steam::DoglegGaussNewtonSolver;
+    // Initialize solver parameters
+    SolverType::Params solver_params;
+    solver_params.verbose = false; // Makes the output display for debug when true (prints every iteration, too slow for the control loop)
+    solver_params.relative_cost_change_threshold = 1e-4;
+    solver_params.max_iterations = mpc_max_iterations;
+    solver_params.absolute_cost_change_threshold = 1e-4;
+    solver_params.backtrack_multiplier = 0.5; // Line Search Specific Params, will fail to build if using GaussNewtonSolver
+    solver_params.max_backtrack_steps = 400; // Line Search Specific Params, will fail to build if using GaussNewtonSolver
+
+    // Cap the iterations to what fits in the remaining time budget given the measured time per iteration of previous solves
+    const double remaining_ms = time_budget_ms - std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - solve_start).count();
+    if (iteration_time > 0.0 && remaining_ms < iteration_time * mpc_max_iterations)
+    {
+      solver_params.max_iterations = (unsigned int)std::max(1.0, std::floor(remaining_ms / iteration_time));
+    }
+    const bool capped = solver_params.max_iterations < (unsigned int)mpc_max_iterations;
+
+    double initial_cost = opt_problem->cost();
+
+    // Solve the optimization problem, drop the problem on failure so that the next cycle starts from scratch
+    // The solvers are cheap to construct, they only reference the persistent problem and state variables
+    unsigned int iterations = 0;
+    try
+    {
+      if (banded_solver)
+      {
+        // Same parameters, the linear systems are solved with a banded factorization exploiting the stage-wise structure
+        vtr::path_planning::HorizonGaussNewtonSolver::Params horizon_params;
+        horizon_params.verbose = solver_params.verbose;
+        horizon_params.max_iterations = solver_params.max_iterations;
+        horizon_params.relative_cost_change_threshold = solver_params.relative_cost_change_threshold;
+        horizon_params.absolute_cost_change_threshold = solver_params.absolute_cost_change_threshold;
+        horizon_params.backtrack_multiplier = solver_params.backtrack_multiplier;
+        horizon_params.max_backtrack_steps = solver_params.max_backtrack_steps;
+        // Anytime: stop at the end of the budget with the best iterate so far (every accepted step decreases the cost)
+        if (std::isfinite(time_budget_ms))
+        {
+          horizon_params.deadline = solve_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(time_budget_ms));
+        }
+        vtr::path_planning::HorizonGaussNewtonSolver solver(*opt_problem, horizon_params);
+        solver.optimize();
+        iterations = solver.curr_iteration();
+      }
+      else
+      {
+        SolverType solver(*opt_problem, solver_params);
+        solver.optimize();
+        iterations = solver.curr_iteration();
+      }
+    }
+    catch(...)
+    {
+      Reset();
+      throw;
+    }
+
+    double final_cost = opt_problem->cost();
 
-    //CLOG(DEBUG, "mpc_debug.cbit") << "Verifying that the initial robot state is about the same as the initial reference measurement";
-    //CLOG(DEBUG, "mpc_debug.cbit") << "T0_inv: " << T0_inv;
-    //CLOG(ERROR, "mpc_debug.cbit") << "1st meas: " << measurements_cbit[0];
+    const double solve_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - solve_start).count();
+    if (warm_start)
+    {
+      stats.num_warm_starts++;
+    }
+    RecordSolve(solve_time, (int)iterations, capped);
+    CLOG(DEBUG, "mpc.cbit") << "MPC solved in " << solve_time << "ms, " << iterations << "/" << solver_params.max_iterations
+                            << " iterations, warm started: " << warm_start << ", cost: " << initial_cost << " -> " << final_cost;
 
-    // Set the remaining states using a warm start from the cbit solution
-    for (int i=1; i<K; i++)
+    // Check the cost, disregard the result if it is unreasonable (i.e if its higher then the initial cost)
+    if (final_cost > initial_cost)
     {
-        //pose_states.push_back(lgmath::se3::Transformation());
-        //pose_states.push_back(T0_inv); // old initialization - set all initial states to that of the current robot state
-        pose_states.push_back(measurements_cbit[i]); // New initialization - use the reference measurements from the cbit solution as our initialization - the first one is the same as our initial state
-        vel_states.push_back(v0);
+      CLOG(ERROR, "mpc_debug.cbit") << "The final cCost was > initial cost, something went wrong. Commanding the vehicle to stop";
+      Reset();
+
+      Eigen::Matrix<double, 2, 1> bad_cost_vel;
+      bad_cost_vel(0) = 0.0;
+      bad_cost_vel(1) = 0.0;
+
+      // return the mpc_poses as all being the robots current pose (not moving across the horizon as we should be stopped)
+      std::vector<lgmath::se3::Transformation> mpc_poses(K, T0);
+      return {bad_cost_vel, mpc_poses};
     }
 
-    // Create Steam states
-    std::vector<steam::se3::SE3StateVar::Ptr> pose_state_vars;
-    std::vector<steam::vspace::VSpaceStateVar<2>::Ptr> vel_state_vars;
-    std::vector<steam::se3::SE3StateVar::Ptr> measurement_vars; // This one is for storing measurements as locked evaluators for barrier constraints
-    
-    // Create a locked state var for the 4th column of the identity matrix (used in state constraint)
-    steam::stereo::HomoPointStateVar::Ptr I_4_eval = steam::stereo::HomoPointStateVar::MakeShared(I_4);
-    I_4_eval->locked() = true;
+    // Store the velocity command to apply
+    Eigen::Matrix<double, 2, 1> applied_vel = vel_state_vars[0]->value();
+
+    // First check if any of the values are nan, if so we return a zero velocity and flag the error
+    if (std::isnan(applied_vel(0)) || std::isnan(applied_vel(1)))
+    {
+      CLOG(ERROR, "mpc.cbit") << "NAN values detected, mpc optimization failed. Returning zero velocities";
+      Reset();
+
+      Eigen::Matrix<double, 2, 1> nan_vel;
+      nan_vel(0) = 0.0;
+      nan_vel(1) = 0.0;
+
+      // if we do detect nans, return the mpc_poses as all being the robots current pose (not moving across the horizon as we should be stopped)
+      std::vector<lgmath::se3::Transformation> mpc_poses(K, T0);
+      return {nan_vel, mpc_poses};
+    }
 
-    // Create Steam variables
+    // if no nan values, return the applied velocity and mpc pose predictions as normal
+    // Store the sequence of resulting mpc prediction horizon poses for visualization
+    std::vector<lgmath::se3::Transformation> mpc_poses;
     for (int i = 0; i < K; i++)
     {
-        pose_state_vars.push_back(steam::se3::SE3StateVar::MakeShared(pose_states[i])); 
-        vel_state_vars.push_back(steam::vspace::VSpaceStateVar<2>::MakeShared(vel_states[i])); 
+      mpc_poses.push_back(pose_state_vars[i]->value().inverse());
+    }
+
+    // Return the resulting structure
+    return {applied_vel, mpc_poses};
+}
+
+
+void CorridorMPC::Build(const ProblemParams& problem_params, const Eigen::Matrix<double, 2, 1>& previous_vel, const lgmath::se3::Transformation& T0_inv, const std::vector<lgmath::se3::Transformation>& measurements, const std::vector<lgmath::se3::Transformation>& measurements_cbit, const std::vector<double>& barrier_q_left, const std::vector<double>& barrier_q_right)
+{
+    params = problem_params;
+    const int K = params.K;
+
+    const Eigen::Matrix<double, 6, 2> P_tran = UnicycleProjection();
+
+    // Lateral constraint projection matrices (Experimental)
+    Eigen::Matrix<double, 3, 1> I_4; // In steam, the homopoint vars automatically add the 4th row 1, so representing I_4 just needs the 3 zeros
+    I_4 << 0,
+           0,
+           0;
+
+    // The custom L2WeightedLossFunc allows you to dynamically set the weights of cost terms by providing the value as an argument
+    const auto velLossFunc = steam::L2WeightedLossFunc::MakeShared(params.vel_error_weight);
+    const auto accelLossFunc = steam::L2WeightedLossFunc::MakeShared(params.acc_error_weight);
+    const auto kinLossFunc = steam::L2WeightedLossFunc::MakeShared(params.kin_error_weight);
+    const auto latLossFunc = steam::L2WeightedLossFunc::MakeShared(params.lat_error_weight);
+
+    // Cost term Noise Covariance Initialization
+    const auto sharedPoseNoiseModel = steam::StaticNoiseModel<6>::MakeShared(params.pose_noise_vect);
+    const auto sharedVelNoiseModel = steam::StaticNoiseModel<2>::MakeShared(params.vel_noise_vect);
+    const auto sharedAccelNoiseModel = steam::StaticNoiseModel<2>::MakeShared(params.accel_noise_vect);
+    const auto sharedKinNoiseModel = steam::StaticNoiseModel<6>::MakeShared(params.kin_noise_vect);
+    const auto sharedLatNoiseModel = steam::StaticNoiseModel<1>::MakeShared(params.lat_noise_vect);
+
+    // Create Steam states, the first (current robot) state is the inverted robot pose and the remaining states use a cold start from the
+    // cbit solution (the first measurement is the same as our initial state). Velocities start at zero.
+    pose_state_vars.clear();
+    vel_state_vars.clear();
+    measurement_vars.clear();
+    lat_error_right.clear();
+    lat_error_left.clear();
+    const Eigen::Vector2d v0(0.0, 0.0);
+    for (int i = 0; i < K; i++)
+    {
+        pose_state_vars.push_back(steam::se3::SE3StateVar::MakeShared(i == 0 ? T0_inv : measurements_cbit[i]));
+        vel_state_vars.push_back(steam::vspace::VSpaceStateVar<2>::MakeShared(v0));
     }
 
     // Lock the first (current robot) state from being modified during the optimization
     pose_state_vars[0]->locked() = true;
 
+    // The previously applied control command, locked so it can be updated every cycle without changing the problem
+    previous_vel_var = steam::vspace::VSpaceStateVar<2>::MakeShared(previous_vel);
+    previous_vel_var->locked() = true;
 
+    // Create a locked state var for the 4th column of the identity matrix (used in state constraint)
+    I_4_eval = steam::stereo::HomoPointStateVar::MakeShared(I_4);
+    I_4_eval->locked() = true;
 
     // Setup the optimization problem
-    steam::OptimizationProblem opt_problem;
+    // The free states are added in time order (v0, T1, v1, T2, ...) so the Gauss-Newton system is block banded for the horizon solver
+    opt_problem = std::make_unique<steam::OptimizationProblem>();
     for (int i=1; i<K; i++) // start at 1 so as to not add the locked state variable
     {
-        opt_problem.addStateVariable(pose_state_vars[i]);
-    }
-
-    // The velocity states should have one less variable then the pose states
-    for (int i=0; i<K-1; i++)
-    {
-        opt_problem.addStateVariable(vel_state_vars[i]);
+        // The velocity states should have one less variable then the pose states
+        opt_problem->addStateVariable(vel_state_vars[i-1]);
+        opt_problem->addStateVariable(pose_state_vars[i]);
     }
 
     // Generate the cost terms using combinations of the built-in steam evaluators
-    double dynamic_pose_error_weight = pose_error_weight;
+    double dynamic_pose_error_weight = params.pose_error_weight;
     for (int i = 0; i < K; i++)
     {
-      // Pose Error
+      // Generate a locked transform evaluator to store the current measurement for the pose error and state constraints
+      // The reason we make it a variable and lock it is so we can use the built in steam evaluators which require evaluable inputs,
+      // and so the measurement can be updated every cycle without rebuilding the problem
+      measurement_vars.push_back(steam::se3::SE3StateVar::MakeShared(measurements[i]));
+      measurement_vars[i]->locked() = true;
+
+      // Take the compose inverse of the locked measurement w.r.t the state transforms
+      const auto compose_inv = steam::se3::ComposeInverseEvaluator::MakeShared(measurement_vars[i], pose_state_vars[i]);
+
+      // Pose Error (same as the SE3ErrorEvaluator with a constant measurement)
       if (i > 0)
       {
-        const auto pose_error_func = steam::se3::SE3ErrorEvaluator::MakeShared(pose_state_vars[i], measurements[i]);
+        const auto pose_error_func = steam::se3::LogMapEvaluator::MakeShared(compose_inv);
         auto dynamicposeLossFunc = steam::L2WeightedLossFunc::MakeShared(dynamic_pose_error_weight);
         const auto pose_cost_term = steam::WeightedLeastSqCostTerm<6>::MakeShared(pose_error_func, sharedPoseNoiseModel, dynamicposeLossFunc);
-        opt_problem.addCostTerm(pose_cost_term);
+        opt_problem->addCostTerm(pose_cost_term);
         dynamic_pose_error_weight = dynamic_pose_error_weight * 0.95;
       }
 
@@ -195,223 +342,145 @@ struct mpc_result SolveMPC2(Eigen::Matrix<double, 2, 1> previous_vel, lgmath::se
       {
         const auto lhs = steam::se3::ComposeInverseEvaluator::MakeShared(pose_state_vars[i+1], pose_state_vars[i]);
         const auto vel_proj = steam::vspace::MatrixMultEvaluator<6,2>::MakeShared(vel_state_vars[i], P_tran); // TODO, I guess this version of steam doesnt have this one, will need to do it myself
-        const auto scaled_vel_proj = steam::vspace::ScalarMultEvaluator<6>::MakeShared(vel_proj, DT);
+        const auto scaled_vel_proj = steam::vspace::ScalarMultEvaluator<6>::MakeShared(vel_proj, params.DT);
         const auto rhs = steam::se3::ExpMapEvaluator::MakeShared(scaled_vel_proj);
         const auto kin_error_func = steam::se3::LogMapEvaluator::MakeShared(steam::se3::ComposeInverseEvaluator::MakeShared(lhs, rhs));
         const auto kin_cost_term = steam::WeightedLeastSqCostTerm<6>::MakeShared(kin_error_func, sharedKinNoiseModel, kinLossFunc);
-        opt_problem.addCostTerm(kin_cost_term);
-
-        // Non-Zero Velocity Penalty (penalty of non resting control effort helps with point stabilization)
-        //const auto vel_cost_term = steam::WeightedLeastSqCostTerm<2>::MakeShared(vel_state_vars[i], sharedVelNoiseModel, velLossFunc);
-        //opt_problem.addCostTerm(vel_cost_term);
-
-        // Velocity set-point constraint - No longer using this due to complications when repeating a path in reverse
-        // Only add this cost term if we are not in point stabilization mode (end of path)
-        
-        //if (point_stabilization == false)
-        //{
-        //  const auto vel_cost_term = steam::WeightedLeastSqCostTerm<2>::MakeShared(steam::vspace::VSpaceErrorEvaluator<2>::MakeShared(vel_state_vars[i],v_ref), sharedVelNoiseModel, velLossFunc);
-        //  opt_problem.addCostTerm(vel_cost_term);
-        //}
+        opt_problem->addCostTerm(kin_cost_term);
 
         // Experimental End of Path Termination Constraint
-        if (point_stabilization == true)
+        if (params.point_stabilization == true)
         {
           const auto vel_cost_term = steam::WeightedLeastSqCostTerm<2>::MakeShared(vel_state_vars[i], sharedVelNoiseModel, velLossFunc);
-          opt_problem.addCostTerm(vel_cost_term);
+          opt_problem->addCostTerm(vel_cost_term);
         }
-        
-        
+
         // Acceleration Constraints
         if (i == 0)
         {
         // On the first iteration, we need to use an error with the previously applied control command state
-        const auto accel_cost_term = steam::WeightedLeastSqCostTerm<2>::MakeShared(steam::vspace::VSpaceErrorEvaluator<2>::MakeShared(vel_state_vars[i], previous_vel), sharedAccelNoiseModel, accelLossFunc);
-        opt_problem.addCostTerm(accel_cost_term);
-        } 
+        const auto accel_diff = steam::vspace::AdditionEvaluator<2>::MakeShared(vel_state_vars[i], steam::vspace::NegationEvaluator<2>::MakeShared(previous_vel_var));
+        const auto accel_cost_term = steam::WeightedLeastSqCostTerm<2>::MakeShared(accel_diff, sharedAccelNoiseModel, accelLossFunc);
+        opt_problem->addCostTerm(accel_cost_term);
+        }
         else
         {
         // Subsequent iterations we make an error between consecutive velocities. We penalize large changes in velocity between time steps
         const auto accel_diff = steam::vspace::AdditionEvaluator<2>::MakeShared(vel_state_vars[i], steam::vspace::NegationEvaluator<2>::MakeShared(vel_state_vars[i-1]));
         const auto accel_cost_term = steam::WeightedLeastSqCostTerm<2>::MakeShared(accel_diff, sharedAccelNoiseModel, accelLossFunc);
-        opt_problem.addCostTerm(accel_cost_term);
-        }  
-        
-        
+        opt_problem->addCostTerm(accel_cost_term);
+        }
       }
 
       // Laterial Barrier State Constraints
-      if (i >= 0)
-      {
-        // Generate a locked transform evaluator to store the current measurement for state constraints
-        // The reason we make it a variable and lock it is so we can use the built in steam evaluators which require evaluable inputs
-        measurement_vars.push_back(steam::se3::SE3StateVar::MakeShared(measurements[i]));
-        measurement_vars[i]->locked() = true;
-
-        // Take the compose inverse of the locked measurement w.r.t the state transforms
-        const auto compose_inv = steam::se3::ComposeInverseEvaluator::MakeShared(measurement_vars[i], pose_state_vars[i]);
-
-        // Use the ComposeLandmarkEvaluator to right multiply the 4th column of the identity matrix to create a 4x1 homogenous point vector with lat,lon,alt error components
-        const auto error_vec = steam::stereo::ComposeLandmarkEvaluator::MakeShared(compose_inv, I_4_eval);
-
-        // Build lateral barrier terms by querying the current cbit corridor
-        Eigen::Matrix<double, 4, 1> barrier_right;
-        barrier_right <<  0,
-                          barrier_q_right[i],
-                          0,
-                          1;
-        Eigen::Matrix<double, 4, 1> barrier_left;
-        barrier_left <<   0.0,
-                          barrier_q_left[i],
-                          0,
-                          1;
-
-        CLOG(INFO, "mpc_debug.cbit") << "Left Barrier for this meas is: " << barrier_q_left[i];
-        CLOG(INFO, "mpc_debug.cbit") << "Right Barrier for tis meas is: " << barrier_q_right[i];
-        //CLOG(INFO, "mpc_debug.cbit") << "The Initaial Pose is:" << T0;
-        //CLOG(INFO, "mpc_debug.cbit") << "The cbit measurement for this value is: " << measurements_cbit[i].inverse();
-        //CLOG(INFO, "mpc_debug.cbit") << "The vtr measurement for this value is: " << measurements[i].inverse();
-
-        // compute the lateral error using a custom Homogenous point error STEAM evaluator
-        const auto lat_error_right = steam::LateralErrorEvaluatorRight::MakeShared(error_vec, barrier_right); // TODO, rename this evaluator to something else
-        const auto lat_error_left = steam::LateralErrorEvaluatorLeft::MakeShared(error_vec, barrier_left);
-
-        // Previously used Log barriers, however due to instability switch to using inverse squared barriers
-        //const auto lat_barrier_right = steam::vspace::ScalarLogBarrierEvaluator<1>::MakeShared(lat_error_right);
-        //const auto lat_barrier_left = steam::vspace::ScalarLogBarrierEvaluator<1>::MakeShared(lat_error_left);
-
-        // For each side of the barrier, compute a scalar inverse barrier term to penalize being close to the bound
-        const auto lat_barrier_right = steam::vspace::ScalarInverseBarrierEvaluator<1>::MakeShared(lat_error_right);
-        const auto lat_barrier_left = steam::vspace::ScalarInverseBarrierEvaluator<1>::MakeShared(lat_error_left);
-
-        // Generate least square cost terms and add them to the optimization problem
-        const auto lat_cost_term_right = steam::WeightedLeastSqCostTerm<1>::MakeShared(lat_barrier_right, sharedLatNoiseModel, latLossFunc);
-        opt_problem.addCostTerm(lat_cost_term_right);
-        const auto lat_cost_term_left = steam::WeightedLeastSqCostTerm<1>::MakeShared(lat_barrier_left, sharedLatNoiseModel, latLossFunc);
-        opt_problem.addCostTerm(lat_cost_term_left);
 
-      
-      }
-    }
+      // Use the ComposeLandmarkEvaluator to right multiply the 4th column of the identity matrix to create a 4x1 homogenous point vector with lat,lon,alt error components
+      const auto error_vec = steam::stereo::ComposeLandmarkEvaluator::MakeShared(compose_inv, I_4_eval);
 
-    // Solve the optimization problem with GuassNewton solver
-    //using SolverType = steam::GaussNewtonSolver; // Old solver, does not have back stepping capability
-    using SolverType = steam::LineSearchGaussNewtonSolver;
-    //using SolverType = steam::DoglegGaussNewtonSolver;
-    // Initialize solver parameters
-    SolverType::Params params;
-    params.verbose = true; // Makes the output display for debug when true
-    params.relative_cost_change_threshold = 1e-4;
-    params.max_iterations = 100;
-    params.absolute_cost_change_threshold = 1e-4;
-    params.backtrack_multiplier = 0.5; // Line Search Specific Params, will fail to build if using GaussNewtonSolver
-    params.max_backtrack_steps = 400; // Line Search Specific Params, will fail to build if using GaussNewtonSolver
-    //params.ratio_threshold_shrink = 0.1; // Dogleg Specific Params, will fail to build if using GaussNewtonSolver
-    /// Grow trust region if ratio of actual to predicted cost reduction above
-    /// this (range: 0.0-1.0)
-    //params.ratio_threshold_grow = 0.9; // Dogleg Specific Params, will fail to build if using GaussNewtonSolver
-    /// Amount to shrink by (range: <1.0)
-    //params.shrink_coeff = 0.9; // Dogleg Specific Params, will fail to build if using GaussNewtonSolver
-    /// Amount to grow by (range: >1.0)
-    //params.grow_coeff = 1.1; // Dogleg Specific Params, will fail to build if using GaussNewtonSolver
-    /// Maximum number of times to shrink trust region before giving up
-    //params.max_shrink_steps = 200; // Dogleg Specific Params, will fail to build if using GaussNewtonSolver
-
-    SolverType solver(opt_problem, params);
-
-    double initial_cost = opt_problem.cost();
-    // Check the cost, disregard the result if it is unreasonable (i.e if its higher then the initial cost)
-    //CLOG(ERROR, "mpc_debug.cbit") << "The Solution Cost is:" << initial_cost;
+      // compute the lateral error using a custom Homogenous point error STEAM evaluator, the barriers are updated every cycle
+      lat_error_right.push_back(steam::LateralErrorEvaluatorRight::MakeShared(error_vec, BarrierPoint(barrier_q_right[i]))); // TODO, rename this evaluator to something else
+      lat_error_left.push_back(steam::LateralErrorEvaluatorLeft::MakeShared(error_vec, BarrierPoint(barrier_q_left[i])));
 
+      // For each side of the barrier, compute a scalar inverse barrier term to penalize being close to the bound
+      const auto lat_barrier_right = steam::vspace::ScalarInverseBarrierEvaluator<1>::MakeShared(lat_error_right[i]);
+      const auto lat_barrier_left = steam::vspace::ScalarInverseBarrierEvaluator<1>::MakeShared(lat_error_left[i]);
 
-    // Solve the optimization problem
-    solver.optimize();
+      // Generate least square cost terms and add them to the optimization problem
+      const auto lat_cost_term_right = steam::WeightedLeastSqCostTerm<1>::MakeShared(lat_barrier_right, sharedLatNoiseModel, latLossFunc);
+      opt_problem->addCostTerm(lat_cost_term_right);
+      const auto lat_cost_term_left = steam::WeightedLeastSqCostTerm<1>::MakeShared(lat_barrier_left, sharedLatNoiseModel, latLossFunc);
+      opt_problem->addCostTerm(lat_cost_term_left);
+    }
+}
 
-    double final_cost = opt_problem.cost();
-    // Check the cost, disregard the result if it is unreasonable (i.e if its higher then the initial cost)
-    //CLOG(ERROR, "mpc_debug.cbit") << "The Solution Cost is:" << final_cost;
 
-    if (final_cost > initial_cost)
-    {
-      CLOG(ERROR, "mpc_debug.cbit") << "The final cCost was > initial cost, something went wrong. Commanding the vehicle to stop";
-         // First check if any of the values are nan, if so we return a zero velocity and flag the error
-      Eigen::Matrix<double, 2, 1> bad_cost_vel;
-      
-      bad_cost_vel(0) = 0.0;
-      bad_cost_vel(1) = 0.0;
+void CorridorMPC::Update(const Eigen::Matrix<double, 2, 1>& previous_vel, const lgmath::se3::Transformation& T0_inv, const std::vector<lgmath::se3::Transformation>& measurements, const std::vector<double>& barrier_q_left, const std::vector<double>& barrier_q_right)
+{
+    const int K = params.K;
 
-      // if we do detect nans, return the mpc_poses as all being the robots current pose (not moving across the horizon as we should be stopped)
-      std::vector<lgmath::se3::Transformation> mpc_poses;
-      for (int i = 0; i<pose_state_vars.size(); i++)
+    // Warm start: shift the previous solution forward by one step. The last pose is extrapolated with the last velocity using the
+    // kinematic model and the last velocity is repeated. The extrapolation needs the unshifted values so it is computed first.
+    if (K > 1)
+    {
+      const Eigen::Matrix<double, 6, 1> last_xi = params.DT * UnicycleProjection() * vel_state_vars[K-2]->value();
+      const lgmath::se3::Transformation last_pose = lgmath::se3::Transformation(last_xi) * pose_state_vars[K-1]->value();
+      for (int i = 1; i < K-1; i++)
       {
-        mpc_poses.push_back(T0);
+        SetStateValue(pose_state_vars[i], pose_state_vars[i+1]->value());
+      }
+      SetStateValue(pose_state_vars[K-1], last_pose);
+      for (int i = 0; i < K-2; i++)
+      {
+        SetStateValue(vel_state_vars[i], vel_state_vars[i+1]->value());
       }
-      return {bad_cost_vel, mpc_poses};
     }
 
-    // DEBUG: Display the several of the prediction horizon results
-    /*
-    CLOG(DEBUG, "mpc_debug.cbit") << "Trying to Display the Optimization Results for the isolated MPC";
-    CLOG(DEBUG, "mpc_debug.cbit") << "The First State is: " << pose_state_vars[0]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Second State is: " << pose_state_vars[1]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Third State is: " << pose_state_vars[2]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Forth State is: " << pose_state_vars[3]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Fifth State is: " << pose_state_vars[4]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Sixth State is: " << pose_state_vars[5]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Seventh State is: " << pose_state_vars[6]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Eighth State is: " << pose_state_vars[7]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Ninth State is: " << pose_state_vars[8]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Tenth State is: " << pose_state_vars[9]->value().inverse();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The First Velocity is: " << vel_state_vars[0]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Second Velocity is: " << vel_state_vars[1]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Third Velocity is: " << vel_state_vars[2]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Forth Velocity is: " << vel_state_vars[3]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Fifth Velocity is: " << vel_state_vars[4]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Sixth Velocity is: " << vel_state_vars[5]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Seventh Velocity is: " << vel_state_vars[6]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Eighth Velocity is: " << vel_state_vars[7]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Ninth Velocity is: " << vel_state_vars[8]->value();
-    CLOG(DEBUG, "mpc_debug.cbit") << "The Tenth Velocity is: " << vel_state_vars[9]->value();
-    
+    // Update the measurement and reference terms
+    SetStateValue(pose_state_vars[0], T0_inv);
+    SetStateValue(previous_vel_var, previous_vel);
+    for (int i = 0; i < K; i++)
+    {
+      SetStateValue(measurement_vars[i], measurements[i]);
+      lat_error_right[i]->setMeasurement(BarrierPoint(barrier_q_right[i]));
+      lat_error_left[i]->setMeasurement(BarrierPoint(barrier_q_left[i]));
+    }
+}
 
-    CLOG(DEBUG, "mpc_debug.cbit") << "Linear Component to Return is: " << (vel_state_vars[0]->value())[0];
-    CLOG(DEBUG, "mpc_debug.cbit") << "Angular Component to Return is: " << (vel_state_vars[0]->value())[1];
-    */
 
-    // Store the velocity command to apply
-    Eigen::Matrix<double, 2, 1> applied_vel = vel_state_vars[0]->value();
+void CorridorMPC::Reset()
+{
+    opt_problem.reset();
+}
 
-    // First check if any of the values are nan, if so we return a zero velocity and flag the error
-    Eigen::Matrix<double, 2, 1> nan_vel;
-    if (std::isnan(applied_vel(0)) || std::isnan(applied_vel(1)))
-    {
-      CLOG(ERROR, "mpc.cbit") << "NAN values detected, mpc optimization failed. Returning zero velocities";
-      nan_vel(0) = 0.0;
-      nan_vel(1) = 0.0;
 
-      // if we do detect nans, return the mpc_poses as all being the robots current pose (not moving across the horizon as we should be stopped)
-      std::vector<lgmath::se3::Transformation> mpc_poses;
-      for (int i = 0; i<pose_state_vars.size(); i++)
-      {
-        mpc_poses.push_back(T0);
-      }
-      return {nan_vel, mpc_poses};
+void CorridorMPC::RecordSolve(double solve_time, int iterations, bool capped)
+{
+    stats.num_solves++;
+    stats.num_capped += capped ? 1 : 0;
+    stats.last_solve_time = solve_time;
+    stats.last_iterations = iterations;
+
+    if (stats.recent_solve_times.size() < mpc_solve_time_window)
+    {
+      stats.recent_solve_times.push_back(solve_time);
+    }
+    else
+    {
+      stats.recent_solve_times[(stats.num_solves - 1) % mpc_solve_time_window] = solve_time;
     }
 
-    // if no nan values, return the applied velocity and mpc pose predictions as normal
+    const double sample = solve_time / std::max(iterations, 1);
+    if (iteration_time == 0.0)
+    {
+      iteration_time = sample;
+    }
     else
     {
-    // Store the sequence of resulting mpc prediction horizon poses for visualization
-    std::vector<lgmath::se3::Transformation> mpc_poses;
-    for (int i = 0; i<pose_state_vars.size(); i++)
+      iteration_time = (1.0 - mpc_iteration_time_smoothing) * iteration_time + mpc_iteration_time_smoothing * sample;
+    }
+
+    if (stats.num_solves % mpc_report_period == 0)
     {
-      mpc_poses.push_back(pose_state_vars[i]->value().inverse());
+      const auto summary = SolveTimeSummary();
+      CLOG(INFO, "mpc.cbit") << "MPC solve time (ms) over the last " << stats.recent_solve_times.size() << " solves - mean: " << summary[0]
+                             << " median: " << summary[1] << " p90: " << summary[2] << " p99: " << summary[3] << " max: " << summary[4]
+                             << ", warm started: " << stats.num_warm_starts << "/" << stats.num_solves
+                             << ", iteration capped: " << stats.num_capped << "/" << stats.num_solves;
     }
+}
 
-    
-    // Return the resulting structure
-    return {applied_vel, mpc_poses};
+
+std::vector<double> CorridorMPC::SolveTimeSummary() const
+{
+    std::vector<double> times = stats.recent_solve_times;
+    if (times.empty())
+    {
+      return std::vector<double>(5, 0.0);
     }
+    std::sort(times.begin(), times.end());
+    const auto percentile = [&times](double q) { return times[(size_t)std::round(q * (times.size() - 1))]; };
+    const double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+    return {mean, percentile(0.5), percentile(0.9), percentile(0.99), times.back()};
 }
 
 
@@ -0,0 +1,166 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_cbit_collision.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+
+// Edge collision check throughput of the cbit planner on a synthetic teach path and costmap.
+// Every edge is discretized the same way as CBITPlanner::discrete_collision_v2, converted to euclidean and checked with the EdgeChecker using:
+//   - Copy: bisection on a copy of the p vector + linear interpolation (previous implementation, bisection took the vector by value)
+//   - Bisection: the same without the copy
+//   - Lookup: CBITPath::curve_to_euclid for each point (p lookup table, precomputed segment terms)
+//   - Batch: CBITPath::curve_to_euclid for the whole edge (current implementation)
+// All variants must find the same number of colliding edges.
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+
+#include "vtr_path_planning/cbit/cbit_costmap.hpp"
+#include "vtr_path_planning/cbit/generate_pq.hpp"
+
+namespace {
+
+std::vector<Pose> make_path(int num_poses, double spacing) {
+  std::vector<Pose> path;
+  double x = 0.0, y = 0.0, yaw = 0.0;
+  for (int i = 0; i < num_poses; i++) {
+    path.emplace_back(x, y, 0.0, 0.0, 0.0, yaw);
+    x += spacing * std::cos(yaw);
+    y += spacing * std::sin(yaw);
+    yaw = 0.8 * std::sin(0.01 * i);
+  }
+  return path;
+}
+
+// Obstacle discs next to the path
+void make_costmap(CBITCostmap& costmap, const std::vector<Pose>& path, std::mt19937& rng) {
+  const float dl = 0.25f;
+  std::uniform_real_distribution<double> offset(-2.5, 2.5);
+  costmap.grid_resolution = dl;
+  for (size_t i = 0; i < path.size(); i += 25) {
+    const int ci = std::floor((path[i].x + offset(rng)) / dl), cj = std::floor((path[i].y + offset(rng)) / dl);
+    for (int a = -3; a <= 3; a++)
+      for (int b = -3; b <= 3; b++)
+        if (a * a + b * b <= 9) costmap.obs_map[std::make_pair((float)((ci + a) * dl), (float)((cj + b) * dl))] = 1.0f;
+  }
+  costmap.T_c_w = vtr::tactic::EdgeTransform(Eigen::Matrix4d(Eigen::Matrix4d::Identity()));
+  costmap.update_grid();
+}
+
+// Previous conversion
+Node reference_curve_to_euclid(const CBITPath& global_path, const Node& node, bool copy) {
+  const double p_val = node.p, q_val = node.q;
+  int p_ind;
+  if (copy) {
+    const std::vector<double> p = global_path.p;
+    p_ind = bisection(p, p_val);
+  } else {
+    p_ind = bisection(global_path.p, p_val);
+  }
+  Pose pose_c;
+  if (p_val >= global_path.p.back()) {
+    pose_c = global_path.path.back();
+  } else {
+    const double p_lower = global_path.p[p_ind], p_upper = global_path.p[p_ind + 1];
+    const Pose& start_pose = global_path.path[p_ind];
+    const Pose& end_pose = global_path.path[p_ind + 1];
+    const double t = (p_val - p_lower) / (p_upper - p_lower);
+    const double angle_difference =
+        std::fmod((std::fmod((end_pose.yaw - start_pose.yaw), (2.0 * M_PI)) + (3.0 * M_PI)), (2.0 * M_PI)) - M_PI;
+    pose_c = Pose(start_pose.x + t * (end_pose.x - start_pose.x), start_pose.y + t * (end_pose.y - start_pose.y),
+                  start_pose.z + t * (end_pose.z - start_pose.z), 0.0, 0.0, start_pose.yaw + t * angle_difference);
+  }
+  return Node(pose_c.x - sin(pose_c.yaw) * q_val, pose_c.y + cos(pose_c.yaw) * q_val, pose_c.z);
+}
+
+enum class Variant { COPY, BISECTION, LOOKUP, BATCH };
+
+// Same discretization as CBITPlanner::discrete_collision_v2
+bool edge_collision(const CBITPath& global_path, const CBITCostmap& costmap, const Node& start, const Node& end,
+                    Variant variant, std::vector<double>& p_test, std::vector<double>& q_test,
+                    std::vector<Node>& euclid_test) {
+  const double discretization = ceil(calc_dist(start, end) * 20.0);
+  const double p_step = fabs(end.p - start.p) / discretization;
+  const double q_step = fabs(end.q - start.q) / discretization;
+  p_test.assign(1, start.p);
+  q_test.assign(1, start.q);
+  for (int i = 0; i < discretization - 1; i++) {
+    p_test.push_back(p_test[i] + p_step * sgn(end.p - start.p));
+    q_test.push_back(q_test[i] + q_step * sgn(end.q - start.q));
+  }
+  p_test.push_back(end.p);
+  q_test.push_back(end.q);
+
+  CBITCostmap::EdgeChecker edge_checker(costmap, false);
+  if (variant == Variant::BATCH) {
+    global_path.curve_to_euclid(p_test, q_test, euclid_test);
+    for (const auto& euclid_pt : euclid_test)
+      if (edge_checker.collision(euclid_pt)) return true;
+    return false;
+  }
+  for (size_t i = 0; i < p_test.size(); i++) {
+    const Node curv_pt(p_test[i], q_test[i]);
+    const Node euclid_pt = (variant == Variant::LOOKUP)
+                               ? global_path.curve_to_euclid(curv_pt)
+                               : reference_curve_to_euclid(global_path, curv_pt, variant == Variant::COPY);
+    if (edge_checker.collision(euclid_pt)) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(0);
+  CBITConfig config;
+  const int num_edges = 20000;
+  std::cout << std::setw(10) << "poses" << std::setw(12) << "variant" << std::setw(12) << "time (ms)" << std::setw(14)
+            << "edges/s" << std::setw(12) << "collisions" << std::endl;
+  for (const int num_poses : {500, 2000, 8000}) {
+    const auto teach_path = make_path(num_poses, 0.25);
+    const CBITPath global_path(config, teach_path);
+    CBITCostmap costmap;
+    make_costmap(costmap, teach_path, rng);
+
+    // edges of the length the planner connects (expansion radius ~1)
+    std::uniform_real_distribution<double> p_dist(0.0, global_path.p.back() - 1.0);
+    std::uniform_real_distribution<double> q_dist(-2.5, 2.5);
+    std::uniform_real_distribution<double> dp_dist(-1.0, 1.0);
+    std::vector<std::pair<Node, Node>> edges;
+    for (int k = 0; k < num_edges; k++) {
+      const Node start(p_dist(rng), q_dist(rng));
+      edges.emplace_back(start, Node(std::max(0.0, start.p + dp_dist(rng)), q_dist(rng)));
+    }
+
+    std::vector<double> p_test, q_test;
+    std::vector<Node> euclid_test;
+    for (const auto& [name, variant] : {std::make_pair("Copy", Variant::COPY),
+                                        std::make_pair("Bisection", Variant::BISECTION),
+                                        std::make_pair("Lookup", Variant::LOOKUP), std::make_pair("Batch", Variant::BATCH)}) {
+      size_t collisions = 0;
+      const auto t0 = std::chrono::high_resolution_clock::now();
+      for (const auto& [start, end] : edges)
+        collisions += edge_collision(global_path, costmap, start, end, variant, p_test, q_test, euclid_test);
+      const auto t1 = std::chrono::high_resolution_clock::now();
+      const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+      std::cout << std::setw(10) << num_poses << std::setw(12) << name << std::setw(12) << std::fixed
+                << std::setprecision(1) << ms << std::setw(14) << std::setprecision(0) << (1000.0 * num_edges / ms)
+                << std::setw(12) << collisions << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,211 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_cbit_mpc.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+
+// Solve time distribution of the corridor MPC in a closed loop path tracking scenario.
+// A unicycle robot tracks a teach path (recorded path given as a text file with one "x y yaw" pose per line, or a synthetic one) with
+// the same horizon, covariances and weights as the default grizzly configs, running one MPC solve per control period:
+//   - Cold: SolveMPC2, the problem is built and cold started from the reference every cycle (previous implementation)
+//   - Warm: CorridorMPC, the problem is kept and warm started from the previous solution shifted by one step
+//   - Budget: CorridorMPC with the iterations capped to the control period
+//   - Banded: same as Budget with the banded horizon solver
+// for a range of horizon lengths (the banded solver is linear in the horizon length).
+// Prints solve time percentiles and the mean lateral tracking error of each variant and horizon length.
+//
+// Usage: benchmark_cbit_mpc [path_file]
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+#include "vtr_path_planning/mpc/mpc_path_planner2.hpp"
+
+namespace {
+
+const double VF = 1.0;
+const double control_period = 100.0;  // ms
+const double corridor_half_width = 1.5;
+
+std::vector<Pose> make_path(int num_poses, double spacing) {
+  std::vector<Pose> path;
+  double x = 0.0, y = 0.0, yaw = 0.0;
+  for (int i = 0; i < num_poses; i++) {
+    path.emplace_back(x, y, 0.0, 0.0, 0.0, yaw);
+    x += spacing * std::cos(yaw);
+    y += spacing * std::sin(yaw);
+    yaw = 0.8 * std::sin(0.02 * i);
+  }
+  return path;
+}
+
+std::vector<Pose> load_path(const std::string& file) {
+  std::vector<Pose> path;
+  std::ifstream stream(file);
+  double x, y, yaw;
+  while (stream >> x >> y >> yaw) path.emplace_back(x, y, 0.0, 0.0, 0.0, yaw);
+  return path;
+}
+
+lgmath::se3::Transformation to_transform(double x, double y, double yaw) {
+  Eigen::Matrix4d T = Eigen::Matrix4d::Identity();
+  T(0, 0) = std::cos(yaw);
+  T(0, 1) = -std::sin(yaw);
+  T(1, 0) = std::sin(yaw);
+  T(1, 1) = std::cos(yaw);
+  T(0, 3) = x;
+  T(1, 3) = y;
+  return lgmath::se3::Transformation(T);
+}
+
+// Teach path with its arc length, interpolated the same way as CBITPath::curve_to_euclid
+struct Reference {
+  std::vector<Pose> path;
+  std::vector<double> s;
+
+  explicit Reference(const std::vector<Pose>& poses) : path(poses), s(1, 0.0) {
+    for (size_t i = 1; i < path.size(); i++)
+      s.push_back(s.back() + std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y));
+  }
+
+  Pose at(double s_val) const {
+    if (s_val >= s.back()) return path.back();
+    const size_t i = std::upper_bound(s.begin(), s.end(), s_val) - s.begin() - 1;
+    const double t = (s_val - s[i]) / (s[i + 1] - s[i]);
+    const double angle_difference =
+        std::fmod((std::fmod((path[i + 1].yaw - path[i].yaw), (2.0 * M_PI)) + (3.0 * M_PI)), (2.0 * M_PI)) - M_PI;
+    return Pose(path[i].x + t * (path[i + 1].x - path[i].x), path[i].y + t * (path[i + 1].y - path[i].y), 0.0, 0.0, 0.0,
+                path[i].yaw + t * angle_difference);
+  }
+
+  // Arc length and signed lateral offset of the closest point, searching forward from the previous index
+  std::pair<double, double> project(double x, double y, size_t& index) const {
+    double best = std::numeric_limits<double>::infinity();
+    size_t best_index = index;
+    for (size_t i = index; i < std::min(path.size(), index + 200); i++) {
+      const double d = std::hypot(x - path[i].x, y - path[i].y);
+      if (d < best) best = d, best_index = i;
+    }
+    index = best_index;
+    const auto& pose = path[index];
+    const double lateral = -std::sin(pose.yaw) * (x - pose.x) + std::cos(pose.yaw) * (y - pose.y);
+    return {s[index], lateral};
+  }
+};
+
+enum class Variant { COLD, WARM, BUDGET, BANDED };
+
+struct Result {
+  std::vector<double> solve_times;
+  double lateral_error = 0.0;
+  int failures = 0;
+};
+
+Result track(const Reference& reference, Variant variant, int K, double DT) {
+  Eigen::Matrix<double, 6, 6> pose_noise_vect = Eigen::Matrix<double, 6, 6>::Zero();
+  pose_noise_vect.diagonal() << 100.0, 100.0, 1000.0, 1000.0, 1000.0, 200.0;
+  Eigen::Matrix<double, 2, 2> vel_noise_vect = Eigen::Matrix<double, 2, 2>::Zero();
+  vel_noise_vect.diagonal() << 25.0, 10.0;
+  Eigen::Matrix<double, 2, 2> accel_noise_vect = Eigen::Matrix<double, 2, 2>::Zero();
+  accel_noise_vect.diagonal() << 10.0, 10.0;
+  Eigen::Matrix<double, 6, 6> kin_noise_vect = Eigen::Matrix<double, 6, 6>::Zero();
+  kin_noise_vect.diagonal() << 0.001, 0.001, 0.001, 0.001, 0.001, 0.001;
+  Eigen::Matrix<double, 1, 1> lat_noise_vect;
+  lat_noise_vect << 20.0;
+
+  CorridorMPC mpc(variant == Variant::BANDED ? "banded" : "sparse");
+  Result result;
+  // start slightly off the path
+  double x = reference.path.front().x, y = reference.path.front().y + 0.3, yaw = reference.path.front().yaw;
+  Eigen::Matrix<double, 2, 1> applied_vel = Eigen::Matrix<double, 2, 1>::Zero();
+  size_t index = 0;
+  int cycles = 0;
+  while (true) {
+    const auto [s_robot, lateral] = reference.project(x, y, index);
+    if (s_robot >= reference.s.back() - VF * DT) break;
+    result.lateral_error += std::abs(lateral);
+    cycles++;
+
+    std::vector<lgmath::se3::Transformation> measurements;
+    for (int i = 0; i < K; i++) {
+      const Pose ref = reference.at(s_robot + i * DT * VF);
+      measurements.push_back(to_transform(ref.x, ref.y, ref.yaw).inverse());
+    }
+    const std::vector<double> barrier_q_left(K, corridor_half_width), barrier_q_right(K, -corridor_half_width);
+    const auto T0 = to_transform(x, y, yaw);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+      const auto mpc_result =
+          (variant == Variant::COLD)
+              ? SolveMPC2(applied_vel, T0, measurements, measurements, barrier_q_left, barrier_q_right, K, DT, VF,
+                          lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, false, 1.0,
+                          1.0, 1.0, 1.0, 0.01)
+              : mpc.Solve(applied_vel, T0, measurements, measurements, barrier_q_left, barrier_q_right, K, DT, VF,
+                          lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect, kin_noise_vect, false, 1.0,
+                          1.0, 1.0, 1.0, 0.01,
+                          variant == Variant::WARM ? std::numeric_limits<double>::infinity() : control_period);
+      applied_vel = mpc_result.applied_vel;
+    } catch (...) {
+      result.failures++;
+      applied_vel << 0.0, 0.0;
+    }
+    result.solve_times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+
+    // unicycle plant
+    applied_vel = SaturateVel2(applied_vel, 1.5, 1.25);
+    const double dt = control_period / 1000.0;
+    x += applied_vel(0) * std::cos(yaw) * dt;
+    y += applied_vel(0) * std::sin(yaw) * dt;
+    yaw += applied_vel(1) * dt;
+    if (cycles > 10 * reference.s.back() / (VF * dt)) break;  // not making progress
+  }
+  result.lateral_error /= std::max(cycles, 1);
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const auto teach_path = (argc > 1) ? load_path(argv[1]) : make_path(1200, 0.1);
+  if (teach_path.size() < 2) {
+    std::cerr << "Path needs at least two poses" << std::endl;
+    return 1;
+  }
+  const Reference reference(teach_path);
+
+  std::cout << std::setw(8) << "K" << std::setw(8) << "variant" << std::setw(8) << "solves" << std::setw(10) << "mean" << std::setw(10) << "p50"
+            << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << std::setw(12) << "lat err"
+            << std::setw(10) << "failures" << "   (times in ms, lateral error in m)" << std::endl;
+  // same horizon duration (6s) with finer steps
+  for (const int K : {20, 40, 80})
+  for (const auto& [name, variant] : {std::make_pair("Cold", Variant::COLD), std::make_pair("Warm", Variant::WARM),
+                                      std::make_pair("Budget", Variant::BUDGET), std::make_pair("Banded", Variant::BANDED)}) {
+    const auto result = track(reference, variant, K, 6.0 / K);
+    if (result.solve_times.empty()) continue;
+    auto times = result.solve_times;
+    std::sort(times.begin(), times.end());
+    const auto percentile = [&times](double q) { return times[(size_t)std::round(q * (times.size() - 1))]; };
+    const double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+    std::cout << std::setw(8) << K << std::setw(8) << name << std::setw(8) << times.size() << std::fixed << std::setprecision(2)
+              << std::setw(10) << mean << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.9)
+              << std::setw(10) << percentile(0.99) << std::setw(10) << times.back() << std::setprecision(3)
+              << std::setw(12) << result.lateral_error << std::setw(10) << result.failures << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,334 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_cbit_tree.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+
+// Planning throughput (replan rate) of the cbit tree and queue bookkeeping on a synthetic p,q corridor, with and without obstacles.
+// The same simplified batch (BIT* style vertex expansion, edge processing with rewiring, then prune) is run with:
+//   - Linear: plain vectors with linear scans for neighbours and tree membership, multimap queues (previous implementation)
+//   - Indexed: NodeSet/EdgeSet with the spatial grid and constant time membership, multimap queues
+//   - Heap: NodeSet/EdgeSet with the indexed heap vertex queue and EdgeQueue (current implementation)
+// All variants process the same samples in the same batches, so the resulting path costs should match.
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+
+#include "vtr_path_planning/cbit/utils.hpp"
+
+namespace {
+
+using NodePtr = std::shared_ptr<Node>;
+using Edge = std::tuple<NodePtr, NodePtr>;
+
+struct Corridor {
+  double length = 30.0;
+  double q_max = 2.5;
+  // obstacles as {p_min, p_max, q_min, q_max}
+  std::vector<std::vector<double>> obstacles;
+
+  bool inside_obs(double p, double q) const {
+    for (const auto& obs : obstacles)
+      if (p >= obs[0] && p <= obs[1] && q >= obs[2] && q <= obs[3]) return true;
+    return false;
+  }
+
+  bool edge_collision(const Node& a, const Node& b) const {
+    const double dist = calc_dist(a, b);
+    const int steps = std::max(1, static_cast<int>(std::ceil(dist / 0.05)));
+    for (int i = 0; i <= steps; i++) {
+      const double t = static_cast<double>(i) / steps;
+      if (inside_obs(a.p + t * (b.p - a.p), a.q + t * (b.q - a.q))) return true;
+    }
+    return false;
+  }
+};
+
+// Previous bookkeeping: vectors and linear scans
+struct LinearTree {
+  std::vector<NodePtr> V, samples;
+  std::vector<Edge> E;
+
+  void set_cell_size(double) {}
+  bool node_in_tree(const NodePtr& x) const {
+    for (const auto& v : V)
+      if (v == x) return true;
+    return false;
+  }
+  bool edge_in_tree(const NodePtr& v, const NodePtr& x) const {
+    for (const auto& e : E)
+      if (std::get<0>(e) == v && std::get<1>(e) == x) return true;
+    return false;
+  }
+  void erase_edges_to(const NodePtr& x) {
+    for (size_t i = 0; i < E.size(); i++)
+      if (std::get<1>(E[i]) == x) {
+        E[i] = std::move(E.back());
+        E.pop_back();
+        i--;
+      }
+  }
+  void erase_sample(const NodePtr& x) {
+    for (size_t i = 0; i < samples.size(); i++)
+      if (samples[i] == x) {
+        samples[i] = std::move(samples.back());
+        samples.pop_back();
+        break;
+      }
+  }
+  template <typename F>
+  void near_samples(const Node& v, double r, F f) const {
+    for (const auto& s : samples)
+      if (calc_dist(*s, v) <= r) f(s);
+  }
+  template <typename F>
+  void near_vertices(const Node& v, double r, F f) const {
+    for (const auto& x : V)
+      if (calc_dist(*x, v) <= r) f(x);
+  }
+  template <typename P>
+  void prune(P keep) {
+    std::vector<NodePtr> samples_pruned, vertex_pruned;
+    for (const auto& s : samples)
+      if (keep(s)) samples_pruned.push_back(s);
+    for (const auto& v : V)
+      if (keep(v)) vertex_pruned.push_back(v);
+    std::vector<Edge> edge_pruned;
+    for (const auto& e : E)
+      if (keep(std::get<0>(e)) && keep(std::get<1>(e))) edge_pruned.push_back(e);
+    samples = samples_pruned;
+    V = vertex_pruned;
+    E = edge_pruned;
+  }
+};
+
+// Current bookkeeping: NodeSet/EdgeSet
+struct IndexedTree {
+  NodeSet V{VERTEX_SET}, samples{SAMPLE_SET};
+  EdgeSet E;
+
+  void set_cell_size(double cell_size) {
+    V.set_cell_size(cell_size);
+    samples.set_cell_size(cell_size);
+  }
+  bool node_in_tree(const NodePtr& x) const { return V.contains(x); }
+  bool edge_in_tree(const NodePtr& v, const NodePtr& x) const { return E.contains(v, x); }
+  void erase_edges_to(const NodePtr& x) { E.erase_to(x); }
+  void erase_sample(const NodePtr& x) { samples.erase(x); }
+  template <typename F>
+  void near_samples(const Node& v, double r, F f) const {
+    samples.radius_search(v.p, v.q, r, f);
+  }
+  template <typename F>
+  void near_vertices(const Node& v, double r, F f) const {
+    V.radius_search(v.p, v.q, r, f);
+  }
+  template <typename P>
+  void prune(P keep) {
+    samples.erase_if([&](const NodePtr& s) { return !keep(s); });
+    V.erase_if([&](const NodePtr& v) { return !keep(v); });
+    E.erase_if([&](const Edge& e) { return !(keep(std::get<0>(e)) && keep(std::get<1>(e))); });
+  }
+};
+
+// Previous queues: multimaps, dropping the edges into a rewired vertex scans the whole edge queue
+struct MapQueues {
+  std::multimap<double, NodePtr> QV;
+  std::multimap<double, Edge> QE;
+
+  void push_vertex(double key, const NodePtr& v) { QV.emplace(key, v); }
+  void push_edge(double key, const Edge& e) { QE.emplace(key, e); }
+  bool vertices_empty() const { return QV.empty(); }
+  bool edges_empty() const { return QE.empty(); }
+  double vertex_key() const { return QV.empty() ? INFINITY : QV.begin()->first; }
+  double edge_key() const { return QE.empty() ? INFINITY : QE.begin()->first; }
+  NodePtr pop_vertex() {
+    const NodePtr v = QV.begin()->second;
+    QV.erase(QV.begin());
+    return v;
+  }
+  Edge pop_edge() {
+    const Edge e = QE.begin()->second;
+    QE.erase(QE.begin());
+    return e;
+  }
+  template <typename P>
+  void erase_edges_to_if(const NodePtr& x, P pred) {
+    for (auto itr = QE.begin(); itr != QE.end();) {
+      if (std::get<1>(itr->second) == x && pred(itr->second))
+        itr = QE.erase(itr);
+      else
+        itr++;
+    }
+  }
+};
+
+// Current queues: indexed heaps
+struct HeapQueues {
+  IndexedHeap<NodePtr> QV;
+  EdgeQueue QE;
+
+  void push_vertex(double key, const NodePtr& v) { QV.push(key, v); }
+  void push_edge(double key, const Edge& e) { QE.push(key, e); }
+  bool vertices_empty() const { return QV.empty(); }
+  bool edges_empty() const { return QE.empty(); }
+  double vertex_key() { return QV.top_key(); }
+  double edge_key() { return QE.top_key(); }
+  NodePtr pop_vertex() { return QV.pop(); }
+  Edge pop_edge() { return QE.pop(); }
+  template <typename P>
+  void erase_edges_to_if(const NodePtr& x, P pred) {
+    QE.erase_if_to(x, pred);
+  }
+};
+
+struct Result {
+  double cost = INFINITY;
+  double ms = 0.0;
+  size_t vertices = 0;
+  size_t edge_checks = 0;
+};
+
+// Every variant gets copies of the same nodes so they do not share costs or parents
+std::vector<std::vector<Node>> make_batches(const Corridor& corridor, int num_batches, int batch_size) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> p_dist(0.0, corridor.length);
+  std::uniform_real_distribution<double> q_dist(-corridor.q_max, corridor.q_max);
+  std::vector<std::vector<Node>> batches(num_batches);
+  for (auto& batch : batches) {
+    while (static_cast<int>(batch.size()) < batch_size) {
+      Node node(p_dist(rng), q_dist(rng));
+      if (!corridor.inside_obs(node.p, node.q)) batch.push_back(node);
+    }
+  }
+  return batches;
+}
+
+template <typename TreeType, typename QueueType>
+Result plan(const Corridor& corridor, const std::vector<std::vector<Node>>& batches, double radius) {
+  const double alpha = 0.5;
+  auto start = std::make_shared<Node>(0.0, 0.0);
+  auto goal = std::make_shared<Node>(corridor.length, 0.0);
+  start->g_T = start->g_T_weighted = 0.0;
+  goal->g_T = goal->g_T_weighted = INFINITY;
+
+  Result result;
+  const auto t0 = std::chrono::high_resolution_clock::now();
+
+  TreeType tree;
+  QueueType Q;
+  tree.set_cell_size(radius);
+  tree.V.push_back(start);
+  tree.samples.push_back(goal);
+
+  for (const auto& batch : batches) {
+    for (const auto& node : batch) {
+      auto sample = std::make_shared<Node>(node);
+      sample->g_T = sample->g_T_weighted = INFINITY;
+      tree.samples.push_back(sample);
+    }
+
+    for (const auto& v : tree.V) Q.push_vertex(v->g_T_weighted + calc_dist(*v, *goal), v);
+
+    while (!Q.vertices_empty() || !Q.edges_empty()) {
+      // Expand all vertices better than the best edge
+      while (!Q.vertices_empty() && Q.vertex_key() <= Q.edge_key()) {
+        const NodePtr v = Q.pop_vertex();
+        tree.near_samples(*v, radius, [&](const NodePtr& x) {
+          const double f = v->g_T_weighted + calc_weighted_dist(*v, *x, alpha) + calc_dist(*x, *goal);
+          if (f < goal->g_T_weighted) Q.push_edge(f, Edge{v, x});
+        });
+        tree.near_vertices(*v, radius, [&](const NodePtr& x) {
+          const double g = v->g_T_weighted + calc_weighted_dist(*v, *x, alpha);
+          if (g < x->g_T_weighted && !tree.edge_in_tree(v, x))
+            Q.push_edge(g + calc_dist(*x, *goal), Edge{v, x});
+        });
+      }
+      if (Q.edges_empty()) break;
+
+      const double f = Q.edge_key();
+      const Edge edge = Q.pop_edge();
+      if (f >= goal->g_T_weighted) break;
+      const NodePtr v = std::get<0>(edge), x = std::get<1>(edge);
+      const double g = v->g_T_weighted + calc_weighted_dist(*v, *x, alpha);
+      if (g >= x->g_T_weighted) continue;
+      result.edge_checks++;
+      if (corridor.edge_collision(*v, *x)) continue;
+
+      if (tree.node_in_tree(x)) {
+        tree.erase_edges_to(x);
+      } else {
+        tree.erase_sample(x);
+        tree.V.push_back(x);
+      }
+      x->g_T_weighted = g;
+      x->g_T = v->g_T + calc_dist(*v, *x);
+      x->parent = v;
+      tree.E.push_back(Edge{v, x});
+      Q.push_vertex(g + calc_dist(*x, *goal), x);
+      // Drop queued edges into x which can no longer improve it
+      Q.erase_edges_to_if(x, [&](const Edge& e) {
+        return std::get<0>(e)->g_T_weighted + calc_weighted_dist(*std::get<0>(e), *x, alpha) >= x->g_T_weighted;
+      });
+    }
+
+    // Prune everything which can no longer improve the solution
+    const double c_best = goal->g_T_weighted;
+    if (c_best < INFINITY)
+      tree.prune([&](const NodePtr& n) { return calc_dist(*start, *n) + calc_dist(*n, *goal) <= c_best; });
+  }
+
+  const auto t1 = std::chrono::high_resolution_clock::now();
+  result.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  result.cost = goal->g_T_weighted;
+  result.vertices = tree.V.size();
+  return result;
+}
+
+void run(const std::string& name, const Corridor& corridor) {
+  const int num_batches = 10;
+  const double radius = 1.0;
+  std::cout << name << std::endl;
+  std::cout << std::setw(12) << "batch size" << std::setw(12) << "variant" << std::setw(12) << "time (ms)"
+            << std::setw(14) << "batches/s" << std::setw(12) << "cost" << std::setw(12) << "vertices"
+            << std::setw(14) << "edge checks" << std::endl;
+  for (const int batch_size : {250, 500, 1000}) {
+    const auto batches = make_batches(corridor, num_batches, batch_size);
+    const Result linear = plan<LinearTree, MapQueues>(corridor, batches, radius);
+    const Result indexed = plan<IndexedTree, MapQueues>(corridor, batches, radius);
+    const Result heap = plan<IndexedTree, HeapQueues>(corridor, batches, radius);
+    for (const auto& [variant, r] : {std::make_pair("Linear", linear), std::make_pair("Indexed", indexed),
+                                     std::make_pair("Heap", heap)}) {
+      std::cout << std::setw(12) << batch_size << std::setw(12) << variant << std::setw(12) << std::fixed
+                << std::setprecision(1) << r.ms << std::setw(14) << (1000.0 * num_batches / r.ms) << std::setw(12)
+                << std::setprecision(3) << r.cost << std::setw(12) << r.vertices << std::setw(14) << r.edge_checks
+                << std::endl;
+    }
+  }
+  std::cout << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  Corridor corridor;
+  run("Corridor without obstacles", corridor);
+
+  corridor.obstacles = {{5.0, 6.0, -1.5, 2.5}, {12.0, 13.0, -2.5, 1.0}, {20.0, 22.0, -1.0, 1.0}};
+  run("Corridor with obstacles", corridor);
+  return 0;
+}
@@ -0,0 +1,252 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_base_path_planner.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gtest/gtest.h>
+
+#include "vtr_logging/logging_init.hpp"
+#include "vtr_path_planning/base_path_planner.hpp"
+
+using namespace ::testing;
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::path_planning;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double SAFE_COMMAND = -1.0;
+/** \brief tolerated scheduling delay when checking deadlines (ms) */
+constexpr double SLACK = 10.0;
+
+/**
+ * \brief Deterministic planner with an injected computation time per cycle.
+ * The command of cycle i has linear.x = i, and the safe command linear.x = -1.
+ * In anytime mode the planner only keeps refining while there is budget left.
+ */
+class TestPlanner : public BasePathPlanner {
+ public:
+  TestPlanner(const Config::ConstPtr& config,
+              const RobotState::Ptr& robot_state,
+              const Callback::Ptr& callback, const std::vector<double>& loads,
+              const bool anytime = false)
+      : BasePathPlanner(config, robot_state, callback),
+        loads_(loads),
+        anytime_(anytime) {
+    Command safe_command;
+    safe_command.linear.x = SAFE_COMMAND;
+    setSafeCommand(safe_command);
+  }
+  ~TestPlanner() override { stop(); }
+
+  std::vector<Clock::time_point> deadlines() const {
+    LockGuard lock(test_mutex_);
+    return deadlines_;
+  }
+
+  /** \brief cycles whose command was dropped, and the command sent instead */
+  std::vector<std::pair<size_t, double>> dropped() const {
+    LockGuard lock(test_mutex_);
+    return dropped_;
+  }
+
+  std::vector<std::thread::id> threadIds() const {
+    LockGuard lock(test_mutex_);
+    return thread_ids_;
+  }
+
+ private:
+  Command computeCommand(RobotState&) override {
+    size_t cycle;
+    {
+      LockGuard lock(test_mutex_);
+      cycle = deadlines_.size();
+      deadlines_.push_back(deadline());
+      thread_ids_.push_back(std::this_thread::get_id());
+    }
+    const auto load = std::chrono::duration<double, std::milli>(
+        loads_[cycle % loads_.size()]);
+    const auto start = Clock::now();
+    if (anytime_) {
+      while (Clock::now() - start < load && remainingBudget() > 5.0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } else {
+      std::this_thread::sleep_for(load);
+    }
+    Command command;
+    command.linear.x = (double)cycle;
+    return command;
+  }
+
+  void onCommandDropped(const Command& sent) override {
+    LockGuard lock(test_mutex_);
+    dropped_.emplace_back(deadlines_.size() - 1, sent.linear.x);
+  }
+
+  const std::vector<double> loads_;
+  const bool anytime_;
+  mutable Mutex test_mutex_;
+  std::vector<Clock::time_point> deadlines_;
+  std::vector<std::pair<size_t, double>> dropped_;
+  std::vector<std::thread::id> thread_ids_;
+};
+
+class TestCallback : public PathPlannerCallbackInterface {
+ public:
+  using Ptr = std::shared_ptr<TestCallback>;
+
+  void commandReceived(const Command& command) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands_.push_back(command.linear.x);
+    times_.push_back(Clock::now());
+    cv_.notify_all();
+  }
+
+  /** \brief waits for num commands and returns false on timeout */
+  bool waitFor(const size_t num) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, std::chrono::seconds(10),
+                        [&] { return commands_.size() >= num; });
+  }
+
+  /** \brief copies the received commands and their times */
+  std::pair<std::vector<double>, std::vector<Clock::time_point>> received() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {commands_, times_};
+  }
+
+ private:
+  std::vector<double> commands_;
+  std::vector<Clock::time_point> times_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+BasePathPlanner::Config::ConstPtr makeConfig(const bool command_fallback) {
+  auto config = std::make_shared<BasePathPlanner::Config>();
+  config->control_period = 50;
+  config->command_fallback = command_fallback;
+  return config;
+}
+
+double lateness(const Clock::time_point& time,
+                const Clock::time_point& deadline) {
+  return std::chrono::duration<double, std::milli>(time - deadline).count();
+}
+
+}  // namespace
+
+TEST(BasePathPlanner, safe_command_sent_by_deadline_under_load) {
+  // every third cycle takes more than twice the control period
+  const std::vector<double> loads{5.0, 5.0, 120.0};
+  const size_t num_cycles = 9;
+
+  auto callback = std::make_shared<TestCallback>();
+  TestPlanner planner(makeConfig(true), std::make_shared<tactic::OutputCache>(),
+                      callback, loads);
+  planner.setRunning(true);
+  ASSERT_TRUE(callback->waitFor(num_cycles));
+  planner.setRunning(false);
+
+  // one command per cycle, sent before the end of the cycle
+  const auto deadlines = planner.deadlines();
+  const auto [commands, times] = callback->received();
+  ASSERT_EQ(commands.size(), deadlines.size());
+  for (size_t i = 0; i < num_cycles; ++i) {
+    EXPECT_LE(lateness(times[i], deadlines[i]), SLACK) << "cycle " << i;
+    if (loads[i % loads.size()] > 50.0)
+      EXPECT_EQ(commands[i], SAFE_COMMAND) << "cycle " << i;
+    else
+      EXPECT_EQ(commands[i], (double)i) << "cycle " << i;
+  }
+
+  // the planner is told about every dropped command, and what was sent instead
+  const auto dropped = planner.dropped();
+  ASSERT_EQ(dropped.size(), deadlines.size() / 3);
+  for (size_t k = 0; k < dropped.size(); ++k) {
+    EXPECT_EQ(dropped[k].first, 3 * k + 2);
+    EXPECT_EQ(dropped[k].second, SAFE_COMMAND);
+  }
+
+  // all commands are computed by the same thread
+  const auto thread_ids = planner.threadIds();
+  for (const auto& id : thread_ids) EXPECT_EQ(id, thread_ids.front());
+  EXPECT_NE(thread_ids.front(), std::this_thread::get_id());
+
+  const auto stats = planner.budgetStatistics();
+  EXPECT_EQ(stats.num_cycles, deadlines.size());
+  EXPECT_EQ(stats.num_fallbacks, deadlines.size() / 3);
+  EXPECT_EQ(stats.num_overruns, stats.num_fallbacks);
+  EXPECT_GT(stats.max_usage, 2.0);
+  EXPECT_LT(stats.mean_usage, stats.max_usage);
+}
+
+TEST(BasePathPlanner, anytime_planner_meets_every_deadline) {
+  // wants more time than available, but stops refining at the deadline
+  const std::vector<double> loads{5.0, 200.0};
+  const size_t num_cycles = 6;
+
+  auto callback = std::make_shared<TestCallback>();
+  TestPlanner planner(makeConfig(true), std::make_shared<tactic::OutputCache>(),
+                      callback, loads, true);
+  planner.setRunning(true);
+  ASSERT_TRUE(callback->waitFor(num_cycles));
+  planner.setRunning(false);
+
+  const auto deadlines = planner.deadlines();
+  const auto [commands, times] = callback->received();
+  for (size_t i = 0; i < num_cycles; ++i) {
+    EXPECT_LE(lateness(times[i], deadlines[i]), SLACK) << "cycle " << i;
+    EXPECT_EQ(commands[i], (double)i) << "cycle " << i;
+  }
+  EXPECT_TRUE(planner.dropped().empty());
+  const auto stats = planner.budgetStatistics();
+  EXPECT_EQ(stats.num_fallbacks, 0u);
+  EXPECT_EQ(stats.num_overruns, 0u);
+  EXPECT_LE(stats.max_usage, 1.0);
+}
+
+TEST(BasePathPlanner, late_command_sent_without_fallback) {
+  const std::vector<double> loads{5.0, 80.0};
+  const size_t num_cycles = 4;
+
+  auto callback = std::make_shared<TestCallback>();
+  TestPlanner planner(makeConfig(false),
+                      std::make_shared<tactic::OutputCache>(), callback, loads);
+  planner.setRunning(true);
+  ASSERT_TRUE(callback->waitFor(num_cycles));
+  planner.setRunning(false);
+
+  // the late commands are still sent, after the deadline
+  const auto deadlines = planner.deadlines();
+  const auto [commands, times] = callback->received();
+  for (size_t i = 0; i < num_cycles; ++i) {
+    EXPECT_EQ(commands[i], (double)i) << "cycle " << i;
+    if (i % 2 == 1) EXPECT_GT(lateness(times[i], deadlines[i]), 0.0);
+  }
+  EXPECT_TRUE(planner.dropped().empty());
+  const auto stats = planner.budgetStatistics();
+  EXPECT_EQ(stats.num_fallbacks, 0u);
+  EXPECT_EQ(stats.num_overruns, deadlines.size() / 2);
+}
+
+int main(int argc, char** argv) {
+  configureLogging("", true);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
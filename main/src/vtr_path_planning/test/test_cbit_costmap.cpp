@@ -0,0 +1,203 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_cbit_costmap.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include "vtr_path_planning/cbit/cbit_costmap.hpp"
+
+namespace {
+
+// Costmap with obstacle blobs keyed the same way as DenseCostMap::filter, values in (0, 1] as output by change detection
+void make_costmap(CBITCostmap& costmap, std::mt19937& rng, float dl) {
+  std::uniform_int_distribution<int> center(-40, 40);
+  std::uniform_real_distribution<float> value(0.0f, 1.0f);
+  costmap.grid_resolution = dl;
+  costmap.obs_map.clear();
+  for (int blob = 0; blob < 8; blob++) {
+    const int ci = center(rng), cj = center(rng);
+    for (int i = ci - 4; i <= ci + 4; i++)
+      for (int j = cj - 4; j <= cj + 4; j++) {
+        const int d2 = (i - ci) * (i - ci) + (j - cj) * (j - cj);
+        if (d2 > 16) continue;
+        // include values exactly at the tight threshold
+        const float v = (d2 <= 2) ? 1.0f : ((d2 == 4) ? 0.89f : value(rng));
+        costmap.obs_map[std::make_pair((float)(i * dl), (float)(j * dl))] = v;
+      }
+  }
+
+  Eigen::Matrix4d T_c_w = Eigen::Matrix4d::Identity();
+  const double yaw = std::uniform_real_distribution<double>(-M_PI, M_PI)(rng);
+  T_c_w.block<2, 2>(0, 0) << std::cos(yaw), -std::sin(yaw), std::sin(yaw), std::cos(yaw);
+  T_c_w(0, 3) = 1.3;
+  T_c_w(1, 3) = -0.7;
+  costmap.T_c_w = vtr::tactic::EdgeTransform(T_c_w);
+  costmap.update_grid();
+}
+
+// Previous collision check: lookup of the floored point in obs_map, a miss is free
+bool reference_collision(const CBITCostmap& costmap, const Node& node, bool tight) {
+  Eigen::Matrix<double, 4, 1> test_pt({node.p, node.q, node.z, 1});
+  auto collision_pt = costmap.T_c_w * test_pt;
+  float x_key = floor(collision_pt[0] / costmap.grid_resolution) * costmap.grid_resolution;
+  float y_key = floor(collision_pt[1] / costmap.grid_resolution) * costmap.grid_resolution;
+  float grid_value;
+  try {
+    grid_value = costmap.obs_map.at(std::pair<float, float>(x_key, y_key));
+  } catch (std::out_of_range&) {
+    grid_value = 0.0;
+  }
+  return tight ? (grid_value >= 0.89) : (grid_value > 0.0);
+}
+
+}  // namespace
+
+TEST(CBITCostmap, point_collision_matches_obstacle_map) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> coord(-12.0, 12.0);
+  for (const float dl : {0.1f, 0.25f, 0.3f}) {
+    CBITCostmap costmap;
+    make_costmap(costmap, rng, dl);
+    size_t num_collisions = 0;
+    for (int k = 0; k < 20000; k++) {
+      const Node node(coord(rng), coord(rng), 0.0);
+      for (const bool tight : {false, true}) {
+        const bool expected = reference_collision(costmap, node, tight);
+        EXPECT_EQ(costmap.collision(node, tight), expected);
+        num_collisions += expected;
+      }
+    }
+    EXPECT_GT(num_collisions, 0u);
+  }
+}
+
+TEST(CBITCostmap, clearance_is_distance_to_nearest_obstacle_cell) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> coord(-12.0, 12.0);
+  CBITCostmap costmap;
+  make_costmap(costmap, rng, 0.25f);
+
+  std::vector<std::pair<int, int>> obstacles;
+  for (const auto& cell : costmap.obs_map)
+    if (cell.second > 0.0)
+      obstacles.emplace_back(std::lround(cell.first.first / 0.25f), std::lround(cell.first.second / 0.25f));
+
+  for (int k = 0; k < 2000; k++) {
+    const Node node(coord(rng), coord(rng), 0.0);
+    Eigen::Matrix<double, 4, 1> test_pt({node.p, node.q, node.z, 1});
+    auto pt = costmap.T_c_w * test_pt;
+    const int i = floor(pt[0] / 0.25f), j = floor(pt[1] / 0.25f);
+    double expected = INFINITY;
+    for (const auto& [oi, oj] : obstacles) expected = std::min(expected, std::hypot(oi - i, oj - j) * 0.25f);
+    const double clearance = costmap.clearance(node);
+    // outside of the grid there is no distance information
+    if (clearance == 0.0 && expected > 0.0) continue;
+    EXPECT_NEAR(clearance, expected, 1e-4);
+  }
+}
+
+TEST(CBITCostmap, edge_checker_matches_point_checks) {
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<double> coord(-12.0, 12.0);
+  std::uniform_real_distribution<double> step(0.0, 3.0);
+  for (const float dl : {0.1f, 0.25f}) {
+    CBITCostmap costmap;
+    make_costmap(costmap, rng, dl);
+    for (int k = 0; k < 2000; k++) {
+      // discretized edge as in discrete_collision, a few points per cell
+      const Node start(coord(rng), coord(rng), 0.0);
+      const Node end(start.p + step(rng) - 1.5, start.q + step(rng) - 1.5, 0.0);
+      const int num_points = std::ceil(calc_dist(start, end) * 20.0) + 1;
+      for (const bool tight : {false, true}) {
+        int expected = -1;
+        for (int n = 0; n < num_points && expected < 0; n++) {
+          const double t = (double)n / (num_points - 1);
+          if (reference_collision(costmap, Node(start.p + t * (end.p - start.p), start.q + t * (end.q - start.q), 0.0), tight))
+            expected = n;
+        }
+        CBITCostmap::EdgeChecker edge_checker(costmap, tight);
+        int result = -1;
+        for (int n = 0; n < num_points && result < 0; n++) {
+          const double t = (double)n / (num_points - 1);
+          if (edge_checker.collision(Node(start.p + t * (end.p - start.p), start.q + t * (end.q - start.q), 0.0)))
+            result = n;
+        }
+        EXPECT_EQ(result, expected);
+      }
+    }
+  }
+}
+
+TEST(CBITCostmap, empty_costmap_is_free) {
+  CBITCostmap costmap;
+  costmap.grid_resolution = 0.25;
+  costmap.update_grid();
+  EXPECT_FALSE(costmap.collision(Node(1.0, 2.0, 0.0), false));
+  EXPECT_FALSE(costmap.collision(Node(1.0, 2.0, 0.0), true));
+  EXPECT_EQ(costmap.clearance(Node(1.0, 2.0, 0.0)), INFINITY);
+}
+
+TEST(CBITCostmap, collision_checks_while_updating) {
+  // the planner thread checks collisions while the costmap is updated, every check must see one of the published grids
+  std::mt19937 rng(3);
+  CBITCostmap costmap_a, costmap_b;
+  make_costmap(costmap_a, rng, 0.25f);
+  make_costmap(costmap_b, rng, 0.1f);  // different resolution, extent and transform
+
+  CBITCostmap costmap;
+  costmap.obs_map = costmap_a.obs_map;
+  costmap.T_c_w = costmap_a.T_c_w;
+  costmap.grid_resolution = costmap_a.grid_resolution;
+  costmap.update_grid();
+
+  std::atomic<bool> done{false};
+  std::thread updater([&] {
+    for (int k = 0; k < 200; k++) {
+      const auto& source = (k % 2) ? costmap_a : costmap_b;
+      costmap.obs_map = source.obs_map;
+      costmap.T_c_w = source.T_c_w;
+      costmap.grid_resolution = source.grid_resolution;
+      costmap.update_grid();
+    }
+    done = true;
+  });
+
+  std::uniform_real_distribution<double> coord(-12.0, 12.0);
+  size_t num_checks = 0;
+  while (!done || num_checks < 1000) {
+    const Node node(coord(rng), coord(rng), 0.0);
+    const bool tight = num_checks % 2;
+    const bool collision = costmap.collision(node, tight);
+    EXPECT_TRUE(collision == costmap_a.collision(node, tight) || collision == costmap_b.collision(node, tight));
+    const double clearance = costmap.clearance(node);
+    EXPECT_TRUE(clearance == costmap_a.clearance(node) || clearance == costmap_b.clearance(node));
+    CBITCostmap::EdgeChecker edge_checker(costmap, tight);
+    const bool edge_collision = edge_checker.collision(node);
+    EXPECT_TRUE(edge_collision == costmap_a.collision(node, tight) || edge_collision == costmap_b.collision(node, tight));
+    num_checks++;
+  }
+  updater.join();
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
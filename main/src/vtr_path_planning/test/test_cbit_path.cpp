@@ -0,0 +1,123 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_cbit_path.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "vtr_path_planning/cbit/generate_pq.hpp"
+
+namespace {
+
+// Teach path with uneven spacing, a repeated pose and a heading which wraps around +-pi
+std::vector<Pose> make_path(std::mt19937& rng, int num_poses) {
+  std::uniform_real_distribution<double> step(0.05, 0.6);
+  std::uniform_real_distribution<double> turn(-0.3, 0.3);
+  std::vector<Pose> path;
+  double x = 0.0, y = 0.0, z = 0.0, yaw = 3.0;
+  for (int i = 0; i < num_poses; i++) {
+    path.emplace_back(x, y, z, 0.0, 0.0, yaw);
+    if (i == num_poses / 2) path.push_back(path.back());
+    const double ds = step(rng);
+    x += ds * std::cos(yaw);
+    y += ds * std::sin(yaw);
+    z += 0.02 * ds;
+    yaw += turn(rng);
+    if (yaw > M_PI) yaw -= 2.0 * M_PI;
+    if (yaw < -M_PI) yaw += 2.0 * M_PI;
+  }
+  return path;
+}
+
+// Previous conversion: bisection over p, then linear interpolation of the two path poses
+Node reference_curve_to_euclid(const CBITPath& global_path, const Node& node) {
+  const double p_val = node.p, q_val = node.q;
+  const int p_ind = bisection(global_path.p, p_val);
+  Pose pose_c;
+  if (p_val >= global_path.p.back()) {
+    pose_c = global_path.path.back();
+  } else {
+    const double p_lower = global_path.p[p_ind], p_upper = global_path.p[p_ind + 1];
+    const Pose& start_pose = global_path.path[p_ind];
+    const Pose& end_pose = global_path.path[p_ind + 1];
+    const double t = (p_val - p_lower) / (p_upper - p_lower);
+    const double angle_difference =
+        std::fmod((std::fmod((end_pose.yaw - start_pose.yaw), (2.0 * M_PI)) + (3.0 * M_PI)), (2.0 * M_PI)) - M_PI;
+    pose_c = Pose(start_pose.x + t * (end_pose.x - start_pose.x), start_pose.y + t * (end_pose.y - start_pose.y),
+                  start_pose.z + t * (end_pose.z - start_pose.z), 0.0, 0.0, start_pose.yaw + t * angle_difference);
+  }
+  return Node(pose_c.x - sin(pose_c.yaw) * q_val, pose_c.y + cos(pose_c.yaw) * q_val, pose_c.z);
+}
+
+void expect_near(const Node& a, const Node& b) {
+  EXPECT_NEAR(a.p, b.p, 1e-9);
+  EXPECT_NEAR(a.q, b.q, 1e-9);
+  EXPECT_NEAR(a.z, b.z, 1e-9);
+}
+
+}  // namespace
+
+TEST(CBITPath, curve_to_euclid_matches_bisection) {
+  std::mt19937 rng(3);
+  CBITConfig config;
+  const CBITPath global_path(config, make_path(rng, 500));
+  const double p_max = global_path.p.back();
+  std::uniform_real_distribution<double> p_dist(0.0, p_max);
+  std::uniform_real_distribution<double> q_dist(-2.5, 2.5);
+
+  // random points, every path pose, and the end of the path
+  for (int k = 0; k < 20000; k++) {
+    const Node node(p_dist(rng), q_dist(rng));
+    expect_near(global_path.curve_to_euclid(node), reference_curve_to_euclid(global_path, node));
+  }
+  for (const double p : global_path.p) {
+    const Node node(p, q_dist(rng));
+    expect_near(global_path.curve_to_euclid(node), reference_curve_to_euclid(global_path, node));
+  }
+  for (const double p : {p_max, p_max + 1.0}) {
+    const Node node(p, 0.7);
+    expect_near(global_path.curve_to_euclid(node), reference_curve_to_euclid(global_path, node));
+  }
+}
+
+TEST(CBITPath, batch_curve_to_euclid_matches_single) {
+  std::mt19937 rng(4);
+  CBITConfig config;
+  const CBITPath global_path(config, make_path(rng, 300));
+  const double p_max = global_path.p.back();
+  std::uniform_real_distribution<double> p_dist(0.0, p_max);
+  std::uniform_real_distribution<double> q_dist(-2.5, 2.5);
+
+  for (int edge = 0; edge < 500; edge++) {
+    // discretized edge in either direction, sometimes running past the end of the path
+    const Node start(p_dist(rng), q_dist(rng));
+    const Node end((edge % 10 == 0) ? p_max + 0.5 : p_dist(rng), q_dist(rng));
+    const std::vector<double> p_test = linspace(start.p, end.p, 40);
+    const std::vector<double> q_test = linspace(start.q, end.q, 40);
+    std::vector<Node> euclid_test;
+    global_path.curve_to_euclid(p_test, q_test, euclid_test);
+    ASSERT_EQ(euclid_test.size(), p_test.size());
+    for (size_t i = 0; i < p_test.size(); i++)
+      expect_near(euclid_test[i], reference_curve_to_euclid(global_path, Node(p_test[i], q_test[i])));
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_cbit_queues.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "vtr_path_planning/cbit/utils.hpp"
+
+namespace {
+
+using NodePtr = std::shared_ptr<Node>;
+using Edge = std::tuple<NodePtr, NodePtr>;
+
+}  // namespace
+
+// Pops in the same order as a multimap, including the insertion order of equal keys, with erased entries skipped
+TEST(CBITQueues, heap_matches_multimap_order) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> key(0, 50);  // lots of equal keys
+  std::uniform_int_distribution<int> op(0, 9);
+
+  IndexedHeap<int> heap;
+  std::multimap<double, int> reference;
+  // item i was pushed as entries[i], live[i] while it is in the queue
+  std::vector<std::pair<IndexedHeap<int>::Handle, std::multimap<double, int>::iterator>> entries;
+  std::vector<bool> live;
+  int next_item = 0;
+  for (int i = 0; i < 20000; i++) {
+    const int o = op(rng);
+    if (o < 5 || reference.empty()) {
+      const double k = key(rng);
+      entries.emplace_back(heap.push(k, next_item), reference.emplace(k, next_item));
+      live.push_back(true);
+      next_item++;
+    } else if (o < 7) {
+      // erase a random live entry
+      std::uniform_int_distribution<size_t> pick(0, entries.size() - 1);
+      const size_t j = pick(rng);
+      if (!live[j]) continue;
+      ASSERT_TRUE(heap.contains(entries[j].first));
+      heap.erase(entries[j].first);
+      reference.erase(entries[j].second);
+      live[j] = false;
+    } else {
+      ASSERT_EQ(heap.top_key(), reference.begin()->first);
+      ASSERT_EQ(heap.pop(), reference.begin()->second);
+      live[reference.begin()->second] = false;
+      reference.erase(reference.begin());
+    }
+    ASSERT_EQ(heap.size(), reference.size());
+  }
+  while (!reference.empty()) {
+    ASSERT_EQ(heap.pop(), reference.begin()->second);
+    reference.erase(reference.begin());
+  }
+  EXPECT_TRUE(heap.empty());
+  EXPECT_EQ(heap.top_key(), INFINITY);
+}
+
+TEST(CBITQueues, heap_update_key) {
+  IndexedHeap<int> heap;
+  const auto a = heap.push(5.0, 0);
+  const auto b = heap.push(3.0, 1);
+  heap.push(3.0, 2);
+  heap.update(a, 1.0);  // decrease
+  heap.update(b, 4.0);  // increase, now behind item 2
+  EXPECT_EQ(heap.size(), 3u);
+  EXPECT_EQ(heap.top_key(), 1.0);
+  EXPECT_EQ(heap.pop(), 0);
+  EXPECT_EQ(heap.pop(), 2);
+  EXPECT_EQ(heap.key(b), 4.0);
+  EXPECT_EQ(heap.pop(), 1);
+  EXPECT_TRUE(heap.empty());
+  EXPECT_FALSE(heap.contains(a));
+}
+
+TEST(CBITQueues, edge_queue_erase_edges_to_node) {
+  std::vector<NodePtr> nodes;
+  for (int i = 0; i < 4; i++) nodes.push_back(std::make_shared<Node>(i, 0.0));
+  EdgeQueue queue;
+  // edges i -> j keyed on 10 * i + j
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      if (i != j) queue.push(10.0 * i + j, Edge{nodes[i], nodes[j]});
+  ASSERT_EQ(queue.size(), 12u);
+
+  // drop the edges into node 2 starting at node 0 or 3
+  queue.erase_if_to(nodes[2], [&](const Edge& e) { return std::get<0>(e) != nodes[1]; });
+  EXPECT_EQ(queue.size(), 10u);
+  // popping keeps the remaining per node lists consistent
+  EXPECT_EQ(std::get<1>(queue.pop()), nodes[1]);  // 0 -> 1
+  queue.erase_if_to(nodes[1], [](const Edge&) { return true; });
+  EXPECT_EQ(queue.size(), 7u);
+
+  std::vector<double> keys;
+  while (!queue.empty()) {
+    keys.push_back(queue.top_key());
+    const auto edge = queue.pop();
+    EXPECT_NE(std::get<1>(edge), nodes[1]);
+  }
+  EXPECT_EQ(keys, (std::vector<double>{3.0, 10.0, 12.0, 13.0, 20.0, 23.0, 30.0}));
+
+  // cleared queues do not leave stale lists behind
+  queue.push(1.0, Edge{nodes[0], nodes[2]});
+  queue.clear();
+  queue.push(2.0, Edge{nodes[1], nodes[3]});
+  queue.erase_if_to(nodes[2], [](const Edge&) { return true; });
+  EXPECT_EQ(queue.size(), 1u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
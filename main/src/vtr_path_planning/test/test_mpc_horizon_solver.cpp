@@ -0,0 +1,138 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_mpc_horizon_solver.cpp
+ * \author Jordy Sehn, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <Eigen/Dense>
+
+#include "vtr_path_planning/mpc/banded_cholesky.hpp"
+#include "vtr_path_planning/mpc/mpc_path_planner2.hpp"
+
+using namespace ::testing;
+using namespace vtr::path_planning;
+
+namespace {
+
+// Gauss-Newton system of a horizon with stages of (velocity, pose) where each
+// residual couples a stage with the next one
+Eigen::SparseMatrix<double> make_horizon_hessian(int K, std::mt19937& rng, bool upper) {
+  const int s = 8, n = s * K;
+  std::normal_distribution<double> normal;
+  std::vector<Eigen::Triplet<double>> triplets;
+  for (int k = 0; k < K; k++)
+    for (int r = 0; r < 2 * s; r++)
+      for (int c = k * s; c < std::min(n, (k + 2) * s); c++) triplets.emplace_back(2 * k * s + r, c, normal(rng));
+  Eigen::SparseMatrix<double> J(2 * n, n);
+  J.setFromTriplets(triplets.begin(), triplets.end());
+  Eigen::SparseMatrix<double> I(n, n);
+  I.setIdentity();
+  Eigen::SparseMatrix<double> A = Eigen::SparseMatrix<double>(J.transpose() * J) + 1e-3 * I;
+  if (upper) A = Eigen::SparseMatrix<double>(A.triangularView<Eigen::Upper>());
+  return A;
+}
+
+lgmath::se3::Transformation to_transform(double x, double y, double yaw) {
+  Eigen::Matrix4d T = Eigen::Matrix4d::Identity();
+  T.block<2, 2>(0, 0) << std::cos(yaw), -std::sin(yaw), std::sin(yaw), std::cos(yaw);
+  T(0, 3) = x;
+  T(1, 3) = y;
+  return lgmath::se3::Transformation(T);
+}
+
+// Tracking a curved reference starting off the path, with the default grizzly covariances and weights
+mpc_result solve_tracking_problem(CorridorMPC& mpc, int K, double DT, double offset) {
+  std::vector<lgmath::se3::Transformation> measurements;
+  for (int i = 0; i < K; i++) {
+    const double s = i * DT, yaw = 0.3 * std::sin(0.5 * s);
+    measurements.push_back(to_transform(s, 0.5 * std::sin(0.3 * s), yaw).inverse());
+  }
+  const std::vector<double> barrier_q_left(K, 1.5), barrier_q_right(K, -1.5);
+
+  Eigen::Matrix<double, 6, 6> pose_noise_vect = Eigen::Matrix<double, 6, 6>::Zero();
+  pose_noise_vect.diagonal() << 100.0, 100.0, 1000.0, 1000.0, 1000.0, 200.0;
+  Eigen::Matrix<double, 2, 2> vel_noise_vect = Eigen::Matrix<double, 2, 2>::Zero();
+  vel_noise_vect.diagonal() << 25.0, 10.0;
+  Eigen::Matrix<double, 2, 2> accel_noise_vect = Eigen::Matrix<double, 2, 2>::Zero();
+  accel_noise_vect.diagonal() << 10.0, 10.0;
+  Eigen::Matrix<double, 6, 6> kin_noise_vect = Eigen::Matrix<double, 6, 6>::Identity() * 0.001;
+  Eigen::Matrix<double, 1, 1> lat_noise_vect;
+  lat_noise_vect << 20.0;
+
+  Eigen::Matrix<double, 2, 1> previous_vel;
+  previous_vel << 0.5, 0.0;
+  return mpc.Solve(previous_vel, to_transform(0.0, offset, 0.0), measurements, measurements, barrier_q_left,
+                   barrier_q_right, K, DT, 1.0, lat_noise_vect, pose_noise_vect, vel_noise_vect, accel_noise_vect,
+                   kin_noise_vect, false, 1.0, 1.0, 1.0, 1.0, 0.01, std::numeric_limits<double>::infinity());
+}
+
+}  // namespace
+
+TEST(MPCHorizonSolver, banded_cholesky_matches_dense) {
+  std::mt19937 rng(0);
+  for (const bool upper : {true, false}) {
+    for (const int K : {1, 2, 10, 40}) {
+      const auto A = make_horizon_hessian(K, rng, upper);
+      const Eigen::MatrixXd A_dense =
+          upper ? Eigen::MatrixXd(Eigen::MatrixXd(A).selfadjointView<Eigen::Upper>()) : Eigen::MatrixXd(A);
+      const Eigen::VectorXd b = Eigen::VectorXd::Random(A.rows());
+
+      BandedCholesky cholesky;
+      ASSERT_TRUE(cholesky.compute(A));
+      // two stages of 8 variables
+      EXPECT_LE(cholesky.bandwidth(), 15);
+      const Eigen::VectorXd x = cholesky.solve(b);
+      const Eigen::VectorXd x_ref = A_dense.llt().solve(b);
+      EXPECT_LT((x - x_ref).norm() / x_ref.norm(), 1e-9) << "K: " << K << ", upper: " << upper;
+    }
+  }
+}
+
+TEST(MPCHorizonSolver, banded_cholesky_rejects_indefinite) {
+  Eigen::SparseMatrix<double> A(2, 2);
+  A.insert(0, 0) = 1.0;
+  A.insert(1, 1) = -1.0;
+  BandedCholesky cholesky;
+  EXPECT_FALSE(cholesky.compute(A));
+}
+
+TEST(MPCHorizonSolver, banded_solver_reaches_sparse_optimum) {
+  for (const int K : {10, 20, 60}) {
+    CorridorMPC sparse_mpc("sparse"), banded_mpc("banded");
+    // cold start then two warm started cycles
+    for (const double offset : {0.3, 0.25, 0.2}) {
+      const auto sparse = solve_tracking_problem(sparse_mpc, K, 6.0 / K, offset);
+      const auto banded = solve_tracking_problem(banded_mpc, K, 6.0 / K, offset);
+      EXPECT_NEAR(sparse.applied_vel(0), banded.applied_vel(0), 1e-6) << "K: " << K;
+      EXPECT_NEAR(sparse.applied_vel(1), banded.applied_vel(1), 1e-6) << "K: " << K;
+      ASSERT_EQ(sparse.mpc_poses.size(), banded.mpc_poses.size());
+      for (size_t i = 0; i < sparse.mpc_poses.size(); i++)
+        EXPECT_LT((sparse.mpc_poses[i].inverse() * banded.mpc_poses[i]).vec().norm(), 1e-6) << "K: " << K;
+    }
+  }
+}
+
+TEST(MPCHorizonSolver, unknown_solver_throws) {
+  EXPECT_THROW(CorridorMPC mpc("dense"), std::invalid_argument);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -18,19 +18,21 @@
  */
 #pragma once
 
-#include "vtr_lidar/data_types/pointmap.hpp"
+#include "vtr_pointcloud/data_types/pointmap.hpp"
 
 #include "pcl_conversions/pcl_conversions.h"
 
 #include "vtr_common/conversions/ros_lgmath.hpp"
 
 namespace vtr {
-namespace lidar {
+namespace pointcloud {
 
-template <class PointT>
-auto PointMap<PointT>::fromStorable(const PointMapMsg& storable) -> Ptr {
+template <class PointT, class MsgTraits>
+auto PointMap<PointT, MsgTraits>::fromStorable(const PointMapMsg& storable)
+    -> Ptr {
   // construct with dl and version
-  auto data = std::make_shared<PointMap<PointT>>(storable.dl, storable.version);
+  auto data = std::make_shared<PointMap<PointT, MsgTraits>>(storable.dl,
+                                                            storable.version);
   // load point cloud data
   pcl::fromROSMsg(storable.point_cloud, data->point_cloud_);
   // load vertex id
@@ -53,8 +55,8 @@ auto PointMap<PointT>::fromStorable(const PointMapMsg& storable) -> Ptr {
   return data;
 }
 
-template <class PointT>
-auto PointMap<PointT>::toStorable() const -> PointMapMsg {
+template <class PointT, class MsgTraits>
+auto PointMap<PointT, MsgTraits>::toStorable() const -> PointMapMsg {
   PointMapMsg storable;
   // save point cloud data
   pcl::toROSMsg(this->point_cloud_, storable.point_cloud);
@@ -70,10 +72,10 @@ auto PointMap<PointT>::toStorable() const -> PointMapMsg {
   return storable;
 }
 
-template <class PointT>
+template <class PointT, class MsgTraits>
 template <class Callback>
-void PointMap<PointT>::update(const PointCloudType& point_cloud,
-                              const Callback& callback) {
+void PointMap<PointT, MsgTraits>::update(const PointCloudType& point_cloud,
+                                         const Callback& callback) {
   // reserve new space if needed
   if (samples_.empty()) samples_.reserve(10 * point_cloud.size());
   this->point_cloud_.reserve(this->point_cloud_.size() + point_cloud.size());
@@ -88,9 +90,9 @@ void PointMap<PointT>::update(const PointCloudType& point_cloud,
   }
 }
 
-template <class PointT>
+template <class PointT, class MsgTraits>
 template <class Callback>
-void PointMap<PointT>::filter(const Callback& callback) {
+void PointMap<PointT, MsgTraits>::filter(const Callback& callback) {
   //
   std::vector<int> indices;
   indices.reserve(this->point_cloud_.size());
@@ -112,5 +114,5 @@ void PointMap<PointT>::filter(const Callback& callback) {
   }
 }
 
-}  // namespace lidar
+}  // namespace pointcloud
 }  // namespace vtr
\ No newline at end of file
@@ -0,0 +1,134 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file pointmap_merging.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ * \brief Merging of many point clouds (e.g. the submaps of a long route) into
+ * a point map with bounded memory.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "vtr_pointcloud/data_types/pointmap.hpp"
+
+namespace vtr {
+namespace pointcloud {
+
+namespace pointmap_merging {
+
+/**
+ * \brief Estimated memory of a point reduced into a point map: the point,
+ * its voxel hash node and the buckets reserved by PointMap::update.
+ */
+template <class PointT>
+constexpr size_t bytesPerPoint() {
+  return sizeof(PointT) + sizeof(std::pair<const pointmap::VoxKey, size_t>) +
+         2 * sizeof(void*) + 10 * sizeof(void*);
+}
+
+/**
+ * \brief Number of sources of the next batch: as many sources as large as the
+ * largest one loaded so far fit the budget, at least one.
+ */
+template <class PointT>
+size_t batchSize(const size_t max_source_size, const size_t memory_budget) {
+  const size_t bytes_per_source = max_source_size * bytesPerPoint<PointT>();
+  if (bytes_per_source == 0) return std::numeric_limits<size_t>::max();
+  return std::max(memory_budget / bytes_per_source, size_t(1));
+}
+
+}  // namespace pointmap_merging
+
+/**
+ * \brief Merges point clouds into a point map in the given order, the result
+ * is the same as calling map.update on each of them one after another.
+ * \details The sources are streamed in batches: each source of a batch is
+ * loaded and reduced to its first point per voxel in parallel, then the batch
+ * is merged in order and released before the next one is loaded. Source sizes
+ * are not needed upfront: the first batch has one source per thread, the
+ * following ones as many sources as fit memory_budget if they are as large as
+ * the largest source loaded so far. Memory used by the merge is thus bounded
+ * by the budget plus one load buffer per thread (as long as sources are not
+ * much larger than the ones before), instead of growing with the number of
+ * sources. Memory held by load itself (e.g. a cache of the sources)
+ * is not accounted for.
+ * With max_range > 0, loaded points farther than max_range from the map
+ * origin by more than a voxel are dropped: every point of their voxel is
+ * beyond max_range, so a crop of the merged map at max_range (e.g. the crop
+ * box of the intra-experience merging) would remove the voxel anyway.
+ * \param map point map to merge into
+ * \param num_sources number of sources, merged in order 0 to num_sources - 1
+ * \param load load(i, point_cloud) fills point_cloud with source i in the
+ * frame of the map, called concurrently for different sources
+ * \param max_range range beyond which the merged map is cropped, <= 0 to keep
+ * all points
+ * \param memory_budget memory of the sources held at once, in bytes
+ * \param num_threads threads loading the sources of a batch
+ */
+template <class PointT, class MsgTraits, class LoadCallback>
+void streamingMerge(PointMap<PointT, MsgTraits>& map, const size_t num_sources,
+                    const LoadCallback& load, const float max_range,
+                    const size_t memory_budget, const int num_threads = 1) {
+  using PointMapType = PointMap<PointT, MsgTraits>;
+  // voxel diagonal (sqrt(3) dl) with some room for rounding
+  const float sq_max_range = std::pow(max_range + 2.0f * map.dl(), 2);
+
+  std::vector<std::unique_ptr<PointMapType>> reduced_maps;
+  size_t batch = std::max(num_threads, 1), max_source_size = 0;
+  for (size_t begin = 0; begin < num_sources;) {
+    const size_t end = begin + std::min(batch, num_sources - begin);
+    const int batch_size = (int)(end - begin);
+    reduced_maps.resize(batch_size);
+    std::vector<size_t> source_sizes(batch_size);
+#pragma omp parallel num_threads(num_threads)
+    {
+      // loaded points, reused for all sources reduced by this thread
+      typename PointMapType::PointCloudType point_cloud;
+#pragma omp for schedule(dynamic, 1)
+      for (int i = 0; i < batch_size; ++i) {
+        load(begin + i, point_cloud);
+        source_sizes[i] = point_cloud.size();
+        if (max_range > 0) {
+          const auto out_of_range = [&sq_max_range](const PointT& p) {
+            return p.getVector3fMap().squaredNorm() > sq_max_range;
+          };
+          point_cloud.erase(std::remove_if(point_cloud.begin(),
+                                           point_cloud.end(), out_of_range),
+                            point_cloud.end());
+        }
+        reduced_maps[i] = std::make_unique<PointMapType>(map.dl());
+        reduced_maps[i]->update(point_cloud);
+      }
+    }
+
+    // merge in order, so that the same point wins every voxel
+    for (auto& reduced_map : reduced_maps) {
+      map.update(reduced_map->point_cloud());
+      reduced_map.reset();
+    }
+    begin = end;
+    for (const auto& size : source_sizes)
+      max_source_size = std::max(max_source_size, size);
+    batch = pointmap_merging::batchSize<PointT>(max_source_size, memory_budget);
+  }
+}
+
+}  // namespace pointcloud
+}  // namespace vtr
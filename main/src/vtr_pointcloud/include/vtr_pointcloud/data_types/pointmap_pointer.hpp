@@ -0,0 +1,72 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file pointmap_pointer.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include "vtr_common/conversions/ros_lgmath.hpp"
+#include "vtr_tactic/types.hpp"
+
+namespace vtr {
+namespace pointcloud {
+
+/**
+ * \brief Points a vertex to the vertex that stores its point map.
+ * \tparam PointMapPointerMsgT ROS2 message of the sensor package
+ */
+template <class PointMapPointerMsgT>
+struct PointMapPointer {
+  PTR_TYPEDEFS(PointMapPointer);
+  using PointMapPointerMsg = PointMapPointerMsgT;
+
+  /// for vtr storage
+  /** \brief construct from a storable message */
+  static Ptr fromStorable(const PointMapPointerMsg& storable) {
+    //
+    auto data = std::make_shared<PointMapPointer>();
+    // load vertex ids
+    data->this_vid = tactic::VertexId(storable.this_vid);
+    data->map_vid = tactic::VertexId(storable.map_vid);
+    // load transform
+    using namespace vtr::common;
+    conversions::fromROSMsg(storable.t_v_this_map, data->T_v_this_map);
+    //
+    return data;
+  }
+
+  /** \brief to storable message */
+  PointMapPointerMsg toStorable() const {
+    //
+    PointMapPointerMsg storable;
+    // save vertex ids
+    storable.this_vid = this->this_vid;
+    storable.map_vid = this->map_vid;
+    // save transform
+    using namespace vtr::common;
+    conversions::toROSMsg(this->T_v_this_map, storable.t_v_this_map);
+    //
+    return storable;
+  }
+
+  /// data
+  tactic::VertexId this_vid = tactic::VertexId::Invalid();
+  tactic::VertexId map_vid = tactic::VertexId::Invalid();
+  tactic::EdgeTransform T_v_this_map = tactic::EdgeTransform(true);
+};
+
+}  // namespace pointcloud
+}  // namespace vtr
@@ -0,0 +1,70 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file pointscan.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include "pcl/point_cloud.h"
+
+#include "vtr_tactic/types.hpp"
+
+namespace vtr {
+namespace pointcloud {
+
+/**
+ * \brief Point cloud associated with a vertex of the pose graph.
+ * \tparam PointT point type of the sensor pipeline
+ * \tparam PointScanMsgT ROS2 message used to store the scan (each sensor
+ * package defines its own, all with the same fields)
+ */
+template <class PointT, class PointScanMsgT>
+class PointScan {
+ public:
+  using PointCloudType = pcl::PointCloud<PointT>;
+  PTR_TYPEDEFS(PointScan);
+
+  using PointScanMsg = PointScanMsgT;
+  /** \brief Static function that constructs this class from ROS2 message */
+  static Ptr fromStorable(const PointScanMsg& storable);
+  /** \brief Returns the ROS2 message to be stored */
+  PointScanMsg toStorable() const;
+
+  virtual ~PointScan() = default;
+
+  size_t size() const { return point_cloud_.size(); }
+
+  PointCloudType& point_cloud() { return point_cloud_; }
+  const PointCloudType& point_cloud() const { return point_cloud_; }
+
+  tactic::VertexId& vertex_id() { return vertex_id_; }
+  const tactic::VertexId& vertex_id() const { return vertex_id_; }
+
+  tactic::EdgeTransform& T_vertex_this() { return T_vertex_this_; }
+  const tactic::EdgeTransform& T_vertex_this() const { return T_vertex_this_; }
+
+ protected:
+  PointCloudType point_cloud_;
+  /** \brief the associated vertex id */
+  tactic::VertexId vertex_id_ = tactic::VertexId::Invalid();
+  /** \brief the transform from this scan/map to its associated vertex */
+  tactic::EdgeTransform T_vertex_this_ = tactic::EdgeTransform(true);
+};
+
+}  // namespace pointcloud
+}  // namespace vtr
+
+#include "vtr_pointcloud/data_types/pointscan.inl"
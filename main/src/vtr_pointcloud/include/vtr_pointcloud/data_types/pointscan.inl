@@ -18,19 +18,20 @@
  */
 #pragma once
 
-#include "vtr_radar/data_types/pointscan.hpp"
+#include "vtr_pointcloud/data_types/pointscan.hpp"
 
 #include "pcl_conversions/pcl_conversions.h"
 
 #include "vtr_common/conversions/ros_lgmath.hpp"
 
 namespace vtr {
-namespace radar {
+namespace pointcloud {
 
-template <class PointT>
-auto PointScan<PointT>::fromStorable(const PointScanMsg& storable) -> Ptr {
+template <class PointT, class PointScanMsgT>
+auto PointScan<PointT, PointScanMsgT>::fromStorable(
+    const PointScanMsg& storable) -> Ptr {
   // construct with dl
-  auto data = std::make_shared<PointScan<PointT>>();
+  auto data = std::make_shared<PointScan<PointT, PointScanMsgT>>();
   // load point cloud data
   pcl::fromROSMsg(storable.point_cloud, data->point_cloud_);
   // load vertex id
@@ -41,8 +42,8 @@ auto PointScan<PointT>::fromStorable(const PointScanMsg& storable) -> Ptr {
   return data;
 }
 
-template <class PointT>
-auto PointScan<PointT>::toStorable() const -> PointScanMsg {
+template <class PointT, class PointScanMsgT>
+auto PointScan<PointT, PointScanMsgT>::toStorable() const -> PointScanMsg {
   PointScanMsg storable;
   // save point cloud data
   pcl::toROSMsg(this->point_cloud_, storable.point_cloud);
@@ -54,5 +55,5 @@ auto PointScan<PointT>::toStorable() const -> PointScanMsg {
   return storable;
 }
 
-}  // namespace radar
-}  // namespace vtr
\ No newline at end of file
+}  // namespace pointcloud
+}  // namespace vtr
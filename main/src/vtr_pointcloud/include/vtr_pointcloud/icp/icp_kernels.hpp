@@ -0,0 +1,142 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file icp_kernels.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ * \brief Sensor agnostic data association and weighting of the ICP modules.
+ * The sensor specific behaviour is given by a matching policy:
+ *  - bool accept(step, query_pt, map_pt): keeps or rejects a nearest neighbor
+ *    pair that passed the distance check
+ *  - bool information(map_pt, W): information matrix of a pair, returns false
+ *    to skip the pair
+ */
+#pragma once
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "vtr_pointcloud/utils/nanoflann_utils.hpp"
+
+namespace vtr {
+namespace pointcloud {
+namespace icp {
+
+/** \brief (query index, map index) pairs */
+using Associations = std::vector<std::pair<size_t, size_t>>;
+
+/**
+ * \brief Point to plane matching (lidar): after the first steps, pairs
+ * farther than max_planar_dist from the plane of the map point are rejected,
+ * and each pair is weighted by n * n^T scaled by the map point normal score.
+ */
+struct PointToPlanePolicy {
+  PointToPlanePolicy(const int first_steps, const float max_planar_dist)
+      : first_steps(first_steps), max_planar_dist(max_planar_dist) {}
+
+  template <class PointT>
+  bool accept(const int step, const PointT& qry_pt,
+              const PointT& map_pt) const {
+    // only after a few steps for initial alignment
+    if (step < first_steps) return true;
+    const auto diff = qry_pt.getVector3fMap() - map_pt.getVector3fMap();
+    const float planar_dist = std::abs(diff.dot(map_pt.getNormalVector3fMap()));
+    return planar_dist < max_planar_dist;
+  }
+
+  template <class PointT>
+  bool information(const PointT& map_pt, Eigen::Matrix3d& W) const {
+    if (map_pt.normal_score <= 0.0) return false;
+    const Eigen::Vector3d nrm =
+        map_pt.getNormalVector3fMap().template cast<double>();
+    W = map_pt.normal_score * (nrm * nrm.transpose()) +
+        1e-5 * Eigen::Matrix3d::Identity();
+    return true;
+  }
+
+  const int first_steps;
+  const float max_planar_dist;
+};
+
+/**
+ * \brief Point to point matching (radar): every pair within the pairing
+ * distance is kept with identity information. Doppler compensation lives in
+ * the error terms of the radar modules, not in the weighting.
+ */
+struct PointToPointPolicy {
+  template <class PointT>
+  bool accept(const int, const PointT&, const PointT&) const {
+    return true;
+  }
+
+  template <class PointT>
+  bool information(const PointT&, Eigen::Matrix3d& W) const {
+    W = Eigen::Matrix3d::Identity();
+    return true;
+  }
+};
+
+/**
+ * \brief Nearest map point of the sampled query points, searched in batch
+ * (see batchNearestNeighbors).
+ * \param[in] kdtree kd-tree of the map
+ * \param[in] query_points query points already aligned to the map frame
+ * \param[in,out] sample_inds (sampled query index, nearest map point index)
+ * \param[out] nn_dists squared distance to the nearest map point
+ */
+template <class PointT, class QueryPointT>
+void findNearestNeighbors(const KDTree<PointT>& kdtree,
+                          const pcl::PointCloud<QueryPointT>& query_points,
+                          Associations& sample_inds,
+                          std::vector<float>& nn_dists,
+                          const int num_threads) {
+  nn_dists.resize(sample_inds.size());
+  nanoflann_batch::nearestNeighbors(
+      kdtree, sample_inds.size(),
+      [&](const size_t i) { return query_points[sample_inds[i].first].data; },
+      [&](const size_t i, const size_t index, const float dist) {
+        sample_inds[i].second = index;
+        nn_dists[i] = dist;
+      },
+      num_threads);
+}
+
+/**
+ * \brief Keeps the pairs closer than the pairing distance that the policy
+ * accepts, in query order.
+ */
+template <class PointT, class Policy>
+Associations filterAssociations(const pcl::PointCloud<PointT>& query_points,
+                                const pcl::PointCloud<PointT>& map_points,
+                                const Associations& sample_inds,
+                                const std::vector<float>& nn_dists,
+                                const float max_pair_d2, const int step,
+                                const Policy& policy) {
+  Associations filtered_sample_inds;
+  filtered_sample_inds.reserve(sample_inds.size());
+  for (size_t i = 0; i < sample_inds.size(); i++) {
+    if (nn_dists[i] < max_pair_d2 &&
+        policy.accept(step, query_points[sample_inds[i].first],
+                      map_points[sample_inds[i].second]))
+      filtered_sample_inds.push_back(sample_inds[i]);
+  }
+  return filtered_sample_inds;
+}
+
+}  // namespace icp
+}  // namespace pointcloud
+}  // namespace vtr
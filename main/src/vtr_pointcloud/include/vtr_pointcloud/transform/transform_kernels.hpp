@@ -0,0 +1,176 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file transform_kernels.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ * \brief Rigid transformation of point clouds whose points carry a cartesian
+ * (data) and a normal (data_n) vector, e.g. lidar and radar PointWithInfo.
+ * Positions and normals are transformed in a single pass over the cloud, each
+ * as one 4-float vector: the columns of the rotation are broadcast and summed
+ * in SIMD registers, so the point stride never has to be gathered. Large
+ * clouds are split over threads.
+ * The transform must be rigid: positions get C * p + r with data[3] = 1 and
+ * normals get C * n with data_n[3] = 0.
+ */
+#pragma once
+
+#include <Eigen/Core>
+
+#include "pcl/point_cloud.h"
+
+namespace vtr {
+namespace pointcloud {
+
+namespace transform_kernels {
+
+/// clouds smaller than this are not worth spreading over threads
+constexpr size_t MIN_PARALLEL_SIZE = 4096;
+
+/** \brief Columns of a rigid transform, laid out for transformVector */
+struct Columns {
+  Columns(const Eigen::Matrix4f& T) {
+    c0 << T.block<3, 1>(0, 0), 0.f;
+    c1 << T.block<3, 1>(0, 1), 0.f;
+    c2 << T.block<3, 1>(0, 2), 0.f;
+    r << T.block<3, 1>(0, 3), 1.f;
+  }
+  Eigen::Array4f c0, c1, c2, r;
+};
+
+/**
+ * \brief out = c0 * in[0] + c1 * in[1] + c2 * in[2] (+ r for positions),
+ * in and out may alias.
+ */
+template <bool Position>
+inline void transformVector(const Columns& T, const float* in, float* out) {
+  const float x = in[0], y = in[1], z = in[2];
+  Eigen::Map<Eigen::Array4f, Eigen::Aligned16> res(out);
+  if (Position)
+    res = T.c0 * x + T.c1 * y + T.c2 * z + T.r;
+  else
+    res = T.c0 * x + T.c1 * y + T.c2 * z;
+}
+
+template <bool Copy, bool Normals, class PointT>
+void transformPoints(const Columns& T, const PointT* src, PointT* dst,
+                     const size_t size, const int num_threads) {
+#pragma omp parallel for schedule(static) num_threads(num_threads) if (size >= MIN_PARALLEL_SIZE)
+  for (size_t i = 0; i < size; ++i) {
+    if (Copy) dst[i] = src[i];
+    transformVector<true>(T, src[i].data, dst[i].data);
+    if (Normals) transformVector<false>(T, src[i].data_n, dst[i].data_n);
+  }
+}
+
+/**
+ * \brief Transforms src[0, size) into dst[0, size), src and dst are either
+ * the same or do not overlap. When they differ, the fields that are not
+ * transformed are copied from src to dst in the same pass.
+ */
+template <class PointT>
+void transformPoints(const Eigen::Matrix4f& T, const PointT* src, PointT* dst,
+                     const size_t size, const bool with_normals,
+                     const int num_threads) {
+  const Columns columns(T);
+  if (src != dst && with_normals)
+    transformPoints<true, true>(columns, src, dst, size, num_threads);
+  else if (src != dst)
+    transformPoints<true, false>(columns, src, dst, size, num_threads);
+  else if (with_normals)
+    transformPoints<false, true>(columns, src, dst, size, num_threads);
+  else
+    transformPoints<false, false>(columns, src, dst, size, num_threads);
+}
+
+}  // namespace transform_kernels
+
+/**
+ * \brief Transforms a single point in place, for per point transforms such as
+ * motion compensation.
+ * \param T rigid transform
+ * \param p point to transform
+ * \param with_normals also rotate the normal
+ */
+template <class PointT>
+inline void transformPoint(const Eigen::Matrix4f& T, PointT& p,
+                           const bool with_normals = true) {
+  const transform_kernels::Columns columns(T);
+  transform_kernels::transformVector<true>(columns, p.data, p.data);
+  if (with_normals)
+    transform_kernels::transformVector<false>(columns, p.data_n, p.data_n);
+}
+
+/**
+ * \brief Transforms a single point: dst becomes a copy of src with its
+ * position and normal transformed.
+ * \param T rigid transform
+ * \param src point to transform
+ * \param dst output, may be src
+ * \param with_normals also rotate the normal
+ */
+template <class PointT>
+inline void transformPoint(const Eigen::Matrix4f& T, const PointT& src,
+                           PointT& dst, const bool with_normals = true) {
+  if (&src != &dst) dst = src;
+  transformPoint(T, dst, with_normals);
+}
+
+/**
+ * \brief Transforms src into dst: dst becomes a copy of src with positions and
+ * normals transformed, the copy and the transform are done in one pass.
+ * \param T rigid transform
+ * \param src points to transform
+ * \param dst output, may be src
+ * \param with_normals also rotate the normals
+ * \param num_threads threads used for large clouds
+ */
+template <class PointT>
+void transformPointCloud(const Eigen::Matrix4f& T,
+                         const pcl::PointCloud<PointT>& src,
+                         pcl::PointCloud<PointT>& dst,
+                         const bool with_normals = true,
+                         const int num_threads = 1) {
+  if (&src != &dst) {
+    dst.header = src.header;
+    dst.points.resize(src.size());
+    dst.width = src.width;
+    dst.height = src.height;
+    dst.is_dense = src.is_dense;
+    dst.sensor_origin_ = src.sensor_origin_;
+    dst.sensor_orientation_ = src.sensor_orientation_;
+  }
+  transform_kernels::transformPoints(T, src.points.data(), dst.points.data(),
+                                     src.size(), with_normals, num_threads);
+}
+
+/**
+ * \brief Transforms a point cloud in place.
+ * \param T rigid transform
+ * \param cloud points to transform
+ * \param with_normals also rotate the normals
+ * \param num_threads threads used for large clouds
+ */
+template <class PointT>
+void transformPointCloud(const Eigen::Matrix4f& T,
+                         pcl::PointCloud<PointT>& cloud,
+                         const bool with_normals = true,
+                         const int num_threads = 1) {
+  transform_kernels::transformPoints(T, cloud.points.data(),
+                                     cloud.points.data(), cloud.size(),
+                                     with_normals, num_threads);
+}
+
+}  // namespace pointcloud
+}  // namespace vtr
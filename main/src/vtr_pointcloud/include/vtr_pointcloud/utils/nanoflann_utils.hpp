@@ -0,0 +1,282 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file nanoflann_utils.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "pcl/point_cloud.h"
+#include "pcl/point_types.h"
+
+#include "vtr_pointcloud/utils/nanoflann.hpp"
+
+namespace vtr {
+namespace pointcloud {
+
+template <class PointT>
+struct NanoFLANNAdapter {
+  NanoFLANNAdapter(const pcl::PointCloud<PointT>& points) : points_(points) {}
+
+  const pcl::PointCloud<PointT>& points_;
+
+  // Must return the number of data points
+  inline size_t kdtree_get_point_count() const { return points_.size(); }
+
+  // Returns the dim'th component of the idx'th point in the class:
+  // Since this is inlined and the "dim" argument is typically an immediate
+  // value, the "if/else's" are actually solved at compile time.
+  inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
+    if (dim == 0)
+      return points_[idx].x;
+    else if (dim == 1)
+      return points_[idx].y;
+    else
+      return points_[idx].z;
+  }
+
+  // Optional bounding-box computation: return false to default to a standard
+  // bbox computation loop.
+  //   Return true if the BBOX was already computed by the class and returned in
+  //   "bb" so it can be avoided to redo it again. Look at bb.size() to find out
+  //   the expected dimensionality (e.g. 2 or 3 for point clouds)
+  template <class BBOX>
+  bool kdtree_get_bbox(BBOX& /* bb */) const {
+    return false;
+  }
+};
+
+/// 2D points (used by the radar normal estimation in the x-y plane)
+template <>
+struct NanoFLANNAdapter<pcl::PointXY> {
+  NanoFLANNAdapter(const pcl::PointCloud<pcl::PointXY>& points)
+      : points_(points) {}
+
+  const pcl::PointCloud<pcl::PointXY>& points_;
+
+  // Must return the number of data points
+  inline size_t kdtree_get_point_count() const { return points_.size(); }
+
+  // Returns the dim'th component of the idx'th point in the class
+  inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
+    if (dim == 0)
+      return points_[idx].x;
+    else if (dim == 1)
+      return points_[idx].y;
+    else
+      throw std::invalid_argument("Invalid dim");
+  }
+
+  template <class BBOX>
+  bool kdtree_get_bbox(BBOX& /* bb */) const {
+    return false;
+  }
+};
+
+//Store all neighbours within a given radius
+template <typename _DistanceType = float, typename _IndexType = size_t>
+class NanoFLANNRadiusResultSet {
+ public:
+  using DistanceType = _DistanceType;
+  using IndexType = _IndexType;
+
+ public:
+  const DistanceType radius;
+
+  std::vector<DistanceType>& m_dists;
+  std::vector<IndexType>& m_indices;
+
+  inline NanoFLANNRadiusResultSet(DistanceType radius_,
+                                  std::vector<DistanceType>& dists,
+                                  std::vector<IndexType>& indices)
+      : radius(radius_), m_dists(dists), m_indices(indices) {
+    init();
+  }
+
+  inline void init() { clear(); }
+  inline void clear() {
+    m_dists.clear();
+    m_indices.clear();
+  }
+
+  inline size_t size() const { return m_indices.size(); }
+
+  inline bool full() const { return true; }
+
+  /**
+   * Called during search to add an element matching the criteria.
+   * \return true if the search should be continued, false if the results are
+   * sufficient
+   */
+  inline bool addPoint(DistanceType dist, IndexType index) {
+    if (dist < radius) {
+      m_dists.push_back(dist);
+      m_indices.push_back(index);
+    }
+    return true;
+  }
+
+  inline DistanceType worstDist() const { return radius; }
+};
+
+// KDTree type definition
+using KDTreeParams = nanoflann::KDTreeSingleIndexAdaptorParams;
+using KDTreeSearchParams = nanoflann::SearchParams;
+using KDTreeResultSet = nanoflann::KNNResultSet<float>;
+template <class PointT>
+using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
+    nanoflann::L2_Simple_Adaptor<float, NanoFLANNAdapter<PointT>>,
+    NanoFLANNAdapter<PointT>>;
+template <class PointT>
+using DynamicKDTree = nanoflann::KDTreeSingleIndexDynamicAdaptor<
+    nanoflann::L2_Simple_Adaptor<float, NanoFLANNAdapter<PointT>>,
+    NanoFLANNAdapter<PointT>>;
+
+namespace nanoflann_batch {
+
+/// queries are searched in blocks of consecutive points along the curve
+constexpr size_t BLOCK_SIZE = 256;
+/// batches smaller than this are searched in the given order
+constexpr size_t MIN_SORT_SIZE = 2 * BLOCK_SIZE;
+/// resolution of the curve, i.e. 2^5 cells per axis
+constexpr int CURVE_BITS = 5;
+
+/** \brief Spreads the lower 10 bits of v over every third bit */
+inline uint32_t spreadBits(uint32_t v) {
+  v &= 0x3ff;
+  v = (v | (v << 16)) & 0x030000ff;
+  v = (v | (v << 8)) & 0x0300f00f;
+  v = (v | (v << 4)) & 0x030c30c3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+/**
+ * \brief Order of the queries along a Morton (Z-order) curve over their
+ * bounding box, so that consecutive queries are close to each other.
+ * \details The queries are bucketed by curve cell with a counting sort, and
+ * keep their given order inside a cell.
+ */
+template <class QueryFunc>
+std::vector<size_t> spatialOrder(const size_t size, const int dim,
+                                 const QueryFunc& query) {
+  const int num_axes = std::min(dim, 3);
+  const float max_cell = (1 << CURVE_BITS) - 1;
+  float lo[3] = {0, 0, 0}, scale[3] = {0, 0, 0};
+  for (int d = 0; d < num_axes; d++) {
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < size; i++) {
+      min = std::min(min, query(i)[d]);
+      max = std::max(max, query(i)[d]);
+    }
+    lo[d] = min;
+    scale[d] = max > min ? max_cell / (max - min) : 0.f;
+  }
+
+  std::vector<uint32_t> cells(size);
+  std::vector<size_t> offsets(size_t(1) << (CURVE_BITS * num_axes), 0);
+  for (size_t i = 0; i < size; i++) {
+    uint32_t code = 0;
+    for (int d = 0; d < num_axes; d++) {
+      const float x = (query(i)[d] - lo[d]) * scale[d];
+      const float cell = x > 0.f ? std::min(x, max_cell) : 0.f;  // and NaN
+      code |= spreadBits(static_cast<uint32_t>(cell)) << d;
+    }
+    cells[i] = code;
+    offsets[code]++;
+  }
+  size_t offset = 0;
+  for (auto& count : offsets) {
+    const size_t next = offset + count;
+    count = offset;
+    offset = next;
+  }
+  std::vector<size_t> order(size);
+  for (size_t i = 0; i < size; i++) order[offsets[cells[i]]++] = i;
+  return order;
+}
+
+/**
+ * \brief Nearest neighbor of each query, see batchNearestNeighbors.
+ * \param query query(i) returns the coordinates of the i-th query
+ * \param store store(i, index, dist) receives the result of the i-th query
+ */
+template <class PointT, class QueryFunc, class StoreFunc>
+void nearestNeighbors(const KDTree<PointT>& kdtree, const size_t size,
+                      const QueryFunc& query, const StoreFunc& store,
+                      const int num_threads) {
+  std::vector<size_t> order;
+  if (size >= MIN_SORT_SIZE) order = spatialOrder(size, kdtree.dim, query);
+
+  const KDTreeSearchParams search_params;
+  const size_t num_blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+  for (size_t b = 0; b < num_blocks; b++) {
+    const size_t end = std::min(size, (b + 1) * BLOCK_SIZE);
+    for (size_t k = b * BLOCK_SIZE; k < end; k++) {
+      const size_t i = order.empty() ? k : order[k];
+      size_t index = 0;
+      float dist;
+      KDTreeResultSet result_set(1);
+      result_set.init(&index, &dist);
+      kdtree.findNeighbors(result_set, query(i), search_params);
+      store(i, index, dist);
+    }
+  }
+}
+
+}  // namespace nanoflann_batch
+
+/**
+ * \brief Finds the nearest neighbor of every query point in one call, with
+ * the same results as one findNeighbors call per point with a
+ * KDTreeResultSet(1).
+ * \details The queries are sorted along a space filling curve and searched in
+ * blocks of consecutive queries spread over threads, so that consecutive
+ * searches go through the same nodes and leaves of the tree while they are
+ * still in cache.
+ * \param[in] kdtree kd-tree of the map
+ * \param[in] query_points query points, in the frame of the map
+ * \param[out] nn_inds index of the nearest map point of each query
+ * \param[out] nn_dists squared distance to the nearest map point
+ * \param[in] num_threads number of threads
+ */
+template <class PointT, class QueryPointT>
+void batchNearestNeighbors(const KDTree<PointT>& kdtree,
+                           const pcl::PointCloud<QueryPointT>& query_points,
+                           std::vector<size_t>& nn_inds,
+                           std::vector<float>& nn_dists,
+                           const int num_threads = 1) {
+  nn_inds.resize(query_points.size());
+  nn_dists.resize(query_points.size());
+  nanoflann_batch::nearestNeighbors(
+      kdtree, query_points.size(),
+      [&](const size_t i) { return query_points[i].data; },
+      [&](const size_t i, const size_t index, const float dist) {
+        nn_inds[i] = index;
+        nn_dists[i] = dist;
+      },
+      num_threads);
+}
+
+}  // namespace pointcloud
+}  // namespace vtr
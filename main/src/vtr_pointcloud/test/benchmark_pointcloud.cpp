@@ -0,0 +1,265 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_pointcloud.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+
+// Run time of the point cloud kernels shared by the lidar and radar pipelines,
+// on synthetic scans of increasing size:
+//   - Downsample: voxelDownsample of the scan
+//   - Map update: PointMap::update with the downsampled scan
+//   - KD-tree: kd-tree construction on the map
+//   - NN search: nearest map point of every scan point, one findNeighbors
+//     call per point (1 thread) and in batch (1 and all threads)
+//   - Plane / Point: data association with the lidar point to plane and the
+//     radar point to point policies
+// followed by the throughput of the rigid transform of a cloud of 16 float
+// points (the layout of lidar PointWithInfo), positions and normals:
+//   - Strided map: 4xN strided Eigen maps multiplied by the 4x4 transform, one
+//     product for positions and one for normals, after a copy of the cloud
+//   - Kernel: transformPointCloud out of place (1 and all threads), i.e. the
+//     copy is fused with the transform, and in place
+// A scan is a set of concentric rings on a ground plane with walls, observed
+// from a slightly shifted pose so that the map and the scan do not coincide.
+//
+// Usage: benchmark_pointcloud
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include <omp.h>
+
+#include <Eigen/Geometry>
+
+#define PCL_NO_PRECOMPILE
+#include <pcl/pcl_macros.h>
+#include <pcl/point_types.h>
+
+#include "vtr_pointcloud/data_types/pointmap.hpp"
+#include "vtr_pointcloud/filters/voxel_downsample.hpp"
+#include "vtr_pointcloud/icp/icp_kernels.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
+#include "vtr_pointcloud/utils/nanoflann_utils.hpp"
+
+using namespace vtr::pointcloud;
+
+namespace {
+
+struct EIGEN_ALIGN16 BenchmarkPoint {
+  PCL_ADD_POINT4D;
+  PCL_ADD_NORMAL4D;
+  float normal_score = 1.0;
+  PCL_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// same size as lidar PointWithInfo (16 floats)
+struct EIGEN_ALIGN16 WidePoint {
+  PCL_ADD_POINT4D;
+  PCL_ADD_NORMAL4D;
+  float flex[8];
+  PCL_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr size_t size() { return 16; }
+  static constexpr size_t cartesian_offset() { return 0; }
+  static constexpr size_t normal_offset() { return 4; }
+};
+
+struct PointScanMsg {};
+struct PointMapMsg {
+  static constexpr unsigned INITIAL = 0;
+  static constexpr unsigned INTRA_EXP_MERGED = 1;
+  static constexpr unsigned DYNAMIC_REMOVED = 2;
+  static constexpr unsigned INTER_EXP_MERGED = 3;
+};
+struct MsgTraits {
+  using PointScanMsg = ::PointScanMsg;
+  using PointMapMsg = ::PointMapMsg;
+};
+
+pcl::PointCloud<BenchmarkPoint> make_scan(size_t size, float shift,
+                                          std::mt19937& rng) {
+  std::normal_distribution<float> noise(0.0, 0.02);
+  std::uniform_real_distribution<float> angle(0.0, 2.0 * M_PI);
+  std::uniform_real_distribution<float> unit(0.0, 1.0);
+  pcl::PointCloud<BenchmarkPoint> scan;
+  scan.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    BenchmarkPoint p;
+    const float theta = angle(rng);
+    if (unit(rng) < 0.6) {
+      // ground
+      const float range = 2.0 + 40.0 * unit(rng);
+      p.x = range * std::cos(theta), p.y = range * std::sin(theta);
+      p.z = -1.5 + noise(rng);
+      p.normal_x = 0.0, p.normal_y = 0.0, p.normal_z = 1.0;
+    } else {
+      // walls of a 30m x 30m room
+      const float c = std::cos(theta), s = std::sin(theta);
+      const float range = 15.0 / std::max(std::abs(c), std::abs(s));
+      p.x = range * c + noise(rng), p.y = range * s + noise(rng);
+      p.z = -1.5 + 4.0 * unit(rng);
+      const bool x_wall = std::abs(c) > std::abs(s);
+      p.normal_x = x_wall ? 1.0 : 0.0, p.normal_y = x_wall ? 0.0 : 1.0;
+      p.normal_z = 0.0;
+    }
+    p.x += shift, p.data[3] = 1.0, p.data_n[3] = 0.0;
+    scan.push_back(p);
+  }
+  return scan;
+}
+
+template <class Function>
+double time_ms(const Function& function, int repeats = 5) {
+  double best = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < repeats; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(
+        best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  return best;
+}
+
+}  // namespace
+
+int main() {
+  const int max_threads = omp_get_max_threads();
+  std::cout << std::setw(10) << "points" << std::setw(12) << "downsample"
+            << std::setw(12) << "map update" << std::setw(10) << "kd-tree"
+            << std::setw(12) << "nn single" << std::setw(12) << "nn (1)"
+            << std::setw(12) << ("nn (" + std::to_string(max_threads) + ")")
+            << std::setw(10)
+            << "plane" << std::setw(10) << "point" << std::setw(10)
+            << "matched" << "   (best of 5, times in ms)" << std::endl;
+
+  std::mt19937 rng(0);
+  for (const size_t size : {20000, 80000, 320000}) {
+    const auto raw_map = make_scan(size, 0.0, rng);
+    const auto scan = make_scan(size, 0.1, rng);
+
+    auto downsampled = raw_map;
+    const double t_downsample = time_ms([&] {
+      downsampled = raw_map;
+      voxelDownsample(downsampled, 0.3);
+    });
+
+    PointMap<BenchmarkPoint, MsgTraits> map(0.3);
+    const double t_update = time_ms([&] {
+      map = PointMap<BenchmarkPoint, MsgTraits>(0.3);
+      map.update(downsampled);
+    });
+
+    NanoFLANNAdapter<BenchmarkPoint> adapter(map.point_cloud());
+    std::unique_ptr<KDTree<BenchmarkPoint>> kdtree;
+    const double t_kdtree = time_ms([&] {
+      kdtree = std::make_unique<KDTree<BenchmarkPoint>>(
+          3, adapter, KDTreeParams(10 /* max leaf */));
+      kdtree->buildIndex();
+    });
+
+    icp::Associations sample_inds(scan.size());
+    for (size_t i = 0; i < scan.size(); i++) sample_inds[i].first = i;
+    std::vector<float> nn_dists(scan.size());
+    const double t_nn_point = time_ms([&] {
+      for (size_t i = 0; i < scan.size(); i++) {
+        KDTreeResultSet result_set(1);
+        result_set.init(&sample_inds[i].second, &nn_dists[i]);
+        kdtree->findNeighbors(result_set, scan[i].data, KDTreeSearchParams());
+      }
+    });
+    const double t_nn_single = time_ms([&] {
+      icp::findNearestNeighbors(*kdtree, scan, sample_inds, nn_dists, 1);
+    });
+    const double t_nn_multi = time_ms([&] {
+      icp::findNearestNeighbors(*kdtree, scan, sample_inds, nn_dists,
+                                max_threads);
+    });
+
+    const float max_pair_d2 = 1.0;
+    icp::Associations filtered;
+    const icp::PointToPlanePolicy plane_policy(0, 0.1);
+    const double t_plane = time_ms([&] {
+      filtered = icp::filterAssociations(scan, map.point_cloud(), sample_inds,
+                                         nn_dists, max_pair_d2, 0,
+                                         plane_policy);
+    });
+    const double matched = (double)filtered.size() / (double)scan.size();
+    const icp::PointToPointPolicy point_policy;
+    const double t_point = time_ms([&] {
+      filtered = icp::filterAssociations(scan, map.point_cloud(), sample_inds,
+                                         nn_dists, max_pair_d2, 0,
+                                         point_policy);
+    });
+
+    std::cout << std::fixed << std::setprecision(2) << std::setw(10) << size
+              << std::setw(12) << t_downsample << std::setw(12) << t_update
+              << std::setw(10) << t_kdtree << std::setw(12) << t_nn_point
+              << std::setw(12) << t_nn_single
+              << std::setw(12) << t_nn_multi << std::setw(10) << t_plane
+              << std::setw(10) << t_point << std::setw(10) << matched
+              << std::endl;
+  }
+
+  std::cout << std::endl
+            << std::setw(10) << "points" << std::setw(14) << "strided map"
+            << std::setw(14) << "kernel (1)" << std::setw(14)
+            << ("kernel (" + std::to_string(max_threads) + ")")
+            << std::setw(14) << "in place"
+            << "   (best of 5, million points per second)" << std::endl;
+  Eigen::Matrix4f T = Eigen::Matrix4f::Identity();
+  T.block<3, 3>(0, 0) =
+      Eigen::AngleAxisf(0.3, Eigen::Vector3f(0.1, 0.2, 1.0).normalized())
+          .toRotationMatrix();
+  T.block<3, 1>(0, 3) << 1.0, -2.0, 0.5;
+  for (const size_t size : {20000, 80000, 320000, 1280000}) {
+    const auto scan = make_scan(size, 0.0, rng);
+    pcl::PointCloud<WidePoint> wide;
+    for (const auto& p : scan) {
+      WidePoint q;
+      q.getVector4fMap() = p.getVector4fMap();
+      q.getNormalVector4fMap() = p.getNormalVector4fMap();
+      wide.push_back(q);
+    }
+
+    pcl::PointCloud<WidePoint> aligned;
+    const double t_map = time_ms([&] {
+      aligned = wide;
+      // clang-format off
+      auto points_mat = aligned.getMatrixXfMap(4, WidePoint::size(), WidePoint::cartesian_offset());
+      auto normal_mat = aligned.getMatrixXfMap(4, WidePoint::size(), WidePoint::normal_offset());
+      // clang-format on
+      points_mat = T * points_mat;
+      normal_mat = T * normal_mat;
+    });
+    const double t_kernel_single =
+        time_ms([&] { transformPointCloud(T, wide, aligned, true, 1); });
+    const double t_kernel_multi = time_ms(
+        [&] { transformPointCloud(T, wide, aligned, true, max_threads); });
+    const double t_in_place =
+        time_ms([&] { transformPointCloud(T, aligned, true, max_threads); });
+
+    const auto rate = [&](const double ms) { return size / ms / 1000.0; };
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << size
+              << std::setw(14) << rate(t_map) << std::setw(14)
+              << rate(t_kernel_single) << std::setw(14)
+              << rate(t_kernel_multi) << std::setw(14) << rate(t_in_place)
+              << std::endl;
+  }
+  return 0;
+}
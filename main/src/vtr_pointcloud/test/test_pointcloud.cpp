@@ -0,0 +1,411 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_pointcloud.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ * \brief Regression suite of the point cloud core shared by the lidar and
+ * radar pipelines.
+ */
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <Eigen/Geometry>
+
+#define PCL_NO_PRECOMPILE
+#include <pcl/pcl_macros.h>
+#include <pcl/point_types.h>
+
+#include "vtr_pointcloud/data_types/pointmap.hpp"
+#include "vtr_pointcloud/data_types/pointmap_merging.hpp"
+#include "vtr_pointcloud/filters/voxel_downsample.hpp"
+#include "vtr_pointcloud/icp/icp_kernels.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
+#include "vtr_pointcloud/utils/nanoflann_utils.hpp"
+
+using namespace ::testing;
+using namespace vtr;
+using namespace vtr::pointcloud;
+
+namespace {
+
+/// the fields the shared kernels rely on (cartesian, normal and normal score)
+struct EIGEN_ALIGN16 TestPoint {
+  PCL_ADD_POINT4D;
+  PCL_ADD_NORMAL4D;
+  float normal_score = 0.0;
+  PCL_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// storage is not tested here, the map only needs the version constants
+struct TestPointScanMsg {};
+struct TestPointMapMsg {
+  static constexpr unsigned INITIAL = 0;
+  static constexpr unsigned INTRA_EXP_MERGED = 1;
+  static constexpr unsigned DYNAMIC_REMOVED = 2;
+  static constexpr unsigned INTER_EXP_MERGED = 3;
+};
+struct TestMsgTraits {
+  using PointScanMsg = TestPointScanMsg;
+  using PointMapMsg = TestPointMapMsg;
+};
+using TestPointMap = PointMap<TestPoint, TestMsgTraits>;
+
+TestPoint make_point(float x, float y, float z, float nz = 1.0,
+                     float score = 1.0) {
+  TestPoint p;
+  p.x = x, p.y = y, p.z = z, p.data[3] = 1.0;
+  p.normal_x = 0.0, p.normal_y = 0.0, p.normal_z = nz, p.data_n[3] = 0.0;
+  p.normal_score = score;
+  return p;
+}
+
+pcl::PointCloud<TestPoint> random_cloud(size_t size, float extent,
+                                        std::mt19937& rng) {
+  std::uniform_real_distribution<float> uniform(-extent, extent);
+  pcl::PointCloud<TestPoint> cloud;
+  for (size_t i = 0; i < size; i++)
+    cloud.push_back(make_point(uniform(rng), uniform(rng), uniform(rng)));
+  return cloud;
+}
+
+}  // namespace
+
+TEST(PointCloud, voxel_downsample_keeps_closest_point_to_voxel_center) {
+  pcl::PointCloud<TestPoint> cloud;
+  // two points in voxel [0, 1)^3, the second one is closer to the center
+  cloud.push_back(make_point(0.1, 0.1, 0.1));
+  cloud.push_back(make_point(0.4, 0.6, 0.5));
+  // one point in voxel [1, 2) x [0, 1)^2
+  cloud.push_back(make_point(1.9, 0.2, 0.3));
+  voxelDownsample(cloud, 1.0);
+
+  ASSERT_EQ(cloud.size(), (size_t)2);
+  bool found_center = false, found_other = false;
+  for (const auto& p : cloud) {
+    if (p.x == 0.4f && p.y == 0.6f) found_center = true;
+    if (p.x == 1.9f) found_other = true;
+  }
+  EXPECT_TRUE(found_center);
+  EXPECT_TRUE(found_other);
+}
+
+TEST(PointCloud, point_map_update_and_filter) {
+  TestPointMap point_map(0.5);
+  EXPECT_EQ(point_map.version(), TestPointMap::INITIAL);
+
+  pcl::PointCloud<TestPoint> cloud;
+  cloud.push_back(make_point(0.1, 0.1, 0.1, 1.0, 1.0));
+  cloud.push_back(make_point(0.2, 0.2, 0.2, 1.0, 2.0));  // same voxel
+  cloud.push_back(make_point(1.1, 0.1, 0.1, 1.0, 3.0));
+  size_t num_init = 0;
+  point_map.update(cloud, [&](bool init, TestPoint& curr_pt,
+                              const TestPoint& new_pt) {
+    if (init) {
+      num_init++;
+    } else {
+      curr_pt.normal_score = std::max(curr_pt.normal_score, new_pt.normal_score);
+    }
+  });
+  EXPECT_EQ(num_init, (size_t)2);
+  ASSERT_EQ(point_map.size(), (size_t)2);
+  EXPECT_EQ(point_map.point_cloud()[0].normal_score, 2.0);
+
+  // removing a point frees its voxel
+  point_map.filter([](const TestPoint& p) { return p.x < 1.0; });
+  ASSERT_EQ(point_map.size(), (size_t)1);
+  point_map.update(cloud);
+  EXPECT_EQ(point_map.size(), (size_t)2);
+}
+
+TEST(PointCloud, streaming_merge_matches_serial_merge) {
+  std::mt19937 rng(11);
+  // overlapping sources along a route, of different sizes
+  std::vector<pcl::PointCloud<TestPoint>> sources;
+  for (int i = 0; i < 12; i++) {
+    auto cloud = random_cloud(2000 + 500 * (i % 4), 15.0, rng);
+    for (auto& p : cloud) p.x += 3.0 * i - 10.0;
+    sources.push_back(std::move(cloud));
+  }
+  const auto load = [&sources](const size_t i,
+                                pcl::PointCloud<TestPoint>& out) {
+    out = sources[i];
+  };
+  const float range = 12.0;
+  const auto in_range = [&range](const TestPoint& p) {
+    return p.getVector3fMap().norm() <= range;
+  };
+
+  TestPointMap expected(0.5);
+  for (const auto& cloud : sources) expected.update(cloud);
+  TestPointMap expected_cropped = expected;
+  expected_cropped.filter(in_range);
+
+  const auto expect_same = [](const TestPointMap& a, const TestPointMap& b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++)
+      ASSERT_EQ(a.point_cloud()[i].getVector4fMap(),
+                b.point_cloud()[i].getVector4fMap());
+  };
+  // one source per batch, a few sources per batch and all sources at once
+  const size_t per_source =
+      2000 * pointmap_merging::bytesPerPoint<TestPoint>();
+  for (const size_t budget : {size_t(1), 3 * per_source, 100 * per_source}) {
+    for (const int num_threads : {1, 4}) {
+      TestPointMap actual(0.5);
+      streamingMerge(actual, sources.size(), load, 0.0, budget, num_threads);
+      expect_same(expected, actual);
+
+      // points beyond the crop range are dropped, the cropped maps agree
+      TestPointMap cropped(0.5);
+      streamingMerge(cropped, sources.size(), load, range, budget,
+                     num_threads);
+      EXPECT_LT(cropped.size(), expected.size());
+      cropped.filter(in_range);
+      expect_same(expected_cropped, cropped);
+    }
+  }
+}
+
+TEST(PointCloud, streaming_merge_batches_fit_the_budget) {
+  const auto batchSize = pointmap_merging::batchSize<TestPoint>;
+  const size_t per_source =
+      1000 * pointmap_merging::bytesPerPoint<TestPoint>();
+  // as many sources as large as the largest one so far fit
+  EXPECT_EQ(batchSize(1000, 10 * per_source), (size_t)10);
+  EXPECT_EQ(batchSize(1000, 11 * per_source - 1), (size_t)10);
+  // at least one source, however large
+  EXPECT_EQ(batchSize(1000, per_source / 2), (size_t)1);
+  // empty sources so far, all remaining sources
+  EXPECT_EQ(batchSize(0, per_source), std::numeric_limits<size_t>::max());
+}
+
+TEST(PointCloud, nearest_neighbors_match_brute_force) {
+  std::mt19937 rng(0);
+  const auto map = random_cloud(2000, 10.0, rng);
+  const auto query = random_cloud(500, 12.0, rng);
+
+  NanoFLANNAdapter<TestPoint> adapter(map);
+  KDTree<TestPoint> kdtree(3, adapter, KDTreeParams(10 /* max leaf */));
+  kdtree.buildIndex();
+
+  for (const int num_threads : {1, 4}) {
+    icp::Associations sample_inds(query.size());
+    for (size_t i = 0; i < query.size(); i++) sample_inds[i].first = i;
+    std::vector<float> nn_dists;
+    icp::findNearestNeighbors(kdtree, query, sample_inds, nn_dists,
+                              num_threads);
+
+    ASSERT_EQ(nn_dists.size(), query.size());
+    for (size_t i = 0; i < query.size(); i++) {
+      float best = std::numeric_limits<float>::max();
+      for (const auto& p : map)
+        best = std::min(best, (p.getVector3fMap() - query[i].getVector3fMap())
+                                  .squaredNorm());
+      EXPECT_NEAR(nn_dists[i], best, 1e-4) << "query " << i;
+      const auto& nn = map[sample_inds[i].second];
+      EXPECT_NEAR(
+          (nn.getVector3fMap() - query[i].getVector3fMap()).squaredNorm(),
+          best, 1e-4);
+    }
+  }
+}
+
+TEST(PointCloud, batch_nearest_neighbors_match_single_queries) {
+  std::mt19937 rng(0);
+  // random points, and integer lattice points queried at half integers where
+  // most queries have several equidistant neighbors
+  std::vector<std::pair<pcl::PointCloud<TestPoint>, pcl::PointCloud<TestPoint>>>
+      cases;
+  cases.emplace_back(random_cloud(5000, 10.0, rng),
+                     random_cloud(3000, 12.0, rng));
+  pcl::PointCloud<TestPoint> lattice, half_lattice;
+  for (int x = -8; x < 8; x++)
+    for (int y = -8; y < 8; y++)
+      for (int z = -4; z < 4; z++) {
+        lattice.push_back(make_point(x, y, z));
+        half_lattice.push_back(make_point(x + 0.5, y + 0.5, z + 0.5));
+        half_lattice.push_back(make_point(x + 0.5, y, z));
+      }
+  cases.emplace_back(lattice, half_lattice);
+  cases.emplace_back(lattice, pcl::PointCloud<TestPoint>());
+
+  for (const auto& [map, query] : cases) {
+    NanoFLANNAdapter<TestPoint> adapter(map);
+    KDTree<TestPoint> kdtree(3, adapter, KDTreeParams(10 /* max leaf */));
+    kdtree.buildIndex();
+
+    std::vector<size_t> expected_inds(query.size());
+    std::vector<float> expected_dists(query.size());
+    for (size_t i = 0; i < query.size(); i++) {
+      KDTreeResultSet result_set(1);
+      result_set.init(&expected_inds[i], &expected_dists[i]);
+      kdtree.findNeighbors(result_set, query[i].data, KDTreeSearchParams());
+    }
+
+    for (const int num_threads : {1, 4}) {
+      std::vector<size_t> nn_inds;
+      std::vector<float> nn_dists;
+      batchNearestNeighbors(kdtree, query, nn_inds, nn_dists, num_threads);
+      EXPECT_EQ(nn_inds, expected_inds);
+      EXPECT_EQ(nn_dists, expected_dists);
+
+      // sampled queries through the icp kernel
+      icp::Associations sample_inds;
+      for (size_t i = 0; i < query.size(); i += 3)
+        sample_inds.emplace_back(i, 0);
+      icp::findNearestNeighbors(kdtree, query, sample_inds, nn_dists,
+                                num_threads);
+      for (size_t j = 0; j < sample_inds.size(); j++) {
+        EXPECT_EQ(sample_inds[j].second, expected_inds[sample_inds[j].first]);
+        EXPECT_EQ(nn_dists[j], expected_dists[sample_inds[j].first]);
+      }
+    }
+  }
+}
+
+TEST(PointCloud, two_dimensional_adapter) {
+  pcl::PointCloud<pcl::PointXY> points;
+  for (int i = 0; i < 10; i++) {
+    pcl::PointXY p;
+    p.x = i, p.y = -i;
+    points.push_back(p);
+  }
+  NanoFLANNAdapter<pcl::PointXY> adapter(points);
+  KDTree<pcl::PointXY> kdtree(2, adapter, KDTreeParams(10 /* max leaf */));
+  kdtree.buildIndex();
+
+  const float query[2] = {3.2, -3.1};
+  size_t index;
+  float dist;
+  KDTreeResultSet result_set(1);
+  result_set.init(&index, &dist);
+  kdtree.findNeighbors(result_set, query, KDTreeSearchParams());
+  EXPECT_EQ(index, (size_t)3);
+  EXPECT_THROW(adapter.kdtree_get_pt(0, 2), std::invalid_argument);
+}
+
+TEST(PointCloud, point_to_plane_policy) {
+  pcl::PointCloud<TestPoint> map, query;
+  map.push_back(make_point(0.0, 0.0, 0.0, 1.0, 0.5));  // plane z = 0
+  map.push_back(make_point(5.0, 0.0, 0.0, 1.0, 0.0));  // no normal score
+  query.push_back(make_point(0.1, 0.0, 0.3));  // off plane
+  query.push_back(make_point(0.0, 0.2, 0.05));
+  query.push_back(make_point(5.0, 0.0, 0.01));
+  query.push_back(make_point(9.0, 0.0, 0.0));  // too far
+
+  const icp::Associations sample_inds{{0, 0}, {1, 0}, {2, 1}, {3, 1}};
+  std::vector<float> nn_dists;
+  for (const auto& ind : sample_inds)
+    nn_dists.push_back((query[ind.first].getVector3fMap() -
+                        map[ind.second].getVector3fMap())
+                           .squaredNorm());
+
+  const icp::PointToPlanePolicy policy(/* first_steps */ 2,
+                                       /* max_planar_dist */ 0.1);
+  // no planar check during the first steps
+  const auto initial = icp::filterAssociations(query, map, sample_inds,
+                                               nn_dists, 1.0, 0, policy);
+  EXPECT_EQ(initial, icp::Associations({{0, 0}, {1, 0}, {2, 1}}));
+  const auto refined = icp::filterAssociations(query, map, sample_inds,
+                                               nn_dists, 1.0, 2, policy);
+  EXPECT_EQ(refined, icp::Associations({{1, 0}, {2, 1}}));
+
+  Eigen::Matrix3d W;
+  ASSERT_TRUE(policy.information(map[0], W));
+  Eigen::Matrix3d expected = 1e-5 * Eigen::Matrix3d::Identity();
+  expected(2, 2) += 0.5;
+  EXPECT_TRUE(W.isApprox(expected));
+  EXPECT_FALSE(policy.information(map[1], W));
+}
+
+TEST(PointCloud, point_to_point_policy) {
+  pcl::PointCloud<TestPoint> map, query;
+  map.push_back(make_point(0.0, 0.0, 0.0, 1.0, 0.0));
+  query.push_back(make_point(0.1, 0.0, 0.3));
+  query.push_back(make_point(3.0, 0.0, 0.0));
+  const icp::Associations sample_inds{{0, 0}, {1, 0}};
+  const std::vector<float> nn_dists{0.1, 9.0};
+
+  const icp::PointToPointPolicy policy;
+  const auto filtered = icp::filterAssociations(query, map, sample_inds,
+                                                nn_dists, 1.0, 5, policy);
+  EXPECT_EQ(filtered, icp::Associations({{0, 0}}));
+
+  Eigen::Matrix3d W;
+  ASSERT_TRUE(policy.information(map[0], W));
+  EXPECT_TRUE(W.isIdentity());
+}
+
+TEST(PointCloud, rigid_transform_matches_homogeneous_product) {
+  std::mt19937 rng(0);
+  // large enough to be split over threads
+  auto cloud = random_cloud(10000, 10.0, rng);
+  std::uniform_real_distribution<float> uniform(-1.0, 1.0);
+  for (auto& p : cloud) {
+    p.getNormalVector3fMap() =
+        Eigen::Vector3f(uniform(rng), uniform(rng), uniform(rng)).normalized();
+    p.normal_score = uniform(rng);
+  }
+
+  Eigen::Matrix4f T = Eigen::Matrix4f::Identity();
+  T.block<3, 3>(0, 0) =
+      Eigen::AngleAxisf(0.7, Eigen::Vector3f(1.0, -0.5, 0.3).normalized())
+          .toRotationMatrix();
+  T.block<3, 1>(0, 3) << 3.0, -1.0, 2.0;
+
+  const auto expect_transformed = [&](const pcl::PointCloud<TestPoint>& out,
+                                      const bool with_normals) {
+    ASSERT_EQ(out.size(), cloud.size());
+    for (size_t i = 0; i < cloud.size(); i++) {
+      const auto& p = cloud[i];
+      const auto& q = out[i];
+      const Eigen::Vector4f expected_pt = T * p.getVector4fMap();
+      const Eigen::Vector4f expected_nm =
+          with_normals ? Eigen::Vector4f(T * p.getNormalVector4fMap())
+                       : Eigen::Vector4f(p.getNormalVector4fMap());
+      EXPECT_TRUE(q.getVector4fMap().isApprox(expected_pt, 1e-5)) << i;
+      EXPECT_TRUE(q.getNormalVector4fMap().isApprox(expected_nm, 1e-5)) << i;
+      EXPECT_EQ(q.normal_score, p.normal_score);
+    }
+  };
+
+  for (const int num_threads : {1, 4}) {
+    for (const bool with_normals : {true, false}) {
+      // out of place into an empty cloud and into a cloud to be overwritten
+      pcl::PointCloud<TestPoint> out;
+      transformPointCloud(T, cloud, out, with_normals, num_threads);
+      expect_transformed(out, with_normals);
+      out = random_cloud(cloud.size(), 1.0, rng);
+      transformPointCloud(T, cloud, out, with_normals, num_threads);
+      expect_transformed(out, with_normals);
+
+      // in place
+      auto in_place = cloud;
+      transformPointCloud(T, in_place, with_normals, num_threads);
+      expect_transformed(in_place, with_normals);
+
+      // one point at a time
+      auto per_point = cloud;
+      for (auto& p : per_point) transformPoint(T, p, with_normals);
+      expect_transformed(per_point, with_normals);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -65,6 +65,15 @@ class BubbleInterface {
       const std::string &stream_name, const std::string &stream_type,
       const Timestamp &start, const Timestamp &stop);
 
+  /**
+   * \brief Retrieves data from stream name of timestamp time, without keeping
+   * it in the databubble if it was not loaded already.
+   */
+  template <typename DataType>
+  typename storage::LockableMessage<DataType>::Ptr retrieveUncached(
+      const std::string &stream_name, const std::string &stream_type,
+      const Timestamp &time);
+
  private:
   template <typename DataType>
   typename storage::DataBubble<DataType>::Ptr getBubble(
@@ -109,6 +118,14 @@ auto BubbleInterface::retrieve(const std::string &stream_name,
   return getBubble<DataType>(stream_name, stream_type)->retrieve(start, stop);
 }
 
+template <typename DataType>
+auto BubbleInterface::retrieveUncached(const std::string &stream_name,
+                                       const std::string &stream_type,
+                                       const Timestamp &time) ->
+    typename storage::LockableMessage<DataType>::Ptr {
+  return getBubble<DataType>(stream_name, stream_type)->retrieveUncached(time);
+}
+
 template <typename DataType>
 typename storage::DataBubble<DataType>::Ptr BubbleInterface::getBubble(
     const std::string &stream_name, const std::string &stream_type,
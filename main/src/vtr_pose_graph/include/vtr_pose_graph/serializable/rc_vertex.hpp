@@ -126,6 +126,15 @@ class RCVertex : public VertexBase, public BubbleInterface {
                                                stop);
   }
 
+  template <typename DataType>
+  typename storage::LockableMessage<DataType>::Ptr retrieveUncached(
+      const std::string& stream_name, const std::string& stream_type) {
+    std::shared_lock lock(mutex_);
+    if (vertex_time_ == storage::NO_TIMESTAMP_VALUE) return nullptr;
+    return BubbleInterface::retrieveUncached<DataType>(stream_name, stream_type,
+                                                       vertex_time_);
+  }
+
   template <typename DataType>
   bool insert(const std::string& stream_name, const std::string& stream_type,
               const typename storage::LockableMessage<DataType>::Ptr& message) {
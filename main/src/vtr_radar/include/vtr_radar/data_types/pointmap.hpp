@@ -18,103 +18,26 @@
  */
 #pragma once
 
-#include "vtr_common/utils/hash.hpp"
+#include "vtr_pointcloud/data_types/pointmap.hpp"
 #include "vtr_radar/data_types/pointscan.hpp"
 
 #include "vtr_radar_msgs/msg/point_map.hpp"
 
 namespace vtr {
 namespace radar {
-namespace pointmap {
-
-struct VoxKey {
-  VoxKey(int x0 = 0, int y0 = 0, int z0 = 0) : x(x0), y(y0), z(z0) {}
-  // clang-format off
-  bool operator==(const VoxKey& other) const { return (x == other.x && y == other.y && z == other.z); }
-  friend VoxKey operator+(const VoxKey &A, const VoxKey &B) { return VoxKey(A.x + B.x, A.y + B.y, A.z + B.z); }
-  friend VoxKey operator-(const VoxKey &A, const VoxKey &B) { return VoxKey(A.x - B.x, A.y - B.y, A.z - B.z); }
-  // clang-format on
-  int x, y, z;
-};
 
+namespace pointmap {
+using pointcloud::pointmap::VoxKey;
 }  // namespace pointmap
-}  // namespace radar
-}  // namespace vtr
 
-// Specialization of std:hash function
-namespace std {
-
-template <>
-struct hash<vtr::radar::pointmap::VoxKey> {
-  std::size_t operator()(const vtr::radar::pointmap::VoxKey& k) const {
-    std::size_t ret = 0;
-    vtr::common::hash_combine(ret, k.x, k.y, k.z);
-    return ret;
-  }
+/// storage messages of the radar point maps
+struct PointMapMsgTraits {
+  using PointScanMsg = vtr_radar_msgs::msg::PointScan;
+  using PointMapMsg = vtr_radar_msgs::msg::PointMap;
 };
 
-}  // namespace std
-
-namespace vtr {
-namespace radar {
-
 template <class PointT>
-class PointMap : public PointScan<PointT> {
- public:
-  using typename PointScan<PointT>::PointCloudType;
-  PTR_TYPEDEFS(PointMap<PointT>);
-
-  using PointMapMsg = vtr_radar_msgs::msg::PointMap;
-  /// constexpr of map version enum (keep in sync with the msg)
-  static constexpr unsigned INITIAL = PointMapMsg::INITIAL;
-  static constexpr unsigned INTRA_EXP_MERGED = PointMapMsg::INTRA_EXP_MERGED;
-  static constexpr unsigned DYNAMIC_REMOVED = PointMapMsg::DYNAMIC_REMOVED;
-  static constexpr unsigned INTER_EXP_MERGED = PointMapMsg::INTER_EXP_MERGED;
-  /** \brief Static function that constructs this class from ROS2 message */
-  static Ptr fromStorable(const PointMapMsg& storable);
-  /** \brief Returns the ROS2 message to be stored */
-  PointMapMsg toStorable() const;
-
-  PointMap(const float& dl, const unsigned& version = INITIAL)
-      : dl_(dl), version_(version) {}
-
-  float dl() const { return dl_; }
-
-  unsigned& version() { return version_; }
-  const unsigned& version() const { return version_; }
-
-  /** \brief Update map with a set of new points. */
-  struct DefaultUpdateCb {
-    void operator()(bool /* init */, PointT& /* curr_pt */,
-                    const PointT& /* new_pt */) const {}
-  };
-  template <class Callback = DefaultUpdateCb>
-  void update(const PointCloudType& point_cloud,
-              const Callback& callback = DefaultUpdateCb());
-
-  struct DefaultFilterCb {
-    bool operator()(const PointT&) const { return true; }
-  };
-  template <class Callback = DefaultFilterCb>
-  void filter(const Callback& callback = DefaultFilterCb());
-
- protected:
-  using VoxKey = pointmap::VoxKey;
-  VoxKey getKey(const PointT& p) const {
-    return VoxKey((int)std::floor(p.x / dl_), (int)std::floor(p.y / dl_),
-                  (int)std::floor(p.z / dl_));
-  }
-
- protected:
-  /** \brief Voxel grid size */
-  float dl_;
-  /** \brief Version of the map */
-  unsigned version_;
-  /** \brief Sparse hashmap that contain voxels and map to point indices */
-  std::unordered_map<VoxKey, size_t> samples_;
-};
+using PointMap = pointcloud::PointMap<PointT, PointMapMsgTraits>;
 
 }  // namespace radar
 }  // namespace vtr
-
-#include "vtr_radar/data_types/pointmap.inl"
\ No newline at end of file
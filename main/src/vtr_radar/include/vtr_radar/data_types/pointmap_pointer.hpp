@@ -18,28 +18,15 @@
  */
 #pragma once
 
-#include "vtr_tactic/types.hpp"
+#include "vtr_pointcloud/data_types/pointmap_pointer.hpp"
 
 #include "vtr_radar_msgs/msg/point_map_pointer.hpp"
 
 namespace vtr {
 namespace radar {
 
-struct PointMapPointer {
-  PTR_TYPEDEFS(PointMapPointer);
-  using PointMapPointerMsg = vtr_radar_msgs::msg::PointMapPointer;
-
-  /// for vtr storage
-  /** \brief construct from a storable message */
-  static PointMapPointer::Ptr fromStorable(const PointMapPointerMsg& storable);
-  /** \brief to storable message */
-  PointMapPointerMsg toStorable() const;
-
-  /// data
-  tactic::VertexId this_vid = tactic::VertexId::Invalid();
-  tactic::VertexId map_vid = tactic::VertexId::Invalid();
-  tactic::EdgeTransform T_v_this_map = tactic::EdgeTransform(true);
-};
+using PointMapPointer =
+    pointcloud::PointMapPointer<vtr_radar_msgs::msg::PointMapPointer>;
 
 }  // namespace radar
-}  // namespace vtr
\ No newline at end of file
+}  // namespace vtr
@@ -18,9 +18,7 @@
  */
 #pragma once
 
-#include "pcl/point_cloud.h"
-
-#include "vtr_tactic/types.hpp"
+#include "vtr_pointcloud/data_types/pointscan.hpp"
 
 #include "vtr_radar_msgs/msg/point_scan.hpp"
 
@@ -28,39 +26,7 @@ namespace vtr {
 namespace radar {
 
 template <class PointT>
-class PointScan {
- public:
-  using PointCloudType = pcl::PointCloud<PointT>;
-  PTR_TYPEDEFS(PointScan<PointT>);
-
-  using PointScanMsg = vtr_radar_msgs::msg::PointScan;
-  /** \brief Static function that constructs this class from ROS2 message */
-  static Ptr fromStorable(const PointScanMsg& storable);
-  /** \brief Returns the ROS2 message to be stored */
-  PointScanMsg toStorable() const;
-
-  virtual ~PointScan() = default;
-
-  size_t size() const { return point_cloud_.size(); }
-
-  PointCloudType& point_cloud() { return point_cloud_; }
-  const PointCloudType& point_cloud() const { return point_cloud_; }
-
-  tactic::VertexId& vertex_id() { return vertex_id_; }
-  const tactic::VertexId& vertex_id() const { return vertex_id_; }
-
-  tactic::EdgeTransform& T_vertex_this() { return T_vertex_this_; }
-  const tactic::EdgeTransform& T_vertex_this() const { return T_vertex_this_; }
-
- protected:
-  PointCloudType point_cloud_;
-  /** \brief the associated vertex id */
-  tactic::VertexId vertex_id_ = tactic::VertexId::Invalid();
-  /** \brief the transform from this scan/map to its associated vertex */
-  tactic::EdgeTransform T_vertex_this_ = tactic::EdgeTransform(true);
-};
+using PointScan = pointcloud::PointScan<PointT, vtr_radar_msgs::msg::PointScan>;
 
 }  // namespace radar
 }  // namespace vtr
-
-#include "vtr_radar/data_types/pointscan.inl"
\ No newline at end of file
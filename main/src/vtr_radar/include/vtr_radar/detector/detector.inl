@@ -19,19 +19,202 @@
  */
 #pragma once
 
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 #include "vtr_radar/detector/detector.hpp"
 
 namespace vtr {
 namespace radar {
 
 namespace {
-bool sort_desc_by_first(const std::pair<int, float> &a,
-                        const std::pair<int, float> &b) {
-  return (a.first > b.first);
+/** \brief orders (intensity, range bin) by decreasing intensity */
+bool stronger_first(const std::pair<float, int> &a,
+                    const std::pair<float, int> &b) {
+  return a.first > b.first || (a.first == b.first && a.second < b.second);
 }
-bool sort_asc_by_second(const std::pair<int, float> &a,
-                        const std::pair<int, float> &b) {
-  return (a.second < b.second);
+
+/**
+ * \brief Sums of consecutive cells of an azimuth in O(1) from prefix sums.
+ * \details Used when every sum of consecutive cells is exactly representable
+ * in double precision, i.e. all cells are multiples of the smallest cell ulp
+ * 2^e and the total magnitude is below 2^(53 + e), which holds for radar
+ * intensities (8-bit values / 255). Then the prefix sums are exact and each
+ * window sum is identical to adding its cells one by one. Otherwise the cells
+ * are added one by one.
+ */
+class RowWindowSums {
+ public:
+  /** \brief sums of cells within [first, last) of row */
+  RowWindowSums(const float *row, const int first, const int last)
+      : row_(row), first_(first) {
+    int min_exponent = std::numeric_limits<int>::max();
+    double magnitude = 0;
+    for (int j = first; j < last; ++j) {
+      uint32_t bits;
+      std::memcpy(&bits, &row[j], sizeof(bits));
+      const int biased_exponent = (bits >> 23) & 0xff;
+      if (biased_exponent == 0xff) return;  // inf or nan
+      if ((bits & 0x7fffffff) == 0) continue;
+      // row[j] is an integer multiple of 2^(exponent - 23) (2^-149 if subnormal)
+      min_exponent = std::min(min_exponent, std::max(biased_exponent, 1) - 150);
+      magnitude += std::abs(row[j]);
+    }
+    // one bit of margin for the rounding of magnitude
+    if (min_exponent != std::numeric_limits<int>::max() &&
+        magnitude >= std::ldexp(1.0, 52 + min_exponent))
+      return;
+    exact_ = true;
+    prefix_.resize(std::max(last - first, 0) + 1);
+    prefix_[0] = 0;
+    for (int j = first; j < last; ++j)
+      prefix_[j - first + 1] = prefix_[j - first] + row[j];
+  }
+
+  /** \brief sum of cells [begin, end) */
+  double operator()(const int begin, const int end) const {
+    if (exact_) return prefix_[end - first_] - prefix_[begin - first_];
+    double sum = 0;
+    for (int j = begin; j < end; ++j) sum += row_[j];
+    return sum;
+  }
+
+ private:
+  const float *row_;
+  const int first_;
+  bool exact_ = false;
+  std::vector<double> prefix_;
+};
+
+/**
+ * \brief k-th smallest (0-indexed) value of a sliding window, each insertion
+ * and replacement is O(log W).
+ * \details A pair of indexed binary heaps: the k + 1 smallest values are kept
+ * in a max heap (lower) and the others in a min heap (upper), so that the k-th
+ * smallest value is the top of the max heap. Values are identified by an id in
+ * [0, capacity) given on insertion. Sliding the window replaces the value of
+ * an outgoing id in place, which keeps the heap sizes.
+ */
+class SlidingKthSmallest {
+ public:
+  SlidingKthSmallest(const size_t k, const size_t capacity)
+      : k_(k), values_(capacity), heap_(capacity), position_(capacity) {
+    heaps_[LOWER].reserve(capacity);
+    heaps_[UPPER].reserve(capacity);
+  }
+
+  void insert(const int id, const float value) {
+    values_[id] = value;
+    push((heaps_[LOWER].empty() || value <= top(LOWER)) ? LOWER : UPPER, id);
+    rebalance();
+  }
+
+  /** \brief replaces the value of old_id by value with the new id */
+  void replace(const int old_id, const int id, const float value) {
+    values_[id] = value;
+    const int h = heap_[old_id];
+    const size_t pos = position_[old_id];
+    heaps_[h][pos] = id;
+    heap_[id] = h;
+    siftUp(h, pos);
+    siftDown(h, position_[id]);
+    // the new value may belong to the other heap, then swapping the tops
+    // restores max(lower) <= min(upper)
+    if (!heaps_[UPPER].empty() && top(LOWER) > top(UPPER)) {
+      std::swap(heaps_[LOWER][0], heaps_[UPPER][0]);
+      heap_[heaps_[LOWER][0]] = LOWER;
+      heap_[heaps_[UPPER][0]] = UPPER;
+      siftDown(LOWER, 0);
+      siftDown(UPPER, 0);
+    }
+  }
+
+  /** \brief requires at least k + 1 values in the window */
+  float kth() const { return top(LOWER); }
+
+ private:
+  static constexpr int LOWER = 0;
+  static constexpr int UPPER = 1;
+
+  bool before(const int h, const int a, const int b) const {
+    return h == LOWER ? values_[a] > values_[b] : values_[a] < values_[b];
+  }
+  float top(const int h) const { return values_[heaps_[h][0]]; }
+
+  void push(const int h, const int id) {
+    heaps_[h].push_back(id);
+    heap_[id] = h;
+    position_[id] = heaps_[h].size() - 1;
+    siftUp(h, heaps_[h].size() - 1);
+  }
+
+  int pop(const int h) {
+    auto &heap = heaps_[h];
+    const int id = heap[0];
+    heap[0] = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) siftDown(h, 0);
+    return id;
+  }
+
+  void siftUp(const int h, size_t pos) {
+    auto &heap = heaps_[h];
+    const int id = heap[pos];
+    while (pos > 0) {
+      const size_t parent = (pos - 1) / 2;
+      if (!before(h, id, heap[parent])) break;
+      heap[pos] = heap[parent];
+      position_[heap[pos]] = pos;
+      pos = parent;
+    }
+    heap[pos] = id;
+    position_[id] = pos;
+  }
+
+  void siftDown(const int h, size_t pos) {
+    auto &heap = heaps_[h];
+    const int id = heap[pos];
+    while (true) {
+      size_t child = 2 * pos + 1;
+      if (child >= heap.size()) break;
+      if (child + 1 < heap.size() && before(h, heap[child + 1], heap[child]))
+        ++child;
+      if (!before(h, heap[child], id)) break;
+      heap[pos] = heap[child];
+      position_[heap[pos]] = pos;
+      pos = child;
+    }
+    heap[pos] = id;
+    position_[id] = pos;
+  }
+
+  void rebalance() {
+    while (heaps_[LOWER].size() > k_ + 1) push(UPPER, pop(LOWER));
+    while (heaps_[LOWER].size() < k_ + 1 && !heaps_[UPPER].empty())
+      push(LOWER, pop(UPPER));
+  }
+
+  const size_t k_;
+  std::vector<float> values_;
+  /** \brief heap and position in the heap of each id */
+  std::vector<int> heap_;
+  std::vector<size_t> position_;
+  std::vector<int> heaps_[2];
+};
+
+/**
+ * \brief Concatenates the points of each azimuth in azimuth order, so that the
+ * output does not depend on how azimuths were distributed among threads.
+ */
+template <class PointT>
+void merge_azimuths(const std::vector<pcl::PointCloud<PointT>> &polar_time,
+                    pcl::PointCloud<PointT> &pointcloud) {
+  size_t size = 0;
+  for (const auto &azimuth : polar_time) size += azimuth.size();
+  pointcloud.reserve(size);
+  for (const auto &azimuth : polar_time)
+    pointcloud.insert(pointcloud.end(), azimuth.begin(), azimuth.end());
 }
 
 }  // namespace
@@ -50,7 +233,8 @@ void KStrongest<PointT>::run(const cv::Mat &raw_scan, const float &res,
   if (maxcol > cols || maxcol < 0) maxcol = cols;
   const auto N = maxcol - mincol;
 
-  // #pragma omp parallel for
+  std::vector<pcl::PointCloud<PointT>> polar_time(rows);
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
     std::vector<std::pair<float, int>> intens;
     intens.reserve(N / 2);
@@ -64,25 +248,23 @@ void KStrongest<PointT>::run(const cv::Mat &raw_scan, const float &res,
       if (raw_scan.at<float>(i, j) >= thres)
         intens.emplace_back(raw_scan.at<float>(i, j), j);
     }
-    // sort intensities in descending order
-    std::sort(intens.begin(), intens.end(), sort_desc_by_first);
+    // select the k strongest in descending order, the closest first on ties
+    const int k = std::min<int>(kstrong_, intens.size());
+    std::nth_element(intens.begin(), intens.begin() + k, intens.end(),
+                     stronger_first);
+    std::sort(intens.begin(), intens.begin() + k, stronger_first);
     const double azimuth = azimuth_angles[i];
     const int64_t time = azimuth_times[i];
-    pcl::PointCloud<PointT> polar_time;
-    for (int j = 0; j < kstrong_; ++j) {
-      if (intens[j].first < thres) break;
+    for (int j = 0; j < k; ++j) {
       PointT p;
       p.rho = float(intens[j].second) * res + range_offset_;
       p.phi = azimuth;
       p.theta = 0;
       p.timestamp = time;
-      polar_time.push_back(p);
-    }
-    // #pragma omp critical
-    {
-      pointcloud.insert(pointcloud.end(), polar_time.begin(), polar_time.end());
+      polar_time[i].push_back(p);
     }
   }
+  merge_azimuths(polar_time, pointcloud);
 }
 
 template <class PointT>
@@ -103,6 +285,7 @@ void Cen2018<PointT>::run(const cv::Mat &raw_scan, const float &res,
   // TODO: try implementing an efficient median filter
   // Estimate the bias and subtract it from the signal
   cv::Mat q = raw_scan.clone();
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
     float mean = 0;
     for (int j = mincol; j < maxcol; ++j) {
@@ -131,6 +314,7 @@ void Cen2018<PointT>::run(const cv::Mat &raw_scan, const float &res,
   cv::filter2D(q, p, -1, filter, cv::Point(-1, -1), 0, cv::BORDER_REFLECT101);
 
   // Estimate variance of noise at each azimuth
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
     int nonzero = 0;
     for (int j = mincol; j < maxcol; ++j) {
@@ -146,9 +330,9 @@ void Cen2018<PointT>::run(const cv::Mat &raw_scan, const float &res,
       sigma_q[i] = 0.034;
   }
   // Extract peak centers from each azimuth
-  // #pragma omp parallel for
+  std::vector<pcl::PointCloud<PointT>> polar_time(rows);
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
-    pcl::PointCloud<PointT> polar_time;
     float peak_points = 0;
     int num_peak_points = 0;
     const float thres = zq_ * sigma_q[i];
@@ -169,7 +353,7 @@ void Cen2018<PointT>::run(const cv::Mat &raw_scan, const float &res,
         p.phi = azimuth;
         p.theta = 0;
         p.timestamp = time;
-        polar_time.push_back(p);
+        polar_time[i].push_back(p);
         peak_points = 0;
         num_peak_points = 0;
       }
@@ -182,13 +366,10 @@ void Cen2018<PointT>::run(const cv::Mat &raw_scan, const float &res,
       p.phi = azimuth;
       p.theta = 0;
       p.timestamp = time;
-      polar_time.push_back(p);
-    }
-    // #pragma omp critical
-    {
-      pointcloud.insert(pointcloud.end(), polar_time.begin(), polar_time.end());
+      polar_time[i].push_back(p);
     }
   }
+  merge_azimuths(polar_time, pointcloud);
 }
 
 template <class PointT>
@@ -206,33 +387,32 @@ void CACFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
   if (mincol > cols || mincol < 0) mincol = 0;
   auto maxcol = maxr_ / res - w2 - guard_;
   if (maxcol > cols || maxcol < 0) maxcol = cols;
+  // keep the training windows within the scan
+  mincol = std::max<double>(mincol, w2 + guard_ + 1);
+  maxcol = std::min<double>(maxcol, cols - w2 - guard_);
+  if (maxcol <= mincol) return;
   const int N = maxcol - mincol;
+  // cells read by the training windows
+  const int first = std::max(int(mincol) - w2 - guard_, 0);
+  const int last = std::min(int(std::ceil(maxcol)) + w2 + guard_, cols);
 
-  // #pragma omp parallel for
+  std::vector<pcl::PointCloud<PointT>> polar_time(rows);
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
     const double azimuth = azimuth_angles[i];
     const int64_t time = azimuth_times[i];
-    pcl::PointCloud<PointT> polar_time;
     double mean = 0;
     for (int j = mincol; j < maxcol; ++j) {
       mean += raw_scan.at<float>(i, j);
     }
     mean /= N;
 
+    const RowWindowSums window_sum(raw_scan.ptr<float>(i), first, last);
     for (int j = mincol; j < maxcol; ++j) {
       double stat = 0;  // (statistic) estimate of clutter power
-      double left = 0;
-      double right = 0;
-      // for (int k = -w2 - guard_; k <= w2 + guard_; ++k) {
-      //   if (k < -guard_ || k > guard_)
-      //     stat += raw_scan.at<float>(i, j + k);
-      // }
-      for (int k = -w2 - guard_; k < -guard_; ++k) {
-        left += raw_scan.at<float>(i, j + k);
-      }
-      for (int k = guard_ + 1; k <= w2 + guard_; ++k) {
-        right += raw_scan.at<float>(i, j + k);
-      }
+      // training cells [j - w2 - guard, j - guard) and (j + guard, j + w2 + guard]
+      const double left = window_sum(j - w2 - guard_, j - guard_);
+      const double right = window_sum(j + guard_ + 1, j + w2 + guard_ + 1);
       stat = std::max(left, right);
       const float thres =
           threshold_ * stat / (window / 2) + threshold2_ * mean + threshold3_;
@@ -242,14 +422,11 @@ void CACFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
         p.phi = azimuth;
         p.theta = 0;
         p.timestamp = time;
-        polar_time.push_back(p);
+        polar_time[i].push_back(p);
       }
     }
-    // #pragma omp critical
-    {
-      pointcloud.insert(pointcloud.end(), polar_time.begin(), polar_time.end());
-    }
   }
+  merge_azimuths(polar_time, pointcloud);
 }
 
 template <class PointT>
@@ -266,60 +443,47 @@ void OSCFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
   if (mincol > cols || mincol < 0) mincol = 0;
   auto maxcol = maxr_ / res - w2;
   if (maxcol > cols || maxcol < 0) maxcol = cols;
+  // keep the training windows within the scan
+  mincol = std::max<double>(mincol, w2 + 1);
+  maxcol = std::min<double>(maxcol, cols - w2);
+  if (maxcol <= mincol) return;
   const int N = maxcol - mincol;
 
-  // #pragma omp parallel for
+  std::vector<pcl::PointCloud<PointT>> polar_time(rows);
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
     const double azimuth = azimuth_angles[i];
     const int64_t time = azimuth_times[i];
-    pcl::PointCloud<PointT> polar_time;
     double mean = 0;
     for (int j = mincol; j < maxcol; ++j) {
       mean += raw_scan.at<float>(i, j);
     }
     mean /= N;
 
-    std::vector<std::pair<int, float>> window;
-    window.reserve(width_ - 1);
+    // training cells [j - w2, j + w2] except the cell under test j, the ids
+    // of the cells that can be in the window at the same time are unique
+    const int capacity = 2 * w2 + 2;
+    SlidingKthSmallest window(kstat_, capacity);
     int j = mincol - 1;
     for (int k = -w2; k < 0; ++k) {
-      window.emplace_back(j + k, raw_scan.at<float>(i, j + k));
+      window.insert((j + k) % capacity, raw_scan.at<float>(i, j + k));
     }
     for (int k = 1; k <= w2; ++k) {
-      window.emplace_back(j + k, raw_scan.at<float>(i, j + k));
+      window.insert((j + k) % capacity, raw_scan.at<float>(i, j + k));
     }
-    std::sort(window.begin(), window.end(), sort_asc_by_second);
 
     float peak_points = 0;
     int num_peak_points = 0;
 
     for (j = mincol; j < maxcol; ++j) {
-      // remove cell under test and left-most cell
-      window.erase(std::remove_if(window.begin(), window.end(),
-                                  [&](const std::pair<float, int> &p) -> bool {
-                                    return p.first == j ||
-                                           p.first == j - w2 - 1;
-                                  }),
-                   window.end());
-      // insert prev CUT and right-most cell
-      auto prevcut = std::make_pair(j - 1, raw_scan.at<float>(i, j - 1));
-      auto it = std::lower_bound(window.begin(), window.end(), prevcut,
-                                 sort_asc_by_second);
-      window.insert(it, prevcut);
-      auto newentry = std::make_pair(j + w2, raw_scan.at<float>(i, j + w2));
-      it = std::lower_bound(window.begin(), window.end(), newentry,
-                            sort_asc_by_second);
-      window.insert(it, newentry);
-
-      // DEBUG: check that the window is indeed sorted:
-      // assert(window.size() == width_ - 1);
-      // for (size_t k = 1; k < window.size(); ++k) {
-      //   if (window[k - 1].second > window[k].second) {
-      //     throw std::runtime_error("window not sorted.");
-      //   }
-      // }
+      // replace cell under test by prev CUT and left-most by right-most cell
+      window.replace(j % capacity, (j - 1) % capacity,
+                     raw_scan.at<float>(i, j - 1));
+      window.replace((j - w2 - 1) % capacity, (j + w2) % capacity,
+                     raw_scan.at<float>(i, j + w2));
+
       // (statistic) estimate of clutter power
-      double stat = window[kstat_].second;
+      double stat = window.kth();
       const float thres = threshold_ * stat + threshold2_ * mean + threshold3_;
       if (raw_scan.at<float>(i, j) > thres) {
         peak_points += j;
@@ -330,16 +494,13 @@ void OSCFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
         p.phi = azimuth;
         p.theta = 0;
         p.timestamp = time;
-        polar_time.push_back(p);
+        polar_time[i].push_back(p);
         peak_points = 0;
         num_peak_points = 0;
       }
     }
-    // #pragma omp critical
-    {
-      pointcloud.insert(pointcloud.end(), polar_time.begin(), polar_time.end());
-    }
   }
+  merge_azimuths(polar_time, pointcloud);
 }
 
 template <class PointT>
@@ -356,12 +517,20 @@ void ModifiedCACFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
   if (mincol > cols || mincol < 0) mincol = 0;
   auto maxcol = maxr_ / res - w2 - guard_;
   if (maxcol > cols || maxcol < 0) maxcol = cols;
+  // keep the training windows within the scan
+  mincol = std::max<double>(mincol, w2 + guard_ + 1);
+  maxcol = std::min<double>(maxcol, cols - w2 - guard_);
+  if (maxcol <= mincol) return;
   const int N = maxcol - mincol;
+  // cells read by the training windows
+  const int first = std::max(int(mincol) - w2 - guard_, 0);
+  const int last = std::min(int(std::ceil(maxcol)) + w2 + guard_, cols);
 
+  std::vector<pcl::PointCloud<PointT>> polar_time(rows);
+#pragma omp parallel for schedule(static)
   for (int i = 0; i < rows; ++i) {
     const double azimuth = azimuth_angles[i];
     const int64_t time = azimuth_times[i];
-    pcl::PointCloud<PointT> polar_time;
     double mean = 0;
     for (int j = mincol; j < maxcol; ++j) {
       mean += raw_scan.at<float>(i, j);
@@ -371,13 +540,10 @@ void ModifiedCACFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
     float peak_points = 0;
     int num_peak_points = 0;
 
+    const RowWindowSums window_sum(raw_scan.ptr<float>(i), first, last);
     for (int j = mincol; j < maxcol; ++j) {
-      double left = 0;
-      double right = 0;
-      for (int k = -w2 - guard_; k < -guard_; ++k)
-        left += raw_scan.at<float>(i, j + k);
-      for (int k = guard_ + 1; k <= w2 + guard_; ++k)
-        right += raw_scan.at<float>(i, j + k);
+      const double left = window_sum(j - w2 - guard_, j - guard_);
+      const double right = window_sum(j + guard_ + 1, j + w2 + guard_ + 1);
       // (statistic) estimate of clutter power
       // const double stat = (left + right) / (2 * w2);
       const double stat = std::max(left, right) / w2;  // GO-CFAR
@@ -391,13 +557,13 @@ void ModifiedCACFAR<PointT>::run(const cv::Mat &raw_scan, const float &res,
         p.phi = azimuth;
         p.theta = 0;
         p.timestamp = time;
-        polar_time.push_back(p);
+        polar_time[i].push_back(p);
         peak_points = 0;
         num_peak_points = 0;
       }
     }
-    pointcloud.insert(pointcloud.end(), polar_time.begin(), polar_time.end());
   }
+  merge_azimuths(polar_time, pointcloud);
 }
 
 }  // namespace radar
@@ -19,88 +19,20 @@
 #pragma once
 
 #include "vtr_radar/data_types/point.hpp"
-#include "vtr_radar/utils/nanoflann.hpp"
+#include "vtr_pointcloud/utils/nanoflann_utils.hpp"
 
 namespace vtr {
 namespace radar {
 
-template <class PointT>
-struct NanoFLANNAdapter {
-  NanoFLANNAdapter(const pcl::PointCloud<PointT> &points) : points_(points) {}
-
-  const pcl::PointCloud<PointT> &points_;
-
-  // Must return the number of data points
-  inline size_t kdtree_get_point_count() const { return points_.size(); }
-
-  // Returns the dim'th component of the idx'th point in the class:
-  // Since this is inlined and the "dim" argument is typically an immediate
-  // value, the "if/else's" are actually solved at compile time.
-  inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
-    if (dim == 0)
-      return points_[idx].x;
-    else if (dim == 1)
-      return points_[idx].y;
-    else
-      return points_[idx].z;
-  }
-
-  // Optional bounding-box computation: return false to default to a standard
-  // bbox computation loop.
-  //   Return true if the BBOX was already computed by the class and returned in
-  //   "bb" so it can be avoided to redo it again. Look at bb.size() to find out
-  //   the expected dimensionality (e.g. 2 or 3 for point clouds)
-  template <class BBOX>
-  bool kdtree_get_bbox(BBOX & /* bb */) const {
-    return false;
-  }
-};
-
-template <>
-struct NanoFLANNAdapter<pcl::PointXY> {
-  NanoFLANNAdapter(const pcl::PointCloud<pcl::PointXY> &points)
-      : points_(points) {}
-
-  const pcl::PointCloud<pcl::PointXY> &points_;
-
-  // Must return the number of data points
-  inline size_t kdtree_get_point_count() const { return points_.size(); }
-
-  // Returns the dim'th component of the idx'th point in the class:
-  // Since this is inlined and the "dim" argument is typically an immediate
-  // value, the "if/else's" are actually solved at compile time.
-  inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
-    if (dim == 0)
-      return points_[idx].x;
-    else if (dim == 1)
-      return points_[idx].y;
-    else
-      throw std::invalid_argument("Invalid dim");
-  }
-
-  // Optional bounding-box computation: return false to default to a standard
-  // bbox computation loop.
-  //   Return true if the BBOX was already computed by the class and returned in
-  //   "bb" so it can be avoided to redo it again. Look at bb.size() to find out
-  //   the expected dimensionality (e.g. 2 or 3 for point clouds)
-  template <class BBOX>
-  bool kdtree_get_bbox(BBOX & /* bb */) const {
-    return false;
-  }
-};
+using pointcloud::NanoFLANNAdapter;
+using pointcloud::NanoFLANNRadiusResultSet;
 
 // KDTree type definition
-using KDTreeParams = nanoflann::KDTreeSingleIndexAdaptorParams;
-using KDTreeSearchParams = nanoflann::SearchParams;
-using KDTreeResultSet = nanoflann::KNNResultSet<float>;
-template <class PointT>
-using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
-    nanoflann::L2_Simple_Adaptor<float, NanoFLANNAdapter<PointT>>,
-    NanoFLANNAdapter<PointT>>;
-template <class PointT>
-using DynamicKDTree = nanoflann::KDTreeSingleIndexDynamicAdaptor<
-    nanoflann::L2_Simple_Adaptor<float, NanoFLANNAdapter<PointT>>,
-    NanoFLANNAdapter<PointT>>;
+using pointcloud::DynamicKDTree;
+using pointcloud::KDTree;
+using pointcloud::KDTreeParams;
+using pointcloud::KDTreeResultSet;
+using pointcloud::KDTreeSearchParams;
 
 }  // namespace radar
 }  // namespace vtr
@@ -18,6 +18,8 @@
  */
 #include "vtr_radar/modules/localization/localization_icp_module.hpp"
 
+#include "vtr_pointcloud/icp/icp_kernels.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 #include "vtr_radar/utils/nanoflann_utils.hpp"
 
 namespace vtr {
@@ -76,7 +78,6 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
   float max_pair_d = config_->initial_max_pairing_dist;
   // float max_planar_d = config_->initial_max_planar_dist;
   float max_pair_d2 = max_pair_d * max_pair_d;
-  KDTreeSearchParams search_params;
 
   // clang-format off
   /// Create robot to sensor transform variable, fixed.
@@ -106,9 +107,6 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
   const auto map_mat = point_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
   // const auto map_normals_mat = point_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
   const auto query_mat = query_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  const auto query_norms_mat = query_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-  auto aligned_mat = aligned_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto aligned_norms_mat = aligned_points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
 
   /// create kd-tree of the map
   CLOG(DEBUG, "radar.localization_icp") << "Start building a kd-tree of the map.";
@@ -119,9 +117,8 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
 
   /// perform initial alignment
   {
-    const auto T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
-    aligned_mat = T_m_s * query_mat;
-    aligned_norms_mat = T_m_s * query_norms_mat;
+    const Eigen::Matrix4f T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
+    pointcloud::transformPointCloud(T_m_s, query_points, aligned_points, true, config_->num_threads);
   }
 
   using Stopwatch = common::timing::Stopwatch<>;
@@ -164,31 +161,15 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
 
     /// find nearest neigbors and distances
     timer[1]->start();
-    std::vector<float> nn_dists(sample_inds.size());
-#pragma omp parallel for schedule(dynamic, 10) num_threads(config_->num_threads)
-    for (size_t i = 0; i < sample_inds.size(); i++) {
-      KDTreeResultSet result_set(1);
-      result_set.init(&sample_inds[i].second, &nn_dists[i]);
-      kdtree->findNeighbors(result_set, aligned_points[sample_inds[i].first].data, search_params);
-    }
+    std::vector<float> nn_dists;
+    pointcloud::icp::findNearestNeighbors(*kdtree, aligned_points, sample_inds, nn_dists, config_->num_threads);
     timer[1]->stop();
 
     /// filtering based on distances metrics
     timer[2]->start();
-    std::vector<std::pair<size_t, size_t>> filtered_sample_inds;
-    filtered_sample_inds.reserve(sample_inds.size());
-    for (size_t i = 0; i < sample_inds.size(); i++) {
-      if (nn_dists[i] < max_pair_d2) {
-        // // Check planar distance (only after a few steps for initial alignment)
-        // auto diff = aligned_points[sample_inds[i].first].getVector3fMap() -
-        //             point_map[sample_inds[i].second].getVector3fMap();
-        // float planar_dist = std::abs(
-        //     diff.dot(point_map[sample_inds[i].second].getNormalVector3fMap()));
-        // if (step < first_steps || planar_dist < max_planar_d) {
-          filtered_sample_inds.push_back(sample_inds[i]);
-        // }
-      }
-    }
+    const pointcloud::icp::PointToPointPolicy policy;
+    const auto filtered_sample_inds = pointcloud::icp::filterAssociations(
+        aligned_points, point_map, sample_inds, nn_dists, max_pair_d2, step, policy);
     timer[2]->stop();
 
     /// point to point optimization
@@ -210,20 +191,8 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
 #pragma omp parallel for schedule(dynamic, 10) num_threads(config_->num_threads)
     for (const auto &ind : filtered_sample_inds) {
       // noise model W = n * n.T (information matrix)
-      Eigen::Matrix3d W = [&] {
-        // point to line
-        // if (point_map[ind.second].normal_score > 0) {
-        //   Eigen::Vector3d nrm = map_normals_mat.block<3, 1>(0, ind.second).cast<double>();
-        //   return Eigen::Matrix3d((nrm * nrm.transpose()) + 1e-5 * Eigen::Matrix3d::Identity());
-        // } else {
-        //   Eigen::Matrix3d W = Eigen::Matrix3d::Identity();
-        //   W(2, 2) = 1e-5;
-        //   return W;
-        // }
-        /// point to point
-        Eigen::Matrix3d W = Eigen::Matrix3d::Identity();
-        return W;
-      }();
+      Eigen::Matrix3d W;
+      if (!policy.information(point_map[ind.second], W)) continue;
       auto noise_model = StaticNoiseModel<3>::MakeShared(W, NoiseType::INFORMATION);
 
       // query and reference point
@@ -251,9 +220,8 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
     /// Alignment
     timer[4]->start();
     {
-      const auto T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
-      aligned_mat = T_m_s * query_mat;
-      aligned_norms_mat = T_m_s * query_norms_mat;
+      const Eigen::Matrix4f T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
+      pointcloud::transformPointCloud(T_m_s, query_points, aligned_points, true, config_->num_threads);
     }
 
     // Update all result matrices
@@ -21,6 +21,7 @@
 #include "pcl_conversions/pcl_conversions.h"
 
 #include "vtr_radar/data_types/pointmap_pointer.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 
 namespace vtr {
 namespace radar {
@@ -111,13 +112,9 @@ void LocalizationMapRecallModule::run_(QueryCache &qdata0, OutputCache &,
   /// vertex frame, so can be slow.
   if (config_->visualize) {
     // clang-format off
-    const auto T_v_m = qdata.T_v_m_loc->matrix();
-    auto point_map = qdata.submap_loc->point_cloud();  // makes a copy
-    auto map_point_mat = point_map.getMatrixXfMap(3, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-
-    Eigen::Matrix3f C_v_m = (T_v_m.block<3, 3>(0, 0)).cast<float>();
-    Eigen::Vector3f r_m_v_in_v = (T_v_m.block<3, 1>(0, 3)).cast<float>();
-    map_point_mat = (C_v_m * map_point_mat).colwise() + r_m_v_in_v;
+    const Eigen::Matrix4f T_v_m = qdata.T_v_m_loc->matrix().cast<float>();
+    pcl::PointCloud<PointWithInfo> point_map;
+    pointcloud::transformPointCloud(T_v_m, qdata.submap_loc->point_cloud(), point_map, false);
 
     PointCloudMsg pc2_msg;
     pcl::toROSMsg(point_map, pc2_msg);
@@ -19,6 +19,7 @@
 #include "vtr_radar/modules/odometry/odometry_map_maintenance_module.hpp"
 
 #include "pcl_conversions/pcl_conversions.h"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 
 namespace vtr {
 namespace radar {
@@ -72,13 +73,8 @@ void OdometryMapMaintenanceModule::run_(QueryCache &qdata0, OutputCache &,
   }
 
   // Transform points into the map frame
-  auto T_m_s = (T_s_r * T_r_m_odo).inverse().matrix().cast<float>();
-  // clang-format off
-  auto points_mat = points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-  auto normal_mat = points.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::normal_offset());
-  // clang-format on
-  points_mat = T_m_s * points_mat;
-  normal_mat = T_m_s * normal_mat;
+  const Eigen::Matrix4f T_m_s = (T_s_r * T_r_m_odo).inverse().matrix().cast<float>();
+  pointcloud::transformPointCloud(T_m_s, points);
 
   // update the map with new points and refresh their life time and normal
   auto update_cb = [&config = config_](bool, PointWithInfo &curr_pt,
@@ -111,12 +107,11 @@ void OdometryMapMaintenanceModule::run_(QueryCache &qdata0, OutputCache &,
   /// vertex frame, so can be slow.
   if (config_->visualize) {
     // clang-format off
-    const auto T_v_m = sliding_map_odo.T_vertex_this().matrix().cast<float>();
+    const Eigen::Matrix4f T_v_m = sliding_map_odo.T_vertex_this().matrix().cast<float>();
     // publish the map
     {
-      auto point_map = sliding_map_odo.point_cloud();  // makes a copy
-      auto map_point_mat = point_map.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-      map_point_mat = T_v_m * map_point_mat;
+      pcl::PointCloud<PointWithInfo> point_map;
+      pointcloud::transformPointCloud(T_v_m, sliding_map_odo.point_cloud(), point_map, false);
 
       PointCloudMsg pc2_msg;
       pcl::toROSMsg(point_map, pc2_msg);
@@ -126,9 +121,8 @@ void OdometryMapMaintenanceModule::run_(QueryCache &qdata0, OutputCache &,
     }
     // publish the aligned points
     {
-      auto scan_in_vf = points;
-      auto points_mat = scan_in_vf.getMatrixXfMap(4, PointWithInfo::size(), PointWithInfo::cartesian_offset());
-      points_mat = T_v_m * points_mat;
+      pcl::PointCloud<PointWithInfo> scan_in_vf;
+      pointcloud::transformPointCloud(T_v_m, points, scan_in_vf, false);
 
       PointCloudMsg pc2_msg;
       pcl::toROSMsg(scan_in_vf, pc2_msg);
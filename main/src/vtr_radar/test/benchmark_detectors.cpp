@@ -0,0 +1,368 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file benchmark_detectors.cpp
+ * \author Keenan Burnett, Autonomous Space Robotics Lab (ASRL)
+ * \brief Run time of the Navtech keypoint detectors
+ */
+
+// Runs every detector on recorded Navtech scans (polar png files as read by
+// load_radar) or on synthetic scans of the same size, with one thread and with
+// all threads, and checks that the detections are identical:
+//   - to the single threaded run (azimuths are merged in order)
+//   - for CACFAR and ModifiedCACFAR, to the previous implementation that
+//     summed the training cells of every range bin (O(N W) per azimuth)
+//   - for OSCFAR, to the previous implementation that kept the training cells
+//     in a sorted vector (O(W) per range bin)
+// Exits with 1 if any detection differs.
+//
+// Usage: benchmark_detectors [scan.png ...]
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <random>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "vtr_radar/detector/detector.hpp"
+#include "vtr_radar/utils/utils.hpp"
+
+using namespace vtr::radar;
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+namespace {
+
+struct Scan {
+  cv::Mat fft_data;
+  std::vector<int64_t> azimuth_times;
+  std::vector<double> azimuth_angles;
+};
+
+// 400 azimuths x 3360 range bins of exponential clutter with a few targets,
+// encoded the same way as the Navtech polar images
+Scan make_scan(std::mt19937 &rng) {
+  const int rows = 400, range_bins = 3360;
+  cv::Mat raw = cv::Mat::zeros(rows, range_bins + 11, CV_8UC1);
+  std::exponential_distribution<double> clutter(25.0);
+  std::uniform_int_distribution<int> target_bin(0, range_bins - 1);
+  for (int i = 0; i < rows; ++i) {
+    uchar *row = raw.ptr<uchar>(i);
+    const int64_t time = 1000000 + 625 * i;
+    const uint16_t encoder = i * 14;
+    std::memcpy(row, &time, sizeof(time));
+    std::memcpy(row + 8, &encoder, sizeof(encoder));
+    for (int j = 0; j < range_bins; ++j)
+      row[11 + j] = (uchar)std::min(255.0, 255.0 * clutter(rng));
+    for (int t = 0; t < 20; ++t) {
+      const int j = target_bin(rng);
+      for (int k = j; k < std::min(range_bins, j + 4); ++k) row[11 + k] = 200;
+    }
+  }
+  Scan scan;
+  load_radar(raw, scan.azimuth_times, scan.azimuth_angles, scan.fft_data);
+  return scan;
+}
+
+/// previous implementations
+void reference_cacfar(const Scan &scan, const float res, PointCloud &pointcloud,
+                      int width = 41, const int guard = 2,
+                      const double threshold = 3.0,
+                      const double threshold2 = 1.1,
+                      const double threshold3 = 0.22, const double minr = 2.0,
+                      const double maxr = 100.0,
+                      const double range_offset = -0.31) {
+  const cv::Mat &raw_scan = scan.fft_data;
+  pointcloud.clear();
+  const int rows = raw_scan.rows;
+  const int cols = raw_scan.cols;
+  if (width % 2 == 0) width += 1;
+  const int w2 = std::floor(width / 2);
+  const int window = width + guard * 2;
+  auto mincol = minr / res + w2 + guard + 1;
+  if (mincol > cols || mincol < 0) mincol = 0;
+  auto maxcol = maxr / res - w2 - guard;
+  if (maxcol > cols || maxcol < 0) maxcol = cols;
+  const int N = maxcol - mincol;
+  for (int i = 0; i < rows; ++i) {
+    double mean = 0;
+    for (int j = mincol; j < maxcol; ++j) mean += raw_scan.at<float>(i, j);
+    mean /= N;
+    for (int j = mincol; j < maxcol; ++j) {
+      double left = 0;
+      double right = 0;
+      for (int k = -w2 - guard; k < -guard; ++k)
+        left += raw_scan.at<float>(i, j + k);
+      for (int k = guard + 1; k <= w2 + guard; ++k)
+        right += raw_scan.at<float>(i, j + k);
+      const double stat = std::max(left, right);
+      const float thres =
+          threshold * stat / (window / 2) + threshold2 * mean + threshold3;
+      if (raw_scan.at<float>(i, j) > thres) {
+        PointWithInfo p;
+        p.rho = j * res + range_offset;
+        p.phi = scan.azimuth_angles[i];
+        p.theta = 0;
+        p.timestamp = scan.azimuth_times[i];
+        pointcloud.push_back(p);
+      }
+    }
+  }
+}
+
+void reference_modified_cacfar(
+    const Scan &scan, const float res, PointCloud &pointcloud, int width = 41,
+    const int guard = 2, const double threshold = 3.0,
+    const double threshold2 = 1.1, const double threshold3 = 0.22,
+    const double minr = 2.0, const double maxr = 100.0,
+    const double range_offset = -0.31) {
+  const cv::Mat &raw_scan = scan.fft_data;
+  pointcloud.clear();
+  const int rows = raw_scan.rows;
+  const int cols = raw_scan.cols;
+  if (width % 2 == 0) width += 1;
+  const int w2 = std::floor(width / 2);
+  auto mincol = minr / res + w2 + guard + 1;
+  if (mincol > cols || mincol < 0) mincol = 0;
+  auto maxcol = maxr / res - w2 - guard;
+  if (maxcol > cols || maxcol < 0) maxcol = cols;
+  const int N = maxcol - mincol;
+  for (int i = 0; i < rows; ++i) {
+    double mean = 0;
+    for (int j = mincol; j < maxcol; ++j) mean += raw_scan.at<float>(i, j);
+    mean /= N;
+    float peak_points = 0;
+    int num_peak_points = 0;
+    for (int j = mincol; j < maxcol; ++j) {
+      double left = 0;
+      double right = 0;
+      for (int k = -w2 - guard; k < -guard; ++k)
+        left += raw_scan.at<float>(i, j + k);
+      for (int k = guard + 1; k <= w2 + guard; ++k)
+        right += raw_scan.at<float>(i, j + k);
+      const double stat = std::max(left, right) / w2;
+      const float thres = threshold * stat + threshold2 * mean + threshold3;
+      if (raw_scan.at<float>(i, j) > thres) {
+        peak_points += j;
+        num_peak_points += 1;
+      } else if (num_peak_points > 0) {
+        PointWithInfo p;
+        p.rho = res * peak_points / num_peak_points + range_offset;
+        p.phi = scan.azimuth_angles[i];
+        p.theta = 0;
+        p.timestamp = scan.azimuth_times[i];
+        pointcloud.push_back(p);
+        peak_points = 0;
+        num_peak_points = 0;
+      }
+    }
+  }
+}
+
+void reference_oscfar(const Scan &scan, const float res,
+                      PointCloud &pointcloud, int width = 40,
+                      const int kstat = 20, const double threshold = 1.25,
+                      const double threshold2 = 1.2,
+                      const double threshold3 = 0.22, const double minr = 2.0,
+                      const double maxr = 100.0,
+                      const double range_offset = -0.31) {
+  const auto sort_asc_by_second = [](const std::pair<int, float> &a,
+                                     const std::pair<int, float> &b) {
+    return (a.second < b.second);
+  };
+  const cv::Mat &raw_scan = scan.fft_data;
+  pointcloud.clear();
+  const int rows = raw_scan.rows;
+  const int cols = raw_scan.cols;
+  if (width % 2 == 0) width += 1;
+  const int w2 = std::floor(width / 2);
+  auto mincol = minr / res + w2 + 1;
+  if (mincol > cols || mincol < 0) mincol = 0;
+  auto maxcol = maxr / res - w2;
+  if (maxcol > cols || maxcol < 0) maxcol = cols;
+  const int N = maxcol - mincol;
+  for (int i = 0; i < rows; ++i) {
+    double mean = 0;
+    for (int j = mincol; j < maxcol; ++j) mean += raw_scan.at<float>(i, j);
+    mean /= N;
+    std::vector<std::pair<int, float>> window;
+    window.reserve(width - 1);
+    int j = mincol - 1;
+    for (int k = -w2; k < 0; ++k)
+      window.emplace_back(j + k, raw_scan.at<float>(i, j + k));
+    for (int k = 1; k <= w2; ++k)
+      window.emplace_back(j + k, raw_scan.at<float>(i, j + k));
+    std::sort(window.begin(), window.end(), sort_asc_by_second);
+    float peak_points = 0;
+    int num_peak_points = 0;
+    for (j = mincol; j < maxcol; ++j) {
+      window.erase(std::remove_if(window.begin(), window.end(),
+                                  [&](const std::pair<int, float> &p) {
+                                    return p.first == j ||
+                                           p.first == j - w2 - 1;
+                                  }),
+                   window.end());
+      auto prevcut = std::make_pair(j - 1, raw_scan.at<float>(i, j - 1));
+      window.insert(std::lower_bound(window.begin(), window.end(), prevcut,
+                                     sort_asc_by_second),
+                    prevcut);
+      auto newentry = std::make_pair(j + w2, raw_scan.at<float>(i, j + w2));
+      window.insert(std::lower_bound(window.begin(), window.end(), newentry,
+                                     sort_asc_by_second),
+                    newentry);
+      const double stat = window[kstat].second;
+      const float thres = threshold * stat + threshold2 * mean + threshold3;
+      if (raw_scan.at<float>(i, j) > thres) {
+        peak_points += j;
+        num_peak_points += 1;
+      } else if (num_peak_points > 0) {
+        PointWithInfo p;
+        p.rho = res * peak_points / num_peak_points + range_offset;
+        p.phi = scan.azimuth_angles[i];
+        p.theta = 0;
+        p.timestamp = scan.azimuth_times[i];
+        pointcloud.push_back(p);
+        peak_points = 0;
+        num_peak_points = 0;
+      }
+    }
+  }
+}
+
+bool identical(const PointCloud &a, const PointCloud &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t k = 0; k < a.size(); ++k)
+    if (a[k].rho != b[k].rho || a[k].phi != b[k].phi ||
+        a[k].timestamp != b[k].timestamp)
+      return false;
+  return true;
+}
+
+void set_threads(const int threads) {
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#else
+  (void)threads;
+#endif
+}
+
+int max_threads() {
+#ifdef _OPENMP
+  return omp_get_num_procs();
+#else
+  return 1;
+#endif
+}
+
+/// mean run time in ms over repetitions, keeps the last detections
+template <typename Run>
+double time_ms(const Run &run, PointCloud &pointcloud, const int repetitions) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repetitions; ++r) run(pointcloud);
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         repetitions;
+}
+
+std::string format_ms(const double ms) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(2) << ms;
+  return ss.str();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<Scan> scans;
+  for (int k = 1; k < argc; ++k) {
+    Scan scan;
+    load_radar(argv[k], scan.azimuth_times, scan.azimuth_angles,
+               scan.fft_data);
+    scans.push_back(scan);
+  }
+  std::mt19937 rng(0);
+  while (scans.size() < 5) scans.push_back(make_scan(rng));
+  const float res = 0.0596;
+  const int repetitions = 3;
+
+  using DetectorRun = std::function<void(const Scan &, PointCloud &)>;
+  const auto wrap = [res](auto detector) -> DetectorRun {
+    return [detector, res](const Scan &scan, PointCloud &pointcloud) mutable {
+      detector.run(scan.fft_data, res, scan.azimuth_times, scan.azimuth_angles,
+                   pointcloud);
+    };
+  };
+  const std::vector<std::tuple<std::string, DetectorRun, DetectorRun>>
+      detectors{
+          {"kstrongest", wrap(KStrongest<PointWithInfo>()), nullptr},
+          {"cen2018", wrap(Cen2018<PointWithInfo>()), nullptr},
+          {"cacfar", wrap(CACFAR<PointWithInfo>()),
+           [res](const Scan &scan, PointCloud &pointcloud) {
+             reference_cacfar(scan, res, pointcloud);
+           }},
+          {"oscfar", wrap(OSCFAR<PointWithInfo>()),
+           [res](const Scan &scan, PointCloud &pointcloud) {
+             reference_oscfar(scan, res, pointcloud);
+           }},
+          {"modified_cacfar", wrap(ModifiedCACFAR<PointWithInfo>()),
+           [res](const Scan &scan, PointCloud &pointcloud) {
+             reference_modified_cacfar(scan, res, pointcloud);
+           }},
+      };
+
+  const int threads = max_threads();
+  std::cout << std::setw(16) << "detector" << std::setw(12) << "reference"
+            << std::setw(12) << "1 thread" << std::setw(12)
+            << (std::to_string(threads) + " threads") << std::setw(12)
+            << "points" << std::setw(12) << "identical"
+            << "   (mean time per scan in ms)" << std::endl;
+  bool all_identical = true;
+  for (const auto &[name, run, reference] : detectors) {
+    double reference_time = 0, serial_time = 0, parallel_time = 0;
+    size_t points = 0;
+    bool same = true;
+    for (const auto &scan : scans) {
+      PointCloud expected, serial, parallel;
+      if (reference) {
+        reference_time += time_ms(
+            [&](PointCloud &pc) { reference(scan, pc); }, expected, 1);
+      }
+      set_threads(1);
+      serial_time += time_ms([&](PointCloud &pc) { run(scan, pc); }, serial,
+                             repetitions);
+      set_threads(threads);
+      parallel_time += time_ms([&](PointCloud &pc) { run(scan, pc); },
+                               parallel, repetitions);
+      same &= identical(serial, parallel);
+      if (reference) same &= identical(expected, serial);
+      points += parallel.size();
+    }
+    all_identical &= same;
+    const double n = scans.size();
+    std::cout << std::setw(16) << name << std::fixed << std::setprecision(2)
+              << std::setw(12)
+              << (reference ? format_ms(reference_time / n) : "-")
+              << std::setw(12) << serial_time / n << std::setw(12)
+              << parallel_time / n << std::setw(12) << points / scans.size()
+              << std::setw(12) << (same ? "yes" : "NO") << std::endl;
+  }
+  return all_identical ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_detector.cpp
+ * \author Keenan Burnett, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <random>
+
+#include "vtr_radar/detector/detector.hpp"
+
+using namespace ::testing;  // NOLINT
+using namespace vtr::radar;
+
+namespace {
+
+using PointCloud = pcl::PointCloud<PointWithInfo>;
+
+constexpr float res = 0.0438;
+constexpr double range_offset = -0.31;
+
+struct Scan {
+  cv::Mat fft_data;
+  std::vector<int64_t> azimuth_times;
+  std::vector<double> azimuth_angles;
+};
+
+/// exponential clutter with a few targets, some of them at the end of the scan
+Scan makeScan(const int rows, const int cols, std::mt19937 &gen) {
+  Scan scan;
+  scan.fft_data = cv::Mat::zeros(rows, cols, CV_32F);
+  std::exponential_distribution<float> clutter(10.0);
+  std::uniform_int_distribution<int> target(0, cols - 1);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j)
+      scan.fft_data.at<float>(i, j) = clutter(gen);
+    for (int t = 0; t < 5; ++t) scan.fft_data.at<float>(i, target(gen)) = 1.0;
+    scan.fft_data.at<float>(i, cols - 1) = 1.0;
+    scan.azimuth_times.push_back(1000 * i);
+    scan.azimuth_angles.push_back(2 * M_PI * i / rows);
+  }
+  return scan;
+}
+
+PointCloud detect(Detector<PointWithInfo> &&detector, const Scan &scan) {
+  PointCloud pointcloud;
+  detector.run(scan.fft_data, res, scan.azimuth_times, scan.azimuth_angles,
+               pointcloud);
+  return pointcloud;
+}
+
+/// k-th smallest value of values[begin, end) by brute force
+float kthSmallest(const std::vector<float> &values, const size_t begin,
+                  const size_t end, const size_t k) {
+  std::vector<float> window(values.begin() + begin, values.begin() + end);
+  std::nth_element(window.begin(), window.begin() + k, window.end());
+  return window[k];
+}
+
+/// rows of few distinct values (many ties) or of continuous values
+std::vector<float> makeRow(const size_t size, const bool ties,
+                           std::mt19937 &gen) {
+  std::uniform_int_distribution<int> level(0, 3);
+  std::exponential_distribution<float> clutter(10.0);
+  std::vector<float> row(size);
+  for (auto &value : row) value = ties ? float(level(gen)) : clutter(gen);
+  return row;
+}
+
+bool sameDetections(const PointCloud &a, const PointCloud &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i)
+    if (a[i].rho != b[i].rho || a[i].phi != b[i].phi ||
+        a[i].timestamp != b[i].timestamp)
+      return false;
+  return true;
+}
+
+/// detections can only be at range bins whose training cells are in the scan
+bool withinScan(const PointCloud &pointcloud, const int margin,
+                const int cols) {
+  for (const auto &p : pointcloud) {
+    const double j = (p.rho - range_offset) / res;
+    if (j < margin - 1e-3 || j > cols - 1 - margin + 1e-3) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(RADAR, sliding_kth_smallest_slide) {
+  std::mt19937 gen(4);
+  const size_t N = 200;
+  for (const bool ties : {true, false}) {
+    const auto row = makeRow(N, ties, gen);
+    for (const size_t W : {size_t(1), size_t(2), size_t(7), size_t(41), N}) {
+      for (const size_t k : {size_t(0), W / 2, W - 1}) {
+        // an id per cell, unique among the W cells of the window and the
+        // incoming one
+        const size_t capacity = W + 1;
+        SlidingKthSmallest window(k, capacity);
+        for (size_t j = 0; j < W; ++j) {
+          window.insert(j % capacity, row[j]);
+          if (j >= k)
+            ASSERT_EQ(window.kth(), kthSmallest(row, 0, j + 1, k))
+                << "W " << W << ", k " << k << ", inserted " << j + 1;
+        }
+        for (size_t j = W; j < N; ++j) {
+          window.replace((j - W) % capacity, j % capacity, row[j]);
+          ASSERT_EQ(window.kth(), kthSmallest(row, j + 1 - W, j + 1, k))
+              << "W " << W << ", k " << k << ", window end " << j;
+        }
+      }
+    }
+  }
+}
+
+TEST(RADAR, sliding_kth_smallest_random_replace) {
+  std::mt19937 gen(5);
+  const size_t W = 41;
+  for (const bool ties : {true, false}) {
+    for (const size_t k : {size_t(0), size_t(20), W - 1}) {
+      // window[id] is the value of id, ids are the ids in the window and W
+      // is the free one
+      auto window = makeRow(W + 1, ties, gen);
+      std::vector<int> ids(W);
+      SlidingKthSmallest kth(k, W + 1);
+      for (size_t i = 0; i < W; ++i) kth.insert(i, window[i]), ids[i] = i;
+      int free_id = W;
+      std::uniform_int_distribution<size_t> slot(0, W - 1);
+      for (int t = 0; t < 2000; ++t) {
+        const size_t s = slot(gen);
+        const float value = makeRow(1, ties, gen)[0];
+        kth.replace(ids[s], free_id, value);
+        window[free_id] = value;
+        std::swap(ids[s], free_id);
+        std::vector<float> current;
+        for (const int id : ids) current.push_back(window[id]);
+        ASSERT_EQ(kth.kth(), kthSmallest(current, 0, W, k))
+            << "k " << k << ", replacement " << t;
+      }
+    }
+  }
+}
+
+TEST(RADAR, cacfar_range_beyond_scan) {
+  std::mt19937 gen(0);
+  const int cols = 500, width = 41, guard = 2;
+  const auto scan = makeScan(20, cols, gen);
+  const double end = cols * res;
+  const auto make = [&](const double minr, const double maxr) {
+    return CACFAR<PointWithInfo>(width, guard, 3.0, 1.1, 0.22, minr, maxr,
+                                 range_offset);
+  };
+  const auto within = detect(make(0.0, end), scan);
+  ASSERT_FALSE(within.empty());
+  EXPECT_TRUE(withinScan(within, width / 2 + guard, cols));
+  // max range beyond the scan is the end of the scan
+  EXPECT_TRUE(sameDetections(detect(make(0.0, 10 * end), scan), within));
+  // min range beyond the scan is the start of the scan
+  EXPECT_TRUE(sameDetections(detect(make(10 * end, end), scan), within));
+}
+
+TEST(RADAR, modified_cacfar_range_beyond_scan) {
+  std::mt19937 gen(1);
+  const int cols = 500, width = 41, guard = 2;
+  const auto scan = makeScan(20, cols, gen);
+  const double end = cols * res;
+  const auto make = [&](const double minr, const double maxr) {
+    return ModifiedCACFAR<PointWithInfo>(width, guard, 3.0, 1.1, 0.22, minr,
+                                         maxr, range_offset);
+  };
+  const auto within = detect(make(0.0, end), scan);
+  ASSERT_FALSE(within.empty());
+  EXPECT_TRUE(withinScan(within, width / 2 + guard, cols));
+  EXPECT_TRUE(sameDetections(detect(make(0.0, 10 * end), scan), within));
+  EXPECT_TRUE(sameDetections(detect(make(10 * end, end), scan), within));
+}
+
+TEST(RADAR, oscfar_range_beyond_scan) {
+  std::mt19937 gen(2);
+  const int cols = 500, width = 41;
+  const auto scan = makeScan(20, cols, gen);
+  const double end = cols * res;
+  const auto make = [&](const double minr, const double maxr) {
+    return OSCFAR<PointWithInfo>(width, 2, 20, 1.25, 1.2, 0.22, minr, maxr,
+                                 range_offset);
+  };
+  const auto within = detect(make(0.0, end), scan);
+  ASSERT_FALSE(within.empty());
+  EXPECT_TRUE(withinScan(within, width / 2, cols));
+  EXPECT_TRUE(sameDetections(detect(make(0.0, 10 * end), scan), within));
+  EXPECT_TRUE(sameDetections(detect(make(10 * end, end), scan), within));
+}
+
+TEST(RADAR, cfar_scan_shorter_than_window) {
+  std::mt19937 gen(3);
+  const auto scan = makeScan(4, 30, gen);
+  EXPECT_TRUE(detect(CACFAR<PointWithInfo>(), scan).empty());
+  EXPECT_TRUE(detect(ModifiedCACFAR<PointWithInfo>(), scan).empty());
+  EXPECT_TRUE(detect(OSCFAR<PointWithInfo>(), scan).empty());
+}
+
+int main(int argc, char **argv) {
+  InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
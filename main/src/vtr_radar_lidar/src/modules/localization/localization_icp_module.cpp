@@ -19,6 +19,8 @@
 #include "vtr_radar_lidar/modules/localization/localization_icp_module.hpp"
 
 #include "vtr_lidar/utils/nanoflann_utils.hpp"
+#include "vtr_pointcloud/icp/icp_kernels.hpp"
+#include "vtr_pointcloud/transform/transform_kernels.hpp"
 
 namespace vtr {
 namespace radar_lidar {
@@ -138,48 +140,37 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
 
   // project points to 2D
   {
-    auto aligned_point_map = point_map;
-    // clang-format off
-    auto map_mat = point_map.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::cartesian_offset());
-    auto map_normals_mat = point_map.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::normal_offset());
-    auto aligned_map_mat = aligned_point_map.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::cartesian_offset());
-    auto aligned_map_normals_mat = aligned_point_map.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::normal_offset());
-
     // convert to sensor frame
-    const auto T_s_m = (T_s_r * T_r_v * T_v_m).matrix().cast<float>();
-    aligned_map_mat = T_s_m * map_mat;
-    aligned_map_normals_mat = T_s_m * map_normals_mat;
+    const Eigen::Matrix4f T_s_m = (T_s_r * T_r_v * T_v_m).matrix().cast<float>();
+    pointcloud::transformPointCloud(T_s_m, point_map, true, config_->num_threads);
 
     // project to 2D
-    for (uint j = 0; j < aligned_map_mat.cols(); ++j) {
-        const double px = aligned_map_mat(0, j);
-        const double py = aligned_map_mat(1, j);
-        const double pz = aligned_map_mat(2, j);
-        const double rho = std::sqrt(px * px + py * py + pz * pz);
-        const double phi = std::atan2(py, px);
-        aligned_map_mat(0, j) = rho * std::cos(phi);
-        aligned_map_mat(1, j) = rho * std::sin(phi);
-        aligned_map_mat(2, j) = 0.0;
+    for (auto &p : point_map) {
+      const double px = p.x;
+      const double py = p.y;
+      const double pz = p.z;
+      const double rho = std::sqrt(px * px + py * py + pz * pz);
+      const double phi = std::atan2(py, px);
+      p.x = rho * std::cos(phi);
+      p.y = rho * std::sin(phi);
+      p.z = 0.0;
+      // \todo double check correctness of this normal projection
+      p.normal_z = 0.0;
+      const float norm = std::sqrt(p.normal_x * p.normal_x + p.normal_y * p.normal_y);
+      p.normal_x /= norm;
+      p.normal_y /= norm;
     }
-    aligned_map_normals_mat.row(2).setZero();
-    // \todo double check correctness of this normal projection
-    Eigen::MatrixXf aligned_map_norms_mat = aligned_map_normals_mat.colwise().norm();
-    aligned_map_normals_mat.row(0).array() /= aligned_map_norms_mat.array();
-    aligned_map_normals_mat.row(1).array() /= aligned_map_norms_mat.array();
 
     // convert back to point map frame
-    const auto T_m_s = T_s_m.inverse();
-    map_mat = T_m_s * aligned_map_mat;
-    map_normals_mat = T_m_s * aligned_map_normals_mat;
-    // clang-format on
+    const Eigen::Matrix4f T_m_s = T_s_m.inverse();
+    pointcloud::transformPointCloud(T_m_s, point_map, true, config_->num_threads);
   }
 
   if (config_->visualize) {
     // clang-format off
-    auto point_map_in_v = point_map;  // makes a copy
-    auto map_point_mat = point_map_in_v.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::cartesian_offset());
+    pcl::PointCloud<lidar::PointWithInfo> point_map_in_v;
     Eigen::Matrix4f T_v_m_mat = T_v_m.matrix().cast<float>();
-    map_point_mat = T_v_m_mat * map_point_mat;
+    pointcloud::transformPointCloud(T_v_m_mat, point_map, point_map_in_v, false);
 
     PointCloudMsg pc2_msg;
     pcl::toROSMsg(point_map_in_v, pc2_msg);
@@ -195,7 +186,6 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
   float max_pair_d = config_->initial_max_pairing_dist;
   // float max_planar_d = config_->initial_max_planar_dist;
   float max_pair_d2 = max_pair_d * max_pair_d;
-  lidar::KDTreeSearchParams search_params;
 
   // clang-format off
   /// Create robot to sensor transform variable, fixed.
@@ -225,9 +215,6 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
   const auto map_mat = point_map.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::cartesian_offset());
   // const auto map_normals_mat = point_map.getMatrixXfMap(4, lidar::PointWithInfo::size(), lidar::PointWithInfo::normal_offset());
   const auto query_mat = query_points.getMatrixXfMap(4, radar::PointWithInfo::size(), radar::PointWithInfo::cartesian_offset());
-  const auto query_norms_mat = query_points.getMatrixXfMap(4, radar::PointWithInfo::size(), radar::PointWithInfo::normal_offset());
-  auto aligned_mat = aligned_points.getMatrixXfMap(4, radar::PointWithInfo::size(), radar::PointWithInfo::cartesian_offset());
-  auto aligned_norms_mat = aligned_points.getMatrixXfMap(4, radar::PointWithInfo::size(), radar::PointWithInfo::normal_offset());
 
   /// create kd-tree of the map
   CLOG(DEBUG, "radar_lidar.localization_icp") << "Start building a kd-tree of the map.";
@@ -238,9 +225,8 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
 
   /// perform initial alignment
   {
-    const auto T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
-    aligned_mat = T_m_s * query_mat;
-    aligned_norms_mat = T_m_s * query_norms_mat;
+    const Eigen::Matrix4f T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
+    pointcloud::transformPointCloud(T_m_s, query_points, aligned_points, true, config_->num_threads);
   }
 
   using Stopwatch = common::timing::Stopwatch<>;
@@ -283,13 +269,8 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
 
     /// find nearest neigbors and distances
     timer[1]->start();
-    std::vector<float> nn_dists(sample_inds.size());
-#pragma omp parallel for schedule(dynamic, 10) num_threads(config_->num_threads)
-    for (size_t i = 0; i < sample_inds.size(); i++) {
-      lidar::KDTreeResultSet result_set(1);
-      result_set.init(&sample_inds[i].second, &nn_dists[i]);
-      kdtree->findNeighbors(result_set, aligned_points[sample_inds[i].first].data, search_params);
-    }
+    std::vector<float> nn_dists;
+    pointcloud::icp::findNearestNeighbors(*kdtree, aligned_points, sample_inds, nn_dists, config_->num_threads);
     timer[1]->stop();
 
     /// filtering based on distances metrics
@@ -370,9 +351,8 @@ void LocalizationICPModule::run_(QueryCache &qdata0, OutputCache &,
     /// Alignment
     timer[4]->start();
     {
-      const auto T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
-      aligned_mat = T_m_s * query_mat;
-      aligned_norms_mat = T_m_s * query_norms_mat;
+      const Eigen::Matrix4f T_m_s = T_m_s_eval->evaluate().matrix().cast<float>();
+      pointcloud::transformPointCloud(T_m_s, query_points, aligned_points, true, config_->num_threads);
     }
 
     // Update all result matrices
@@ -121,6 +121,13 @@ class DataBubble : public DataBubbleBase {
   std::vector<MessagePtr> retrieve(const Timestamp& start,
                                    const Timestamp& stop);
 
+  /**
+   * \brief Retrieves a reference to the message without caching it: a message
+   * not in cache is read from disk and released with the returned pointer.
+   * \note changes to a message read from disk are not saved
+   */
+  MessagePtr retrieveUncached(const Timestamp& time);
+
   /** \brief Gets the size of the bubble. */
   size_t size() const override;
 
@@ -313,6 +320,26 @@ auto DataBubble<DataType>::retrieve(const Timestamp& start,
   return messages;
 }
 
+template <typename DataType>
+auto DataBubble<DataType>::retrieveUncached(const Timestamp& time)
+    -> MessagePtr {
+  const LockGuard lock(mutex_);
+  const auto itr = time2message_map_.find(time);
+  if (itr != time2message_map_.end()) return itr->second;
+
+  auto accessor = accessor_.lock();
+  if (!accessor) {
+    CLOG(WARNING, "storage") << "Accessor has expired or not set. Skip loading";
+    return nullptr;
+  }
+  const auto message = accessor->readAtTimestamp(time);
+  if (!message)
+    CLOG(WARNING, "storage")
+        << "Message with time stamp " << time
+        << " does not exist in cache or disk. Return a nullptr.";
+  return message;
+}
+
 template <typename DataType>
 size_t DataBubble<DataType>::size() const {
   const LockGuard lock(mutex_);
@@ -89,11 +89,26 @@ class Message : public MessageBase {
 
   const DataType& getData() const { return *data_; }
 
+  /**
+   * \brief Gets a mutable reference to the data for in-place updates, marks
+   * the message unsaved. Only use it while holding the exclusive lock of the
+   * lockable message, i.e. through locked().
+   */
+  DataType& getDataMutable() {
+    saved_ = false;
+    return *data_;
+  }
+
   void setData(const DataType& data) {
     *data_ = data;
     saved_ = false;
   }
 
+  void setData(DataType&& data) {
+    *data_ = std::move(data);
+    saved_ = false;
+  }
+
  private:
   std::shared_ptr<DataType> data_;
 };
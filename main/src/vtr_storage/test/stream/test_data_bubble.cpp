@@ -163,6 +163,41 @@ TEST_F(TemporaryDirectoryFixture, load_loaded_unload) {
   EXPECT_EQ(retrieved_data3.data, "data2");
 }
 
+TEST_F(TemporaryDirectoryFixture, retrieve_uncached) {
+  // accessor used by the data bubble
+  auto accessor =
+      std::make_shared<DataStreamAccessor<StringMsg>>(temp_dir_, "test_string");
+
+  DataBubble<StringMsg> db(accessor), db2(accessor);
+
+  // a test message
+  Timestamp timestamp = 0;
+  StringMsg data;
+  data.data = "data";
+  auto message = std::make_shared<LockableMessage<StringMsg>>(
+      std::make_shared<StringMsg>(data), timestamp);
+
+  // a message in cache is returned as is, even if not on disk yet
+  EXPECT_TRUE(db.insert(message));
+  EXPECT_EQ(db.retrieveUncached(timestamp), message);
+
+  // save to disk and release the message
+  message.reset();
+  EXPECT_TRUE(db.unload());
+
+  // a message on disk is read without being added to the cache
+  auto retrieved = db2.retrieveUncached(timestamp);
+  ASSERT_NE(retrieved, nullptr);
+  EXPECT_EQ(retrieved->locked().get().getData().data, "data");
+  EXPECT_FALSE(db2.loaded(timestamp));
+  EXPECT_EQ(db2.size(), (size_t)0);
+
+  // a message neither in cache nor on disk
+  LOG(INFO) << "Expecting warning: Message with time stamp 1 does not exist in "
+               "cache or disk. Return a nullptr.";
+  EXPECT_EQ(db2.retrieveUncached(1), nullptr);
+}
+
 TEST_F(TemporaryDirectoryFixture, shared_ptr_to_message_concurrency) {
   // accessor used by the data bubble
   auto accessor =
@@ -128,6 +128,23 @@ TEST(TestLockableMessage, constructing_getting_setting_lockable_message) {
     EXPECT_EQ(message.getSaved(), true);
   }
 
+  /// update data in place through a locked reference
+  {
+    const auto data_ptr = std::make_shared<std::string>(data0);
+    LockableMessage<std::string> lockable_message{data_ptr, 100, 1};
+    EXPECT_EQ(lockable_message.unlocked().get().getSaved(), true);
+    {
+      auto locked_message = lockable_message.locked();
+      auto& data = locked_message.get().getDataMutable();
+      data.replace(data.size() - 1, 1, "2");
+    }
+    // the data is updated in place (no copy) and the message becomes unsaved
+    const auto& message = lockable_message.unlocked().get();
+    EXPECT_EQ(&message.getData(), data_ptr.get());
+    EXPECT_EQ(message.getData(), data2);
+    EXPECT_EQ(message.getSaved(), false);
+  }
+
   /// get a locked const reference to data
   {
     const auto data_ptr = std::make_shared<std::string>(data0);
@@ -18,6 +18,9 @@
  */
 #pragma once
 
+#include <mutex>
+#include <vector>
+
 #include "rclcpp/rclcpp.hpp"
 
 #include "steam.hpp"
@@ -103,6 +106,34 @@ class Cache {
 template <class DataType>
 using LockableCache = common::SharedLockable<Cache<DataType>>;
 
+/**
+ * \brief Wall time of the modules run on a frame, in completion order. Tasks
+ * dispatched by the frame keep its query cache, so their modules (run
+ * asynchronously, on other threads) are recorded here too.
+ */
+class ModuleTiming {
+ public:
+  struct Entry {
+    std::string module;
+    double ms;
+    bool async;
+  };
+
+  void add(const std::string& module, const double ms, const bool async) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(Entry{module, ms, async});
+  }
+
+  std::vector<Entry> entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<Entry> entries_;
+};
+
 struct QueryCache : std::enable_shared_from_this<QueryCache> {
   using Ptr = std::shared_ptr<QueryCache>;
 
@@ -113,6 +144,9 @@ struct QueryCache : std::enable_shared_from_this<QueryCache> {
   Cache<Timestamp> stamp;
   Cache<EnvInfo> env_info;
 
+  // load shedding decision, set when entering the pipeline
+  Cache<const LoadDecision> load_decision;
+
   // preprocessing
   Cache<const PipelineMode> pipeline_mode;
   Cache<const bool> first_frame;
@@ -133,6 +167,10 @@ struct QueryCache : std::enable_shared_from_this<QueryCache> {
   // graph memory management cache args
   Cache<const VertexId> live_mem_async;
   Cache<const std::pair<VertexId, VertexId>> graph_mem_async;
+
+  // profiling - wall time of the modules, only recorded when emplaced by the
+  // caller (e.g. offline replay)
+  Cache<ModuleTiming> module_timing;
 };
 
 /** \brief Shared memory to the path tracker. */
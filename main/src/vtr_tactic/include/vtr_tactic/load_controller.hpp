@@ -0,0 +1,122 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file load_controller.hpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+#include "vtr_tactic/types.hpp"
+
+namespace vtr {
+namespace tactic {
+
+/**
+ * \brief Adaptive load shedding across the pipeline stages.
+ * \details Tracks the service time of each stage, the number of frames in
+ * flight and the input-to-odometry latency with exponential moving averages.
+ * When odometry latency exceeds the configured budget (or frames pile up) the
+ * degradation level is raised by one, when it is well within budget the level
+ * is lowered by one, with a minimum number of frames between changes. Each
+ * level maps to a preprocessing resolution scale, an icp iteration scale and a
+ * localization period, see Config.
+ */
+class LoadController {
+ public:
+  using Mutex = std::mutex;
+  using LockGuard = std::lock_guard<Mutex>;
+
+  enum class Stage : size_t {
+    Preprocessing = 0,
+    OdometryMapping = 1,
+    Localization = 2,
+  };
+  static constexpr size_t NumStages = 3;
+
+  struct Config {
+    /** \brief Disabled controller always returns the nominal decision */
+    bool enabled = false;
+    /** \brief Target input-to-odometry latency in milliseconds */
+    double odometry_latency_budget = 100.0;
+    /** \brief Raise level when latency > budget * raise_ratio */
+    double raise_ratio = 1.0;
+    /** \brief Lower level when latency < budget * lower_ratio */
+    double lower_ratio = 0.6;
+    /** \brief Raise level when average number of frames in flight exceeds */
+    double max_frames_in_flight = 2.0;
+    /** \brief Weight of new samples in the moving averages */
+    double smoothing = 0.2;
+    /** \brief Minimum number of frames between two level changes */
+    int hold_frames = 5;
+    /// Per-level degradation, level 0 is nominal, all must have the same size
+    std::vector<double> resolution_scales{1.0, 1.0, 1.0, 1.5};
+    std::vector<double> icp_iteration_scales{1.0, 1.0, 0.5, 0.5};
+    /** \brief Localization runs once every n frames at each level */
+    std::vector<int> localization_periods{1, 2, 2, 4};
+  };
+
+  struct Statistics {
+    int level = 0;
+    /** \brief Moving average of input-to-odometry latency (ms) */
+    double odometry_latency = 0.0;
+    /** \brief Moving average of each stage's service time (ms) */
+    std::array<double, NumStages> service_time{0.0, 0.0, 0.0};
+    /** \brief Moving average of each stage's input queue size */
+    std::array<double, NumStages> queue_size{0.0, 0.0, 0.0};
+    /** \brief Moving average of number of frames in the pipeline */
+    double frames_in_flight = 0.0;
+    size_t num_frames = 0;
+    size_t num_localization_skipped = 0;
+    size_t num_level_changes = 0;
+  };
+
+  LoadController() : LoadController(Config()) {}
+  LoadController(const Config &config);
+
+  bool enabled() const { return config_.enabled; }
+
+  /** \brief Decides the degradation of a new frame entering the pipeline */
+  LoadDecision decide(const size_t frames_in_flight);
+
+  void recordServiceTime(const Stage &stage, const double &ms);
+  void recordQueueSize(const Stage &stage, const size_t &size);
+  void recordLocalizationSkipped();
+  /** \brief Called when odometry finishes, drives the level update */
+  void recordOdometryLatency(const double &ms);
+
+  Statistics statistics() const;
+
+ private:
+  void update(double &average, const double &sample) const;
+
+  const Config config_;
+  const int max_level_;
+
+  mutable Mutex mutex_;
+  Statistics stats_;
+  bool latency_initialized_ = false;
+  int frames_since_change_ = 0;
+  size_t localization_counter_ = 0;
+};
+
+std::ostream &operator<<(std::ostream &os,
+                         const LoadController::Statistics &stats);
+
+}  // namespace tactic
+}  // namespace vtr
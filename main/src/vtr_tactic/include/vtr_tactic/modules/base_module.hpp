@@ -95,6 +95,7 @@ class BaseModule : public std::enable_shared_from_this<BaseModule> {
   common::timing::Stopwatch<> timer_{false};
   common::timing::Stopwatch<boost::chrono::thread_clock> thread_timer_{false};
   std::atomic<int> count_{0};
+  std::atomic<int> async_count_{0};
 
   /// factory handlers (note: local static variable constructed on first use)
  private:
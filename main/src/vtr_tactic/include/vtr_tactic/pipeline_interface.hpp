@@ -21,6 +21,7 @@
 #include "rclcpp/rclcpp.hpp"
 
 #include "vtr_tactic/cache.hpp"
+#include "vtr_tactic/load_controller.hpp"
 #include "vtr_tactic/task_queue.hpp"
 #include "vtr_tactic/types.hpp"
 
@@ -160,13 +161,18 @@ class QueryBuffer {
     while (curr_size_ != size) cv_size_changed_.wait(lock);
   }
 
+  size_t size() const {
+    LockGuard lock(mutex_);
+    return curr_size_;
+  }
+
  private:
   /** \brief Buffer maximum size */
   const size_t size_;
   const bool require_immediate_pop_;
 
   /** \brief Protects all members below, cv should release this mutex */
-  std::mutex mutex_;
+  mutable std::mutex mutex_;
   /** \brief Wait until some thread is trying to pop but the queue is empty */
   std::condition_variable cv_has_waiting_;
   /** \brief Wait until the queue is not full */
@@ -202,7 +208,9 @@ class PipelineInterface {
                     const size_t& num_async_threads,
                     const size_t& async_queue_size,
                     const TaskQueueCallback::Ptr& task_queue_callback =
-                        std::make_shared<TaskQueueCallback>());
+                        std::make_shared<TaskQueueCallback>(),
+                    const LoadController::Config& load_controller_config =
+                        LoadController::Config());
 
   /** \brief Subclass must call join due to inheritance. */
   virtual ~PipelineInterface() { join(); }
@@ -218,10 +226,31 @@ class PipelineInterface {
   /** \brief Pipline entrypoint, gets query input from navigator */
   void input(const QueryCache::Ptr& qdata);
 
+  /**
+   * \brief Lock-step pipeline entrypoint for offline replay.
+   * \details Blocks until the pipeline mutex is available instead of dropping
+   * the frame, passes the query as non-discardable and returns only after the
+   * pipeline and the async task queue are empty, so that every frame is
+   * processed and timing does not depend on thread scheduling.
+   */
+  void inputLockstep(const QueryCache::Ptr& qdata);
+
+  /** \brief Load controller decisions and stage/queue metrics */
+  LoadController::Statistics loadStatistics() const {
+    return load_controller_.statistics();
+  }
+
  private:
   void inputSequential(const QueryCache::Ptr& qdata);
   void inputParallel(const QueryCache::Ptr& qdata);
 
+  /** \brief Sets the load decision of a new frame */
+  void decideLoad(const QueryCache::Ptr& qdata);
+  /** \brief Stage wrappers that time the stage and update the controller */
+  bool timedPreprocess(const QueryCache::Ptr& qdata);
+  bool timedOdometryMapping(const QueryCache::Ptr& qdata);
+  void timedLocalization(const QueryCache::Ptr& qdata);
+
   /** \brief Data preprocessing thread, input->preprocess->odo&mapping */
   void preprocess();
   /** \brief Odometry & mapping thread, preprocess->odo&mapping->localization */
@@ -246,6 +275,10 @@ class PipelineInterface {
 
   PipelineMutex pipeline_mutex_;
   common::joinable_semaphore pipeline_semaphore_{0};
+  /** \brief Set by inputLockstep, no frame is discarded by any stage */
+  std::atomic<bool> lockstep_{false};
+
+  LoadController load_controller_;
 
   QueryBuffer<QueryCache::Ptr> preprocessing_buffer_{0};
   QueryBuffer<QueryCache::Ptr> odometry_mapping_buffer_{0};
@@ -57,6 +57,9 @@ class Tactic : public PipelineInterface, public TacticInterface {
     /** \brief */
     double route_completion_translation_threshold = 0.5;
 
+    /** \brief Adaptive load shedding across pipeline stages */
+    LoadController::Config load_controller;
+
     /** \brief Configuration for the localization chain */
     LocalizationChain::Config chain_config;
 
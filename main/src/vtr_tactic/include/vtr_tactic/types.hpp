@@ -18,6 +18,7 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include "vtr_pose_graph/evaluator/evaluators.hpp"
@@ -81,5 +82,24 @@ struct Localization {
   bool localized;
 };
 
+/**
+ * \brief Per-frame degradation decided by the load controller when the frame
+ * enters the pipeline. Modules that support degraded operation read this from
+ * the query cache; the nominal values leave their behavior unchanged.
+ */
+struct LoadDecision {
+  /** \brief Current degradation level, 0 is nominal */
+  int level = 0;
+  /** \brief Multiplier on the preprocessing voxel/grid resolution (>= 1) */
+  float resolution_scale = 1.0;
+  /** \brief Multiplier on the maximum number of icp iterations (<= 1) */
+  float icp_iteration_scale = 1.0;
+  /** \brief Whether localization should be skipped for this frame */
+  bool skip_localization = false;
+  /** \brief Time at which the frame entered the pipeline */
+  std::chrono::steady_clock::time_point input_time =
+      std::chrono::steady_clock::now();
+};
+
 }  // namespace tactic
 }  // namespace vtr
\ No newline at end of file
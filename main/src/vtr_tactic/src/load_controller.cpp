@@ -0,0 +1,131 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file load_controller.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include "vtr_tactic/load_controller.hpp"
+
+#include "vtr_logging/logging.hpp"
+
+namespace vtr {
+namespace tactic {
+
+LoadController::LoadController(const Config &config)
+    : config_(config), max_level_((int)config.resolution_scales.size() - 1) {
+  if (config_.resolution_scales.empty() ||
+      config_.icp_iteration_scales.size() != config_.resolution_scales.size() ||
+      config_.localization_periods.size() != config_.resolution_scales.size()) {
+    std::string err{"LoadController: per-level settings must be non-empty "
+                    "and have the same size."};
+    CLOG(ERROR, "tactic") << err;
+    throw std::invalid_argument(err);
+  }
+}
+
+LoadDecision LoadController::decide(const size_t frames_in_flight) {
+  LoadDecision decision;
+  if (!config_.enabled) return decision;
+
+  LockGuard lock(mutex_);
+  update(stats_.frames_in_flight, (double)frames_in_flight);
+  ++stats_.num_frames;
+
+  const auto level = stats_.level;
+  decision.level = level;
+  decision.resolution_scale = config_.resolution_scales[level];
+  decision.icp_iteration_scale = config_.icp_iteration_scales[level];
+  const auto period = std::max(config_.localization_periods[level], 1);
+  decision.skip_localization = (localization_counter_++ % period) != 0;
+  return decision;
+}
+
+void LoadController::recordServiceTime(const Stage &stage, const double &ms) {
+  if (!config_.enabled) return;
+  LockGuard lock(mutex_);
+  update(stats_.service_time[(size_t)stage], ms);
+}
+
+void LoadController::recordQueueSize(const Stage &stage, const size_t &size) {
+  if (!config_.enabled) return;
+  LockGuard lock(mutex_);
+  update(stats_.queue_size[(size_t)stage], (double)size);
+}
+
+void LoadController::recordLocalizationSkipped() {
+  if (!config_.enabled) return;
+  LockGuard lock(mutex_);
+  ++stats_.num_localization_skipped;
+}
+
+void LoadController::recordOdometryLatency(const double &ms) {
+  if (!config_.enabled) return;
+  LockGuard lock(mutex_);
+  if (!latency_initialized_) {
+    stats_.odometry_latency = ms;
+    latency_initialized_ = true;
+  } else {
+    update(stats_.odometry_latency, ms);
+  }
+
+  if (++frames_since_change_ < config_.hold_frames) return;
+
+  const auto &budget = config_.odometry_latency_budget;
+  const bool overloaded =
+      stats_.odometry_latency > budget * config_.raise_ratio ||
+      stats_.frames_in_flight > config_.max_frames_in_flight;
+  const bool underloaded =
+      stats_.odometry_latency < budget * config_.lower_ratio &&
+      stats_.frames_in_flight <= config_.max_frames_in_flight / 2.0;
+
+  const auto prev_level = stats_.level;
+  if (overloaded && stats_.level < max_level_)
+    ++stats_.level;
+  else if (underloaded && stats_.level > 0)
+    --stats_.level;
+
+  if (stats_.level != prev_level) {
+    frames_since_change_ = 0;
+    ++stats_.num_level_changes;
+    CLOG(INFO, "tactic.load") << "Load level changed from " << prev_level
+                              << " to " << stats_.level << ", " << stats_;
+  }
+}
+
+auto LoadController::statistics() const -> Statistics {
+  LockGuard lock(mutex_);
+  return stats_;
+}
+
+void LoadController::update(double &average, const double &sample) const {
+  average = (1.0 - config_.smoothing) * average + config_.smoothing * sample;
+}
+
+std::ostream &operator<<(std::ostream &os,
+                         const LoadController::Statistics &stats) {
+  os << "level: " << stats.level
+     << ", odometry latency(ms): " << stats.odometry_latency
+     << ", service time(ms) [preprocessing, odometry_mapping, localization]: ["
+     << stats.service_time[0] << ", " << stats.service_time[1] << ", "
+     << stats.service_time[2] << "], queue size: [" << stats.queue_size[0]
+     << ", " << stats.queue_size[1] << ", " << stats.queue_size[2]
+     << "], frames in flight: " << stats.frames_in_flight
+     << ", frames: " << stats.num_frames
+     << ", localization skipped: " << stats.num_localization_skipped;
+  return os;
+}
+
+}  // namespace tactic
+}  // namespace vtr
@@ -28,10 +28,13 @@ BaseModule::BaseModule(const std::shared_ptr<ModuleFactory> &module_factory,
 BaseModule::~BaseModule() {
   CLOG(DEBUG, "tactic.module")
       << "\033[1;31mSummarizing module: " << name()
-      << ", count: " << count_.load() << ", time: " << timer_
+      << ", count: " << count_.load()
+      << ", async count: " << async_count_.load() << ", time: " << timer_
       << ", time(ms)/count: "
-      << (count_.load() > 0 ? (double)timer_.count() / (double)count_.load()
-                            : 0)
+      << (count_.load() + async_count_.load() > 0
+              ? (double)timer_.count() /
+                    (double)(count_.load() + async_count_.load())
+              : 0)
       << "\033[0m";
 }
 
@@ -46,6 +49,10 @@ void BaseModule::run(QueryCache &qdata, OutputCache &output,
   timer_.start();
   run_(qdata, output, graph, executor);
   timer_.stop();
+  if (qdata.module_timing)
+    qdata.module_timing->add(
+        name(), (double)timer.count<std::chrono::microseconds>() / 1000.0,
+        false);
   CLOG(DEBUG, "tactic.module")
       << "Finished running module: " << name() << ", which takes "
       << thread_timer << " / " << timer;
@@ -60,9 +67,15 @@ void BaseModule::runAsync(QueryCache &qdata, OutputCache &output,
       << "\033[1;31mRunning module (async): " << name() << "\033[0m";
   common::timing::Stopwatch timer;
   common::timing::Stopwatch<boost::chrono::thread_clock> thread_timer;
+  ++async_count_;
   timer_.start();
   runAsync_(qdata, output, graph, executor, priority, dep_id);
   timer_.stop();
+  // the task holds the query cache of the frame that dispatched it
+  if (qdata.module_timing)
+    qdata.module_timing->add(
+        name(), (double)timer.count<std::chrono::microseconds>() / 1000.0,
+        true);
   CLOG(DEBUG, "tactic.module")
       << "Finished running module (async): " << name() << ", which takes "
       << thread_timer << " / " << timer;
@@ -18,6 +18,7 @@
  */
 #include "vtr_tactic/pipeline_interface.hpp"
 
+#include "vtr_common/timing/stopwatch.hpp"
 #include "vtr_tactic/storables.hpp"
 
 namespace vtr {
@@ -27,11 +28,13 @@ PipelineInterface::PipelineInterface(
     const bool& enable_parallelization, const OutputCache::Ptr& output,
     const Graph::Ptr& graph, const size_t& num_async_threads,
     const size_t& async_queue_size,
-    const TaskQueueCallback::Ptr& task_queue_callback)
+    const TaskQueueCallback::Ptr& task_queue_callback,
+    const LoadController::Config& load_controller_config)
     : task_queue_(std::make_shared<TaskExecutor>(
           output, graph, num_async_threads, async_queue_size,
           task_queue_callback)),
-      enable_parallelization_(enable_parallelization) {
+      enable_parallelization_(enable_parallelization),
+      load_controller_(load_controller_config) {
   // clang-format off
   preprocessing_thread_ = std::thread(&PipelineInterface::preprocess, this);
   odometry_mapping_thread_ = std::thread(&PipelineInterface::runOdometryMapping, this);
@@ -80,25 +83,38 @@ void PipelineInterface::input(const QueryCache::Ptr& qdata) {
   }
 }
 
+void PipelineInterface::inputLockstep(const QueryCache::Ptr& qdata) {
+  PipelineLock lock(pipeline_mutex_);
+  lockstep_ = true;
+  if (enable_parallelization_)
+    inputParallel(qdata);
+  else
+    inputSequential(qdata);
+  // wait for the pipeline and the async task queue to be empty
+  pipeline_semaphore_.wait();
+  task_queue_->wait();
+}
+
 void PipelineInterface::inputSequential(const QueryCache::Ptr& qdata) {
   pipeline_semaphore_.release();
 
   CLOG(DEBUG, "tactic") << "Accepting a new frame: " << *qdata->stamp;
+  decideLoad(qdata);
   input_(qdata);
 
   CLOG(DEBUG, "tactic") << "Start running preprocessing: " << *qdata->stamp;
-  preprocess_(qdata);
+  timedPreprocess(qdata);
   CLOG(DEBUG, "tactic") << "Finish running preprocessing: " << *qdata->stamp;
 
   CLOG(DEBUG, "tactic") << "Start running odometry mapping, timestamp: "
                         << *qdata->stamp;
-  runOdometryMapping_(qdata);
+  timedOdometryMapping(qdata);
   CLOG(DEBUG, "tactic") << "Finish running odometry mapping, timestamp: "
                         << *qdata->stamp;
 
   CLOG(DEBUG, "tactic") << "Start running localization, timestamp: "
                         << *qdata->stamp;
-  runLocalization_(qdata);
+  timedLocalization(qdata);
   CLOG(DEBUG, "tactic") << "Finish running localization, timestamp: "
                         << *qdata->stamp;
 
@@ -108,7 +124,10 @@ void PipelineInterface::inputSequential(const QueryCache::Ptr& qdata) {
 void PipelineInterface::inputParallel(const QueryCache::Ptr& qdata) {
   pipeline_semaphore_.release();
   CLOG(DEBUG, "tactic") << "Accepting a new frame: " << *qdata->stamp;
-  const bool discardable = input_(qdata);
+  decideLoad(qdata);
+  const bool discardable = input_(qdata) && !lockstep_;
+  load_controller_.recordQueueSize(LoadController::Stage::Preprocessing,
+                                   preprocessing_buffer_.size());
   const bool discarded = preprocessing_buffer_.push(qdata, discardable);
   CLOG_IF(discarded, WARNING, "tactic")
       << "[input] Buffer is full, one frame discarded.";
@@ -122,7 +141,9 @@ void PipelineInterface::preprocess() {
     if (qdata == nullptr) return;
     CLOG(DEBUG, "tactic") << "Start running preprocessing, timestamp: "
                           << *qdata->stamp;
-    const bool discardable = preprocess_(qdata);
+    const bool discardable = timedPreprocess(qdata) && !lockstep_;
+    load_controller_.recordQueueSize(LoadController::Stage::OdometryMapping,
+                                     odometry_mapping_buffer_.size());
     const bool discarded = odometry_mapping_buffer_.push(qdata, discardable);
     CLOG_IF(discarded, WARNING, "tactic")
         << "[preprocess] Buffer is full, one frame discarded.";
@@ -140,7 +161,9 @@ void PipelineInterface::runOdometryMapping() {
     if (qdata == nullptr) return;
     CLOG(DEBUG, "tactic") << "Start running odometry mapping, timestamp: "
                           << *qdata->stamp;
-    const bool discardable = runOdometryMapping_(qdata);
+    const bool discardable = timedOdometryMapping(qdata) && !lockstep_;
+    load_controller_.recordQueueSize(LoadController::Stage::Localization,
+                                     localization_buffer_.size());
     const bool discarded = localization_buffer_.push(qdata, discardable);
     CLOG_IF(discarded, WARNING, "tactic")
         << "[odometry_mapping] Buffer is full, one frame discarded.";
@@ -158,12 +181,56 @@ void PipelineInterface::runLocalization() {
     if (qdata == nullptr) return;
     CLOG(DEBUG, "tactic") << "Start running localization, timestamp: "
                           << *qdata->stamp;
-    runLocalization_(qdata);
+    timedLocalization(qdata);
     CLOG(DEBUG, "tactic") << "Finish running localization, timestamp: "
                           << *qdata->stamp;
     pipeline_semaphore_.acquire();
   }
 }
 
+void PipelineInterface::decideLoad(const QueryCache::Ptr& qdata) {
+  if (!load_controller_.enabled() || qdata->load_decision) return;
+  // the semaphore counts the frames in the pipeline including this one
+  qdata->load_decision.emplace(
+      load_controller_.decide(pipeline_semaphore_.get_value()));
+}
+
+bool PipelineInterface::timedPreprocess(const QueryCache::Ptr& qdata) {
+  common::timing::Stopwatch timer;
+  const bool discardable = preprocess_(qdata);
+  load_controller_.recordServiceTime(
+      LoadController::Stage::Preprocessing,
+      (double)timer.count<std::chrono::microseconds>() / 1000.0);
+  return discardable;
+}
+
+bool PipelineInterface::timedOdometryMapping(const QueryCache::Ptr& qdata) {
+  common::timing::Stopwatch timer;
+  const bool discardable = runOdometryMapping_(qdata);
+  load_controller_.recordServiceTime(
+      LoadController::Stage::OdometryMapping,
+      (double)timer.count<std::chrono::microseconds>() / 1000.0);
+  if (qdata->load_decision) {
+    const auto latency = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - qdata->load_decision->input_time);
+    load_controller_.recordOdometryLatency(latency.count());
+  }
+  return discardable;
+}
+
+void PipelineInterface::timedLocalization(const QueryCache::Ptr& qdata) {
+  if (qdata->load_decision && qdata->load_decision->skip_localization) {
+    CLOG(DEBUG, "tactic") << "Skipping localization due to load, timestamp: "
+                          << *qdata->stamp;
+    load_controller_.recordLocalizationSkipped();
+    return;
+  }
+  common::timing::Stopwatch timer;
+  runLocalization_(qdata);
+  load_controller_.recordServiceTime(
+      LoadController::Stage::Localization,
+      (double)timer.count<std::chrono::microseconds>() / 1000.0);
+}
+
 }  // namespace tactic
 }  // namespace vtr
\ No newline at end of file
@@ -38,6 +38,20 @@ auto Tactic::Config::fromROS(const rclcpp::Node::SharedPtr& node,
 
   config->route_completion_translation_threshold = node->declare_parameter<double>(prefix+".route_completion_translation_threshold", 0.5);
 
+  /// setup load controller
+  auto& load = config->load_controller;
+  load.enabled = node->declare_parameter<bool>(prefix+".load_controller.enabled", load.enabled);
+  load.odometry_latency_budget = node->declare_parameter<double>(prefix+".load_controller.odometry_latency_budget", load.odometry_latency_budget);
+  load.raise_ratio = node->declare_parameter<double>(prefix+".load_controller.raise_ratio", load.raise_ratio);
+  load.lower_ratio = node->declare_parameter<double>(prefix+".load_controller.lower_ratio", load.lower_ratio);
+  load.max_frames_in_flight = node->declare_parameter<double>(prefix+".load_controller.max_frames_in_flight", load.max_frames_in_flight);
+  load.smoothing = node->declare_parameter<double>(prefix+".load_controller.smoothing", load.smoothing);
+  load.hold_frames = node->declare_parameter<int>(prefix+".load_controller.hold_frames", load.hold_frames);
+  load.resolution_scales = node->declare_parameter<std::vector<double>>(prefix+".load_controller.resolution_scales", load.resolution_scales);
+  load.icp_iteration_scales = node->declare_parameter<std::vector<double>>(prefix+".load_controller.icp_iteration_scales", load.icp_iteration_scales);
+  const auto periods = node->declare_parameter<std::vector<int64_t>>(prefix+".load_controller.localization_periods", std::vector<int64_t>(load.localization_periods.begin(), load.localization_periods.end()));
+  load.localization_periods = std::vector<int>(periods.begin(), periods.end());
+
   /// setup localization chain
   config->chain_config.min_cusp_distance = node->declare_parameter<double>(prefix+".chain.min_cusp_distance", 1.5);
   config->chain_config.angle_weight = node->declare_parameter<double>(prefix+".chain.angle_weight", 7.0);
@@ -58,7 +72,7 @@ Tactic::Tactic(Config::UniquePtr config, const BasePipeline::Ptr& pipeline,
                const TaskQueueCallback::Ptr& task_queue_callback)
     : PipelineInterface(config->enable_parallelization, output, graph,
                         config->task_queue_num_threads, config->task_queue_size,
-                        task_queue_callback),
+                        task_queue_callback, config->load_controller),
       config_(std::move(config)),
       pipeline_(pipeline),
       output_(output),
@@ -0,0 +1,131 @@
+// Copyright 2021, Autonomous Space Robotics Lab (ASRL)
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * \file test_load_controller.cpp
+ * \author Yuchen Wu, Autonomous Space Robotics Lab (ASRL)
+ */
+#include <gtest/gtest.h>
+
+#include "vtr_logging/logging_init.hpp"
+#include "vtr_tactic/load_controller.hpp"
+
+using namespace ::testing;
+using namespace vtr;
+using namespace vtr::logging;
+using namespace vtr::tactic;
+
+namespace {
+
+LoadController::Config makeConfig() {
+  LoadController::Config config;
+  config.enabled = true;
+  config.odometry_latency_budget = 100.0;
+  config.smoothing = 1.0;  // no smoothing to make the test deterministic
+  config.hold_frames = 2;
+  config.resolution_scales = {1.0, 1.5, 2.0};
+  config.icp_iteration_scales = {1.0, 0.5, 0.25};
+  config.localization_periods = {1, 2, 3};
+  return config;
+}
+
+void runFrames(LoadController& controller, const int num,
+               const double latency) {
+  for (int i = 0; i < num; ++i) {
+    controller.decide(1);
+    controller.recordOdometryLatency(latency);
+  }
+}
+
+}  // namespace
+
+TEST(TacticLoadController, disabled_controller_is_nominal) {
+  LoadController controller;
+  for (int i = 0; i < 10; ++i) {
+    const auto decision = controller.decide(10);
+    controller.recordOdometryLatency(1000.0);
+    EXPECT_EQ(decision.level, 0);
+    EXPECT_EQ(decision.resolution_scale, 1.0);
+    EXPECT_EQ(decision.icp_iteration_scale, 1.0);
+    EXPECT_FALSE(decision.skip_localization);
+  }
+  EXPECT_EQ(controller.statistics().level, 0);
+}
+
+TEST(TacticLoadController, raise_and_lower_level_with_hysteresis) {
+  LoadController controller(makeConfig());
+
+  // within budget, stays nominal
+  runFrames(controller, 10, 50.0);
+  EXPECT_EQ(controller.statistics().level, 0);
+
+  // over budget, level raised once every hold_frames frames up to max
+  runFrames(controller, 2, 150.0);
+  EXPECT_EQ(controller.statistics().level, 1);
+  runFrames(controller, 2, 150.0);
+  EXPECT_EQ(controller.statistics().level, 2);
+  runFrames(controller, 10, 150.0);
+  EXPECT_EQ(controller.statistics().level, 2);
+
+  // between lower and raise thresholds, level is kept
+  runFrames(controller, 10, 80.0);
+  EXPECT_EQ(controller.statistics().level, 2);
+
+  // well within budget, level lowered back to nominal
+  runFrames(controller, 4, 10.0);
+  EXPECT_EQ(controller.statistics().level, 0);
+  EXPECT_EQ(controller.statistics().num_level_changes, (size_t)4);
+}
+
+TEST(TacticLoadController, decision_follows_level) {
+  LoadController controller(makeConfig());
+  runFrames(controller, 4, 150.0);
+  ASSERT_EQ(controller.statistics().level, 2);
+
+  int skipped = 0;
+  for (int i = 0; i < 9; ++i) {
+    const auto decision = controller.decide(1);
+    EXPECT_EQ(decision.level, 2);
+    EXPECT_EQ(decision.resolution_scale, 2.0);
+    EXPECT_EQ(decision.icp_iteration_scale, 0.25);
+    if (decision.skip_localization) {
+      ++skipped;
+      controller.recordLocalizationSkipped();
+    }
+  }
+  // localization runs once every 3 frames
+  EXPECT_EQ(skipped, 6);
+  EXPECT_EQ(controller.statistics().num_localization_skipped, (size_t)6);
+}
+
+TEST(TacticLoadController, queue_buildup_raises_level) {
+  LoadController controller(makeConfig());
+  for (int i = 0; i < 2; ++i) {
+    controller.decide(5);
+    controller.recordOdometryLatency(10.0);
+  }
+  EXPECT_EQ(controller.statistics().level, 1);
+}
+
+TEST(TacticLoadController, inconsistent_config_throws) {
+  auto config = makeConfig();
+  config.localization_periods = {1};
+  EXPECT_THROW(LoadController controller(config), std::invalid_argument);
+}
+
+int main(int argc, char** argv) {
+  configureLogging("", true);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}